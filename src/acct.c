@@ -22,7 +22,8 @@
 /* includes */
 #include "pmacct.h"
 #include "imt_plugin.h"
-#include "crc32.h"
+#include "imt_sidx.h"
+#include "cache_hash.h"
 #include "bgp/bgp.h"
 
 /* functions */
@@ -37,9 +38,7 @@ struct acc *search_accounting_structure(struct primitives_ptrs *prim_ptrs)
   struct pkt_tunnel_primitives *ptun = prim_ptrs->ptun;
   u_char *pcust = prim_ptrs->pcust;
   //struct pkt_vlen_hdr_primitives *pvlen = prim_ptrs->pvlen;
-  struct acc *elem_acc;
-  unsigned int hash, pos;
-  unsigned int pp_size = sizeof(struct pkt_primitives); 
+  unsigned int hash;
   unsigned int pb_size = sizeof(struct pkt_bgp_primitives);
   unsigned int plb_size = sizeof(struct pkt_legacy_bgp_primitives);
   unsigned int pn_size = sizeof(struct pkt_nat_primitives);
@@ -47,29 +46,21 @@ struct acc *search_accounting_structure(struct primitives_ptrs *prim_ptrs)
   unsigned int pt_size = sizeof(struct pkt_tunnel_primitives);
   unsigned int pc_size = config.cpptrs.len;
 
-  hash = cache_crc32((unsigned char *)addr, pp_size);
-  if (pbgp) hash ^= cache_crc32((unsigned char *)pbgp, pb_size);
-  if (plbgp) hash ^= cache_crc32((unsigned char *)plbgp, plb_size);
-  if (pnat) hash ^= cache_crc32((unsigned char *)pnat, pn_size);
-  if (pmpls) hash ^= cache_crc32((unsigned char *)pmpls, pm_size);
-  if (ptun) hash ^= cache_crc32((unsigned char *)ptun, pt_size);
-  if (pcust && pc_size) hash ^= cache_crc32((unsigned char *)pcust, pc_size);
-  // if (pvlen) hash ^= cache_crc32((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
-  pos = hash % config.buckets;
-
-  Log(LOG_DEBUG, "DEBUG ( %s/%s ): Selecting bucket %u.\n", config.name, config.type, pos);
+  hash = cache_hash_primitives(addr);
+  if (pbgp) hash ^= cache_hash((unsigned char *)pbgp, pb_size);
+  if (plbgp) hash ^= cache_hash((unsigned char *)plbgp, plb_size);
+  if (pnat) hash ^= cache_hash((unsigned char *)pnat, pn_size);
+  if (pmpls) hash ^= cache_hash((unsigned char *)pmpls, pm_size);
+  if (ptun) hash ^= cache_hash((unsigned char *)ptun, pt_size);
+  if (pcust && pc_size) hash ^= cache_hash((unsigned char *)pcust, pc_size);
+  // if (pvlen) hash ^= cache_hash((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
 
-  elem_acc = (struct acc *) a;
-  elem_acc += pos;  
-  
-  while (elem_acc) {
-    if (elem_acc->signature == hash) {
-      if (compare_accounting_structure(elem_acc, prim_ptrs) == 0) return elem_acc;
-    }
-    elem_acc = elem_acc->next;
-  } 
+  return cache_index_search(&imt_index, hash, imt_index_cmp, prim_ptrs);
+}
 
-  return NULL;
+int imt_index_cmp(void *elem, void *prim_ptrs)
+{
+  return compare_accounting_structure(elem, prim_ptrs);
 }
 
 int compare_accounting_structure(struct acc *elem, struct primitives_ptrs *prim_ptrs)
@@ -131,10 +122,8 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
   u_char *pcust = prim_ptrs->pcust;
   struct pkt_vlen_hdr_primitives *pvlen = prim_ptrs->pvlen;
   struct acc *elem_acc;
-  unsigned char *elem, *new_elem;
-  int solved = FALSE;
+  unsigned char *new_elem;
   unsigned int hash, pos;
-  unsigned int pp_size = sizeof(struct pkt_primitives);
   unsigned int pb_size = sizeof(struct pkt_bgp_primitives);
   unsigned int plb_size = sizeof(struct pkt_legacy_bgp_primitives);
   unsigned int pn_size = sizeof(struct pkt_nat_primitives);
@@ -143,306 +132,193 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
   unsigned int pc_size = config.cpptrs.len;
   unsigned int clb_size = sizeof(struct cache_legacy_bgp_primitives);
 
-  elem = a;
-
-  hash = cache_crc32((unsigned char *)addr, pp_size);
-  if (pbgp) hash ^= cache_crc32((unsigned char *)pbgp, pb_size);
-  if (plbgp) hash ^= cache_crc32((unsigned char *)plbgp, plb_size);
-  if (pnat) hash ^= cache_crc32((unsigned char *)pnat, pn_size);
-  if (pmpls) hash ^= cache_crc32((unsigned char *)pmpls, pm_size);
-  if (ptun) hash ^= cache_crc32((unsigned char *)ptun, pt_size);
-  if (pcust && pc_size) hash ^= cache_crc32((unsigned char *)pcust, pc_size);
-  // if (pvlen) hash ^= cache_crc32((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
+  hash = cache_hash_primitives(addr);
+  if (pbgp) hash ^= cache_hash((unsigned char *)pbgp, pb_size);
+  if (plbgp) hash ^= cache_hash((unsigned char *)plbgp, plb_size);
+  if (pnat) hash ^= cache_hash((unsigned char *)pnat, pn_size);
+  if (pmpls) hash ^= cache_hash((unsigned char *)pmpls, pm_size);
+  if (ptun) hash ^= cache_hash((unsigned char *)ptun, pt_size);
+  if (pcust && pc_size) hash ^= cache_hash((unsigned char *)pcust, pc_size);
+  // if (pvlen) hash ^= cache_hash((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
   pos = hash % config.buckets;
       
-  Log(LOG_DEBUG, "DEBUG ( %s/%s ): Selecting bucket %u.\n", config.name, config.type, pos);
-  /* 
-     1st stage: compare data with last used element;
-     2nd stage: compare data with elements in the table, following chains
+  /*
+     Lookups go through the index: buckets and their chains are just the
+     storage, walked by the query server when serving full-table requests
   */
-  if (lru_elem_ptr[pos]) {
-    elem_acc = lru_elem_ptr[pos];
-    if (elem_acc->signature == hash) {
-      if (compare_accounting_structure(elem_acc, prim_ptrs) == 0) { 
-        if (elem_acc->reset_flag) reset_counters(elem_acc);
-        elem_acc->packet_counter += data->pkt_num;
-        elem_acc->flow_counter += data->flo_num;
-        elem_acc->bytes_counter += data->pkt_len;
-	elem_acc->tcp_flags |= data->tcp_flags;
-	elem_acc->tunnel_tcp_flags |= data->tunnel_tcp_flags;
-        elem_acc->flow_type = data->flow_type; 
-
-        return;
-      }
-    }
+  elem_acc = cache_index_search(&imt_index, hash, imt_index_cmp, prim_ptrs);
+  if (elem_acc) {
+    if (elem_acc->reset_flag) reset_counters(elem_acc);
+    elem_acc->packet_counter += data->pkt_num;
+    elem_acc->flow_counter += data->flo_num;
+    elem_acc->bytes_counter += data->pkt_len;
+    elem_acc->tcp_flags |= data->tcp_flags;
+    elem_acc->tunnel_tcp_flags |= data->tunnel_tcp_flags;
+    elem_acc->flow_type = data->flow_type;
+    imt_topn_update(elem_acc);
+
+    return;
   }
 
-  elem_acc = (struct acc *) elem;
-  elem_acc += pos;
+  Log(LOG_DEBUG, "DEBUG ( %s/%s ): Selecting bucket %u.\n", config.name, config.type, pos);
 
-  while (solved == FALSE) {
-    if (elem_acc->signature == hash) {
-      if (compare_accounting_structure(elem_acc, prim_ptrs) == 0) {
-        if (elem_acc->reset_flag) reset_counters(elem_acc);
-        elem_acc->packet_counter += data->pkt_num;
-        elem_acc->flow_counter += data->flo_num;
-        elem_acc->bytes_counter += data->pkt_len;
-	elem_acc->tcp_flags |= data->tcp_flags;
-	elem_acc->tunnel_tcp_flags |= data->tunnel_tcp_flags;
-        elem_acc->flow_type = data->flow_type;
-        lru_elem_ptr[pos] = elem_acc;
+  elem_acc = (struct acc *) a;
+  elem_acc += pos;
 
+  /* a bucket not in use (yet) is taken over, otherwise a new element is chained right after it */
+  if (!elem_acc->bytes_counter && !elem_acc->packet_counter) { /* hmmm */
+    cache_index_delete(&imt_index, elem_acc->signature, elem_acc);
+    imt_sidx_delete(elem_acc);
+  }
+  else {
+    /* We have to know if there is enough space for a new element;
+       if not we are losing informations; conservative approach */
+    if (no_more_space) return;
+
+    /* We have to allocate new space for this address */
+    Log(LOG_DEBUG, "DEBUG ( %s/%s ): Creating new element.\n", config.name, config.type);
+
+    if (current_pool->space_left < sizeof(struct acc)) {
+      current_pool = request_memory_pool(config.memory_pool_size);
+      if (current_pool == NULL) {
+        Log(LOG_WARNING, "WARN ( %s/%s ): Unable to allocate more memory pools, clear stats manually!\n", config.name, config.type);
+        no_more_space = TRUE;
         return;
       }
     }
-    if (!elem_acc->bytes_counter && !elem_acc->packet_counter) { /* hmmm */
-      if (elem_acc->reset_flag) elem_acc->reset_flag = FALSE; 
-      memcpy(&elem_acc->primitives, addr, sizeof(struct pkt_primitives));
-
-      if (pbgp) {
-        if (!elem_acc->pbgp) {
-          elem_acc->pbgp = (struct pkt_bgp_primitives *) malloc(pb_size);
-          if (!elem_acc->pbgp) {
-            Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-            exit_gracefully(1);
-          }
-        }
-        memcpy(elem_acc->pbgp, pbgp, pb_size);
-      }
-      else {
-        if (elem_acc->pbgp) free(elem_acc->pbgp);
-        elem_acc->pbgp = NULL;
-      }
 
-      if (plbgp) {
-        if (!elem_acc->clbgp) {
-          elem_acc->clbgp = (struct cache_legacy_bgp_primitives *) malloc(clb_size);
-          if (!elem_acc->clbgp) {
-            Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-            exit_gracefully(1);
-          }
-        }
-
-        memset(elem_acc->clbgp, 0, clb_size);
-        pkt_to_cache_legacy_bgp_primitives(elem_acc->clbgp, plbgp, config.what_to_count, config.what_to_count_2, config.what_to_count_3);
-      }
-      else free_cache_legacy_bgp_primitives(&elem_acc->clbgp);
-
-      if (pnat) {
-	if (!elem_acc->pnat) {
-	  elem_acc->pnat = (struct pkt_nat_primitives *) malloc(pn_size);
-	  if (!elem_acc->pnat) {
-            Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-            exit_gracefully(1);
-	  }
-	}
-	memcpy(elem_acc->pnat, pnat, pn_size);
-      }
-      else {
-	if (elem_acc->pnat) free(elem_acc->pnat);
-	elem_acc->pnat = NULL;
-      }
+    new_elem = current_pool->ptr;
+    current_pool->space_left -= sizeof(struct acc);
+    current_pool->ptr += sizeof(struct acc);
 
-      if (pmpls) {
-	if (!elem_acc->pmpls) {
-	  elem_acc->pmpls = (struct pkt_mpls_primitives *) malloc(pm_size);
-	  if (!elem_acc->pmpls) {
-            Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-            exit_gracefully(1);
-	  }
-	}
-        memcpy(elem_acc->pmpls, pmpls, pm_size);
-      }
-      else {
-	if (elem_acc->pmpls) free(elem_acc->pmpls);
-	elem_acc->pmpls = NULL;
-      }
+    ((struct acc *) new_elem)->next = elem_acc->next;
+    elem_acc->next = (struct acc *) new_elem;
+    elem_acc = (struct acc *) new_elem;
+  }
 
-      if (ptun) {
-	if (!elem_acc->ptun) {
-	  elem_acc->ptun = (struct pkt_tunnel_primitives *) malloc(pt_size);
-	  if (!elem_acc->ptun) {
-            Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-            exit_gracefully(1);
-	  }
-	}
-	memcpy(elem_acc->ptun, ptun, pt_size);
-      }
-      else {
-	if (elem_acc->ptun) free(elem_acc->ptun);
-	elem_acc->ptun = NULL;
-      }
+  if (elem_acc->reset_flag) elem_acc->reset_flag = FALSE; 
+  memcpy(&elem_acc->primitives, addr, sizeof(struct pkt_primitives));
 
-      if (pcust) {
-	if (!elem_acc->pcust) {
-	  elem_acc->pcust = malloc(pc_size);
-	  if (!elem_acc->pcust) {
-            Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-            exit_gracefully(1);
-	  }
-	}
-        memcpy(elem_acc->pcust, pcust, pc_size);
-      }
-      else {
-	if (elem_acc->pcust) free(elem_acc->pcust);
-	elem_acc->pcust = NULL;
+  if (pbgp) {
+    if (!elem_acc->pbgp) {
+      elem_acc->pbgp = (struct pkt_bgp_primitives *) malloc(pb_size);
+      if (!elem_acc->pbgp) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
+        exit_gracefully(1);
       }
+    }
+    memcpy(elem_acc->pbgp, pbgp, pb_size);
+  }
+  else {
+    if (elem_acc->pbgp) free(elem_acc->pbgp);
+    elem_acc->pbgp = NULL;
+  }
 
-      /* if we have a pvlen from before let's free it up due to the vlen nature of the memory area */
-      if (elem_acc->pvlen) {
-        vlen_prims_free(elem_acc->pvlen);
-        elem_acc->pvlen = NULL;
+  if (plbgp) {
+    if (!elem_acc->clbgp) {
+      elem_acc->clbgp = (struct cache_legacy_bgp_primitives *) malloc(clb_size);
+      if (!elem_acc->clbgp) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
+        exit_gracefully(1);
       }
+    }
 
-      if (pvlen) {
-        if (!elem_acc->pvlen) {
-          elem_acc->pvlen = (struct pkt_vlen_hdr_primitives *) vlen_prims_copy(pvlen);
-          if (!elem_acc->pvlen) {
-            Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-            exit_gracefully(1);
-          }
-        }
+    memset(elem_acc->clbgp, 0, clb_size);
+    pkt_to_cache_legacy_bgp_primitives(elem_acc->clbgp, plbgp, config.what_to_count, config.what_to_count_2, config.what_to_count_3);
+  }
+  else free_cache_legacy_bgp_primitives(&elem_acc->clbgp);
+
+  if (pnat) {
+    if (!elem_acc->pnat) {
+      elem_acc->pnat = (struct pkt_nat_primitives *) malloc(pn_size);
+      if (!elem_acc->pnat) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
+        exit_gracefully(1);
       }
-
-      elem_acc->packet_counter += data->pkt_num;
-      elem_acc->flow_counter += data->flo_num;
-      elem_acc->bytes_counter += data->pkt_len;
-      elem_acc->tcp_flags |= data->tcp_flags;
-      elem_acc->tunnel_tcp_flags |= data->tunnel_tcp_flags;
-      elem_acc->flow_type = data->flow_type;
-      elem_acc->signature = hash;
-      lru_elem_ptr[pos] = elem_acc;
-
-      return;
     }
+    memcpy(elem_acc->pnat, pnat, pn_size);
+  }
+  else {
+    if (elem_acc->pnat) free(elem_acc->pnat);
+    elem_acc->pnat = NULL;
+  }
 
-    /* Handling collisions */
-    else if (elem_acc->next != NULL) {
-      Log(LOG_DEBUG, "DEBUG ( %s/%s ): Walking through the collision-chain.\n", config.name, config.type);
-      elem_acc = elem_acc->next;
-      solved = FALSE;
-    }
-    else if (elem_acc->next == NULL) {
-      /* We have to know if there is enough space for a new element;
-         if not we are losing informations; conservative approach */
-      if (no_more_space) return;
-
-      /* We have to allocate new space for this address */
-      Log(LOG_DEBUG, "DEBUG ( %s/%s ): Creating new element.\n", config.name, config.type);
-
-      if (current_pool->space_left >= sizeof(struct acc)) {
-        new_elem = current_pool->ptr;
-	current_pool->space_left -= sizeof(struct acc);
-	current_pool->ptr += sizeof(struct acc);
-      }
-      else {
-        current_pool = request_memory_pool(config.memory_pool_size); 
-	if (current_pool == NULL) {
-          Log(LOG_WARNING, "WARN ( %s/%s ): Unable to allocate more memory pools, clear stats manually!\n", config.name, config.type);
-	  no_more_space = TRUE;
-	  return;
-        }
-        else {
-          new_elem = current_pool->ptr;
-          current_pool->space_left -= sizeof(struct acc);
-          current_pool->ptr += sizeof(struct acc);
-	}
+  if (pmpls) {
+    if (!elem_acc->pmpls) {
+      elem_acc->pmpls = (struct pkt_mpls_primitives *) malloc(pm_size);
+      if (!elem_acc->pmpls) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
+        exit_gracefully(1);
       }
+    }
+    memcpy(elem_acc->pmpls, pmpls, pm_size);
+  }
+  else {
+    if (elem_acc->pmpls) free(elem_acc->pmpls);
+    elem_acc->pmpls = NULL;
+  }
 
-      elem_acc->next = (struct acc *) new_elem;
-      elem_acc = (struct acc *) new_elem;
-      memcpy(&elem_acc->primitives, addr, sizeof(struct pkt_primitives));
-
-      if (pbgp) {
-        elem_acc->pbgp = (struct pkt_bgp_primitives *) malloc(pb_size);
-        if (!elem_acc->pbgp) {
-          Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-          exit_gracefully(1);
-        }
-        memcpy(elem_acc->pbgp, pbgp, pb_size);
-      }
-      else elem_acc->pbgp = NULL;
-
-      if (plbgp) {
-        elem_acc->clbgp = (struct cache_legacy_bgp_primitives *) malloc(clb_size);
-        if (!elem_acc->clbgp) {
-          Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-          exit_gracefully(1);
-        }
-        memset(elem_acc->clbgp, 0, clb_size);
-        pkt_to_cache_legacy_bgp_primitives(elem_acc->clbgp, plbgp, config.what_to_count, config.what_to_count_2, config.what_to_count_3);
-      }
-      else elem_acc->clbgp = NULL;
-
-      if (pnat) {
-        elem_acc->pnat = (struct pkt_nat_primitives *) malloc(pn_size);
-	if (!elem_acc->pnat) {
-          Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-          exit_gracefully(1);
-	}
-        memcpy(elem_acc->pnat, pnat, pn_size);
+  if (ptun) {
+    if (!elem_acc->ptun) {
+      elem_acc->ptun = (struct pkt_tunnel_primitives *) malloc(pt_size);
+      if (!elem_acc->ptun) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
+        exit_gracefully(1);
       }
-      else elem_acc->pnat = NULL;
-
-      if (pmpls) {
-        elem_acc->pmpls = (struct pkt_mpls_primitives *) malloc(pm_size);
-	if (!elem_acc->pmpls) {
-          Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-          exit_gracefully(1);
-	}
-        memcpy(elem_acc->pmpls, pmpls, pm_size);
-      }
-      else elem_acc->pmpls = NULL;
-
-      if (ptun) {
-        elem_acc->ptun = (struct pkt_tunnel_primitives *) malloc(pt_size);
-	if (!elem_acc->ptun) {
-          Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-          exit_gracefully(1);
-	}
-        memcpy(elem_acc->ptun, ptun, pt_size);
-      }
-      else elem_acc->ptun = NULL;
-
-      if (pcust) {
-        elem_acc->pcust = malloc(pc_size);
-	if (!elem_acc->pcust) {
-          Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-          exit_gracefully(1);
-	}
-        memcpy(elem_acc->pcust, pcust, pc_size);
-      }
-      else elem_acc->pcust = NULL;
+    }
+    memcpy(elem_acc->ptun, ptun, pt_size);
+  }
+  else {
+    if (elem_acc->ptun) free(elem_acc->ptun);
+    elem_acc->ptun = NULL;
+  }
 
-      /* if we have a pvlen from before let's free it up due to the vlen nature of the memory area */
-      if (elem_acc->pvlen) {
-        vlen_prims_free(elem_acc->pvlen);
-        elem_acc->pvlen = NULL;
+  if (pcust) {
+    if (!elem_acc->pcust) {
+      elem_acc->pcust = malloc(pc_size);
+      if (!elem_acc->pcust) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
+        exit_gracefully(1);
       }
+    }
+    memcpy(elem_acc->pcust, pcust, pc_size);
+  }
+  else {
+    if (elem_acc->pcust) free(elem_acc->pcust);
+    elem_acc->pcust = NULL;
+  }
 
-      if (pvlen) {
-        if (!elem_acc->pvlen) {
-          elem_acc->pvlen = (struct pkt_vlen_hdr_primitives *) vlen_prims_copy(pvlen);
-          if (!elem_acc->pvlen) {
-            Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
-            exit_gracefully(1);
-          }
-        }
-      }
+  /* if we have a pvlen from before let's free it up due to the vlen nature of the memory area */
+  if (elem_acc->pvlen) {
+    vlen_prims_free(elem_acc->pvlen);
+    elem_acc->pvlen = NULL;
+  }
 
-      elem_acc->packet_counter += data->pkt_num;
-      elem_acc->flow_counter += data->flo_num;
-      elem_acc->bytes_counter += data->pkt_len;
-      elem_acc->tcp_flags = data->tcp_flags;
-      elem_acc->tunnel_tcp_flags = data->tunnel_tcp_flags;
-      elem_acc->flow_type = data->flow_type;
-      elem_acc->signature = hash; 
-      elem_acc->next = NULL;
-      lru_elem_ptr[pos] = elem_acc;
-
-      return;
+  if (pvlen) {
+    if (!elem_acc->pvlen) {
+      elem_acc->pvlen = (struct pkt_vlen_hdr_primitives *) vlen_prims_copy(pvlen);
+      if (!elem_acc->pvlen) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (insert_accounting_structure). Exiting ..\n", config.name, config.type);
+        exit_gracefully(1);
+      }
     }
   }
+
+  elem_acc->packet_counter += data->pkt_num;
+  elem_acc->flow_counter += data->flo_num;
+  elem_acc->bytes_counter += data->pkt_len;
+  elem_acc->tcp_flags |= data->tcp_flags;
+  elem_acc->tunnel_tcp_flags |= data->tunnel_tcp_flags;
+  elem_acc->flow_type = data->flow_type;
+  elem_acc->signature = hash;
+
+  if (cache_index_insert(&imt_index, hash, elem_acc) == ERR) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): Unable to grow the table index, clear stats manually!\n", config.name, config.type);
+    no_more_space = TRUE;
+  }
+
+  imt_sidx_insert(elem_acc);
+  imt_topn_update(elem_acc);
 }
 
 void set_reset_flag(struct acc *elem)
@@ -459,4 +335,5 @@ void reset_counters(struct acc *elem)
   elem->tunnel_tcp_flags = 0;
   elem->flow_type = 0;
   memcpy(&elem->rstamp, &cycle_stamp, sizeof(struct timeval));
+  imt_topn_update(elem);
 }
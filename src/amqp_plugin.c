@@ -279,12 +279,14 @@ void amqp_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
           if (seq == 0) rg_err_count = FALSE;
         }
         else {
-          if ((ret = read(pipe_fd, &rgptr, sizeof(rgptr))) == 0) 
+          if ((ret = plugin_pipe_read(pipe_fd, &rgptr)) == 0) 
 	    exit_gracefully(1); /* we exit silently; something happened at the write end */
         }
 
         if ((rg->ptr + bufsz) > rg->end) rg->ptr = rg->base;
 
+        if (!pollagain) plugin_pipe_spin(rg->ptr, seq);
+
         if (((struct ch_buf_hdr *)rg->ptr)->seq != seq) {
           if (!pollagain) {
             pollagain = TRUE;
@@ -300,12 +302,14 @@ void amqp_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
             }
 
 	    rg->ptr = (rg->base + status->last_buf_off);
+	    plugin_pipe_resync(status);
             seq = ((struct ch_buf_hdr *)rg->ptr)->seq;
           }
         }
 
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
+        status->tail++;
         rg->ptr += bufsz;
       }
 #ifdef WITH_ZMQ
@@ -386,6 +390,9 @@ void amqp_cache_purge(struct chained_cache *queue[], int index, int safe_action)
   int j, stop, is_routing_key_dyn = FALSE, qn = 0, ret, saved_index = index;
   int mv_num = 0, mv_num_save = 0;
   time_t start, duration;
+  struct timeval stage;
+  u_int64_t stage_prep, stage_enc, stage_out;
+  char **encoded = NULL;
   struct primitives_ptrs prim_ptrs;
   struct pkt_data dummy_data;
   pid_t writer_pid = getpid();
@@ -469,9 +476,13 @@ void amqp_cache_purge(struct chained_cache *queue[], int index, int safe_action)
   ret = p_amqp_connect_to_publish(&amqpp_amqp_host);
   if (ret) return;
 
+  gettimeofday(&stage, NULL);
+
   for (j = 0, stop = 0; (!stop) && P_preprocess_funcs[j]; j++)
     stop = P_preprocess_funcs[j](queue, &index, j);
 
+  stage_prep = P_purge_stage_msec(&stage);
+
   Log(LOG_INFO, "INFO ( %s/%s ): *** Purging cache - START (PID: %u) ***\n", config.name, config.type, writer_pid);
   start = time(NULL);
 
@@ -549,6 +560,12 @@ void amqp_cache_purge(struct chained_cache *queue[], int index, int safe_action)
     }
   }
 
+  if (config.message_broker_output & PRINT_OUTPUT_JSON) {
+    encoded = P_encode_queue(queue, index, compose_json_acct_str, &writer_id_tokens);
+  }
+
+  stage_enc = P_purge_stage_msec(&stage);
+
   for (j = 0; j < index; j++) {
     char *json_str = NULL;
 
@@ -576,15 +593,11 @@ void amqp_cache_purge(struct chained_cache *queue[], int index, int safe_action)
     if (queue[j]->valid == PRINT_CACHE_FREE) continue;
 
     if (config.message_broker_output & PRINT_OUTPUT_JSON) {
-#ifdef WITH_JANSSON
-      json_t *json_obj = json_object();
-      int idx;
-
-      for (idx = 0; idx < N_PRIMITIVES && cjhandler[idx]; idx++) cjhandler[idx](json_obj, queue[j]);
-      add_writer_name_and_pid_json(json_obj, &writer_id_tokens);
-
-      json_str = compose_json_str(json_obj);
-#endif
+      if (encoded) {
+	json_str = encoded[j];
+	encoded[j] = NULL;
+      }
+      else json_str = compose_json_acct_str(queue[j], &writer_id_tokens);
     }
     else if ((config.message_broker_output & PRINT_OUTPUT_AVRO_BIN) ||
 	     (config.message_broker_output & PRINT_OUTPUT_AVRO_JSON)) {
@@ -781,6 +794,8 @@ void amqp_cache_purge(struct chained_cache *queue[], int index, int safe_action)
   }
 
   duration = time(NULL)-start;
+  stage_out = P_purge_stage_msec(&stage);
+  P_encoded_free(encoded, index);
 
   if (config.print_markers) {
     if (config.message_broker_output & PRINT_OUTPUT_JSON) {
@@ -828,6 +843,8 @@ void amqp_cache_purge(struct chained_cache *queue[], int index, int safe_action)
 
   Log(LOG_INFO, "INFO ( %s/%s ): *** Purging cache - END (PID: %u, QN: %u/%u, ET: %lu) ***\n",
 		config.name, config.type, writer_pid, qn, saved_index, duration);
+  Log(LOG_INFO, "INFO ( %s/%s ): Purging cache - stages (PID: %u, preprocess: %" PRIu64 " ms, encode: %" PRIu64 " ms, output: %" PRIu64 " ms)\n",
+		config.name, config.type, writer_pid, stage_prep, stage_enc, stage_out);
 
   if (config.sql_trigger_exec && !safe_action) P_trigger_exec(config.sql_trigger_exec); 
 
@@ -437,6 +437,7 @@ void skinny_bgp_daemon_online()
   for (afi = AFI_IP; afi < AFI_MAX; afi++) {
     for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
       bgp_routing_db->rib[afi][safi] = bgp_table_init(afi, safi);
+      if (config.bgp_table_lpm_index) bgp_routing_db->rib[afi][safi]->lpm = bgp_lpm_init(afi);
     }
   }
 
@@ -701,6 +702,9 @@ void skinny_bgp_daemon_online()
     if (select_num < 0) goto select_again;
     now = time(NULL);
 
+    /* release RIB memory no longer visible to lookups */
+    bgp_epoch_reclaim();
+
     /* signals handling */
     if (reload_map_bgp_thread) {
       if (config.bgp_daemon_allow_file) load_allow_file(config.bgp_daemon_allow_file, &allow);
@@ -886,6 +890,7 @@ void skinny_bgp_daemon_online()
       peer->idx = peers_idx; 
       FD_SET(peer->fd, &bkp_read_descs);
       sa_to_addr((struct sockaddr *) &client, &peer->addr, &peer->tcp_port);
+      bgp_peers_gen_bump(FUNC_TYPE_BGP);
 
       if (peers_cache && peers_port_cache) {
 	u_int32_t bucket;
@@ -25,6 +25,8 @@
 #include "bgp_prefix.h"
 #include "bgp_packet.h"
 #include "bgp_table.h"
+#include "bgp_epoch.h"
+#include "bgp_lpm.h"
 
 #ifndef _BGP_H_
 #define _BGP_H_
@@ -223,6 +225,7 @@ struct bgp_peer {
   void *bmp_se;
   rd_t peer_distinguisher; /* only relevant for BGP peer learned via BMP */
   u_int8_t eor[AFI_MAX][SAFI_MAX]; /* End of RIB received */
+  struct bgp_info *routes; /* routes of this peer across all tables, for teardown */
 
   struct bgp_xconnect xc;
   struct bgp_peer_buf xbuf;
@@ -266,6 +269,7 @@ struct bgp_misc_structs {
   
   void *peers;
   int max_peers;
+  volatile u_int32_t peers_gen; /* bumped upon peers (un)setting addr or id, see bgp_peers_gen_bump() */
   void *peers_cache;
   void *peers_port_cache;
   struct log_notification *peers_limit_log;
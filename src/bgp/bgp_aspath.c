@@ -263,6 +263,13 @@ aspath_free (struct aspath *aspath)
   free(aspath);
 }
 
+/* AS paths may still be referenced by lock-less RIB readers: see bgp_epoch.h */
+static void
+aspath_free_deferred (void *ptr, void *arg)
+{
+  aspath_free (ptr);
+}
+
 /* Unintern aspath from AS path bucket. */
 void
 aspath_unintern(struct bgp_peer *peer, struct aspath *aspath)
@@ -284,7 +291,7 @@ aspath_unintern(struct bgp_peer *peer, struct aspath *aspath)
     /* This aspath must exist in aspath hash table. */
     ret = hash_release(inter_domain_routing_db->ashash, aspath);
     assert (ret != NULL);
-    aspath_free (aspath);
+    bgp_epoch_defer (aspath_free_deferred, aspath, NULL);
   }
 }
 
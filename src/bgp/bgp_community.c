@@ -369,6 +369,12 @@ community_intern (struct bgp_peer *peer, struct community *com)
   return find;
 }
 
+static void
+community_free_deferred (void *ptr, void *arg)
+{
+  community_free (ptr);
+}
+
 /* Free community attribute. */
 void
 community_unintern (struct bgp_peer *peer, struct community *com)
@@ -392,7 +398,7 @@ community_unintern (struct bgp_peer *peer, struct community *com)
     ret = (struct community *) hash_release(inter_domain_routing_db->comhash, com);
     assert (ret != NULL);
 
-    community_free (com);
+    bgp_epoch_defer (community_free_deferred, com, NULL);
   }
 }
 
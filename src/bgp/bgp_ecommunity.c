@@ -188,6 +188,12 @@ ecommunity_intern (struct bgp_peer *peer, struct ecommunity *ecom)
   return find;
 }
 
+static void
+ecommunity_free_deferred (void *ptr, void *arg)
+{
+  ecommunity_free (ptr);
+}
+
 /* Unintern Extended Communities Attribute.  */
 void
 ecommunity_unintern (struct bgp_peer *peer, struct ecommunity *ecom)
@@ -211,7 +217,7 @@ ecommunity_unintern (struct bgp_peer *peer, struct ecommunity *ecom)
     ret = (struct ecommunity *) hash_release(inter_domain_routing_db->ecomhash, ecom);
     assert (ret != NULL);
 
-    ecommunity_free(ecom);
+    bgp_epoch_defer(ecommunity_free_deferred, ecom, NULL);
   }
 }
 
@@ -0,0 +1,189 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* includes */
+#include "pmacct.h"
+#include "bgp.h"
+
+/* global variables */
+volatile u_int64_t bgp_epoch_global = 1;
+struct bgp_epoch_reader *bgp_epoch_core_reader;
+
+static struct bgp_epoch_reader bgp_epoch_readers[BGP_EPOCH_MAX_READERS];
+static pthread_mutex_t bgp_epoch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct bgp_epoch_deferred *bgp_epoch_head, *bgp_epoch_tail;
+static struct bgp_epoch_stats bgp_epoch_stats;
+
+/* functions */
+struct bgp_epoch_reader *bgp_epoch_reader_register()
+{
+  int idx;
+
+  for (idx = 0; idx < BGP_EPOCH_MAX_READERS; idx++) {
+    if (__sync_bool_compare_and_swap(&bgp_epoch_readers[idx].used, FALSE, TRUE)) {
+      bgp_epoch_readers[idx].epoch = 0;
+
+      return &bgp_epoch_readers[idx];
+    }
+  }
+
+  Log(LOG_WARNING, "WARN ( %s/core/BGP ): bgp_epoch_reader_register(): no free reader slots (max: %u).\n", config.name, BGP_EPOCH_MAX_READERS);
+
+  return NULL;
+}
+
+void bgp_epoch_reader_unregister(struct bgp_epoch_reader *r)
+{
+  if (!r) return;
+
+  bgp_epoch_offline(r);
+  r->used = FALSE;
+}
+
+void bgp_epoch_core_reader_init()
+{
+  if (config.bgp_daemon || config.bmp_daemon || config.rpki_roas_file || config.rpki_rtr_cache) {
+    bgp_epoch_core_reader = bgp_epoch_reader_register();
+  }
+}
+
+/* returns the oldest epoch observed by an online reader; 0 if none is online */
+static u_int64_t bgp_epoch_min_online()
+{
+  u_int64_t min = 0, epoch;
+  int idx;
+
+  for (idx = 0; idx < BGP_EPOCH_MAX_READERS; idx++) {
+    if (!bgp_epoch_readers[idx].used) continue;
+
+    epoch = bgp_epoch_readers[idx].epoch;
+    if (epoch && (!min || epoch < min)) min = epoch;
+  }
+
+  return min;
+}
+
+void bgp_epoch_free(void *ptr, void *arg)
+{
+  free(ptr);
+}
+
+/*
+   To be called by writers once 'ptr' is no longer reachable from the RIB.
+   If no reader is online 'func' runs straight away: the barrier pairs with
+   the one in bgp_epoch_online() so that a reader going online concurrently
+   is guaranteed to see the object already unlinked.
+*/
+void bgp_epoch_defer(bgp_epoch_free_func func, void *ptr, void *arg)
+{
+  struct bgp_epoch_deferred *d;
+  u_int64_t pending;
+
+  if (!func || !ptr) return;
+
+  __sync_synchronize();
+
+  if (!bgp_epoch_min_online()) {
+    __sync_fetch_and_add(&bgp_epoch_stats.immediate, 1);
+    func(ptr, arg);
+    return;
+  }
+
+  d = malloc(sizeof(struct bgp_epoch_deferred));
+  if (!d) {
+    Log(LOG_ERR, "ERROR ( %s/core/BGP ): malloc() failed (bgp_epoch_defer). Exiting ..\n", config.name);
+    exit_gracefully(1);
+  }
+
+  d->func = func;
+  d->ptr = ptr;
+  d->arg = arg;
+  d->next = NULL;
+
+  pthread_mutex_lock(&bgp_epoch_mutex);
+
+  d->epoch = bgp_epoch_global;
+
+  if (bgp_epoch_tail) bgp_epoch_tail->next = d;
+  else bgp_epoch_head = d;
+  bgp_epoch_tail = d;
+
+  bgp_epoch_stats.deferred++;
+  pending = ++bgp_epoch_stats.pending;
+
+  pthread_mutex_unlock(&bgp_epoch_mutex);
+
+  if (pending >= BGP_EPOCH_RECLAIM_THRESHOLD) bgp_epoch_reclaim();
+}
+
+/*
+   Opens a new epoch and frees everything retired before the oldest epoch
+   still observed by an online reader. Called by the daemon threads once
+   per event loop iteration, and by bgp_epoch_defer() if the backlog grows.
+*/
+void bgp_epoch_reclaim()
+{
+  struct bgp_epoch_deferred *list = NULL, *d;
+  u_int64_t min, count = 0;
+
+  pthread_mutex_lock(&bgp_epoch_mutex);
+
+  if (!bgp_epoch_head) {
+    pthread_mutex_unlock(&bgp_epoch_mutex);
+    return;
+  }
+
+  __sync_fetch_and_add(&bgp_epoch_global, 1);
+  min = bgp_epoch_min_online();
+
+  /* the list is ordered by epoch: stop at the first item still in use */
+  if (!min || bgp_epoch_head->epoch < min) {
+    list = bgp_epoch_head;
+
+    for (d = bgp_epoch_head, count = 1; d->next && (!min || d->next->epoch < min); d = d->next, count++);
+
+    bgp_epoch_head = d->next;
+    d->next = NULL;
+    if (!bgp_epoch_head) bgp_epoch_tail = NULL;
+
+    bgp_epoch_stats.reclaimed += count;
+    bgp_epoch_stats.pending -= count;
+  }
+
+  pthread_mutex_unlock(&bgp_epoch_mutex);
+
+  while (list) {
+    d = list;
+    list = list->next;
+
+    d->func(d->ptr, d->arg);
+    free(d);
+  }
+}
+
+void bgp_epoch_print_stats(time_t now)
+{
+  if (!bgp_epoch_core_reader) return;
+
+  Log(LOG_NOTICE, "NOTICE ( %s/%s ): stats [bgp_epoch] time=%ld epoch=%" PRIu64 " immediate=%" PRIu64 " deferred=%" PRIu64 " reclaimed=%" PRIu64 " pending=%" PRIu64 "\n",
+      config.name, config.type, (long)now, bgp_epoch_global, bgp_epoch_stats.immediate,
+      bgp_epoch_stats.deferred, bgp_epoch_stats.reclaimed, bgp_epoch_stats.pending);
+}
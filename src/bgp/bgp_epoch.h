@@ -0,0 +1,98 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef BGP_EPOCH_H
+#define BGP_EPOCH_H
+
+/*
+   Epoch-based reclamation for the BGP/BMP/RPKI RIBs. The daemon threads
+   are the only writers; the core process (flow enrichment) and the Looking
+   Glass are readers. Readers never lock: they announce themselves online
+   for the duration of a lookup and offline once no RIB pointer is held
+   anymore. Writers unlink nodes, bgp_info and attributes as before but
+   hand them to bgp_epoch_defer() instead of freeing them; memory is then
+   released by bgp_epoch_reclaim() once every online reader has moved past
+   the epoch in which the object was retired.
+*/
+
+/* defines */
+#define BGP_EPOCH_MAX_READERS		16
+#define BGP_EPOCH_RECLAIM_THRESHOLD	4096
+#define BGP_EPOCH_CACHE_LINE		64
+
+/* structures */
+typedef void (*bgp_epoch_free_func)(void *, void *);
+
+struct bgp_epoch_reader {
+  volatile u_int64_t epoch;	/* epoch observed when going online; 0 = offline */
+  volatile int used;
+} __attribute__ ((aligned (BGP_EPOCH_CACHE_LINE)));
+
+struct bgp_epoch_deferred {
+  bgp_epoch_free_func func;
+  void *ptr;
+  void *arg;
+  u_int64_t epoch;		/* global epoch at the time of retirement */
+  struct bgp_epoch_deferred *next;
+};
+
+struct bgp_epoch_stats {
+  u_int64_t immediate;		/* freed straight away, no reader online */
+  u_int64_t deferred;		/* queued for a later grace period */
+  u_int64_t reclaimed;		/* deferred objects eventually freed */
+  u_int64_t pending;		/* deferred objects still queued */
+};
+
+/* global variables */
+extern volatile u_int64_t bgp_epoch_global;
+extern struct bgp_epoch_reader *bgp_epoch_core_reader;
+
+/* prototypes */
+extern struct bgp_epoch_reader *bgp_epoch_reader_register();
+extern void bgp_epoch_reader_unregister(struct bgp_epoch_reader *);
+extern void bgp_epoch_core_reader_init();
+extern void bgp_epoch_defer(bgp_epoch_free_func, void *, void *);
+extern void bgp_epoch_free(void *, void *);
+extern void bgp_epoch_reclaim();
+extern void bgp_epoch_print_stats(time_t);
+
+/* a NULL reader (ie. no BGP-like daemon running) makes these no-ops */
+static inline void bgp_epoch_online(struct bgp_epoch_reader *r)
+{
+  if (!r) return;
+
+  r->epoch = bgp_epoch_global;
+
+  /* the epoch must be visible before any RIB pointer is loaded */
+  __sync_synchronize();
+}
+
+static inline void bgp_epoch_offline(struct bgp_epoch_reader *r)
+{
+  if (!r) return;
+
+  /* all RIB loads must complete before the reader is seen offline */
+  __sync_synchronize();
+
+  r->epoch = 0;
+}
+
+#endif // BGP_EPOCH_H
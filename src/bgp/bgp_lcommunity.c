@@ -185,6 +185,12 @@ lcommunity_intern (struct bgp_peer *peer, struct lcommunity *lcom)
   return find;
 }
 
+static void
+lcommunity_free_deferred (void *ptr, void *arg)
+{
+  lcommunity_free (ptr);
+}
+
 /* Unintern Large Communities Attribute.  */
 void
 lcommunity_unintern (struct bgp_peer *peer, struct lcommunity *lcom)
@@ -208,7 +214,7 @@ lcommunity_unintern (struct bgp_peer *peer, struct lcommunity *lcom)
     ret = (struct lcommunity *) hash_release(inter_domain_routing_db->lcomhash, lcom);
     assert (ret != NULL);
 
-    lcommunity_free(lcom);
+    bgp_epoch_defer(lcommunity_free_deferred, lcom, NULL);
   }
 }
 
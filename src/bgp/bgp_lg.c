@@ -88,6 +88,7 @@ void bgp_lg_daemon_worker_json(void *zh, void *zs)
   struct p_zmq_sock *sock = zs;
   struct bgp_lg_req req;
   struct bgp_lg_rep ipl_rep, gp_rep;
+  struct bgp_epoch_reader *reader;
   int ret;
 
   if (!lg_host || !sock) {
@@ -98,6 +99,8 @@ void bgp_lg_daemon_worker_json(void *zh, void *zs)
   memset(&ipl_rep, 0, sizeof(ipl_rep));
   memset(&gp_rep, 0, sizeof(gp_rep));
 
+  reader = bgp_epoch_reader_register();
+
   for (;;) {
     memset(&req, 0, sizeof(req));
     ret = bgp_lg_daemon_decode_query_header_json(sock, &req);
@@ -112,9 +115,13 @@ void bgp_lg_daemon_worker_json(void *zh, void *zs)
         ret = bgp_lg_daemon_decode_query_ip_lookup_json(sock, req.data);
 
         bgp_lg_rep_init(&ipl_rep);
+
+        /* the reply points into the RIB until it is encoded */
+        bgp_epoch_online(reader);
         if (!ret) ret = bgp_lg_daemon_ip_lookup(req.data, &ipl_rep, FUNC_TYPE_BGP); 
 
         bgp_lg_daemon_encode_reply_ip_lookup_json(sock, &ipl_rep, ret);
+        bgp_epoch_offline(reader);
       }
       break;
     case BGP_LG_QT_GET_PEERS:
@@ -28,6 +28,145 @@
 #include "pmbgpd.h"
 #include "rpki/rpki.h"
 
+/*
+   Batched src/dst lookups: entries are added in the order in which
+   bgp_srcdst_lookup() is later going to ask for them (ie. src, dst of
+   each flow record). The BGP peer is resolved once for the whole batch
+   and LPM index walks are interleaved (see bgp_lpm_lookup_batch()).
+*/
+int bgp_lookup_batch_init(struct bgp_lookup_batch *blb, struct sockaddr *sa, struct xflow_status_entry *xs_entry, u_int16_t l3_proto, int type)
+{
+  struct bgp_misc_structs *bms;
+  struct bgp_rt_structs *inter_domain_routing_db;
+  const struct bgp_table *table;
+  afi_t afi;
+
+  blb->peer = NULL;
+  blb->table = NULL;
+  blb->num = 0;
+  blb->idx = 0;
+
+  bms = bgp_select_misc_db(type);
+  inter_domain_routing_db = bgp_select_routing_db(type);
+
+  /* the RPKI node vector needs the full tree walk */
+  if (!bms || !inter_domain_routing_db || bms->bnv) return ERR;
+
+  if (l3_proto == ETHERTYPE_IP) afi = AFI_IP;
+  else if (l3_proto == ETHERTYPE_IPV6) afi = AFI_IP6;
+  else return ERR;
+
+  table = inter_domain_routing_db->rib[afi][SAFI_UNICAST];
+  if (!table || !table->lpm) return ERR;
+
+  blb->peer = bms->bgp_lookup_find_peer(sa, xs_entry, l3_proto, config.tmp_bgp_lookup_compare_ports);
+  if (!blb->peer) return ERR;
+
+  blb->table = table;
+
+  return SUCCESS;
+}
+
+int bgp_lookup_batch_add(struct bgp_lookup_batch *blb, u_char *addr)
+{
+  struct prefix *p;
+
+  if (!blb->table || blb->num >= BGP_LOOKUP_BATCH_MAX) return ERR;
+
+  p = &blb->p[blb->num];
+  memset(p, 0, sizeof(struct prefix));
+
+  if (blb->table->afi == AFI_IP) {
+    p->family = AF_INET;
+    p->prefixlen = IPV4_MAX_PREFIXLEN;
+    memcpy(&p->u.prefix4, addr, 4);
+  }
+  else {
+    p->family = AF_INET6;
+    p->prefixlen = IPV6_MAX_PREFIXLEN;
+    memcpy(&p->u.prefix6, addr, 16);
+  }
+
+  blb->num++;
+
+  return SUCCESS;
+}
+
+void bgp_lookup_batch_resolve(struct bgp_lookup_batch *blb)
+{
+  struct prefix *p[BGP_LOOKUP_BATCH_MAX];
+  u_int32_t idx;
+
+  if (!blb->table || !blb->num) return;
+
+  for (idx = 0; idx < blb->num; idx++) p[idx] = &blb->p[idx];
+
+  bgp_lpm_lookup_batch(blb->table->lpm, p, blb->node, blb->num);
+  blb->idx = 0;
+}
+
+/*
+   Looks 'p' up among the entries not consumed yet; records skipped by the
+   caller (ie. filtered out) are fine as entries are consumed in order.
+   Returns TRUE, and the outcome of the LPM index walk in 'node', if found.
+*/
+int bgp_lookup_batch_get(struct bgp_lookup_batch *blb, struct bgp_peer *peer, const struct bgp_table *table, struct prefix *p, struct bgp_node **node)
+{
+  u_int32_t idx;
+
+  if (!blb || blb->peer != peer || blb->table != table) return FALSE;
+
+  for (idx = blb->idx; idx < blb->num; idx++) {
+    if (prefix_same(&blb->p[idx], p)) {
+      (*node) = blb->node[idx];
+      blb->idx = (idx + 1);
+
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+static void bgp_srcdst_node_match(struct packet_ptrs *pptrs, const struct bgp_table *table, afi_t afi, void *addr,
+				  struct bgp_misc_structs *bms, struct node_match_cmp_term2 *nmct2,
+				  struct bgp_node **result, struct bgp_info **info)
+{
+  struct bgp_lookup_batch *blb = (struct bgp_lookup_batch *) pptrs->bgp_batch;
+  struct bgp_node *hint;
+  struct prefix p;
+
+  if (blb && nmct2->safi == SAFI_UNICAST) {
+    memset(&p, 0, sizeof(p));
+
+    if (afi == AFI_IP) {
+      p.family = AF_INET;
+      p.prefixlen = IPV4_MAX_PREFIXLEN;
+      memcpy(&p.u.prefix4, addr, 4);
+    }
+    else {
+      p.family = AF_INET6;
+      p.prefixlen = IPV6_MAX_PREFIXLEN;
+      memcpy(&p.u.prefix6, addr, 16);
+    }
+
+    if (bgp_lookup_batch_get(blb, nmct2->peer, table, &p, &hint)) {
+      bgp_node_match_hint(table, &p, hint, nmct2->peer, bms->route_info_modulo,
+			  bms->bgp_lookup_node_match_cmp, nmct2, bms->bnv, result, info);
+      return;
+    }
+  }
+
+  if (afi == AFI_IP) {
+    bgp_node_match_ipv4(table, (struct in_addr *) addr, nmct2->peer, bms->route_info_modulo,
+			bms->bgp_lookup_node_match_cmp, nmct2, bms->bnv, result, info);
+  }
+  else {
+    bgp_node_match_ipv6(table, (struct in6_addr *) addr, nmct2->peer, bms->route_info_modulo,
+			bms->bgp_lookup_node_match_cmp, nmct2, bms->bnv, result, info);
+  }
+}
+
 void bgp_srcdst_lookup(struct packet_ptrs *pptrs, int type, struct bgp_lookup_info *bl_info)
 {
   struct bgp_misc_structs *bms;
@@ -137,11 +276,8 @@ void bgp_srcdst_lookup(struct packet_ptrs *pptrs, int type, struct bgp_lookup_in
 	nmct2.peer_dst_ip = NULL;
 
         memcpy(&pref4, &((struct pm_iphdr *)pptrs->iph_ptr)->ip_src, sizeof(struct in_addr));
-	bgp_node_match_ipv4(inter_domain_routing_db->rib[AFI_IP][safi],
-			    &pref4, (struct bgp_peer *) pptrs->bgp_peer,
-		     	    bms->route_info_modulo,
-			    bms->bgp_lookup_node_match_cmp, &nmct2,
-			    bms->bnv, &result, &info);
+	bgp_srcdst_node_match(pptrs, inter_domain_routing_db->rib[AFI_IP][safi], AFI_IP, &pref4,
+			      bms, &nmct2, &result, &info);
       }
 
       if (!pptrs->bgp_src_info && result) {
@@ -166,11 +302,8 @@ void bgp_srcdst_lookup(struct packet_ptrs *pptrs, int type, struct bgp_lookup_in
         nmct2.peer_dst_ip = &peer_dst_ip;
 
 	memcpy(&pref4, &((struct pm_iphdr *)pptrs->iph_ptr)->ip_dst, sizeof(struct in_addr));
-	bgp_node_match_ipv4(inter_domain_routing_db->rib[AFI_IP][safi],
-			    &pref4, (struct bgp_peer *) pptrs->bgp_peer,
-			    bms->route_info_modulo,
-			    bms->bgp_lookup_node_match_cmp, &nmct2,
-			    bms->bnv, &result, &info);
+	bgp_srcdst_node_match(pptrs, inter_domain_routing_db->rib[AFI_IP][safi], AFI_IP, &pref4,
+			      bms, &nmct2, &result, &info);
       }
 
       if (!pptrs->bgp_dst_info && result) {
@@ -321,11 +454,8 @@ void bgp_srcdst_lookup(struct packet_ptrs *pptrs, int type, struct bgp_lookup_in
           nmct2.peer_dst_ip = NULL;
 
           memcpy(&pref6, &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_src, sizeof(struct in6_addr));
-          bgp_node_match_ipv6(inter_domain_routing_db->rib[AFI_IP6][safi],
-                              &pref6, (struct bgp_peer *) pptrs->bgp_peer,
-                              bms->route_info_modulo,
-                              bms->bgp_lookup_node_match_cmp, &nmct2,
-                              bms->bnv, &result, &info);
+          bgp_srcdst_node_match(pptrs, inter_domain_routing_db->rib[AFI_IP6][safi], AFI_IP6, &pref6,
+                                bms, &nmct2, &result, &info);
         }
 
         if (!pptrs->bgp_src_info && result) {
@@ -350,11 +480,8 @@ void bgp_srcdst_lookup(struct packet_ptrs *pptrs, int type, struct bgp_lookup_in
           nmct2.peer_dst_ip = &peer_dst_ip;
 
           memcpy(&pref6, &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_dst, sizeof(struct in6_addr));
-          bgp_node_match_ipv6(inter_domain_routing_db->rib[AFI_IP6][safi],
-                              &pref6, (struct bgp_peer *) pptrs->bgp_peer,
-                              bms->route_info_modulo,
-                              bms->bgp_lookup_node_match_cmp, &nmct2,
-                              bms->bnv, &result, &info);
+          bgp_srcdst_node_match(pptrs, inter_domain_routing_db->rib[AFI_IP6][safi], AFI_IP6, &pref6,
+                                bms, &nmct2, &result, &info);
         }
 
         if (!pptrs->bgp_dst_info && result) {
@@ -653,48 +780,75 @@ void bgp_follow_nexthop_lookup(struct packet_ptrs *pptrs, int type)
   pptrs->f_agent = saved_agent;
 }
 
+struct xflow_status_peer_cache *bgp_lookup_peer_cache(struct xflow_status_entry *xs_entry, u_int16_t l3_proto)
+{
+  if (!xs_entry) return NULL;
+
+  if (l3_proto == ETHERTYPE_IP) return &xs_entry->peer_v4;
+  else if (l3_proto == ETHERTYPE_IPV6) return &xs_entry->peer_v6;
+
+  return NULL;
+}
+
+/* 'gen' to be read before any peer is looked at, see bgp_peers_gen_bump() */
+int bgp_lookup_peer_cache_get(struct xflow_status_peer_cache *pc, int type, u_int32_t gen,
+			      struct host_addr *addr, u_int16_t port, struct bgp_peer **peer)
+{
+  if (!pc || pc->type != type || pc->gen != gen) return FALSE;
+  if (pc->port != port || host_addr_cmp(&pc->addr, addr)) return FALSE;
+
+  (*peer) = pc->peer;
+
+  return TRUE;
+}
+
+void bgp_lookup_peer_cache_set(struct xflow_status_peer_cache *pc, int type, u_int32_t gen,
+			       struct host_addr *addr, u_int16_t port, struct bgp_peer *peer)
+{
+  if (!pc) return;
+
+  pc->peer = peer;
+  memcpy(&pc->addr, addr, sizeof(struct host_addr));
+  pc->port = port;
+  pc->type = type;
+  pc->gen = gen;
+}
+
 struct bgp_peer *bgp_lookup_find_bgp_peer(struct sockaddr *sa, struct xflow_status_entry *xs_entry, u_int16_t l3_proto, int compare_bgp_port)
 {
+  struct bgp_misc_structs *bms = bgp_select_misc_db(FUNC_TYPE_BGP);
+  struct xflow_status_peer_cache *pc;
   struct bgp_peer *peer;
-  u_int32_t peer_idx, *peer_idx_ptr;
+  struct host_addr addr;
+  u_int16_t port = 0;
+  u_int32_t gen = 0;
   int peers_idx;
 
-  peer_idx = 0; peer_idx_ptr = NULL;
-  if (xs_entry) {
-    if (l3_proto == ETHERTYPE_IP) {
-      peer_idx = xs_entry->peer_v4_idx; 
-      peer_idx_ptr = &xs_entry->peer_v4_idx;
-    }
-    else if (l3_proto == ETHERTYPE_IPV6) {
-      peer_idx = xs_entry->peer_v6_idx; 
-      peer_idx_ptr = &xs_entry->peer_v6_idx;
-    }
-  }
+  pc = bgp_lookup_peer_cache(xs_entry, l3_proto);
 
-  if (xs_entry && peer_idx) {
-    if ((!config.bgp_disable_router_id_check && !sa_addr_cmp(sa, &peers[peer_idx].id)) ||
-	(!sa_addr_cmp(sa, &peers[peer_idx].addr) &&
-	(!compare_bgp_port || !sa_port_cmp(sa, peers[peer_idx].tcp_port)))) {
-      peer = &peers[peer_idx];
-    }
-    /* If no match then let's invalidate the entry */
-    else {
-      *peer_idx_ptr = 0;
-      peer = NULL;
-    }
+  if (pc && bms) {
+    gen = bms->peers_gen;
+    sa_to_addr(sa, &addr, &port);
+    if (!compare_bgp_port) port = 0;
+
+    if (bgp_lookup_peer_cache_get(pc, FUNC_TYPE_BGP, gen, &addr, port, &peer)) return peer;
+
+    /* peers must not be read before the generation */
+    __sync_synchronize();
   }
-  else {
-    for (peer = NULL, peers_idx = 0; peers_idx < config.bgp_daemon_max_peers; peers_idx++) {
-      if ((!config.bgp_disable_router_id_check && !sa_addr_cmp(sa, &peers[peers_idx].id)) ||
-	  (!sa_addr_cmp(sa, &peers[peers_idx].addr) && 
-	  (!compare_bgp_port || !sa_port_cmp(sa, peers[peer_idx].tcp_port)))) {
-        peer = &peers[peers_idx];
-        if (xs_entry && peer_idx_ptr) *peer_idx_ptr = peers_idx;
-        break;
-      }
+
+  for (peer = NULL, peers_idx = 0; peers_idx < config.bgp_daemon_max_peers; peers_idx++) {
+    if ((!config.bgp_disable_router_id_check && !sa_addr_cmp(sa, &peers[peers_idx].id)) ||
+	(!sa_addr_cmp(sa, &peers[peers_idx].addr) && 
+	(!compare_bgp_port || !sa_port_cmp(sa, peers[peers_idx].tcp_port)))) {
+      peer = &peers[peers_idx];
+      break;
     }
   }
 
+  /* misses are cached too: no scanning peers per flow for unknown exporters */
+  if (pc && bms) bgp_lookup_peer_cache_set(pc, FUNC_TYPE_BGP, gen, &addr, port, peer);
+
   return peer;
 }
 
@@ -37,10 +37,29 @@ struct bgp_lookup_info {
 };
 extern struct bgp_lookup_info *bl_info;
 
+/* src/dst lookups of a set of flow records against the RIB, resolved in one go */
+#define BGP_LOOKUP_BATCH_MAX	BGP_LPM_BATCH_MAX
+
+struct bgp_lookup_batch {
+  struct bgp_peer *peer;		/* BGP peer, resolved once for all entries */
+  const struct bgp_table *table;	/* RIB the entries were resolved against */
+  u_int32_t num;
+  u_int32_t idx;			/* first entry not consumed yet */
+  struct prefix p[BGP_LOOKUP_BATCH_MAX];
+  struct bgp_node *node[BGP_LOOKUP_BATCH_MAX];	/* bgp_lpm_lookup() outcome */
+};
+
 /* prototypes */
 extern void bgp_srcdst_lookup(struct packet_ptrs *, int, struct bgp_lookup_info *);
 extern void bgp_follow_nexthop_lookup(struct packet_ptrs *, int);
+extern int bgp_lookup_batch_init(struct bgp_lookup_batch *, struct sockaddr *, struct xflow_status_entry *, u_int16_t, int);
+extern int bgp_lookup_batch_add(struct bgp_lookup_batch *, u_char *);
+extern void bgp_lookup_batch_resolve(struct bgp_lookup_batch *);
+extern int bgp_lookup_batch_get(struct bgp_lookup_batch *, struct bgp_peer *, const struct bgp_table *, struct prefix *, struct bgp_node **);
 extern struct bgp_peer *bgp_lookup_find_bgp_peer(struct sockaddr *, struct xflow_status_entry *, u_int16_t, int); 
+extern struct xflow_status_peer_cache *bgp_lookup_peer_cache(struct xflow_status_entry *, u_int16_t);
+extern int bgp_lookup_peer_cache_get(struct xflow_status_peer_cache *, int, u_int32_t, struct host_addr *, u_int16_t, struct bgp_peer **);
+extern void bgp_lookup_peer_cache_set(struct xflow_status_peer_cache *, int, u_int32_t, struct host_addr *, u_int16_t, struct bgp_peer *);
 extern u_int32_t bgp_route_info_modulo_pathid(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int);
 extern u_int32_t bgp_route_info_modulo_mplsvpnrd(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int);
 extern int bgp_lookup_node_match_cmp_bgp(struct bgp_info *, struct node_match_cmp_term2 *);
@@ -0,0 +1,355 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* includes */
+#include "pmacct.h"
+#include "bgp.h"
+
+/* structures */
+struct bgp_lpm_update {
+  struct prefix *p;
+  struct bgp_node *node;	/* route being added or removed */
+  struct bgp_node *repl;	/* on removal, next most specific route */
+  int add;
+
+  /* nodes to retire once the new version of the trie is published */
+  struct bgp_lpm_node **retired;
+  u_int32_t retired_num;
+  u_int32_t retired_max;
+};
+
+/* functions */
+static struct bgp_lpm_node *bgp_lpm_node_build(struct bgp_lpm *lpm, struct bgp_node **leaf, struct bgp_lpm_node **child)
+{
+  struct bgp_lpm_node *new;
+  struct bgp_node *run = NULL;
+  u_int32_t slot, children_num = 0, leaves_num = 0;
+  u_int64_t vector = 0, leafvec = 0;
+
+  for (slot = 0; slot < BGP_LPM_FANOUT; slot++) {
+    if (child[slot]) {
+      vector |= (((u_int64_t) 1) << slot);
+      children_num++;
+    }
+    else if (!leaves_num || leaf[slot] != run) {
+      leafvec |= (((u_int64_t) 1) << slot);
+      run = leaf[slot];
+      leaves_num++;
+    }
+  }
+
+  new = malloc(sizeof(struct bgp_lpm_node) + ((children_num + leaves_num) * sizeof(void *)));
+  if (!new) {
+    Log(LOG_ERR, "ERROR ( %s/core/BGP ): malloc() failed (bgp_lpm_node_build). Exiting ..\n", config.name);
+    exit_gracefully(1);
+  }
+
+  new->vector = vector;
+  new->leafvec = leafvec;
+  new->children = (struct bgp_lpm_node **) (new + 1);
+  new->leaves = (struct bgp_node **) (new->children + children_num);
+
+  for (slot = 0, children_num = 0, leaves_num = 0; slot < BGP_LPM_FANOUT; slot++) {
+    if (vector & (((u_int64_t) 1) << slot)) new->children[children_num++] = child[slot];
+    else if (leafvec & (((u_int64_t) 1) << slot)) new->leaves[leaves_num++] = leaf[slot];
+  }
+
+  lpm->nodes++;
+
+  return new;
+}
+
+static void bgp_lpm_node_expand(struct bgp_lpm_node *node, struct bgp_node **leaf, struct bgp_lpm_node **child)
+{
+  u_int32_t slot;
+
+  for (slot = 0; slot < BGP_LPM_FANOUT; slot++) {
+    if (node->vector & (((u_int64_t) 1) << slot)) {
+      child[slot] = node->children[__builtin_popcountll(node->vector & bgp_lpm_mask(slot)) - 1];
+      leaf[slot] = NULL;
+    }
+    else {
+      child[slot] = NULL;
+      leaf[slot] = node->leaves[__builtin_popcountll(node->leafvec & bgp_lpm_mask(slot)) - 1];
+    }
+  }
+}
+
+static struct bgp_lpm_node *bgp_lpm_node_uniform(struct bgp_lpm *lpm, struct bgp_node *value)
+{
+  struct bgp_node *leaf[BGP_LPM_FANOUT];
+  struct bgp_lpm_node *child[BGP_LPM_FANOUT];
+  u_int32_t slot;
+
+  for (slot = 0; slot < BGP_LPM_FANOUT; slot++) {
+    leaf[slot] = value;
+    child[slot] = NULL;
+  }
+
+  return bgp_lpm_node_build(lpm, leaf, child);
+}
+
+static void bgp_lpm_retire(struct bgp_lpm *lpm, struct bgp_lpm_update *upd, struct bgp_lpm_node *node)
+{
+  if (upd->retired_num == upd->retired_max) {
+    upd->retired_max = (upd->retired_max ? (upd->retired_max * 2) : 16);
+    upd->retired = realloc(upd->retired, (upd->retired_max * sizeof(struct bgp_lpm_node *)));
+
+    if (!upd->retired) {
+      Log(LOG_ERR, "ERROR ( %s/core/BGP ): realloc() failed (bgp_lpm_retire). Exiting ..\n", config.name);
+      exit_gracefully(1);
+    }
+  }
+
+  upd->retired[upd->retired_num++] = node;
+  lpm->nodes--;
+}
+
+/*
+   Applies the route change in 'upd' to the subtree rooted at 'node', whose
+   first slot bit is 'offset'. Returns 'node' itself if it was left alone
+   or only had child pointers swapped in place, a new node otherwise: the
+   caller has then to publish it; replaced nodes are queued in 'upd'.
+*/
+static struct bgp_lpm_node *bgp_lpm_node_update(struct bgp_lpm *lpm, struct bgp_lpm_node *node, u_int32_t offset, struct bgp_lpm_update *upd)
+{
+  struct bgp_node *leaf[BGP_LPM_FANOUT];
+  struct bgp_lpm_node *child[BGP_LPM_FANOUT], *sub, *new;
+  u_int32_t slot, first, last, prefixlen = upd->p->prefixlen;
+  int descend = FALSE, rebuild = FALSE;
+
+  bgp_lpm_node_expand(node, leaf, child);
+
+  /* work out which slots of this node the prefix spans */
+  if (prefixlen > (offset + BGP_LPM_STRIDE)) {
+    first = last = bgp_lpm_slot(&upd->p->u.prefix, offset, lpm->maxlen);
+    descend = TRUE;
+  }
+  else if (prefixlen > offset) {
+    first = bgp_lpm_slot(&upd->p->u.prefix, offset, lpm->maxlen);
+    first &= ~((1 << (offset + BGP_LPM_STRIDE - prefixlen)) - 1);
+    last = first + (1 << (offset + BGP_LPM_STRIDE - prefixlen)) - 1;
+  }
+  else {
+    first = 0;
+    last = (BGP_LPM_FANOUT - 1);
+  }
+
+  for (slot = first; slot <= last; slot++) {
+    if (child[slot] || (descend && upd->add)) {
+      sub = child[slot];
+      if (!sub) sub = bgp_lpm_node_uniform(lpm, leaf[slot]);
+
+      /* if rebuilt, 'sub' gets retired by the recursive call itself */
+      new = bgp_lpm_node_update(lpm, sub, (offset + BGP_LPM_STRIDE), upd);
+
+      /* a child resolving all of its slots to the same route is folded */
+      if (!new->vector && __builtin_popcountll(new->leafvec) == 1) {
+	leaf[slot] = new->leaves[0];
+	child[slot] = NULL;
+	bgp_lpm_retire(lpm, upd, new);
+	rebuild = TRUE;
+      }
+      else if (new != child[slot]) {
+	if (child[slot]) {
+	  /* same shape: the new child can be swapped in place */
+	  __sync_synchronize();
+	  node->children[__builtin_popcountll(node->vector & bgp_lpm_mask(slot)) - 1] = new;
+	}
+	else rebuild = TRUE;
+
+	child[slot] = new;
+      }
+    }
+    else if (!descend) {
+      if (upd->add) {
+	if (!leaf[slot] || leaf[slot]->p.prefixlen < prefixlen) {
+	  leaf[slot] = upd->node;
+	  rebuild = TRUE;
+	}
+      }
+      else if (leaf[slot] == upd->node) {
+	leaf[slot] = upd->repl;
+	rebuild = TRUE;
+      }
+    }
+  }
+
+  if (!rebuild) return node;
+
+  new = bgp_lpm_node_build(lpm, leaf, child);
+  bgp_lpm_retire(lpm, upd, node);
+
+  return new;
+}
+
+static void bgp_lpm_update_apply(struct bgp_lpm *lpm, struct bgp_lpm_update *upd)
+{
+  struct bgp_lpm_node *root;
+  u_int32_t idx;
+
+  root = bgp_lpm_node_update(lpm, lpm->root, 0, upd);
+
+  if (root != lpm->root) {
+    __sync_synchronize();
+    lpm->root = root;
+  }
+
+  for (idx = 0; idx < upd->retired_num; idx++) bgp_epoch_defer(bgp_epoch_free, upd->retired[idx], NULL);
+  if (upd->retired) free(upd->retired);
+}
+
+struct bgp_lpm *bgp_lpm_init(afi_t afi)
+{
+  struct bgp_lpm *lpm;
+
+  if (afi != AFI_IP && afi != AFI_IP6) return NULL;
+
+  lpm = malloc(sizeof(struct bgp_lpm));
+  if (!lpm) {
+    Log(LOG_ERR, "ERROR ( %s/core/BGP ): malloc() failed (bgp_lpm_init). Exiting ..\n", config.name);
+    exit_gracefully(1);
+  }
+
+  memset(lpm, 0, sizeof(struct bgp_lpm));
+  lpm->maxlen = ((afi == AFI_IP) ? 32 : 128);
+  lpm->root = bgp_lpm_node_uniform(lpm, NULL);
+
+  return lpm;
+}
+
+static void bgp_lpm_node_free(struct bgp_lpm_node *node)
+{
+  u_int32_t idx, children_num = __builtin_popcountll(node->vector);
+
+  for (idx = 0; idx < children_num; idx++) bgp_lpm_node_free(node->children[idx]);
+
+  bgp_epoch_defer(bgp_epoch_free, node, NULL);
+}
+
+void bgp_lpm_free(struct bgp_lpm *lpm)
+{
+  if (!lpm) return;
+
+  bgp_lpm_node_free(lpm->root);
+  bgp_epoch_defer(bgp_epoch_free, lpm, NULL);
+}
+
+/* 'node' just got its first route */
+void bgp_lpm_route_add(struct bgp_lpm *lpm, struct bgp_node *node)
+{
+  struct bgp_lpm_update upd;
+
+  if (!lpm || !node || node->p.prefixlen > lpm->maxlen) return;
+
+  memset(&upd, 0, sizeof(upd));
+  upd.p = &node->p;
+  upd.node = node;
+  upd.add = TRUE;
+
+  bgp_lpm_update_apply(lpm, &upd);
+}
+
+/* 'node' lost its last route; 'repl' is the closest ancestor holding any */
+void bgp_lpm_route_delete(struct bgp_lpm *lpm, struct bgp_node *node, struct bgp_node *repl)
+{
+  struct bgp_lpm_update upd;
+
+  if (!lpm || !node || node->p.prefixlen > lpm->maxlen) return;
+
+  memset(&upd, 0, sizeof(upd));
+  upd.p = &node->p;
+  upd.node = node;
+  upd.repl = repl;
+  upd.add = FALSE;
+
+  bgp_lpm_update_apply(lpm, &upd);
+}
+
+/*
+   Same as bgp_lpm_lookup() for 'num' host addresses at once. Rather than
+   walking each path down to its leaf, every round moves all pending
+   lookups one step ahead and prefetches what each of them is going to
+   read next: a node header first, then the child or leaf slot selected
+   by it. Cache misses of the different lookups so overlap instead of
+   being paid one after the other.
+*/
+void bgp_lpm_lookup_batch(struct bgp_lpm *lpm, struct prefix **p, struct bgp_node **result, u_int32_t num)
+{
+  struct bgp_lpm_node *node[BGP_LPM_BATCH_MAX];
+  void **next[BGP_LPM_BATCH_MAX];
+  u_int32_t offset[BGP_LPM_BATCH_MAX], pending[BGP_LPM_BATCH_MAX];
+  u_int32_t idx, pos, left, cnt, slot, base = 0;
+  u_int8_t leaf[BGP_LPM_BATCH_MAX];
+
+  if (!lpm) {
+    for (idx = 0; idx < num; idx++) result[idx] = NULL;
+    return;
+  }
+
+  for (; base < num; base += BGP_LPM_BATCH_MAX) {
+    left = MIN((num - base), BGP_LPM_BATCH_MAX);
+
+    for (idx = 0; idx < left; idx++) {
+      node[idx] = lpm->root;
+      next[idx] = NULL;
+      offset[idx] = 0;
+      pending[idx] = idx;
+    }
+
+    while (left) {
+      for (pos = 0, cnt = 0; pos < left; pos++) {
+	idx = pending[pos];
+
+	/* node header in cache: work out and prefetch the slot to follow */
+	if (!next[idx]) {
+	  slot = bgp_lpm_slot(&p[base + idx]->u.prefix, offset[idx], lpm->maxlen);
+
+	  if (node[idx]->vector & (((u_int64_t) 1) << slot)) {
+	    next[idx] = (void **) &node[idx]->children[__builtin_popcountll(node[idx]->vector & bgp_lpm_mask(slot)) - 1];
+	    leaf[idx] = FALSE;
+	  }
+	  else {
+	    next[idx] = (void **) &node[idx]->leaves[__builtin_popcountll(node[idx]->leafvec & bgp_lpm_mask(slot)) - 1];
+	    leaf[idx] = TRUE;
+	  }
+
+	  __builtin_prefetch(next[idx]);
+	  pending[cnt++] = idx;
+	}
+	/* slot in cache: either done or prefetch the child node header */
+	else if (leaf[idx]) {
+	  result[base + idx] = (struct bgp_node *) (*next[idx]);
+	}
+	else {
+	  node[idx] = (struct bgp_lpm_node *) (*next[idx]);
+	  next[idx] = NULL;
+	  offset[idx] += BGP_LPM_STRIDE;
+
+	  __builtin_prefetch(node[idx]);
+	  pending[cnt++] = idx;
+	}
+      }
+
+      left = cnt;
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef BGP_LPM_H
+#define BGP_LPM_H
+
+/*
+   Longest-prefix match index built alongside a bgp_table (poptrie-like):
+   a multi-bit trie consuming BGP_LPM_STRIDE address bits per level where
+   each node keeps two bitmaps, one flagging slots pointing to a child and
+   one flagging slots starting a new run of leaves; children and leaves
+   are then stored compacted and addressed via popcount. Leaves point to
+   the most specific bgp_node holding any route for the slot.
+
+   The index is maintained by the BGP/BMP thread only and walked lock-less
+   by readers (see bgp_epoch.h). Once published, a node keeps its bitmaps
+   and its leaves; a change to either gets a new node built and published
+   in place of the old one. The one in-place write is to a child pointer,
+   when the child is replaced by a node of the same shape: it is a single
+   aligned pointer store, issued after a barrier so that the new subtree
+   is complete before it becomes reachable. Either way readers see the old
+   or the new subtree, never a mix; unlinked nodes are freed once all the
+   readers are done with them.
+*/
+
+/* defines */
+#define BGP_LPM_STRIDE		6
+#define BGP_LPM_FANOUT		(1 << BGP_LPM_STRIDE)
+#define BGP_LPM_BATCH_MAX	64	/* lookups walked in lock-step */
+
+/* structures */
+struct bgp_lpm_node {
+  u_int64_t vector;		/* slots pointing to a child node */
+  u_int64_t leafvec;		/* slots starting a new run of leaves */
+  struct bgp_lpm_node **children;
+  struct bgp_node **leaves;
+};
+
+struct bgp_lpm {
+  struct bgp_lpm_node *root;
+  u_int8_t maxlen;		/* 32 or 128 bits */
+  u_int64_t nodes;
+};
+
+/* prototypes */
+extern struct bgp_lpm *bgp_lpm_init(afi_t);
+extern void bgp_lpm_free(struct bgp_lpm *);
+extern void bgp_lpm_route_add(struct bgp_lpm *, struct bgp_node *);
+extern void bgp_lpm_route_delete(struct bgp_lpm *, struct bgp_node *, struct bgp_node *);
+extern void bgp_lpm_lookup_batch(struct bgp_lpm *, struct prefix **, struct bgp_node **, u_int32_t);
+
+/* returns the bit slot of 'addr' at bit 'offset', zero-padded past 'maxlen' */
+static inline u_int32_t bgp_lpm_slot(const u_char *addr, u_int32_t offset, u_int32_t maxlen)
+{
+  u_int32_t byte = (offset >> 3), word;
+
+  word = (addr[byte] << 8);
+  if ((byte + 1) < (maxlen >> 3)) word |= addr[byte + 1];
+
+  return ((word >> (16 - BGP_LPM_STRIDE - (offset & 7))) & (BGP_LPM_FANOUT - 1));
+}
+
+/* mask selecting slots 0 to 'slot' included */
+static inline u_int64_t bgp_lpm_mask(u_int32_t slot)
+{
+  return ((((u_int64_t) 2) << slot) - 1);
+}
+
+/* returns the most specific bgp_node holding routes for the host address 'p' */
+static inline struct bgp_node *bgp_lpm_lookup(struct bgp_lpm *lpm, struct prefix *p)
+{
+  struct bgp_lpm_node *node = lpm->root;
+  u_int32_t offset, slot;
+
+  for (offset = 0; node; offset += BGP_LPM_STRIDE) {
+    slot = bgp_lpm_slot(&p->u.prefix, offset, lpm->maxlen);
+
+    if (node->vector & (((u_int64_t) 1) << slot)) {
+      node = node->children[__builtin_popcountll(node->vector & bgp_lpm_mask(slot)) - 1];
+    }
+    else return node->leaves[__builtin_popcountll(node->leafvec & bgp_lpm_mask(slot)) - 1];
+  }
+
+  return NULL;
+}
+
+#endif // BGP_LPM_H
@@ -364,16 +364,8 @@ void bgp_ls_info_delete(struct bgp_peer *peer)
       cdada_list_destroy(blsnmtd.list_del);
     }
 
-    if (bgp_ls_routing_db) {
-      struct bgp_table *table;
-      afi_t afi;
-      safi_t safi = SAFI_UNICAST;
-
-      for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
-	table = bgp_ls_routing_db->rib[afi][safi];
-	bgp_table_info_delete(peer, table, afi, safi);
-      }
-    }
+    /* tag already resolved by bgp_peer_info_delete() */
+    if (bgp_ls_routing_db) bgp_peer_routes_delete(peer, bgp_ls_routing_db);
   }
 }
 
@@ -172,6 +172,7 @@ int bgp_parse_open_msg(struct bgp_msg_data *bmd, char *bgp_packet_ptr, time_t no
       peer->ht = MAX(5, ntohs(bopen->bgpo_holdtime));
       peer->id.family = AF_INET; 
       peer->id.address.ipv4.s_addr = bopen->bgpo_id;
+      bgp_peers_gen_bump(peer->type);
       peer->version = BGP_VERSION4;
 
       /* Check: duplicate Router-IDs; BGP only, ie. no BMP */
@@ -1523,10 +1524,29 @@ int bgp_process_update(struct bgp_msg_data *bmd, struct prefix *p, void *attr, s
         return SUCCESS;
       }
       else {
-        /* Update to new attribute.  */
-        bgp_attr_unintern(peer, ri->attr);
+        struct bgp_attr *attr_old = ri->attr;
+        struct bgp_attr_extra *rie_old = ri->attr_extra;
+
+        /* Update to new attribute. ri may be concurrently read by lookups:
+           attr_extra is rebuilt aside and both are swapped in, old ones are
+           then retired (see bgp_epoch.h) rather than freed in place */
+        memset(&ri_local, 0, sizeof(struct bgp_info));
+        ri_local.peer = peer;
+
+        if (rie_old) {
+          ri_local.attr_extra = bgp_attr_extra_new(&ri_local);
+          memcpy(ri_local.attr_extra, rie_old, sizeof(struct bgp_attr_extra));
+        }
+
+        bgp_attr_extra_process(peer, &ri_local, afi, safi, attr_extra);
+
+        __sync_synchronize();
+        ri->attr_extra = ri_local.attr_extra;
         ri->attr = attr_new;
-        bgp_attr_extra_process(peer, ri, afi, safi, attr_extra);
+
+        bgp_attr_unintern(peer, attr_old);
+        if (rie_old) bgp_epoch_defer(bgp_epoch_free, rie_old, NULL);
+
         if (bms->bgp_extra_data_process) (*bms->bgp_extra_data_process)(&bmd->extra, ri, idx, BGP_NLRI_UPDATE);
 
         bgp_unlock_node (peer, route);
@@ -104,8 +104,10 @@ bgp_node_set (struct bgp_peer *peer, struct bgp_table *table, struct prefix *pre
 
 /* Free route node. */
 static void
-bgp_node_free (struct bgp_node *node)
+bgp_node_free_deferred (void *ptr, void *arg)
 {
+  struct bgp_node *node = ptr;
+
   if (node->info) {
     free (node->info);
     node->info = NULL;
@@ -114,6 +116,13 @@ bgp_node_free (struct bgp_node *node)
   free (node);
 }
 
+/* Readers may still be walking the node: release it after a grace period */
+static void
+bgp_node_free (struct bgp_node *node)
+{
+  bgp_epoch_defer (bgp_node_free_deferred, node, NULL);
+}
+
 /* Utility mask array. */
 static u_char maskbit[] = 
 {
@@ -242,18 +251,47 @@ void bgp_node_vector_debug(struct bgp_node_vector *bnv, struct prefix *p)
   }
 }
 
-/* Find matched prefix. */
-void
-bgp_node_match (const struct bgp_table *table, struct prefix *p, struct bgp_peer *peer,
-		u_int32_t (*modulo_func)(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int),
-		int (*cmp_func)(struct bgp_info *, struct node_match_cmp_term2 *),
-		struct node_match_cmp_term2 *nmct2, struct bgp_node_vector *bnv,
-		struct bgp_node **result_node, struct bgp_info **result_info)
+/* Returns the last route of 'node' satisfying cmp_func, if any */
+static struct bgp_info *
+bgp_node_match_info (struct bgp_node *node, struct prefix *p, u_int32_t modulo, u_int32_t modulo_idx_max,
+		     int (*cmp_func)(struct bgp_info *, struct node_match_cmp_term2 *),
+		     struct node_match_cmp_term2 *nmct2, struct bgp_node_vector *bnv)
+{
+  struct bgp_info *info, *matched_info = NULL;
+  u_int32_t local_modulo, modulo_idx;
+
+  for (local_modulo = modulo, modulo_idx = 0; modulo_idx < modulo_idx_max; local_modulo++, modulo_idx++) {
+    for (info = node->info[local_modulo]; info; info = info->next) {
+      if (!cmp_func(info, nmct2)) {
+	matched_info = info;
+
+	if (bnv) {
+	  bnv->v[bnv->entries].p = &node->p;
+	  bnv->v[bnv->entries].info = info;
+	  bnv->entries++;
+	}
+
+	if (node->p.prefixlen == p->prefixlen) break;
+      }
+    }
+  }
+
+  return matched_info;
+}
+
+/* Find matched prefix; if 'hinted', 'hint' is the outcome of a former bgp_lpm_lookup() for 'p' */
+static void
+bgp_node_match_lpm_hint (const struct bgp_table *table, struct prefix *p, int hinted, struct bgp_node *hint,
+			 struct bgp_peer *peer,
+			 u_int32_t (*modulo_func)(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int),
+			 int (*cmp_func)(struct bgp_info *, struct node_match_cmp_term2 *),
+			 struct node_match_cmp_term2 *nmct2, struct bgp_node_vector *bnv,
+			 struct bgp_node **result_node, struct bgp_info **result_info)
 {
   struct bgp_misc_structs *bms;
   struct bgp_node *node, *matched_node;
   struct bgp_info *info, *matched_info;
-  u_int32_t per_peer_buckets, modulo, local_modulo, modulo_idx, modulo_idx_max;
+  u_int32_t per_peer_buckets, modulo, modulo_idx_max;
 
   if (!table || !peer || !cmp_func) return;
 
@@ -283,34 +321,41 @@ bgp_node_match (const struct bgp_table *table, struct prefix *p, struct bgp_peer
   node = table->top;
   if (bnv) bnv->entries = 0;
 
-  /* Walk down tree.  If there is matched route then store it to matched. */
-  while (node && node->p.prefixlen <= p->prefixlen && prefix_match(&node->p, p)) {
-    for (local_modulo = modulo, modulo_idx = 0; modulo_idx < modulo_idx_max; local_modulo++, modulo_idx++) {
-      for (info = node->info[local_modulo]; info; info = info->next) {
-	if (!cmp_func(info, nmct2)) {
-	  matched_node = node;
-	  matched_info = info;
-
-	  if (bnv) {
-	    bnv->v[bnv->entries].p = &node->p;
-	    bnv->v[bnv->entries].info = info;
-	    bnv->entries++;
-	  }
-
-	  if (node->p.prefixlen == p->prefixlen) break;
-	}
+  /* With a LPM index in place, start from the most specific node holding
+     any route and climb up until one for the peer of interest is found;
+     the full path is instead needed to build the node vector */
+  if (table->lpm && !bnv && p->prefixlen == table->lpm->maxlen) {
+    for (node = (hinted ? hint : bgp_lpm_lookup(table->lpm, p)); node; node = node->parent) {
+      info = bgp_node_match_info(node, p, modulo, modulo_idx_max, cmp_func, nmct2, NULL);
+
+      if (info) {
+	matched_node = node;
+	matched_info = info;
+	break;
       }
     }
+  }
+  else {
+    /* Walk down tree.  If there is matched route then store it to matched. */
+    while (node && node->p.prefixlen <= p->prefixlen && prefix_match(&node->p, p)) {
+      info = bgp_node_match_info(node, p, modulo, modulo_idx_max, cmp_func, nmct2, bnv);
 
-    node = node->link[check_bit(&p->u.prefix, node->p.prefixlen)];
+      if (info) {
+	matched_node = node;
+	matched_info = info;
+      }
+
+      node = node->link[check_bit(&p->u.prefix, node->p.prefixlen)];
+    }
   }
 
   if (config.debug && bnv) bgp_node_vector_debug(bnv, p); 
 
+  /* No bgp_lock_node() here: lookups run outside of the BGP thread and
+     are protected by the reader epoch (see bgp_epoch.h) instead */
   if (matched_node) {
     (*result_node) = matched_node;
     (*result_info) = matched_info;
-    bgp_lock_node (peer, matched_node);
   }
   else {
     (*result_node) = NULL;
@@ -318,6 +363,27 @@ bgp_node_match (const struct bgp_table *table, struct prefix *p, struct bgp_peer
   }
 }
 
+void
+bgp_node_match (const struct bgp_table *table, struct prefix *p, struct bgp_peer *peer,
+		u_int32_t (*modulo_func)(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int),
+		int (*cmp_func)(struct bgp_info *, struct node_match_cmp_term2 *),
+		struct node_match_cmp_term2 *nmct2, struct bgp_node_vector *bnv,
+		struct bgp_node **result_node, struct bgp_info **result_info)
+{
+  bgp_node_match_lpm_hint (table, p, FALSE, NULL, peer, modulo_func, cmp_func, nmct2, bnv, result_node, result_info);
+}
+
+/* Same as bgp_node_match(), the LPM index walk already done (ie. by bgp_lpm_lookup_batch()) */
+void
+bgp_node_match_hint (const struct bgp_table *table, struct prefix *p, struct bgp_node *hint, struct bgp_peer *peer,
+		     u_int32_t (*modulo_func)(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int),
+		     int (*cmp_func)(struct bgp_info *, struct node_match_cmp_term2 *),
+		     struct node_match_cmp_term2 *nmct2, struct bgp_node_vector *bnv,
+		     struct bgp_node **result_node, struct bgp_info **result_info)
+{
+  bgp_node_match_lpm_hint (table, p, TRUE, hint, peer, modulo_func, cmp_func, nmct2, bnv, result_node, result_info);
+}
+
 void
 bgp_node_match_ipv4 (const struct bgp_table *table, struct in_addr *addr, struct bgp_peer *peer,
 		     u_int32_t (*modulo_func)(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int),
@@ -376,9 +442,12 @@ bgp_node_get (struct bgp_peer *peer, struct bgp_table *const table, struct prefi
       node = node->link[check_bit(&p->u.prefix, node->p.prefixlen)];
     }
 
+  /* New nodes must be fully initialized before being linked in, as
+     lock-less readers may reach them as soon as they are published */
   if (node == NULL)
     {
       new = bgp_node_set (peer, table, p);
+      __sync_synchronize ();
       if (match)
 	set_link (match, new);
       else
@@ -390,8 +459,12 @@ bgp_node_get (struct bgp_peer *peer, struct bgp_table *const table, struct prefi
       route_common (&node->p, p, &new->p);
       new->p.family = p->family;
       new->table = table;
+      /* readers climbing up from 'node' (see bgp_node_match()) must
+	 never find a dangling parent */
+      new->parent = match;
       set_link (new, node);
 
+      __sync_synchronize ();
       if (match)
 	set_link (match, new);
       else
@@ -401,6 +474,7 @@ bgp_node_get (struct bgp_peer *peer, struct bgp_table *const table, struct prefi
 	{
 	  match = new;
 	  new = bgp_node_set (peer, table, p);
+	  __sync_synchronize ();
 	  set_link (match, new);
 	  table->count++;
 	}
@@ -566,6 +640,7 @@ void bgp_table_free (struct bgp_table *rt)
  
   assert (rt->count == 0);
 
-  free(rt);
+  bgp_lpm_free (rt->lpm);
+  bgp_epoch_defer (bgp_epoch_free, rt, NULL);
   return;
 }
@@ -42,6 +42,9 @@ struct bgp_table
   struct bgp_node *top;
   
   unsigned long count;
+
+  /* optional longest-prefix match index, see bgp_lpm.h */
+  struct bgp_lpm *lpm;
 };
 
 struct bgp_node
@@ -87,6 +90,9 @@ struct bgp_info
 {
   struct bgp_info *next;
   struct bgp_info *prev;
+  struct bgp_info *peer_next;	/* all routes of the same peer, see bgp_peer.routes */
+  struct bgp_info *peer_prev;
+  struct bgp_node *node;
   struct bgp_peer *peer;
   struct bgp_attr *attr;
   struct bgp_attr_extra *attr_extra;
@@ -129,6 +135,11 @@ extern void bgp_node_match (const struct bgp_table *, struct prefix *, struct bg
 			 int (*cmp_func)(struct bgp_info *, struct node_match_cmp_term2 *),
 			 struct node_match_cmp_term2 *, struct bgp_node_vector *,
 			 struct bgp_node **result_node, struct bgp_info **result_info);
+extern void bgp_node_match_hint (const struct bgp_table *, struct prefix *, struct bgp_node *, struct bgp_peer *,
+			      u_int32_t (*modulo_func)(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int),
+			      int (*cmp_func)(struct bgp_info *, struct node_match_cmp_term2 *),
+			      struct node_match_cmp_term2 *, struct bgp_node_vector *,
+			      struct bgp_node **result_node, struct bgp_info **result_info);
 extern void bgp_node_match_ipv4 (const struct bgp_table *, struct in_addr *, struct bgp_peer *,
 			      u_int32_t (*modulo_func)(struct bgp_peer *, rd_t *,  path_id_t *, struct bgp_msg_extra_data *, int),
 			      int (*cmp_func)(struct bgp_info *, struct node_match_cmp_term2 *),
@@ -383,9 +383,25 @@ struct bgp_info *bgp_info_new(struct bgp_peer *peer)
   return new;
 }
 
+/* TRUE if no peer holds any route for 'rn' */
+static int bgp_node_is_empty(struct bgp_misc_structs *bms, struct bgp_node *rn)
+{
+  u_int32_t ri_idx;
+
+  for (ri_idx = 0; ri_idx < (bms->table_peer_buckets * bms->table_per_peer_buckets); ri_idx++) {
+    if (rn->info[ri_idx]) return FALSE;
+  }
+
+  return TRUE;
+}
+
 void bgp_info_add(struct bgp_peer *peer, struct bgp_node *rn, struct bgp_info *ri, u_int32_t modulo)
 {
+  struct bgp_misc_structs *bms = bgp_select_misc_db(peer->type);
   struct bgp_info *top;
+  int lpm_add = FALSE;
+
+  if (rn->table->lpm && bgp_node_is_empty(bms, rn)) lpm_add = TRUE;
 
   top = rn->info[modulo];
 
@@ -393,8 +409,20 @@ void bgp_info_add(struct bgp_peer *peer, struct bgp_node *rn, struct bgp_info *r
   ri->prev = NULL;
   if (top)
     top->prev = ri;
+
+  ri->node = rn;
+  ri->peer_prev = NULL;
+  ri->peer_next = ri->peer->routes;
+  if (ri->peer->routes)
+    ri->peer->routes->peer_prev = ri;
+  ri->peer->routes = ri;
+
+  /* ri must be complete before lock-less readers can reach it */
+  __sync_synchronize();
   rn->info[modulo] = ri;
 
+  if (lpm_add) bgp_lpm_route_add(rn->table->lpm, rn);
+
   bgp_lock_node(peer, rn);
   ri->peer->lock++;
 }
@@ -415,21 +443,50 @@ void bgp_info_delete(struct bgp_peer *peer, struct bgp_node *rn, struct bgp_info
     rn->info[modulo] = ri->next;
   }
 
+  if (ri->peer_next) {
+    ri->peer_next->peer_prev = ri->peer_prev;
+  }
+  if (ri->peer_prev) {
+    ri->peer_prev->peer_next = ri->peer_next;
+  }
+  else {
+    ri->peer->routes = ri->peer_next;
+  }
+
+  /* the index falls back to the closest ancestor still holding routes */
+  if (rn->table->lpm && bgp_node_is_empty(bms, rn)) {
+    struct bgp_node *repl;
+
+    for (repl = rn->parent; repl && bgp_node_is_empty(bms, repl); repl = repl->parent);
+    bgp_lpm_route_delete(rn->table->lpm, rn, repl);
+  }
+
   bgp_info_free(peer, ri, bms->bgp_extra_data_free);
 
   bgp_unlock_node(peer, rn);
 }
 
+static void bgp_info_free_deferred(void *ptr, void *arg)
+{
+  struct bgp_info *ri = ptr;
+  struct bgp_misc_structs *bms = arg;
+
+  if (ri->attr_extra) free(ri->attr_extra);
+  if (bms && bms->bgp_extra_data_free) (*bms->bgp_extra_data_free)(&ri->bmed);
+
+  free(ri);
+}
+
 /* Free bgp route information. */
 void bgp_info_free(struct bgp_peer *peer, struct bgp_info *ri, void (*bgp_extra_data_free)(struct bgp_msg_extra_data *))
 {
   if (ri->attr) bgp_attr_unintern(peer, ri->attr);
 
-  bgp_attr_extra_free(peer, &ri->attr_extra);
-  if (bgp_extra_data_free) (*bgp_extra_data_free)(&ri->bmed);
-
   ri->peer->lock--;
-  free(ri);
+
+  /* ri is unlinked already but readers may still hold it: attr is retired
+     by bgp_attr_unintern(), the rest is released after a grace period */
+  bgp_epoch_defer(bgp_info_free_deferred, ri, bgp_extra_data_free ? bgp_select_misc_db(peer->type) : NULL);
 }
 
 /* Initialization of attributes */
@@ -567,7 +624,7 @@ void bgp_attr_unintern(struct bgp_peer *peer, struct bgp_attr *attr)
     ret = (struct bgp_attr *) hash_release(inter_domain_routing_db->attrhash, attr);
     // assert (ret != NULL);
     if (!ret) Log(LOG_INFO, "INFO ( %s/%s ): bgp_attr_unintern() hash lookup failed.\n", config.name, bms->log_str);
-    free(attr);
+    bgp_epoch_defer(bgp_epoch_free, attr, NULL);
   }
 
   /* aspath refcount shoud be decrement. */
@@ -614,22 +671,22 @@ struct bgp_peer_cache *bgp_peer_cache_insert(struct bgp_peer_cache_bucket *cache
 {
   struct bgp_peer_cache *cursor, *last, *new, *ret = NULL;
 
-  pthread_mutex_lock(&peers_cache[bucket].mutex);  
+  pthread_mutex_lock(&cache[bucket].mutex);  
 
-  for (cursor = peers_cache[bucket].e, last = NULL; cursor; cursor = cursor->next) last = cursor;
+  for (cursor = cache[bucket].e, last = NULL; cursor; cursor = cursor->next) last = cursor;
 
   new = malloc(sizeof(struct bgp_peer_cache));
   if (new) {
     new->ptr = peer;
     new->next = NULL;
 
-    if (!last) peers_cache[bucket].e = new;
+    if (!last) cache[bucket].e = new;
     else last->next = new; 
 
     ret = new;
   }
 
-  pthread_mutex_unlock(&peers_cache[bucket].mutex);  
+  pthread_mutex_unlock(&cache[bucket].mutex);  
 
   return ret;
 }
@@ -639,11 +696,11 @@ int bgp_peer_cache_delete(struct bgp_peer_cache_bucket *cache, u_int32_t bucket,
   struct bgp_peer_cache *cursor, *last;
   int ret = ERR;
 
-  pthread_mutex_lock(&peers_cache[bucket].mutex);  
+  pthread_mutex_lock(&cache[bucket].mutex);  
 
-  for (cursor = peers_cache[bucket].e, last = NULL; cursor; cursor = cursor->next) {
+  for (cursor = cache[bucket].e, last = NULL; cursor; cursor = cursor->next) {
     if (cursor->ptr == peer) {
-      if (!last) peers_cache[bucket].e = cursor->next;
+      if (!last) cache[bucket].e = cursor->next;
       else last->next = cursor->next;
 
       free(cursor);
@@ -655,7 +712,7 @@ int bgp_peer_cache_delete(struct bgp_peer_cache_bucket *cache, u_int32_t bucket,
     last = cursor;
   }
 
-  pthread_mutex_unlock(&peers_cache[bucket].mutex);
+  pthread_mutex_unlock(&cache[bucket].mutex);
 
   return ret;
 }
@@ -665,9 +722,9 @@ struct bgp_peer *bgp_peer_cache_search(struct bgp_peer_cache_bucket *cache, u_in
   struct bgp_peer_cache *cursor;
   struct bgp_peer *ret = NULL;
 
-  pthread_mutex_lock(&peers_cache[bucket].mutex);
+  pthread_mutex_lock(&cache[bucket].mutex);
 
-  for (cursor = peers_cache[bucket].e; cursor; cursor = cursor->next) {
+  for (cursor = cache[bucket].e; cursor; cursor = cursor->next) {
     if (port) {
       if (cursor->ptr->tcp_port != port) continue;
     }
@@ -678,11 +735,27 @@ struct bgp_peer *bgp_peer_cache_search(struct bgp_peer_cache_bucket *cache, u_in
     }
   }
 
-  pthread_mutex_unlock(&peers_cache[bucket].mutex);
+  pthread_mutex_unlock(&cache[bucket].mutex);
 
   return ret;
 }
 
+/*
+   To be called whenever a peer gets its address or ID set or cleared:
+   lookups resolving an exporter to its peer (ie. bgp_lookup_find_bgp_peer())
+   cache the outcome per xflow status entry and validate it against the
+   generation only, so to take no locks on the steady-state flow path.
+*/
+void bgp_peers_gen_bump(int type)
+{
+  struct bgp_misc_structs *bms;
+
+  bms = bgp_select_misc_db(type);
+  if (!bms) return;
+
+  __sync_fetch_and_add(&bms->peers_gen, 1);
+}
+
 int bgp_peer_init(struct bgp_peer *peer, int type, int buflen)
 {
   struct bgp_misc_structs *bms;
@@ -769,6 +842,7 @@ void bgp_peer_close(struct bgp_peer *peer, int type, int no_quiet, int send_noti
   memset(&peer->id, 0, sizeof(peer->id));
   memset(&peer->addr, 0, sizeof(peer->addr));
   memset(&peer->addr_str, 0, sizeof(peer->addr_str));
+  bgp_peers_gen_bump(peer->type);
   memset(&peer->peer_distinguisher, 0, sizeof(peer->peer_distinguisher));
   memset(&peer->eor, 0, sizeof(peer->eor));
 
@@ -878,62 +952,93 @@ void bgp_peer_xconnect_print(struct bgp_peer *peer, char *buf, int len)
   }
 }
 
-void bgp_peer_info_delete(struct bgp_peer *peer)
+/* Logs and deletes a route found via the peer's list of routes */
+static void bgp_peer_route_delete(struct bgp_peer *peer, struct bgp_misc_structs *bms, struct bgp_info *ri)
 {
-  struct bgp_rt_structs *inter_domain_routing_db = bgp_select_routing_db(peer->type);
-  struct bgp_table *table;
-  afi_t afi;
-  safi_t safi;
+  struct bgp_node *node = ri->node;
+  u_int32_t modulo = 0, modulo_max;
+
+  if (bms->msglog_backend_methods) {
+    char event_type[] = "log";
+
+    bgp_peer_log_msg(node, ri, node->table->afi, node->table->safi, bms->tag, event_type, bms->msglog_output, NULL, BGP_LOG_TYPE_DELETE);
+  }
 
-  if (!inter_domain_routing_db) return;
+  /* the bucket is only needed when ri heads its list: look among the
+     per-peer buckets of the peer, as bgp_table_info_delete() used to */
+  if (!ri->prev) {
+    if (bms->route_info_modulo) modulo = bms->route_info_modulo(peer, NULL, NULL, NULL, bms->table_per_peer_buckets);
+    modulo_max = (modulo + bms->table_per_peer_buckets);
+
+    for (; modulo < modulo_max; modulo++) {
+      if (node->info[modulo] == ri) break;
+    }
 
-  for (afi = AFI_IP; afi < AFI_MAX; afi++) {
-    for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
-      table = inter_domain_routing_db->rib[afi][safi];
-      bgp_table_info_delete(peer, table, afi, safi);
+    /* not expected: fall back to all buckets */
+    if (modulo == modulo_max) {
+      modulo_max = (bms->table_peer_buckets * bms->table_per_peer_buckets);
+
+      for (modulo = 0; modulo < modulo_max; modulo++) {
+	if (node->info[modulo] == ri) break;
+      }
     }
   }
 
-  bgp_ls_info_delete(peer);
+  bgp_info_delete(peer, node, ri, modulo);
 }
 
-void bgp_table_info_delete(struct bgp_peer *peer, struct bgp_table *table, afi_t afi, safi_t safi)
+/*
+   Deletes the routes of the peer held by any table of the routing db;
+   the tag for msglog is expected to be already resolved by the caller
+*/
+void bgp_peer_routes_delete(struct bgp_peer *peer, struct bgp_rt_structs *rt)
+{
+  struct bgp_misc_structs *bms = bgp_select_misc_db(peer->type);
+  struct bgp_table *table;
+  struct bgp_info *ri, *ri_next;
+
+  if (!bms || !rt) return;
+
+  /* teardown is proportional to the routes of the peer, not to the RIB */
+  for (ri = peer->routes; ri; ri = ri_next) {
+    ri_next = ri->peer_next;
+    table = ri->node->table;
+
+    if (table == rt->rib[table->afi][table->safi]) bgp_peer_route_delete(peer, bms, ri);
+  }
+}
+
+void bgp_peer_info_delete(struct bgp_peer *peer)
 {
+  struct bgp_rt_structs *inter_domain_routing_db = bgp_select_routing_db(peer->type);
   struct bgp_misc_structs *bms = bgp_select_misc_db(peer->type);
-  struct bgp_node *node;
 
+  if (!inter_domain_routing_db || !bms) return;
+
+  /* resolved once here, also for the BGP-LS routes */
   if (bms->tag_map && bms->bgp_table_info_delete_tag_find) {
     bms->bgp_table_info_delete_tag_find(peer);
   }
 
-  node = bgp_table_top(peer, table);
-
-  while (node) {
-    u_int32_t modulo;
-    u_int32_t peer_buckets;
-    struct bgp_info *ri;
-    struct bgp_info *ri_next;
+  bgp_peer_routes_delete(peer, inter_domain_routing_db);
+  bgp_ls_info_delete(peer);
+}
 
-    if (bms->route_info_modulo) modulo = bms->route_info_modulo(peer, NULL, NULL, NULL, bms->table_per_peer_buckets);
-    else modulo = 0;
+void bgp_table_info_delete(struct bgp_peer *peer, struct bgp_table *table, afi_t afi, safi_t safi)
+{
+  struct bgp_misc_structs *bms = bgp_select_misc_db(peer->type);
+  struct bgp_info *ri, *ri_next;
 
-    for (peer_buckets = 0; peer_buckets < bms->table_per_peer_buckets; peer_buckets++) {
-      for (ri = node->info[modulo + peer_buckets]; ri; ri = ri_next) {
-	if (ri->peer == peer) {
-	  if (bms->msglog_backend_methods) {
-	    char event_type[] = "log";
+  if (!bms || !table) return;
 
-	    bgp_peer_log_msg(node, ri, afi, safi, bms->tag, event_type, bms->msglog_output, NULL, BGP_LOG_TYPE_DELETE);
-	  }
+  if (bms->tag_map && bms->bgp_table_info_delete_tag_find) {
+    bms->bgp_table_info_delete_tag_find(peer);
+  }
 
-	  ri_next = ri->next; /* let's save pointer to next before free up */
-          bgp_info_delete(peer, node, ri, (modulo + peer_buckets));
-        }
-	else ri_next = ri->next;
-      }
-    }
+  for (ri = peer->routes; ri; ri = ri_next) {
+    ri_next = ri->peer_next;
 
-    node = bgp_route_next(peer, node);
+    if (ri->node->table == table) bgp_peer_route_delete(peer, bms, ri);
   }
 }
 
@@ -85,11 +85,13 @@ extern int bgp_peer_xconnect_init(struct bgp_peer *, int);
 extern void bgp_peer_print(struct bgp_peer *, char *, int);
 extern void bgp_peer_xconnect_print(struct bgp_peer *, char *, int);
 extern void bgp_peer_info_delete(struct bgp_peer *);
+extern void bgp_peer_routes_delete(struct bgp_peer *, struct bgp_rt_structs *);
 extern void bgp_table_info_delete(struct bgp_peer *, struct bgp_table *, afi_t, safi_t);
 extern void bgp_peer_cache_init(struct bgp_peer_cache_bucket *, u_int32_t);
 extern struct bgp_peer_cache *bgp_peer_cache_insert(struct bgp_peer_cache_bucket *, u_int32_t, struct bgp_peer *);
 extern int bgp_peer_cache_delete(struct bgp_peer_cache_bucket *, u_int32_t, struct bgp_peer *);
 extern struct bgp_peer *bgp_peer_cache_search(struct bgp_peer_cache_bucket *, u_int32_t, struct host_addr *, u_int16_t);
+extern void bgp_peers_gen_bump(int);
 
 extern void bgp_batch_init(struct bgp_peer_batch *, int, int);
 extern void bgp_batch_reset(struct bgp_peer_batch *, time_t);
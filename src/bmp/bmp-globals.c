@@ -24,6 +24,8 @@
 #include "bmp.h"
 
 struct bmp_peer *bmp_peers = NULL;
+struct bgp_peer_cache_bucket *bmp_bgp_peers_cache = NULL;
+u_int32_t bmp_bgp_peers_cache_buckets = 0;
 u_int32_t (*bmp_route_info_modulo)(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int) = NULL;
 struct bgp_rt_structs *bmp_routing_db = NULL;
 struct bgp_misc_structs *bmp_misc_db = NULL;
@@ -151,6 +151,16 @@ int skinny_bmp_daemon()
   }
   memset(bmp_peers, 0, config.bmp_daemon_max_peers*sizeof(struct bmp_peer));
 
+  /* BGP peers learnt via BMP peer up, indexed by address for flow correlation */
+  bmp_bgp_peers_cache_buckets = (config.bmp_daemon_max_peers * BMP_BGP_PEERS_CACHE_RATIO);
+  bmp_bgp_peers_cache = malloc(bmp_bgp_peers_cache_buckets*sizeof(struct bgp_peer_cache_bucket));
+  if (!bmp_bgp_peers_cache) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() BMP BGP peers cache structure. Terminating thread.\n", config.name, bmp_misc_db->log_str);
+    exit_gracefully(1);
+  }
+
+  bgp_peer_cache_init(bmp_bgp_peers_cache, bmp_bgp_peers_cache_buckets);
+
   if (config.rpki_roas_file || config.rpki_rtr_cache) {
     rpki_daemon_wrapper();
 
@@ -360,6 +370,7 @@ int skinny_bmp_daemon()
   for (afi = AFI_IP; afi < AFI_MAX; afi++) {
     for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
       bmp_routing_db->rib[afi][safi] = bgp_table_init(afi, safi);
+      if (config.bmp_table_lpm_index) bmp_routing_db->rib[afi][safi]->lpm = bgp_lpm_init(afi);
     }
   }
 
@@ -661,6 +672,8 @@ int skinny_bmp_daemon()
     select_num = select(select_fd, &read_descs, NULL, NULL, drt_ptr);
     if (select_num < 0) goto select_again;
 
+    bgp_epoch_reclaim();
+
     if (reload_map_bmp_thread) {
       if (config.bmp_daemon_allow_file) load_allow_file(config.bmp_daemon_allow_file, &allow);
 
@@ -868,6 +881,7 @@ int skinny_bmp_daemon()
       sa_to_addr((struct sockaddr *) &client, &peer->addr, &peer->tcp_port);
       addr_to_str(peer->addr_str, &peer->addr);
       memcpy(&peer->id, &peer->addr, sizeof(struct host_addr)); /* XXX: some inet_ntoa()'s could be around against peer->id */
+      bgp_peers_gen_bump(FUNC_TYPE_BMP);
 
       if (!config.bmp_daemon_parse_proxy_header) {
 	if (config.bmp_daemon_tag_map) {
@@ -928,6 +942,7 @@ int skinny_bmp_daemon()
       if (ret < 0) {
         goto select_again; /* partial header */
       }
+      bgp_peers_gen_bump(FUNC_TYPE_BMP);
       addr_to_str(peer->addr_str, &peer->addr);
 
       if (config.bmp_daemon_tag_map) {
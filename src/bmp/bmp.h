@@ -27,6 +27,7 @@
 /* defines */
 #define BMP_TCP_PORT		1790
 #define BMP_MAX_PEERS_DEFAULT	10
+#define BMP_BGP_PEERS_CACHE_RATIO	256	/* BGP peers cache buckets per BMP peer */
 #define BMP_V3			3
 #define BMP_V4			4
 
@@ -390,6 +391,8 @@ extern void bmp_daemon_msglog_prepare_sd_schemas();
 
 /* global variables */
 extern struct bmp_peer *bmp_peers;
+extern struct bgp_peer_cache_bucket *bmp_bgp_peers_cache;
+extern u_int32_t bmp_bgp_peers_cache_buckets;
 extern u_int32_t (*bmp_route_info_modulo)(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int);
 extern struct bgp_rt_structs *bmp_routing_db;
 extern struct bgp_misc_structs *bmp_misc_db;
@@ -31,66 +31,52 @@ void bmp_srcdst_lookup(struct packet_ptrs *pptrs, struct bgp_lookup_info *bl_inf
 
 struct bgp_peer *bgp_lookup_find_bmp_peer(struct sockaddr *sa, struct xflow_status_entry *xs_entry, u_int16_t l3_proto, int compare_bgp_port)
 {
+  struct bgp_misc_structs *bms = bgp_select_misc_db(FUNC_TYPE_BMP);
+  struct xflow_status_peer_cache *pc;
   struct bgp_peer *peer;
-  u_int32_t peer_idx, *peer_idx_ptr;
+  struct host_addr addr;
+  u_int16_t port;
+  u_int32_t gen = 0;
   int peers_idx;
 
-  peer_idx = 0; peer_idx_ptr = NULL;
-  if (xs_entry) {
-    if (l3_proto == ETHERTYPE_IP) {
-      peer_idx = xs_entry->peer_v4_idx;
-      peer_idx_ptr = &xs_entry->peer_v4_idx;
-    }
-    else if (l3_proto == ETHERTYPE_IPV6) {
-      peer_idx = xs_entry->peer_v6_idx;
-      peer_idx_ptr = &xs_entry->peer_v6_idx;
-    }
-  }
+  pc = bgp_lookup_peer_cache(xs_entry, l3_proto);
+  if (!bms) pc = NULL;
 
-  if (xs_entry && peer_idx) {
-    if (!sa_addr_cmp(sa, &bmp_peers[peer_idx].self.addr) || !sa_addr_cmp(sa, &bmp_peers[peer_idx].self.id))
-      peer = &bmp_peers[peer_idx].self;
-    /* If no match then let's invalidate the entry */
-    else {
-      *peer_idx_ptr = 0;
-      peer = NULL;
-    }
-  }
-  else {
-    int bmp_peer_found = FALSE;
+  sa_to_addr(sa, &addr, &port);
 
-    /* use-case #1: BMP peer being the edge router */
-    for (peer = NULL, peers_idx = 0; peers_idx < config.bmp_daemon_max_peers; peers_idx++) {
-      if (!sa_addr_cmp(sa, &bmp_peers[peers_idx].self.addr) || !sa_addr_cmp(sa, &bmp_peers[peers_idx].self.id)) {
-        peer = &bmp_peers[peers_idx].self;
-        if (xs_entry && peer_idx_ptr) *peer_idx_ptr = peers_idx;
+  if (pc) {
+    gen = bms->peers_gen;
 
-        bmp_peer_found = TRUE;
-        break;
-      }
-    }
-    
-    if (!bmp_peer_found) {
-      
-      /* use-case #2: BMP peer being the reflector; XXX: fix caching */
-      for (peer = NULL, peers_idx = 0; peers_idx < config.bmp_daemon_max_peers; peers_idx++) {
-        void *ret = NULL;
-
-        if (sa->sa_family == AF_INET) {
-          ret = pm_tfind(sa, &bmp_peers[peers_idx].bgp_peers_v4, bgp_peer_sa_addr_cmp);
-        }
-        else if (sa->sa_family == AF_INET6) {
-          ret = pm_tfind(sa, &bmp_peers[peers_idx].bgp_peers_v6, bgp_peer_sa_addr_cmp);
-        }
+    /* BMP peers are not told apart by port */
+    if (bgp_lookup_peer_cache_get(pc, FUNC_TYPE_BMP, gen, &addr, 0, &peer)) return peer;
 
-        if (ret) {
-          peer = (*(struct bgp_peer **) ret);
-          break;
-        }
-      }
+    /* peers must not be read before the generation */
+    __sync_synchronize();
+  }
+
+  /* use-case #1: BMP peer being the edge router */
+  for (peer = NULL, peers_idx = 0; peers_idx < config.bmp_daemon_max_peers; peers_idx++) {
+    if (!sa_addr_cmp(sa, &bmp_peers[peers_idx].self.addr) || !sa_addr_cmp(sa, &bmp_peers[peers_idx].self.id)) {
+      peer = &bmp_peers[peers_idx].self;
+      break;
     }
   }
 
+  /*
+     use-case #2: BMP peer being the reflector. The flow RD is not known
+     yet at this stage (bgp_lookup_find_peer() gets none), so the search is
+     on the address only: if the same BGP peer address is seen under more
+     than one peer distinguisher, only one of them is returned, a limit the
+     search over the per-BMP-peer trees had already. Correlating with the
+     other instances would need the RD passed down here and made part of
+     the per-exporter peer cache key.
+  */
+  if (!peer && (sa->sa_family == AF_INET || sa->sa_family == AF_INET6)) {
+    peer = bmp_bgp_peers_cache_search(&addr, NULL);
+  }
+
+  if (pc) bgp_lookup_peer_cache_set(pc, FUNC_TYPE_BMP, gen, &addr, 0, peer);
+
   return peer;
 }
 
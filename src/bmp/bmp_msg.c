@@ -398,6 +398,7 @@ void bmp_process_msg_peer_up(char **bmp_packet, u_int32_t *len, struct bmp_peer
 
   bmp_get_and_check_length(bmp_packet, len, bgp_open_len);
   memcpy(&bmpp->self.id, &bgp_peer_loc.id, sizeof(struct host_addr));
+  bgp_peers_gen_bump(FUNC_TYPE_BMP);
   memcpy(&bgp_peer_loc.addr, &blpu.local_ip, sizeof(struct host_addr));
 
   bgp_peer_rem.type = FUNC_TYPE_BMP;
@@ -454,6 +455,10 @@ void bmp_process_msg_peer_up(char **bmp_packet, u_int32_t *len, struct bmp_peer
   }
 
   if (!ret) Log(LOG_WARNING, "WARN ( %s/%s ): [%s] [peer up] tsearch() unable to insert.\n", config.name, bms->log_str, peer->addr_str);
+  else {
+    bmp_bgp_peers_cache_insert(*(struct bgp_peer **) ret);
+    bgp_peers_gen_bump(FUNC_TYPE_BMP);
+  }
 
   while ((*len)) {
     u_int32_t pen = 0;
@@ -658,6 +663,9 @@ void bmp_process_msg_peer_down(char **bmp_packet, u_int32_t *len, struct bmp_pee
   if (ret) {
     bmpp_bgp_peer = (*(struct bgp_peer **) ret);
 
+    bmp_bgp_peers_cache_delete(bmpp_bgp_peer);
+    bgp_peers_gen_bump(FUNC_TYPE_BMP);
+
     bgp_peer_info_delete(bmpp_bgp_peer);
 
     if (bdata.family == AF_INET) {
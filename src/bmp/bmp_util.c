@@ -298,6 +298,10 @@ void bmp_peer_close(struct bmp_peer *bmpp, int type)
 
   if (!bms) return;
 
+  pm_twalk(bmpp->bgp_peers_v4, bmp_bgp_peers_cache_walk_delete, NULL);
+  pm_twalk(bmpp->bgp_peers_v6, bmp_bgp_peers_cache_walk_delete, NULL);
+  bgp_peers_gen_bump(FUNC_TYPE_BMP);
+
   pm_twalk(bmpp->bgp_peers_v4, bgp_peers_bintree_walk_delete, NULL);
   pm_twalk(bmpp->bgp_peers_v6, bgp_peers_bintree_walk_delete, NULL);
 
@@ -311,6 +315,75 @@ void bmp_peer_close(struct bmp_peer *bmpp, int type)
   bgp_peer_close(peer, type, FALSE, FALSE, FALSE, FALSE, NULL);
 }
 
+/*
+   BGP peers learnt via BMP peer up messages (ie. route-reflector use-case)
+   are indexed by address in a global hash, on top of the per-BMP session
+   trees, so that flows can be correlated without probing every session.
+   Written by the BMP thread, read by the Core Process on peer cache misses.
+*/
+void bmp_bgp_peers_cache_insert(struct bgp_peer *peer)
+{
+  u_int32_t bucket;
+
+  if (!bmp_bgp_peers_cache || !peer) return;
+
+  bucket = addr_hash(&peer->addr, bmp_bgp_peers_cache_buckets);
+
+  /* peer up may be repeated for an already known peer */
+  bgp_peer_cache_delete(bmp_bgp_peers_cache, bucket, peer);
+  bgp_peer_cache_insert(bmp_bgp_peers_cache, bucket, peer);
+}
+
+void bmp_bgp_peers_cache_delete(struct bgp_peer *peer)
+{
+  u_int32_t bucket;
+
+  if (!bmp_bgp_peers_cache || !peer) return;
+
+  bucket = addr_hash(&peer->addr, bmp_bgp_peers_cache_buckets);
+  bgp_peer_cache_delete(bmp_bgp_peers_cache, bucket, peer);
+}
+
+/*
+   A NULL peer distinguisher matches any. Buckets are hashed on the address
+   only, so that such searches stay a single bucket walk; peers sharing the
+   address but not the peer distinguisher are then told apart by the loop.
+*/
+struct bgp_peer *bmp_bgp_peers_cache_search(struct host_addr *ha, rd_t *pd)
+{
+  struct bgp_peer_cache *cursor;
+  struct bgp_peer *ret = NULL;
+  u_int32_t bucket;
+
+  if (!bmp_bgp_peers_cache || !ha) return NULL;
+
+  bucket = addr_hash(ha, bmp_bgp_peers_cache_buckets);
+
+  pthread_mutex_lock(&bmp_bgp_peers_cache[bucket].mutex);
+
+  for (cursor = bmp_bgp_peers_cache[bucket].e; cursor; cursor = cursor->next) {
+    if (host_addr_cmp(&cursor->ptr->addr, ha)) continue;
+    if (pd && memcmp(&cursor->ptr->peer_distinguisher, pd, sizeof(rd_t))) continue;
+
+    ret = cursor->ptr;
+    break;
+  }
+
+  pthread_mutex_unlock(&bmp_bgp_peers_cache[bucket].mutex);
+
+  return ret;
+}
+
+int bmp_bgp_peers_cache_walk_delete(const void *nodep, const pm_VISIT which, const int depth, void *extra)
+{
+  struct bgp_peer *peer;
+
+  peer = (*(struct bgp_peer **) nodep);
+  if (peer) bmp_bgp_peers_cache_delete(peer);
+
+  return TRUE;
+}
+
 void bgp_msg_data_set_data_bmp(struct bmp_chars *bmed_bmp, struct bmp_data *bdata)
 {
   memcpy(bmed_bmp, &bdata->chars, sizeof(struct bmp_chars));
@@ -36,6 +36,10 @@ extern void bmp_link_misc_structs(struct bgp_misc_structs *);
 extern struct bgp_peer *bmp_sync_loc_rem_peers(struct bgp_peer *, struct bgp_peer *);
 extern int bmp_peer_init(struct bmp_peer *, int);
 extern void bmp_peer_close(struct bmp_peer *, int);
+extern void bmp_bgp_peers_cache_insert(struct bgp_peer *);
+extern void bmp_bgp_peers_cache_delete(struct bgp_peer *);
+extern struct bgp_peer *bmp_bgp_peers_cache_search(struct host_addr *, rd_t *);
+extern int bmp_bgp_peers_cache_walk_delete(const void *, const pm_VISIT, const int, void *);
 
 extern char *bmp_term_reason_print(u_int16_t);
 
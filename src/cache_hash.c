@@ -0,0 +1,220 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "cache_hash.h"
+
+/* global variables */
+static u_int32_t cache_hash_resolve(const unsigned char *, unsigned int, u_int32_t);
+
+cache_hash_func_t cache_hash_func = cache_hash_resolve;
+
+static struct cache_hash_ranges cache_hash_pp_ranges;
+static int cache_hash_pp_ranges_init = FALSE;
+
+/* functions */
+static inline u_int64_t cache_hash_portable_mix(u_int64_t h, u_int64_t w)
+{
+  h ^= (w * 0x9E3779B97F4A7C15ULL);
+  h = ((h << 31) | (h >> 33));
+
+  return (h * 0xC2B2AE3D27D4EB4FULL);
+}
+
+u_int32_t cache_hash_portable(const unsigned char *buf, unsigned int len, u_int32_t seed)
+{
+  u_int64_t h = (seed ^ ((u_int64_t) len << 32)), w;
+
+  for (; len >= 8; buf += 8, len -= 8) {
+    memcpy(&w, buf, 8);
+    h = cache_hash_portable_mix(h, w);
+  }
+
+  if (len) {
+    w = 0;
+    memcpy(&w, buf, len);
+    h = cache_hash_portable_mix(h, w);
+  }
+
+  /* final avalanche, so that low bits depend on the whole key */
+  h ^= (h >> 33);
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= (h >> 33);
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= (h >> 33);
+
+  return (u_int32_t) h;
+}
+
+#if defined (__x86_64__) && defined (__GNUC__)
+__attribute__ ((target ("sse4.2")))
+u_int32_t cache_hash_crc32c(const unsigned char *buf, unsigned int len, u_int32_t seed)
+{
+  u_int64_t crc = seed, w;
+  u_int32_t w32;
+
+  for (; len >= 8; buf += 8, len -= 8) {
+    memcpy(&w, buf, 8);
+    crc = __builtin_ia32_crc32di(crc, w);
+  }
+
+  if (len >= 4) {
+    memcpy(&w32, buf, 4);
+    crc = __builtin_ia32_crc32si((u_int32_t) crc, w32);
+    buf += 4;
+    len -= 4;
+  }
+
+  for (; len; buf++, len--) crc = __builtin_ia32_crc32qi((u_int32_t) crc, (*buf));
+
+  return (u_int32_t) crc;
+}
+#endif
+
+/* picks the implementation upon first use, then gets out of the way */
+static u_int32_t cache_hash_resolve(const unsigned char *buf, unsigned int len, u_int32_t seed)
+{
+  cache_hash_func_t func = cache_hash_portable;
+
+#if defined (__x86_64__) && defined (__GNUC__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2")) func = cache_hash_crc32c;
+#endif
+
+  cache_hash_func = func;
+
+  return (*func)(buf, len, seed);
+}
+
+/* TRUE if the word at 'off' is entirely made of skipped bytes */
+static int cache_hash_skip_word(const u_char *skip, u_int32_t off)
+{
+  u_int32_t idx;
+
+  for (idx = off; idx < (off + CACHE_HASH_WORD) && idx < sizeof(struct pkt_primitives); idx++) {
+    if (!skip[idx]) return FALSE;
+  }
+
+  return TRUE;
+}
+
+#define CACHE_HASH_SKIP(skip, field) memset(&skip[offsetof(struct pkt_primitives, field)], TRUE, \
+					    sizeof(((struct pkt_primitives *)0)->field))
+
+/*
+   Primitives not part of the aggregate are left zeroed by the Core Process
+   (or cleared by the networks_file handlers), hence hashing and comparing
+   them is wasted work. Only the largest fields are considered and a field
+   is skipped only if none of the primitives possibly filling it in is
+   configured. Skipping is never a correctness issue: keys are still
+   compared in full, a wrong guess would just make for more collisions.
+*/
+void cache_hash_ranges_init(struct cache_hash_ranges *r, pm_cfgreg_t wtc, pm_cfgreg_t wtc_2)
+{
+  u_char skip[sizeof(struct pkt_primitives)];
+  u_int32_t idx, start, end;
+
+  memset(skip, 0, sizeof(skip));
+  memset(r, 0, sizeof(struct cache_hash_ranges));
+
+#if defined (HAVE_L2)
+  if (!(wtc & (COUNT_DST_MAC|COUNT_SUM_MAC))) CACHE_HASH_SKIP(skip, eth_dhost);
+  if (!(wtc & (COUNT_SRC_MAC|COUNT_SUM_MAC))) CACHE_HASH_SKIP(skip, eth_shost);
+#endif
+
+  if (!(wtc & (COUNT_SRC_HOST|COUNT_DST_HOST|COUNT_SUM_HOST|COUNT_SRC_NET|COUNT_DST_NET|COUNT_SUM_NET))) {
+    CACHE_HASH_SKIP(skip, src_ip);
+    CACHE_HASH_SKIP(skip, dst_ip);
+    CACHE_HASH_SKIP(skip, src_net);
+    CACHE_HASH_SKIP(skip, dst_net);
+  }
+
+  if (!(wtc & (COUNT_SRC_AS|COUNT_DST_AS|COUNT_SUM_AS))) {
+    CACHE_HASH_SKIP(skip, src_as);
+    CACHE_HASH_SKIP(skip, dst_as);
+  }
+
+  if (!(wtc & (COUNT_SRC_PORT|COUNT_DST_PORT|COUNT_SUM_PORT))) {
+    CACHE_HASH_SKIP(skip, src_port);
+    CACHE_HASH_SKIP(skip, dst_port);
+  }
+
+#if defined (WITH_GEOIP) || defined (WITH_GEOIPV2)
+  if (!(wtc_2 & (COUNT_SRC_HOST_COUNTRY|COUNT_DST_HOST_COUNTRY|COUNT_SRC_HOST_POCODE|COUNT_DST_HOST_POCODE|
+		 COUNT_SRC_HOST_COORDS|COUNT_DST_HOST_COORDS))) {
+    CACHE_HASH_SKIP(skip, src_ip_country);
+    CACHE_HASH_SKIP(skip, dst_ip_country);
+    CACHE_HASH_SKIP(skip, src_ip_pocode);
+    CACHE_HASH_SKIP(skip, dst_ip_pocode);
+    CACHE_HASH_SKIP(skip, src_ip_lat);
+    CACHE_HASH_SKIP(skip, src_ip_lon);
+    CACHE_HASH_SKIP(skip, dst_ip_lat);
+    CACHE_HASH_SKIP(skip, dst_ip_lon);
+  }
+#endif
+
+  /* ranges are made of whole words and holes smaller than the minimum gap
+     are hashed through: each range costs a call and a final mix, which
+     outweighs hashing a few more bytes (see tests/bench/cache-hash-bench) */
+  for (idx = 0; idx < sizeof(skip); ) {
+    for (; idx < sizeof(skip) && cache_hash_skip_word(skip, idx); idx += CACHE_HASH_WORD);
+    if (idx >= sizeof(skip)) break;
+
+    for (start = idx; idx < sizeof(skip) && !cache_hash_skip_word(skip, idx); idx += CACHE_HASH_WORD);
+    end = MIN(idx, sizeof(skip));
+
+    if (r->num && (r->num == CACHE_HASH_RANGES_MAX ||
+		   (start - (r->off[r->num - 1] + r->len[r->num - 1])) < CACHE_HASH_RANGES_MIN_GAP)) {
+      r->len[r->num - 1] = (end - r->off[r->num - 1]);
+    }
+    else {
+      r->off[r->num] = start;
+      r->len[r->num] = (end - start);
+      r->num++;
+    }
+  }
+}
+
+static inline struct cache_hash_ranges *cache_hash_pp_ranges_get()
+{
+  if (!cache_hash_pp_ranges_init) {
+    cache_hash_ranges_init(&cache_hash_pp_ranges, config.what_to_count, config.what_to_count_2);
+    cache_hash_pp_ranges_init = TRUE;
+  }
+
+  return &cache_hash_pp_ranges;
+}
+
+u_int32_t cache_hash_primitives(struct pkt_primitives *pp)
+{
+  struct cache_hash_ranges *r = cache_hash_pp_ranges_get();
+  const unsigned char *buf = (const unsigned char *) pp;
+  u_int32_t hash = CACHE_HASH_SEED;
+  int idx;
+
+  for (idx = 0; idx < r->num; idx++) {
+    hash = (*cache_hash_func)(buf + r->off[idx], r->len[idx], hash);
+  }
+
+  return hash;
+}
@@ -0,0 +1,66 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef CACHE_HASH_H
+#define CACHE_HASH_H
+
+/*
+   Hashing for the aggregation caches (IMT, print/kafka/amqp and SQL
+   plugins). The implementation is picked at runtime upon first use: CRC32C
+   via SSE4.2 on x86-64 CPUs supporting it, otherwise a portable hash
+   consuming a 64-bit word at a time. Hashes are only meaningful within a
+   process: they must not be persisted nor exchanged.
+*/
+
+/* defines */
+#define CACHE_HASH_SEED		5381
+#define CACHE_HASH_RANGES_MAX	8
+#define CACHE_HASH_RANGES_MIN_GAP	32	/* bytes */
+#define CACHE_HASH_WORD		8	/* bytes consumed per hashing step */
+
+/* structures */
+typedef u_int32_t (*cache_hash_func_t)(const unsigned char *, unsigned int, u_int32_t);
+
+/* byte ranges of struct pkt_primitives relevant to the configured aggregate */
+struct cache_hash_ranges {
+  u_int16_t off[CACHE_HASH_RANGES_MAX];
+  u_int16_t len[CACHE_HASH_RANGES_MAX];
+  int num;
+};
+
+/* global variables */
+extern cache_hash_func_t cache_hash_func;
+
+/* prototypes */
+extern u_int32_t cache_hash_portable(const unsigned char *, unsigned int, u_int32_t);
+#if defined (__x86_64__) && defined (__GNUC__)
+extern u_int32_t cache_hash_crc32c(const unsigned char *, unsigned int, u_int32_t);
+#endif
+extern void cache_hash_ranges_init(struct cache_hash_ranges *, pm_cfgreg_t, pm_cfgreg_t);
+extern u_int32_t cache_hash_primitives(struct pkt_primitives *);
+
+static inline u_int32_t cache_hash(const unsigned char *buf, unsigned int len)
+{
+  return (*cache_hash_func)(buf, len, CACHE_HASH_SEED);
+}
+
+#endif // CACHE_HASH_H
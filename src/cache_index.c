@@ -0,0 +1,257 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "cache_index.h"
+
+/* functions */
+static int cache_index_table_alloc(struct cache_index_table *t, u_int32_t size)
+{
+  memset(t, 0, sizeof(struct cache_index_table));
+
+  t->slots = calloc(size, sizeof(struct cache_index_slot));
+  if (!t->slots) return ERR;
+
+  t->size = size;
+
+  return SUCCESS;
+}
+
+static void cache_index_table_free(struct cache_index_table *t)
+{
+  if (t->slots) free(t->slots);
+
+  memset(t, 0, sizeof(struct cache_index_table));
+}
+
+int cache_index_init(struct cache_index *ci, char *name, u_int32_t entries)
+{
+  u_int32_t size = CACHE_INDEX_MIN_SIZE;
+
+  memset(ci, 0, sizeof(struct cache_index));
+  ci->name = name;
+
+  /* room for 'entries' without crossing the load factor */
+  while (((u_int64_t) size * CACHE_INDEX_MAX_LOAD / 100) < entries && size < (1U << 31)) size <<= 1;
+
+  return cache_index_table_alloc(&ci->cur, size);
+}
+
+void cache_index_free(struct cache_index *ci)
+{
+  cache_index_table_free(&ci->cur);
+  cache_index_table_free(&ci->old);
+  ci->migrate_pos = 0;
+}
+
+/* drops all entries, retaining the current table size */
+void cache_index_reset(struct cache_index *ci)
+{
+  cache_index_table_free(&ci->old);
+  ci->migrate_pos = 0;
+
+  memset(ci->cur.slots, 0, ci->cur.size * sizeof(struct cache_index_slot));
+  ci->cur.used = 0;
+  ci->cur.max_dist = 0;
+}
+
+static void cache_index_table_insert(struct cache_index_table *t, u_int32_t hash, void *ptr)
+{
+  struct cache_index_slot in, tmp, *slot;
+  u_int32_t mask = (t->size - 1), pos;
+
+  in.hash = hash;
+  in.dist = 1;
+  in.ptr = ptr;
+
+  for (pos = (hash & mask); ; pos = ((pos + 1) & mask), in.dist++) {
+    slot = &t->slots[pos];
+
+    if (!slot->dist || slot->dist < in.dist) {
+      if (in.dist > t->max_dist) t->max_dist = in.dist;
+
+      /* rich entries yield their slot to poorer ones */
+      tmp = (*slot);
+      (*slot) = in;
+      if (!tmp.dist) break;
+
+      in = tmp;
+    }
+  }
+
+  t->used++;
+}
+
+/*
+   Robin Hood ordering lets lookups in the current table stop as soon as an
+   entry closer to its home slot than the key would be is found. The table
+   being migrated is instead riddled with holes, hence it is scanned up to
+   the longest probe sequence it ever had.
+*/
+static struct cache_index_slot *cache_index_table_search(struct cache_index_table *t, int holes, u_int32_t hash,
+							 cache_index_cmp_func cmp, void *key, u_int64_t *probes)
+{
+  struct cache_index_slot *slot;
+  u_int32_t mask = (t->size - 1), pos, dist;
+
+  for (pos = (hash & mask), dist = 1; ; pos = ((pos + 1) & mask), dist++) {
+    slot = &t->slots[pos];
+    (*probes)++;
+
+    if (holes) {
+      if (dist > t->max_dist) break;
+      if (!slot->dist) continue;
+    }
+    else if (slot->dist < dist) break;
+
+    if (slot->hash == hash) {
+      if (cmp && !(*cmp)(slot->ptr, key)) return slot;
+      if (!cmp && slot->ptr == key) return slot;
+    }
+  }
+
+  return NULL;
+}
+
+/* backward-shift deletion: no tombstones are left behind */
+static void cache_index_table_remove(struct cache_index_table *t, struct cache_index_slot *slot)
+{
+  u_int32_t mask = (t->size - 1), pos, next;
+
+  for (pos = (slot - t->slots); ; pos = next) {
+    next = ((pos + 1) & mask);
+    if (t->slots[next].dist <= 1) break;
+
+    t->slots[pos] = t->slots[next];
+    t->slots[pos].dist--;
+  }
+
+  memset(&t->slots[pos], 0, sizeof(struct cache_index_slot));
+  t->used--;
+}
+
+static void cache_index_migrate(struct cache_index *ci, u_int32_t steps)
+{
+  struct cache_index_slot *slot;
+
+  for (; ci->old.slots && steps; steps--) {
+    slot = &ci->old.slots[ci->migrate_pos];
+
+    if (slot->dist) {
+      cache_index_table_insert(&ci->cur, slot->hash, slot->ptr);
+      slot->dist = 0;
+      ci->old.used--;
+      ci->stats.migrated++;
+    }
+
+    ci->migrate_pos++;
+
+    if (ci->migrate_pos == ci->old.size) {
+      cache_index_table_free(&ci->old);
+      ci->migrate_pos = 0;
+    }
+  }
+}
+
+static int cache_index_grow(struct cache_index *ci)
+{
+  struct cache_index_table new;
+
+  /* a previous resize still in progress is completed first */
+  if (ci->old.slots) cache_index_migrate(ci, ci->old.size);
+
+  if (ci->cur.size >= (1U << 31) || cache_index_table_alloc(&new, (ci->cur.size << 1)) == ERR) return ERR;
+
+  ci->old = ci->cur;
+  ci->cur = new;
+  ci->migrate_pos = 0;
+  ci->stats.resizes++;
+
+  Log(LOG_INFO, "INFO ( %s/%s ): %s: resizing index to %u slots (entries=%u)\n",
+      config.name, config.type, ci->name, ci->cur.size, cache_index_entries(ci));
+
+  return SUCCESS;
+}
+
+void *cache_index_search(struct cache_index *ci, u_int32_t hash, cache_index_cmp_func cmp, void *key)
+{
+  struct cache_index_slot *slot;
+
+  ci->stats.lookups++;
+
+  slot = cache_index_table_search(&ci->cur, FALSE, hash, cmp, key, &ci->stats.probes);
+  if (!slot && ci->old.slots) slot = cache_index_table_search(&ci->old, TRUE, hash, cmp, key, &ci->stats.probes);
+
+  return (slot ? slot->ptr : NULL);
+}
+
+/* 'ptr' is expected not to be in the index already */
+int cache_index_insert(struct cache_index *ci, u_int32_t hash, void *ptr)
+{
+  u_int64_t entries;
+
+  cache_index_migrate(ci, CACHE_INDEX_MIGRATE_STEP);
+
+  entries = (cache_index_entries(ci) + 1);
+
+  if ((entries * 100) > ((u_int64_t) ci->cur.size * CACHE_INDEX_MAX_LOAD)) {
+    if (cache_index_grow(ci) == ERR) {
+      /* at least one empty slot must be left for lookups to terminate */
+      if (entries >= ci->cur.size) return ERR;
+    }
+  }
+
+  cache_index_table_insert(&ci->cur, hash, ptr);
+
+  return SUCCESS;
+}
+
+int cache_index_delete(struct cache_index *ci, u_int32_t hash, void *ptr)
+{
+  struct cache_index_slot *slot;
+  u_int64_t probes = 0;
+
+  cache_index_migrate(ci, CACHE_INDEX_MIGRATE_STEP);
+
+  if ((slot = cache_index_table_search(&ci->cur, FALSE, hash, NULL, ptr, &probes))) {
+    cache_index_table_remove(&ci->cur, slot);
+    return SUCCESS;
+  }
+
+  if (ci->old.slots && (slot = cache_index_table_search(&ci->old, TRUE, hash, NULL, ptr, &probes))) {
+    slot->dist = 0;
+    ci->old.used--;
+    return SUCCESS;
+  }
+
+  return ERR;
+}
+
+void cache_index_print_stats(struct cache_index *ci, time_t now)
+{
+  Log(LOG_INFO, "INFO ( %s/%s ): stats [%s] time=%ld entries=%u slots=%u load=%.2f probe_avg=%.2f probe_max=%u resizes=%" PRIu64 " migrating=%s\n",
+      config.name, config.type, ci->name, (long)now, cache_index_entries(ci), ci->cur.size,
+      ((float) cache_index_entries(ci) / ci->cur.size),
+      (ci->stats.lookups ? ((float) ci->stats.probes / ci->stats.lookups) : 0),
+      ci->cur.max_dist, ci->stats.resizes, (ci->old.slots ? "true" : "false"));
+}
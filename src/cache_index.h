@@ -0,0 +1,88 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef CACHE_INDEX_H
+#define CACHE_INDEX_H
+
+/*
+   Open-addressing index for the aggregation caches (print, kafka, amqp and
+   memory plugins), mapping a key hash to a cache entry which is owned and
+   compared by the caller. Collisions are resolved by linear probing with
+   Robin Hood displacement, hence deletions shift the following entries
+   back instead of leaving tombstones. When the load factor crosses
+   CACHE_INDEX_MAX_LOAD a table twice as big is allocated and entries are
+   moved over a few slots at a time by subsequent writes, so that no single
+   insertion pays for the whole rehash; lookups meanwhile check both tables.
+   Not thread-safe: meant to be used by the plugin process only.
+*/
+
+/* defines */
+#define CACHE_INDEX_MIN_SIZE		1024
+#define CACHE_INDEX_MAX_LOAD		80	/* percent of used slots triggering a resize */
+#define CACHE_INDEX_MIGRATE_STEP	64	/* slots of the old table moved per write */
+
+/* structures */
+typedef int (*cache_index_cmp_func)(void *, void *);	/* (entry, key): zero if matching */
+
+struct cache_index_slot {
+  u_int32_t hash;
+  u_int32_t dist;			/* distance from the home slot plus one; 0 = empty */
+  void *ptr;
+};
+
+struct cache_index_table {
+  struct cache_index_slot *slots;
+  u_int32_t size;			/* power of two */
+  u_int32_t used;
+  u_int32_t max_dist;			/* longest probe sequence ever needed */
+};
+
+struct cache_index_stats {
+  u_int64_t lookups;
+  u_int64_t probes;			/* slots inspected by lookups */
+  u_int64_t resizes;
+  u_int64_t migrated;			/* entries moved by incremental rehashing */
+};
+
+struct cache_index {
+  char *name;
+  struct cache_index_table cur;
+  struct cache_index_table old;		/* being migrated into 'cur'; no slots if none */
+  u_int32_t migrate_pos;		/* next slot of 'old' to migrate */
+  struct cache_index_stats stats;
+};
+
+/* prototypes */
+extern int cache_index_init(struct cache_index *, char *, u_int32_t);
+extern void cache_index_free(struct cache_index *);
+extern void cache_index_reset(struct cache_index *);
+extern void *cache_index_search(struct cache_index *, u_int32_t, cache_index_cmp_func, void *);
+extern int cache_index_insert(struct cache_index *, u_int32_t, void *);
+extern int cache_index_delete(struct cache_index *, u_int32_t, void *);
+extern void cache_index_print_stats(struct cache_index *, time_t);
+
+static inline u_int32_t cache_index_entries(struct cache_index *ci)
+{
+  return (ci->cur.used + ci->old.used);
+}
+
+#endif // CACHE_INDEX_H
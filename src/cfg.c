@@ -58,6 +58,10 @@ static const struct _dictionary_line dictionary[] = {
   {"pcap_direction", cfg_key_pcap_direction},
   {"pcap_ifindex", cfg_key_pcap_ifindex},
   {"pcap_interfaces_map", cfg_key_pcap_interfaces_map},
+  {"pcap_tpacket", cfg_key_pcap_tpacket},
+  {"pcap_tpacket_block_size", cfg_key_pcap_tpacket_block_size},
+  {"pcap_tpacket_blocks", cfg_key_pcap_tpacket_blocks},
+  {"pcap_fanout_group", cfg_key_pcap_fanout_group},
   {"pcap_arista_trailer_offset", cfg_key_pcap_arista_trailer_offset},
   {"pcap_arista_trailer_flag_value", cfg_key_pcap_arista_trailer_flag_value},
   {"core_proc_name", cfg_key_proc_name},
@@ -72,6 +76,8 @@ static const struct _dictionary_line dictionary[] = {
   {"plugin_pipe_size", cfg_key_plugin_pipe_size},
   {"plugin_buffer_size", cfg_key_plugin_buffer_size},
   {"plugin_pipe_zmq", cfg_key_plugin_pipe_zmq},
+  {"plugin_pipe_eventfd", cfg_key_plugin_pipe_eventfd},
+  {"plugin_pipe_spin", cfg_key_plugin_pipe_spin},
   {"plugin_pipe_zmq_retry", cfg_key_plugin_pipe_zmq_retry},
   {"plugin_pipe_zmq_profile", cfg_key_plugin_pipe_zmq_profile},
   {"plugin_pipe_zmq_hwm", cfg_key_plugin_pipe_zmq_hwm},
@@ -103,6 +109,8 @@ static const struct _dictionary_line dictionary[] = {
   {"imt_buckets", cfg_key_imt_buckets},
   {"imt_mem_pools_number", cfg_key_imt_mem_pools_number},
   {"imt_mem_pools_size", cfg_key_imt_mem_pools_size},
+  {"imt_index_primitives", cfg_key_imt_index_primitives},
+  {"imt_topn_entries", cfg_key_imt_topn_entries},
   {"sql_db", cfg_key_sql_db},
   {"sql_table", cfg_key_sql_table},
   {"sql_table_schema", cfg_key_sql_table_schema},
@@ -153,6 +161,8 @@ static const struct _dictionary_line dictionary[] = {
   {"print_history_offset", cfg_key_sql_history_offset},
   {"print_history_roundoff", cfg_key_sql_history_roundoff},
   {"print_max_writers", cfg_key_dump_max_writers},
+  {"print_writer_threads", cfg_key_dump_writer_threads},
+  {"print_encoders", cfg_key_dump_encoders},
   {"print_preprocess", cfg_key_sql_preprocess},
   {"print_preprocess_type", cfg_key_sql_preprocess_type},
   {"print_startup_delay", cfg_key_sql_startup_delay},
@@ -175,6 +185,8 @@ static const struct _dictionary_line dictionary[] = {
   {"amqp_frame_max", cfg_key_amqp_frame_max},
   {"amqp_cache_entries", cfg_key_print_cache_entries},
   {"amqp_max_writers", cfg_key_dump_max_writers},
+  {"amqp_writer_threads", cfg_key_dump_writer_threads},
+  {"amqp_encoders", cfg_key_dump_encoders},
   {"amqp_preprocess", cfg_key_sql_preprocess},
   {"amqp_preprocess_type", cfg_key_sql_preprocess_type},
   {"amqp_startup_delay", cfg_key_sql_startup_delay},
@@ -200,6 +212,8 @@ static const struct _dictionary_line dictionary[] = {
   {"kafka_partition_key", cfg_key_kafka_partition_key},
   {"kafka_cache_entries", cfg_key_print_cache_entries},
   {"kafka_max_writers", cfg_key_dump_max_writers},
+  {"kafka_writer_threads", cfg_key_dump_writer_threads},
+  {"kafka_encoders", cfg_key_dump_encoders},
   {"kafka_preprocess", cfg_key_sql_preprocess},
   {"kafka_preprocess_type", cfg_key_sql_preprocess_type},
   {"kafka_startup_delay", cfg_key_sql_startup_delay},
@@ -226,6 +240,9 @@ static const struct _dictionary_line dictionary[] = {
   {"nfacctd_mcast_groups", cfg_key_nfacctd_mcast_groups},
   {"nfacctd_peer_as", cfg_key_nfprobe_peer_as},
   {"nfacctd_pipe_size", cfg_key_nfacctd_pipe_size},
+  {"nfacctd_recv_batch", cfg_key_nfacctd_recv_batch},
+  {"nfacctd_recv_queue", cfg_key_nfacctd_recv_queue},
+  {"nfacctd_workers", cfg_key_nfacctd_workers},
   {"nfacctd_pro_rating", cfg_key_nfacctd_pro_rating},
   {"nfacctd_templates_file", cfg_key_nfacctd_templates_file},
   {"nfacctd_templates_receiver", cfg_key_nfacctd_templates_receiver},
@@ -236,6 +253,7 @@ static const struct _dictionary_line dictionary[] = {
   {"nfacctd_renormalize", cfg_key_sfacctd_renormalize},
   {"nfacctd_disable_sanity_checks", cfg_key_nfacctd_disable_sanity_checks},
   {"nfacctd_disable_opt_scope_check", cfg_key_nfacctd_disable_opt_scope_check},
+  {"nfacctd_disable_decode_programs", cfg_key_nfacctd_disable_decode_programs},
   {"nfacctd_ignore_exporter_address", cfg_key_nfacctd_ignore_exporter_address},
   {"nfacctd_kafka_broker_host", cfg_key_nfacctd_kafka_broker_host},
   {"nfacctd_kafka_broker_port", cfg_key_nfacctd_kafka_broker_port},
@@ -339,6 +357,7 @@ static const struct _dictionary_line dictionary[] = {
   {"telemetry_dump_workers", cfg_key_telemetry_dump_workers},
   {"maps_refresh", cfg_key_maps_refresh},
   {"maps_index", cfg_key_maps_index},
+  {"maps_tree", cfg_key_maps_tree},
   {"maps_entries", cfg_key_maps_entries},
   {"maps_row_len", cfg_key_maps_row_len},
   {"pre_tag_map", cfg_key_pre_tag_map},
@@ -364,6 +383,7 @@ static const struct _dictionary_line dictionary[] = {
   {"sfacctd_nonroot", cfg_key_pmacctd_nonroot},
   {"sfacctd_time_new", cfg_key_nfacctd_time_new},
   {"sfacctd_pipe_size", cfg_key_nfacctd_pipe_size},
+  {"sfacctd_recv_batch", cfg_key_nfacctd_recv_batch},
   {"sfacctd_renormalize", cfg_key_sfacctd_renormalize},
   {"sfacctd_disable_sanity_checks", cfg_key_nfacctd_disable_sanity_checks},
   {"sfacctd_mcast_groups", cfg_key_nfacctd_mcast_groups},
@@ -516,6 +536,7 @@ static const struct _dictionary_line dictionary[] = {
   {"bgp_table_per_peer_buckets", cfg_key_bgp_daemon_table_per_peer_buckets},
   {"bgp_table_attr_hash_buckets", cfg_key_bgp_daemon_table_attr_hash_buckets},
   {"bgp_table_per_peer_hash", cfg_key_bgp_daemon_table_per_peer_hash},
+  {"bgp_table_lpm_index", cfg_key_bgp_daemon_table_lpm_index},
   {"bgp_table_dump_output", cfg_key_bgp_daemon_table_dump_output},
   {"bgp_table_dump_file", cfg_key_bgp_daemon_table_dump_file},
   {"bgp_table_dump_latest_file", cfg_key_bgp_daemon_table_dump_latest_file},
@@ -598,6 +619,7 @@ static const struct _dictionary_line dictionary[] = {
   {"bmp_table_per_peer_buckets", cfg_key_bmp_daemon_table_per_peer_buckets},
   {"bmp_table_attr_hash_buckets", cfg_key_bmp_daemon_table_attr_hash_buckets},
   {"bmp_table_per_peer_hash", cfg_key_bmp_daemon_table_per_peer_hash},
+  {"bmp_table_lpm_index", cfg_key_bmp_daemon_table_lpm_index},
   {"bmp_dump_output", cfg_key_bmp_daemon_dump_output},
   {"bmp_dump_file", cfg_key_bmp_daemon_dump_file},
   {"bmp_dump_latest_file", cfg_key_bmp_daemon_dump_latest_file},
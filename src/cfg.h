@@ -107,6 +107,8 @@ struct configuration {
   u_int64_t buffer_size;
   int buffer_immediate;
   int pipe_zmq;
+  int pipe_eventfd;
+  int pipe_spin;
   int pipe_zmq_retry;
   int pipe_zmq_profile;
   int pipe_zmq_hwm;
@@ -224,6 +226,10 @@ struct configuration {
   u_int32_t nfacctd_as;
   u_int32_t nfacctd_net;
   int nfacctd_pipe_size;
+  int nfacctd_recv_batch;
+  int nfacctd_recv_queue;
+  int nfacctd_workers;
+  int nfacctd_worker_id;
   int sfacctd_renormalize;
   int sfacctd_counter_output;
   char *sfacctd_counter_file;
@@ -249,6 +255,7 @@ struct configuration {
   char *sfacctd_counter_kafka_config_file;
   int nfacctd_disable_sanity_checks;
   int nfacctd_disable_opt_scope_check;
+  int nfacctd_disable_decode_programs;
   int nfacctd_ignore_exporter_address;
   int nfacctd_pre_processing_checks;
   int telemetry_daemon;
@@ -394,6 +401,7 @@ struct configuration {
   int bgp_table_per_peer_buckets;
   int bgp_table_attr_hash_buckets;
   int bgp_table_per_peer_hash;
+  int bgp_table_lpm_index;
   int bgp_table_dump_output;
   char *bgp_table_dump_file;
   char *bgp_table_dump_latest_file;
@@ -474,6 +482,7 @@ struct configuration {
   int bmp_table_per_peer_buckets;
   int bmp_table_attr_hash_buckets;
   int bmp_table_per_peer_hash;
+  int bmp_table_lpm_index;
   int bmp_dump_output;
   int bmp_dump_workers;
   char *bmp_dump_file;
@@ -520,9 +529,16 @@ struct configuration {
   int pcap_sf_wait;
   int pcap_sf_delay;
   int pcap_sf_replay;
+  int pcap_tpacket;
+  u_int32_t pcap_tpacket_block_size;
+  u_int32_t pcap_tpacket_blocks;
+  u_int32_t pcap_fanout_group;
   int num_memory_pools;
   int memory_pool_size;
   int buckets;
+  pm_cfgreg_t imt_index_what_to_count;
+  pm_cfgreg_t imt_index_what_to_count_2;
+  int imt_topn_entries;
   int daemon;
   int active_plugins;
   char *logfile;
@@ -554,6 +570,7 @@ struct configuration {
   int tos_encode_as_dscp;
   int maps_refresh;
   int maps_index;
+  int maps_tree;
   int maps_entries;
   int maps_row_len;
   char *pre_tag_map;
@@ -619,6 +636,8 @@ struct configuration {
   int pcap_arista_trailer_offset;
   int pcap_arista_trailer_flag_value;
   int dump_max_writers;
+  int dump_writer_threads;
+  int dump_encoders;
   int tmp_asa_bi_flow;
   int tmp_bgp_lookup_compare_ports;
   int tmp_bgp_daemon_route_refresh;
@@ -1008,6 +1008,71 @@ int cfg_key_pcap_interface_wait(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_pcap_tpacket(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  for (; list; list = list->next, changes++) list->cfg.pcap_tpacket = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pcap_tpacket'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_pcap_tpacket_block_size(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < getpagesize() || (value & (value - 1))) {
+    Log(LOG_WARNING, "WARN: [%s] 'pcap_tpacket_block_size' has to be a power of 2 and >= %d.\n", filename, getpagesize());
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.pcap_tpacket_block_size = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pcap_tpacket_block_size'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_pcap_tpacket_blocks(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value <= 0) {
+    Log(LOG_WARNING, "WARN: [%s] 'pcap_tpacket_blocks' has to be > 0.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.pcap_tpacket_blocks = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pcap_tpacket_blocks'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_pcap_fanout_group(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value <= 0 || value > 65535) {
+    Log(LOG_WARNING, "WARN: [%s] 'pcap_fanout_group' has to be in the range 1-65535.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.pcap_fanout_group = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pcap_fanout_group'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_pcap_savefile_wait(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -1168,6 +1233,84 @@ int cfg_key_imt_mem_pools_size(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_imt_index_primitives(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  char *count_token;
+  int changes = 0;
+  u_int64_t value[4];
+
+  trim_all_spaces(value_ptr);
+  lower_string(value_ptr);
+  memset(&value, 0, sizeof(value));
+
+  /* only primitives living in struct pkt_primitives can be indexed */
+  while ((count_token = extract_token(&value_ptr, ','))) {
+    if (!strcmp(count_token, "src_host")) cfg_set_aggregate(filename, value, COUNT_INT_SRC_HOST, count_token);
+    else if (!strcmp(count_token, "dst_host")) cfg_set_aggregate(filename, value, COUNT_INT_DST_HOST, count_token);
+    else if (!strcmp(count_token, "src_net")) cfg_set_aggregate(filename, value, COUNT_INT_SRC_NET, count_token);
+    else if (!strcmp(count_token, "dst_net")) cfg_set_aggregate(filename, value, COUNT_INT_DST_NET, count_token);
+    else if (!strcmp(count_token, "src_as")) cfg_set_aggregate(filename, value, COUNT_INT_SRC_AS, count_token);
+    else if (!strcmp(count_token, "dst_as")) cfg_set_aggregate(filename, value, COUNT_INT_DST_AS, count_token);
+    else if (!strcmp(count_token, "src_port")) cfg_set_aggregate(filename, value, COUNT_INT_SRC_PORT, count_token);
+    else if (!strcmp(count_token, "dst_port")) cfg_set_aggregate(filename, value, COUNT_INT_DST_PORT, count_token);
+    else if (!strcmp(count_token, "proto")) cfg_set_aggregate(filename, value, COUNT_INT_IP_PROTO, count_token);
+    else if (!strcmp(count_token, "tos")) cfg_set_aggregate(filename, value, COUNT_INT_IP_TOS, count_token);
+    else if (!strcmp(count_token, "in_iface")) cfg_set_aggregate(filename, value, COUNT_INT_IN_IFACE, count_token);
+    else if (!strcmp(count_token, "out_iface")) cfg_set_aggregate(filename, value, COUNT_INT_OUT_IFACE, count_token);
+    else if (!strcmp(count_token, "tag")) cfg_set_aggregate(filename, value, COUNT_INT_TAG, count_token);
+    else if (!strcmp(count_token, "tag2")) cfg_set_aggregate(filename, value, COUNT_INT_TAG2, count_token);
+    else {
+      Log(LOG_WARNING, "WARN: [%s] 'imt_index_primitives': unsupported primitive '%s'.\n", filename, count_token);
+      return ERR;
+    }
+  }
+
+  if (!name) {
+    for (; list; list = list->next, changes++) {
+      list->cfg.imt_index_what_to_count = value[1];
+      list->cfg.imt_index_what_to_count_2 = value[2];
+    }
+  }
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.imt_index_what_to_count = value[1];
+        list->cfg.imt_index_what_to_count_2 = value[2];
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_imt_topn_entries(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0) {
+    Log(LOG_WARNING, "WARN: [%s] 'imt_topn_entries' has to be >= 0.\n", filename);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.imt_topn_entries = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.imt_topn_entries = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
 int cfg_key_sql_db(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -1623,6 +1766,56 @@ int cfg_key_dump_max_writers(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_dump_writer_threads(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0 || value > 64) {
+    Log(LOG_WARNING, "WARN: [%s] invalid 'dump_writer_threads' value). Allowed values are: 0 <= dump_writer_threads <= 64.\n", filename);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.dump_writer_threads = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.dump_writer_threads = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_dump_encoders(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1 || value > 64) {
+    Log(LOG_WARNING, "WARN: [%s] invalid 'dump_encoders' value). Allowed values are: 1 <= dump_encoders <= 64.\n", filename);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.dump_encoders = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.dump_encoders = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
 int cfg_key_sql_trigger_exec(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -2632,6 +2825,53 @@ int cfg_key_plugin_pipe_size(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_plugin_pipe_eventfd(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.pipe_eventfd = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.pipe_eventfd = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_plugin_pipe_spin(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0) {
+    Log(LOG_ERR, "WARN: [%s] 'plugin_pipe_spin' has to be >= 0.\n", filename);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.pipe_spin = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.pipe_spin = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
 int cfg_key_plugin_pipe_zmq(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -2765,6 +3005,57 @@ int cfg_key_nfacctd_pipe_size(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_nfacctd_recv_batch(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0) {
+    Log(LOG_WARNING, "WARN: [%s] '%s_recv_batch' has to be >= 0.\n", filename, config.progname);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.nfacctd_recv_batch = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key '%s_recv_batch'. Globalized.\n", filename, config.progname);
+
+  return changes;
+}
+
+int cfg_key_nfacctd_recv_queue(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0) {
+    Log(LOG_WARNING, "WARN: [%s] 'nfacctd_recv_queue' has to be >= 0.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.nfacctd_recv_queue = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'nfacctd_recv_queue'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_nfacctd_workers(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1 || value > MAX_CORE_WORKERS) {
+    Log(LOG_WARNING, "WARN: [%s] 'nfacctd_workers' has to be >= 1 and <= %u.\n", filename, MAX_CORE_WORKERS);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.nfacctd_workers = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'nfacctd_workers'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_nfacctd_pro_rating(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -3688,6 +3979,20 @@ int cfg_key_maps_index(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_maps_tree(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  for (; list; list = list->next, changes++) list->cfg.maps_tree = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'maps_tree'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_nfacctd_time_secs(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -4479,6 +4784,20 @@ int cfg_key_bgp_daemon_table_per_peer_hash(char *filename, char *name, char *val
   return changes;
 }
 
+int cfg_key_bgp_daemon_table_lpm_index(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  for (; list; list = list->next, changes++) list->cfg.bgp_table_lpm_index = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'bgp_table_lpm_index'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_bgp_daemon_batch_interval(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -4792,6 +5111,20 @@ int cfg_key_bmp_daemon_table_per_peer_hash(char *filename, char *name, char *val
   return changes;
 }
 
+int cfg_key_bmp_daemon_table_lpm_index(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  for (; list; list = list->next, changes++) list->cfg.bmp_table_lpm_index = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'bmp_table_lpm_index'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_bmp_daemon_msglog_file(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -5880,6 +6213,20 @@ int cfg_key_nfacctd_disable_opt_scope_check(char *filename, char *name, char *va
   return changes;
 }
 
+int cfg_key_nfacctd_disable_decode_programs(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  for (; list; list = list->next, changes++) list->cfg.nfacctd_disable_decode_programs = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'nfacctd_disable_decode_programs'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_nfacctd_ignore_exporter_address(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -66,6 +66,10 @@ extern int cfg_key_use_ip_next_hop(char *, char *, char *);
 extern int cfg_key_thread_stack(char *, char *, char *);
 extern int cfg_key_pcap_interface(char *, char *, char *);
 extern int cfg_key_pcap_interface_wait(char *, char *, char *);
+extern int cfg_key_pcap_tpacket(char *, char *, char *);
+extern int cfg_key_pcap_tpacket_block_size(char *, char *, char *);
+extern int cfg_key_pcap_tpacket_blocks(char *, char *, char *);
+extern int cfg_key_pcap_fanout_group(char *, char *, char *);
 extern int cfg_key_files_umask(char *, char *, char *);
 extern int cfg_key_files_uid(char *, char *, char *);
 extern int cfg_key_files_gid(char *, char *, char *);
@@ -76,6 +80,8 @@ extern int cfg_key_imt_path(char *, char *, char *);
 extern int cfg_key_imt_buckets(char *, char *, char *);
 extern int cfg_key_imt_mem_pools_number(char *, char *, char *);
 extern int cfg_key_imt_mem_pools_size(char *, char *, char *);
+extern int cfg_key_imt_index_primitives(char *, char *, char *);
+extern int cfg_key_imt_topn_entries(char *, char *, char *);
 extern int cfg_key_sql_db(char *, char *, char *);
 extern int cfg_key_sql_table(char *, char *, char *);
 extern int cfg_key_sql_table_schema(char *, char *, char *);
@@ -130,6 +136,8 @@ extern int cfg_key_kafka_config_file(char *, char *, char *);
 extern int cfg_key_plugin_pipe_size(char *, char *, char *);
 extern int cfg_key_plugin_buffer_size(char *, char *, char *);
 extern int cfg_key_plugin_pipe_zmq(char *, char *, char *);
+extern int cfg_key_plugin_pipe_eventfd(char *, char *, char *);
+extern int cfg_key_plugin_pipe_spin(char *, char *, char *);
 extern int cfg_key_plugin_pipe_zmq_retry(char *, char *, char *);
 extern int cfg_key_plugin_pipe_zmq_profile(char *, char *, char *);
 extern int cfg_key_plugin_pipe_zmq_hwm(char *, char *, char *);
@@ -166,9 +174,13 @@ extern int cfg_key_nfacctd_as_new(char *, char *, char *);
 extern int cfg_key_nfacctd_net(char *, char *, char *);
 extern int cfg_key_nfacctd_disable_sanity_checks(char *, char *, char *);
 extern int cfg_key_nfacctd_disable_opt_scope_check(char *, char *, char *);
+extern int cfg_key_nfacctd_disable_decode_programs(char *, char *, char *);
 extern int cfg_key_nfacctd_ignore_exporter_address(char *, char *, char *);
 extern int cfg_key_nfacctd_mcast_groups(char *, char *, char *);
 extern int cfg_key_nfacctd_pipe_size(char *, char *, char *);
+extern int cfg_key_nfacctd_recv_batch(char *, char *, char *);
+extern int cfg_key_nfacctd_recv_queue(char *, char *, char *);
+extern int cfg_key_nfacctd_workers(char *, char *, char *);
 extern int cfg_key_nfacctd_pro_rating(char *, char *, char *);
 extern int cfg_key_nfacctd_templates_file(char *, char *, char *);
 extern int cfg_key_nfacctd_templates_receiver(char *, char *, char *);
@@ -280,6 +292,7 @@ extern int cfg_key_telemetry_dump_kafka_config_file(char *, char *, char *);
 extern int cfg_key_telemetry_dump_workers(char *, char *, char *);
 extern int cfg_key_maps_refresh(char *, char *, char *);
 extern int cfg_key_maps_index(char *, char *, char *);
+extern int cfg_key_maps_tree(char *, char *, char *);
 extern int cfg_key_maps_entries(char *, char *, char *);
 extern int cfg_key_maps_row_len(char *, char *, char *);
 extern int cfg_key_pre_tag_map(char *, char *, char *);
@@ -401,6 +414,7 @@ extern int cfg_key_bgp_daemon_table_peer_buckets(char *, char *, char *);
 extern int cfg_key_bgp_daemon_table_per_peer_buckets(char *, char *, char *);
 extern int cfg_key_bgp_daemon_table_attr_hash_buckets(char *, char *, char *);
 extern int cfg_key_bgp_daemon_table_per_peer_hash(char *, char *, char *);
+extern int cfg_key_bgp_daemon_table_lpm_index(char *, char *, char *);
 extern int cfg_key_bgp_daemon_table_dump_output(char *, char *, char *);
 extern int cfg_key_bgp_daemon_table_dump_file(char *, char *, char *);
 extern int cfg_key_bgp_daemon_table_dump_latest_file(char *, char *, char *);
@@ -480,6 +494,7 @@ extern int cfg_key_bmp_daemon_table_peer_buckets(char *, char *, char *);
 extern int cfg_key_bmp_daemon_table_per_peer_buckets(char *, char *, char *);
 extern int cfg_key_bmp_daemon_table_attr_hash_buckets(char *, char *, char *);
 extern int cfg_key_bmp_daemon_table_per_peer_hash(char *, char *, char *);
+extern int cfg_key_bmp_daemon_table_lpm_index(char *, char *, char *);
 extern int cfg_key_bmp_daemon_dump_output(char *, char *, char *);
 extern int cfg_key_bmp_daemon_dump_workers(char *, char *, char *);
 extern int cfg_key_bmp_daemon_dump_file(char *, char *, char *);
@@ -522,6 +537,8 @@ extern int cfg_key_uacctd_nl_size(char *, char *, char *);
 extern int cfg_key_uacctd_threshold(char *, char *, char *);
 extern int cfg_key_tunnel_0(char *, char *, char *);
 extern int cfg_key_dump_max_writers(char *, char *, char *);
+extern int cfg_key_dump_writer_threads(char *, char *, char *);
+extern int cfg_key_dump_encoders(char *, char *, char *);
 extern int cfg_key_tmp_asa_bi_flow(char *, char *, char *);
 extern int cfg_key_tmp_bgp_lookup_compare_ports(char *, char *, char *);
 extern int cfg_key_tmp_bgp_daemon_route_refresh(char *, char *, char *);
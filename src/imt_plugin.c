@@ -24,6 +24,7 @@
 #include "plugin_hooks.h"
 #include "plugin_common.h"
 #include "imt_plugin.h"
+#include "imt_sidx.h"
 #include "bgp/bgp.h"
 #include "net_aggr.h"
 
@@ -32,7 +33,7 @@ void (*imt_insert_func)(struct primitives_ptrs *);
 unsigned char *mpd;
 unsigned char *a;
 struct memory_pool_desc *current_pool;
-struct acc **lru_elem_ptr;
+struct cache_index imt_index;
 int no_more_space;
 struct timeval cycle_stamp;
 struct timeval table_reset_stamp;
@@ -48,6 +49,7 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
   unsigned char srvbuf[maxqsize];
   unsigned char *srvbufptr;
   struct query_header *qh;
+  struct query_topn qt;
   unsigned char *pipebuf, *dataptr;
   char path[] = "/tmp/collect.pipe";
   short int go_to_clear = FALSE;
@@ -171,12 +173,12 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
   }
   a = current_pool->base_ptr;
 
-  lru_elem_ptr = malloc(config.buckets*sizeof(struct acc *));
-  if (lru_elem_ptr == NULL) {
-    Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate LRU element pointers.\n", config.name, config.type);
+  if (cache_index_init(&imt_index, "imt_index", config.buckets) == ERR) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate the table index.\n", config.name, config.type);
     exit_gracefully(1);
   }
-  else memset(lru_elem_ptr, 0, config.buckets*sizeof(struct acc *));
+
+  imt_sidx_init();
 
   current_pool = request_memory_pool(config.memory_pool_size);
   if (current_pool == NULL) {
@@ -295,7 +297,9 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
 	   reset for individual entries, etc.) are entitled of an exclusive
 	   lock.
 	 - if query is matter of just a single short-lived walk through the
-	   table, we avoid fork(): the plugin will serve the request;
+	   table, or can be answered off the secondary indexes (a group of
+	   the per-primitive index, the top-N heaps), we avoid fork(): the
+	   plugin will serve the request;
          - in all other cases, we fork; the newly created child will serve
 	   queries asyncronously.
       */
@@ -315,6 +319,18 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         else Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d incoming bytes. ERRNO: %d\n", config.name, config.type, num, errno);
         Log(LOG_DEBUG, "DEBUG ( %s/%s ): Closing connection with client ...\n", config.name, config.type);
       } 
+      else if (((request == WANT_COUNTER) || (request == WANT_MATCH)) && (qh->num == 1) &&
+	       (num >= (int) (sizeof(struct query_header) + sizeof(struct query_entry))) &&
+	       imt_sidx_serves((struct query_entry *) (srvbuf + sizeof(struct query_header)))) {
+	if (num > 0) process_query_data(sd2, srvbuf, num, &extras, datasize, FALSE);
+        else Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d incoming bytes. ERRNO: %d\n", config.name, config.type, num, errno);
+        Log(LOG_DEBUG, "DEBUG ( %s/%s ): Closing connection with client ...\n", config.name, config.type);
+      }
+      else if ((request == (WANT_STATS|WANT_TOPN)) && query_topn_get(srvbuf, num, &qt) && imt_topn_serves(qt.counter, qt.howmany)) {
+	if (num > 0) process_query_data(sd2, srvbuf, num, &extras, datasize, FALSE);
+        else Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d incoming bytes. ERRNO: %d\n", config.name, config.type, num, errno);
+        Log(LOG_DEBUG, "DEBUG ( %s/%s ): Closing connection with client ...\n", config.name, config.type);
+      }
       else if (request == WANT_CLASS_TABLE) {
 	if (num > 0) process_query_data(sd2, srvbuf, num, &extras, datasize, FALSE);
         else Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d incoming bytes. ERRNO: %d\n", config.name, config.type, num, errno);
@@ -361,6 +377,9 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
 
       free_extra_allocs(); 
       clear_memory_pool_table();
+      cache_index_print_stats(&imt_index, cycle_stamp.tv_sec);
+      cache_index_reset(&imt_index);
+      imt_sidx_reset(cycle_stamp.tv_sec);
       current_pool = request_memory_pool(config.buckets*sizeof(struct acc));
       if (current_pool == NULL) {
         Log(LOG_ERR, "ERROR ( %s/%s ): Cannot allocate my first memory pool, try with larger value.\n", config.name, config.type);
@@ -403,7 +422,7 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         }
 
         pollagain = FALSE;
-        if ((num = read(pipe_fd, &rgptr, sizeof(rgptr))) == 0)
+        if ((num = plugin_pipe_read(pipe_fd, &rgptr)) == 0)
           exit_gracefully(1); /* we exit silently; something happened at the write end */
 
         if (num < 0) {
@@ -422,7 +441,10 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
 	  }
 
           seq = ((struct ch_buf_hdr *)pipebuf)->seq;
+	  plugin_pipe_resync(status);
 	}
+
+        status->tail++;
       }
 #ifdef WITH_ZMQ
       else if (config.pipe_zmq) {
@@ -23,12 +23,14 @@
 #define IMT_PLUGIN_H
 
 #include <sys/poll.h>
+#include "cache_index.h"
 
 /* defines */
 #define NUM_MEMORY_POOLS 16
 #define MEMORY_POOL_SIZE 8192
 #define MAX_HOSTS 32771 
 #define MAX_QUERIES 4096
+#define IMT_TOPN_MAX 2
 
 /* Structures */
 struct acc {
@@ -50,6 +52,10 @@ struct acc {
   u_char *pcust;
   struct pkt_vlen_hdr_primitives *pvlen;
   struct acc *next;
+  u_int32_t topn_pos[IMT_TOPN_MAX];	/* top-N heaps: position plus one; 0 = not in heap */
+  u_int32_t sidx_hash;			/* secondary index: hash of the indexed primitives */
+  struct acc *sidx_prev;		/* secondary index: entries sharing the indexed primitives */
+  struct acc *sidx_next;
 };
 
 struct bucket_desc {
@@ -78,6 +84,16 @@ struct query_header {
   int datasize;				/* total length of aggregation primitives structures */
 };
 
+/*
+   Follows the query entries if WANT_TOPN is set in the query type: kept
+   out of struct query_header so that its layout, shared with clients and
+   servers not knowing about WANT_TOPN, does not change
+*/
+struct query_topn {
+  int counter;				/* counter to rank by, IMT_TOPN_* plus one */
+  unsigned int howmany;			/* number of entries */
+};
+
 struct query_entry {
   pm_cfgreg_t what_to_count;			/* aggregation */
   pm_cfgreg_t what_to_count_2;			/* aggregation */
@@ -129,6 +145,7 @@ struct imt_custom_primitives {
 extern void insert_accounting_structure(struct primitives_ptrs *);
 extern struct acc *search_accounting_structure(struct primitives_ptrs *);
 extern int compare_accounting_structure(struct acc *, struct primitives_ptrs *);
+extern int imt_index_cmp(void *, void *);
 
 extern void init_memory_pool_table();
 extern void clear_memory_pool_table();
@@ -138,6 +155,7 @@ extern void set_reset_flag(struct acc *);
 extern void reset_counters(struct acc *);
 extern int build_query_server(char *);
 extern void process_query_data(int, unsigned char *, int, struct extra_primitives *, int, int);
+extern int query_topn_get(unsigned char *, int, struct query_topn *);
 extern void mask_elem(struct pkt_primitives *, struct pkt_bgp_primitives *, struct pkt_legacy_bgp_primitives *,
 			struct pkt_nat_primitives *, struct pkt_mpls_primitives *, struct pkt_tunnel_primitives *,
 			struct acc *, u_int64_t, u_int64_t, u_int64_t, struct extra_primitives *);
@@ -159,7 +177,7 @@ extern void (*imt_insert_func)(struct primitives_ptrs *); /* pointer to INSERT f
 extern unsigned char *mpd;  /* memory pool descriptors table */
 extern unsigned char *a;  /* accounting in-memory table */
 extern struct memory_pool_desc *current_pool; /* pointer to currently used memory pool */
-extern struct acc **lru_elem_ptr; /* pointer to Last Recently Used (lru) element in a bucket */
+extern struct cache_index imt_index; /* lookup index over the in-memory table */
 extern int no_more_space;
 extern struct timeval cycle_stamp; /* timestamp for the current cycle */
 extern struct timeval table_reset_stamp; /* global table reset timestamp */
@@ -0,0 +1,280 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "imt_plugin.h"
+#include "imt_sidx.h"
+#include "cache_hash.h"
+
+/* global variables */
+struct cache_index imt_sidx;
+struct imt_topn imt_topn[IMT_TOPN_MAX];
+
+static int imt_sidx_active;
+
+/* functions */
+void imt_sidx_init()
+{
+  int idx;
+
+  if (config.imt_index_what_to_count || config.imt_index_what_to_count_2) {
+    if ((config.imt_index_what_to_count & ~config.what_to_count) ||
+	(config.imt_index_what_to_count_2 & ~config.what_to_count_2)) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): 'imt_index_primitives' is not a subset of 'aggregate'. Secondary index disabled.\n", config.name, config.type);
+      config.imt_index_what_to_count = 0;
+      config.imt_index_what_to_count_2 = 0;
+    }
+    else {
+      if (cache_index_init(&imt_sidx, "imt_sidx", config.buckets) == ERR) {
+	Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate the secondary index.\n", config.name, config.type);
+	exit_gracefully(1);
+      }
+
+      imt_sidx_active = TRUE;
+    }
+  }
+
+  if (config.imt_topn_entries) {
+    for (idx = 0; idx < IMT_TOPN_MAX; idx++) {
+      imt_topn[idx].heap = malloc(config.imt_topn_entries * sizeof(struct acc *));
+      if (!imt_topn[idx].heap) {
+	Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate the top-N heaps.\n", config.name, config.type);
+	exit_gracefully(1);
+      }
+
+      imt_topn[idx].num = 0;
+      imt_topn[idx].max = config.imt_topn_entries;
+    }
+  }
+}
+
+/* to be called along with the erasure of the memory table */
+void imt_sidx_reset(time_t now)
+{
+  int idx;
+
+  if (config.imt_index_what_to_count || config.imt_index_what_to_count_2) {
+    cache_index_print_stats(&imt_sidx, now);
+    cache_index_reset(&imt_sidx);
+    imt_sidx_active = TRUE;
+  }
+
+  for (idx = 0; idx < IMT_TOPN_MAX; idx++) imt_topn[idx].num = 0;
+}
+
+/* masks 'elem' down to the indexed primitives, which all live in struct pkt_primitives */
+static void imt_sidx_key(struct pkt_primitives *key, struct acc *elem)
+{
+  struct pkt_bgp_primitives pbgp;
+  struct pkt_legacy_bgp_primitives plbgp;
+  struct pkt_nat_primitives pnat;
+  struct pkt_mpls_primitives pmpls;
+  struct pkt_tunnel_primitives ptun;
+  struct extra_primitives extras;
+
+  memset(&extras, 0, sizeof(extras));
+  mask_elem(key, &pbgp, &plbgp, &pnat, &pmpls, &ptun, elem, config.imt_index_what_to_count,
+	    config.imt_index_what_to_count_2, 0, &extras);
+}
+
+static int imt_sidx_cmp(void *elem, void *key)
+{
+  struct pkt_primitives elem_key;
+
+  imt_sidx_key(&elem_key, (struct acc *) elem);
+
+  return memcmp(&elem_key, key, sizeof(struct pkt_primitives));
+}
+
+/*
+   Entries sharing the indexed primitives are doubly linked off the first
+   one seen, which is the only one referenced by the index itself.
+*/
+void imt_sidx_insert(struct acc *elem)
+{
+  struct pkt_primitives key;
+  struct acc *head;
+
+  if (!imt_sidx_active) return;
+
+  imt_sidx_key(&key, elem);
+  elem->sidx_hash = cache_hash_primitives(&key);
+
+  head = cache_index_search(&imt_sidx, elem->sidx_hash, imt_sidx_cmp, &key);
+  if (head) {
+    elem->sidx_prev = head;
+    elem->sidx_next = head->sidx_next;
+    if (head->sidx_next) head->sidx_next->sidx_prev = elem;
+    head->sidx_next = elem;
+  }
+  else {
+    elem->sidx_prev = NULL;
+    elem->sidx_next = NULL;
+
+    if (cache_index_insert(&imt_sidx, elem->sidx_hash, elem) == ERR) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): Unable to grow the secondary index, disabled until stats are cleared.\n", config.name, config.type);
+      imt_sidx_active = FALSE;
+    }
+  }
+}
+
+void imt_sidx_delete(struct acc *elem)
+{
+  struct acc *next = elem->sidx_next;
+
+  if (!imt_sidx_active) return;
+
+  if (elem->sidx_prev) {
+    elem->sidx_prev->sidx_next = next;
+    if (next) next->sidx_prev = elem->sidx_prev;
+  }
+  else if (cache_index_delete(&imt_sidx, elem->sidx_hash, elem) == SUCCESS && next) {
+    next->sidx_prev = NULL;
+
+    if (cache_index_insert(&imt_sidx, next->sidx_hash, next) == ERR) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): Unable to grow the secondary index, disabled until stats are cleared.\n", config.name, config.type);
+      imt_sidx_active = FALSE;
+    }
+  }
+
+  elem->sidx_prev = NULL;
+  elem->sidx_next = NULL;
+}
+
+/* whether a match query can be served walking a group of the secondary index */
+int imt_sidx_serves(struct query_entry *request)
+{
+  if (!imt_sidx_active) return FALSE;
+
+  return (request->what_to_count == config.imt_index_what_to_count &&
+	  request->what_to_count_2 == config.imt_index_what_to_count_2 &&
+	  !request->what_to_count_3);
+}
+
+/* returns the first entry of the group matching 'request', see imt_sidx_serves() */
+struct acc *imt_sidx_search(struct query_entry *request)
+{
+  return cache_index_search(&imt_sidx, cache_hash_primitives(&request->data), imt_sidx_cmp, &request->data);
+}
+
+static inline pm_counter_t imt_topn_value(struct acc *elem, int idx)
+{
+  if (idx == IMT_TOPN_BYTES) return elem->bytes_counter;
+  else return elem->packet_counter;
+}
+
+static void imt_topn_swap(struct imt_topn *t, int idx, u_int32_t a, u_int32_t b)
+{
+  struct acc *tmp = t->heap[a];
+
+  t->heap[a] = t->heap[b];
+  t->heap[b] = tmp;
+  t->heap[a]->topn_pos[idx] = (a + 1);
+  t->heap[b]->topn_pos[idx] = (b + 1);
+}
+
+static void imt_topn_sift(struct imt_topn *t, int idx, u_int32_t pos)
+{
+  u_int32_t parent, child, min;
+
+  while (pos) {
+    parent = ((pos - 1) / 2);
+    if (imt_topn_value(t->heap[pos], idx) >= imt_topn_value(t->heap[parent], idx)) break;
+
+    imt_topn_swap(t, idx, pos, parent);
+    pos = parent;
+  }
+
+  for (;;) {
+    child = ((pos * 2) + 1);
+    if (child >= t->num) break;
+
+    min = child;
+    if ((child + 1) < t->num && imt_topn_value(t->heap[child + 1], idx) < imt_topn_value(t->heap[child], idx)) min = (child + 1);
+    if (imt_topn_value(t->heap[pos], idx) <= imt_topn_value(t->heap[min], idx)) break;
+
+    imt_topn_swap(t, idx, pos, min);
+    pos = min;
+  }
+}
+
+/* to be called whenever the counters of 'elem' change */
+void imt_topn_update(struct acc *elem)
+{
+  struct imt_topn *t;
+  int idx;
+
+  for (idx = 0; idx < IMT_TOPN_MAX; idx++) {
+    t = &imt_topn[idx];
+    if (!t->max) return;
+
+    if (elem->topn_pos[idx]) imt_topn_sift(t, idx, (elem->topn_pos[idx] - 1));
+    else if (t->num < t->max) {
+      t->heap[t->num] = elem;
+      elem->topn_pos[idx] = ++t->num;
+      imt_topn_sift(t, idx, (t->num - 1));
+    }
+    else if (imt_topn_value(elem, idx) > imt_topn_value(t->heap[0], idx)) {
+      t->heap[0]->topn_pos[idx] = 0;
+      t->heap[0] = elem;
+      elem->topn_pos[idx] = 1;
+      imt_topn_sift(t, idx, 0);
+    }
+  }
+}
+
+/* 'counter' is a IMT_TOPN_* value plus one, as in pmacct -T */
+int imt_topn_serves(int counter, u_int32_t howmany)
+{
+  if (counter < 1 || counter > IMT_TOPN_MAX) return FALSE;
+
+  return (howmany && howmany <= imt_topn[counter - 1].max);
+}
+
+static int imt_topn_cmp_bytes(const void *a, const void *b)
+{
+  pm_counter_t x = (*(struct acc **) a)->bytes_counter, y = (*(struct acc **) b)->bytes_counter;
+
+  return ((x < y) - (x > y));
+}
+
+static int imt_topn_cmp_packets(const void *a, const void *b)
+{
+  pm_counter_t x = (*(struct acc **) a)->packet_counter, y = (*(struct acc **) b)->packet_counter;
+
+  return ((x < y) - (x > y));
+}
+
+/*
+   Fills 'list', at least imt_topn[].max long, with the top 'howmany' entries
+   by 'idx' counter, largest first; returns the number of entries filled in.
+*/
+u_int32_t imt_topn_get(int idx, struct acc **list, u_int32_t howmany)
+{
+  struct imt_topn *t = &imt_topn[idx];
+
+  memcpy(list, t->heap, (t->num * sizeof(struct acc *)));
+  qsort(list, t->num, sizeof(struct acc *), (idx == IMT_TOPN_BYTES) ? imt_topn_cmp_bytes : imt_topn_cmp_packets);
+
+  return MIN(t->num, howmany);
+}
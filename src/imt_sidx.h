@@ -0,0 +1,66 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef IMT_SIDX_H
+#define IMT_SIDX_H
+
+/*
+   Optional secondary indexes over the memory table, kept up to date by
+   insert_accounting_structure() so that the most frequent dashboard-like
+   queries are served without walking (and fork()ing for) the whole table:
+   - a per-primitive index ('imt_index_primitives') grouping entries which
+     share the value of the chosen primitives: match queries on exactly
+     those primitives (ie. pmacct -c dst_host -M 192.0.2.1) walk the group;
+   - bounded min-heaps keeping the top entries by bytes and by packets
+     ('imt_topn_entries'), serving pmacct -s -T <bytes|packets>,<N>.
+   Counters only grow, hence an entry can't overtake one in a heap without
+   going through imt_topn_update(); resetting the counters of individual
+   entries breaks this, making heaps approximate until the table is erased.
+*/
+
+/* defines */
+#define IMT_TOPN_BYTES		0
+#define IMT_TOPN_PACKETS	1
+
+/* structures */
+struct imt_topn {
+  struct acc **heap;		/* min-heap on the counter */
+  u_int32_t num;
+  u_int32_t max;
+};
+
+/* global variables */
+extern struct cache_index imt_sidx;
+extern struct imt_topn imt_topn[IMT_TOPN_MAX];
+
+/* prototypes */
+extern void imt_sidx_init();
+extern void imt_sidx_reset(time_t);
+extern void imt_sidx_insert(struct acc *);
+extern void imt_sidx_delete(struct acc *);
+extern int imt_sidx_serves(struct query_entry *);
+extern struct acc *imt_sidx_search(struct query_entry *);
+extern void imt_topn_update(struct acc *);
+extern int imt_topn_serves(int, u_int32_t);
+extern u_int32_t imt_topn_get(int, struct acc **, u_int32_t);
+
+#endif // IMT_SIDX_H
@@ -27,23 +27,26 @@
 #include "jhash.h"
 
 /* Global variables */
-struct ip_flow **ip_flow_table;
-struct flow_lru_l flow_lru_list;
+struct ip_table ip_flow_table;
+struct ip_table ip_flow_table6;
 
-struct ip_flow6 **ip_flow_table6;
-struct flow_lru_l6 flow_lru_list6;
-
-u_int32_t flt_total_nodes;  
-time_t flt_prune_deadline;
 time_t flt_emergency_prune;
 time_t flow_generic_lifetime;
 time_t flow_tcpest_lifetime;
 u_int32_t flt_trivial_hash_rnd = 140281; /* ummmh */
 
-u_int32_t flt6_total_nodes;
-time_t flt6_prune_deadline;
 time_t flt6_emergency_prune;
 
+static time_t ip_flow_table_expiry(void *node, time_t now)
+{
+  return flow_expiry(&((struct ip_flow *)node)->cmn);
+}
+
+static time_t ip_flow_table6_expiry(void *node, time_t now)
+{
+  return flow_expiry(&((struct ip_flow6 *)node)->cmn);
+}
+
 void init_ip_flow_handler()
 {
   init_ip4_flow_handler();
@@ -52,21 +55,13 @@ void init_ip_flow_handler()
 
 void init_ip4_flow_handler()
 {
-  int size;
+  u_int32_t bufsz;
 
-  if (config.flow_bufsz) flt_total_nodes = config.flow_bufsz / sizeof(struct ip_flow);
-  else flt_total_nodes = DEFAULT_FLOW_BUFFER_SIZE / sizeof(struct ip_flow); 
+  if (config.flow_bufsz) bufsz = config.flow_bufsz;
+  else bufsz = DEFAULT_FLOW_BUFFER_SIZE;
 
   if (!config.flow_hashsz) config.flow_hashsz = FLOW_TABLE_HASHSZ; 
-  size = sizeof(struct ip_flow) * config.flow_hashsz;
-  ip_flow_table = (struct ip_flow **) malloc(size);
-  assert(ip_flow_table);
-
-  memset(ip_flow_table, 0, size);
-  flow_lru_list.root = (struct ip_flow *) malloc(sizeof(struct ip_flow)); 
-  flow_lru_list.last = flow_lru_list.root;
-  memset(flow_lru_list.root, 0, sizeof(struct ip_flow));
-  flt_prune_deadline = time(NULL)+FLOW_TABLE_PRUNE_INTERVAL;
+  ip_table_init(&ip_flow_table, "Flow/4", bufsz, sizeof(struct ip_flow), config.flow_hashsz, ip_flow_table_expiry, NULL);
   flt_emergency_prune = 0; 
 
   if (config.flow_lifetime) flow_generic_lifetime = config.flow_lifetime;
@@ -84,10 +79,7 @@ void ip_flow_handler(struct packet_ptrs *pptrs)
 
   gettimeofday(&now, NULL);
 
-  if (now.tv_sec > flt_prune_deadline) {
-    prune_old_flows(&now);
-    flt_prune_deadline = now.tv_sec+FLOW_TABLE_PRUNE_INTERVAL;
-  }
+  ip_table_expire(&ip_flow_table, now.tv_sec);
 
   find_flow(&now, pptrs);
 }
@@ -133,21 +125,30 @@ void clear_tcp_flow_cmn(struct ip_flow_common *fp, unsigned int idx)
   fp->class[idx] = 0;
 } 
 
+/* an earlier expiry, ie. upon FIN or RST, has to be reflected in the wheel */
+static void update_flow_expiry(struct ip_table *t, struct ip_table_node *tn, struct ip_flow_common *fp)
+{
+  time_t expiry = flow_expiry(fp);
+
+  if ((expiry + 1) < tn->sched) ip_table_schedule(t, tn, (expiry + 1));
+}
+
 void find_flow(struct timeval *now, struct packet_ptrs *pptrs)
 {
   struct pm_iphdr my_iph;
   struct pm_tcphdr my_tlh;
   struct pm_iphdr *iphp = &my_iph;
   struct pm_tlhdr *tlhp = (struct pm_tlhdr *) &my_tlh;
-  struct ip_flow *fp, *candidate = NULL, *last_seen = NULL;
-  unsigned int idx, bucket;
+  struct ip_flow *fp;
+  unsigned int idx;
+  u_int32_t hash, pos;
 
   memcpy(&my_iph, pptrs->iph_ptr, IP4HdrSz);
   memcpy(&my_tlh, pptrs->tlh_ptr, MyTCPHdrSz);
   idx = normalize_flow(&iphp->ip_src.s_addr, &iphp->ip_dst.s_addr, &tlhp->src_port, &tlhp->dst_port);
-  bucket = hash_flow(iphp->ip_src.s_addr, iphp->ip_dst.s_addr, tlhp->src_port, tlhp->dst_port, iphp->ip_p);
+  hash = hash_flow(iphp->ip_src.s_addr, iphp->ip_dst.s_addr, tlhp->src_port, tlhp->dst_port, iphp->ip_p);
 
-  for (fp = ip_flow_table[bucket]; fp; fp = fp->next) {
+  for (pos = (hash & ip_flow_table.mask); (fp = ip_table_probe(&ip_flow_table, hash, &pos));) {
     if (fp->ip_src == iphp->ip_src.s_addr && fp->ip_dst == iphp->ip_dst.s_addr &&
 	fp->port_src == tlhp->src_port && fp->port_dst == tlhp->dst_port &&
 	fp->cmn.proto == iphp->ip_p) {
@@ -158,8 +159,6 @@ void find_flow(struct timeval *now, struct packet_ptrs *pptrs)
 	fp->cmn.last[idx].tv_sec = now->tv_sec;
 	fp->cmn.last[idx].tv_usec = now->tv_usec;
 	pptrs->new_flow = FALSE; 
-
-	return;
       }
       else {
 	/* stale flow: will start a new one */ 
@@ -168,147 +167,45 @@ void find_flow(struct timeval *now, struct packet_ptrs *pptrs)
 	fp->cmn.last[idx].tv_sec = now->tv_sec;
 	fp->cmn.last[idx].tv_usec = now->tv_usec;
 	pptrs->new_flow = TRUE;
-
-	return;
       } 
+
+      update_flow_expiry(&ip_flow_table, &fp->tn, &fp->cmn);
+
+      return;
     }
-    if (!candidate && is_expired(now, &fp->cmn)) candidate = fp; 
-    last_seen = fp;
   } 
 
-  if (candidate) create_flow(now, candidate, TRUE, bucket, pptrs, iphp, tlhp, idx);
-  else create_flow(now, last_seen, FALSE, bucket, pptrs, iphp, tlhp, idx); 
+  create_flow(now, hash, pptrs, iphp, tlhp, idx);
 }
 
-void create_flow(struct timeval *now, struct ip_flow *fp, u_int8_t is_candidate, unsigned int bucket, struct packet_ptrs *pptrs, 
+void create_flow(struct timeval *now, u_int32_t hash, struct packet_ptrs *pptrs,
 		 struct pm_iphdr *iphp, struct pm_tlhdr *tlhp, unsigned int idx)
 {
-  struct ip_flow *newf;
+  struct ip_flow *fp;
 
-  if (!flt_total_nodes) {
+  /* expired flows are recycled by the timer wheel: full means full */
+  fp = ip_table_insert(&ip_flow_table, hash, (now->tv_sec + 1));
+  if (!fp) {
     if (now->tv_sec > flt_emergency_prune+FLOW_TABLE_EMER_PRUNE_INTERVAL) {
       Log(LOG_INFO, "INFO ( %s/core ): Flow/4 buffer full. Skipping flows. Increase %s_flow_buffer_size\n", config.name, config.progname); 
       flt_emergency_prune = now->tv_sec;
-      prune_old_flows(now);
     }
     pptrs->new_flow = FALSE; 
     return;
   }
 
-  if (fp) {
-    /* a 'not candidate' is simply the tail (last node) of the
-       list. We need to allocate a new node */
-    if (!is_candidate) { 
-      newf = (struct ip_flow *) malloc(sizeof(struct ip_flow));
-      if (!newf) { 
-	if (now->tv_sec > flt_emergency_prune+FLOW_TABLE_EMER_PRUNE_INTERVAL) {
-	  Log(LOG_INFO, "INFO ( %s/core ): Flow/4 buffer finished memory. Skipping flows. Increase %s_flow_buffer_size\n", config.name, config.progname);
-	  flt_emergency_prune = now->tv_sec;
-	  prune_old_flows(now);
-	}
-	pptrs->new_flow = FALSE;
-	return;
-      }
-      else flt_total_nodes--;
-      memset(newf, 0, sizeof(struct ip_flow));
-      fp->next = newf;
-      newf->prev = fp;  
-      flow_lru_list.last->lru_next = newf; /* placing new node as LRU tail */
-      newf->lru_prev = flow_lru_list.last;
-      flow_lru_list.last = newf;
-      fp = newf;
-    }
-    else {
-      if (fp->lru_next) { /* if fp->lru_next==NULL the node is already the tail */ 
-        fp->lru_prev->lru_next = fp->lru_next; 
-	fp->lru_next->lru_prev = fp->lru_prev;
-	flow_lru_list.last->lru_next = fp;
-	fp->lru_prev = flow_lru_list.last;
-	fp->lru_next = NULL;
-	flow_lru_list.last = fp;
-      }
-
-      memset(&fp->cmn, 0, sizeof(struct ip_flow_common));
-    }
-  }
-  else {
-    /*	we don't have any pointer to existing flows; this is because the
-	current bucket doesn't contain any node; we'll allocate the first
-	one */ 
-    fp = (struct ip_flow *) malloc(sizeof(struct ip_flow));  
-    if (!fp) {
-      if (now->tv_sec > flt_emergency_prune+FLOW_TABLE_EMER_PRUNE_INTERVAL) {
-        Log(LOG_INFO, "INFO ( %s/core ): Flow/4 buffer finished memory. Skipping flows. Increase %s_flow_buffer_size\n", config.name, config.progname);
-        flt_emergency_prune = now->tv_sec;
-        prune_old_flows(now);
-      }
-      pptrs->new_flow = FALSE;
-      return;
-    }
-    else flt_total_nodes--;
-    memset(fp, 0, sizeof(struct ip_flow));
-    ip_flow_table[bucket] = fp;
-    flow_lru_list.last->lru_next = fp; /* placing new node as LRU tail */ 
-    fp->lru_prev = flow_lru_list.last;
-    flow_lru_list.last = fp;
-  }
-
   fp->ip_src = iphp->ip_src.s_addr;
   fp->ip_dst = iphp->ip_dst.s_addr;
   fp->port_src = tlhp->src_port;
   fp->port_dst = tlhp->dst_port;
   fp->cmn.proto = iphp->ip_p;
-  fp->cmn.bucket = bucket;
   evaluate_tcp_flags(now, pptrs, &fp->cmn, idx); 
   fp->cmn.last[idx].tv_sec = now->tv_sec; 
   fp->cmn.last[idx].tv_usec = now->tv_usec; 
 
-  pptrs->new_flow = TRUE;
-}
+  ip_table_schedule(&ip_flow_table, fp, (flow_expiry(&fp->cmn) + 1));
 
-void prune_old_flows(struct timeval *now)
-{
-  struct ip_flow *fp, *temp, *last_seen = flow_lru_list.root;
-
-  fp = flow_lru_list.root->lru_next;
-  while (fp) {
-    if (is_expired(now, &fp->cmn)) {
-      /* we found a stale element; we'll prune it */
-      if (fp->lru_next) temp = fp->lru_next;
-      else temp = NULL;
-
-      /* rearranging bucket's pointers */ 
-      if (fp->prev && fp->next) {
-	fp->prev->next = fp->next;
-        fp->next->prev = fp->prev;
-      }
-      else if (fp->prev) fp->prev->next = NULL;
-      else if (fp->next) {
-	ip_flow_table[fp->cmn.bucket] = fp->next;
-	fp->next->prev = NULL; 
-      }
-      else ip_flow_table[fp->cmn.bucket] = NULL;
-
-      /* rearranging LRU pointers */
-      if (fp->lru_next) {
-        fp->lru_next->lru_prev = fp->lru_prev;
-        fp->lru_prev->lru_next = fp->lru_next;
-      }
-      else fp->lru_prev->lru_next = NULL;
-
-      free(fp);
-      flt_total_nodes++;
-
-      if (temp) fp = temp;
-      else fp = NULL;
-    }
-    else {
-      last_seen = fp;
-      fp = fp->lru_next;
-    }
-  }
-
-  flow_lru_list.last = last_seen;
+  pptrs->new_flow = TRUE;
 }
 
 unsigned int normalize_flow(u_int32_t *ip_src, u_int32_t *ip_dst,
@@ -347,7 +244,7 @@ unsigned int normalize_flow(u_int32_t *ip_src, u_int32_t *ip_dst,
 unsigned int hash_flow(u_int32_t ip_src, u_int32_t ip_dst,
 		u_int16_t port_src, u_int16_t port_dst, u_int8_t proto)
 {
-  return jhash_3words((u_int32_t)(port_src ^ port_dst) << 16 | proto, ip_src, ip_dst, flt_trivial_hash_rnd) & (config.flow_hashsz-1);
+  return jhash_3words((u_int32_t)(port_src ^ port_dst) << 16 | proto, ip_src, ip_dst, flt_trivial_hash_rnd);
 }
 
 /* is_expired() checks for the expiration of the bi-directional flow; returns: TRUE if
@@ -369,40 +266,48 @@ unsigned int is_expired(struct timeval *now, struct ip_flow_common *fp)
    if the flow has expired; FALSE in any other case. */
 unsigned int is_expired_uni(struct timeval *now, struct ip_flow_common *fp, unsigned int idx)
 {
+  if (now->tv_sec > flow_expiry_uni(fp, idx)) return TRUE;
+
+  return FALSE;
+}
+
+/* flow_expiry_uni() returns the time after which the uni-directional flow is to be
+   considered expired, as per the rules above */
+time_t flow_expiry_uni(struct ip_flow_common *fp, unsigned int idx)
+{
+  time_t lifetime;
+
   if (fp->proto == IPPROTO_TCP) {
     /* tcp_flags == 0 ==> the TCP flow is in ESTABLISHED mode */
-    if (!fp->tcp_flags[idx]) {
-      if (now->tv_sec > fp->last[idx].tv_sec+flow_tcpest_lifetime) return TRUE;
-    }
+    if (!fp->tcp_flags[idx]) lifetime = flow_tcpest_lifetime;
     else {
-      if (fp->tcp_flags[idx] & TH_SYN && now->tv_sec > fp->last[idx].tv_sec+FLOW_TCPSYN_LIFETIME) return TRUE;
-      if (fp->tcp_flags[idx] & TH_FIN && now->tv_sec > fp->last[idx].tv_sec+FLOW_TCPFIN_LIFETIME) return TRUE;
-      if (fp->tcp_flags[idx] & TH_RST && now->tv_sec > fp->last[idx].tv_sec+FLOW_TCPRST_LIFETIME) return TRUE;
+      /* the first one is not reached: flags here always carry SYN, FIN or RST */
+      lifetime = FLOW_TCPEST_LIFETIME;
+      if (fp->tcp_flags[idx] & TH_SYN) lifetime = MIN(lifetime, FLOW_TCPSYN_LIFETIME);
+      if (fp->tcp_flags[idx] & TH_FIN) lifetime = MIN(lifetime, FLOW_TCPFIN_LIFETIME);
+      if (fp->tcp_flags[idx] & TH_RST) lifetime = MIN(lifetime, FLOW_TCPRST_LIFETIME);
     }
   }
-  else {
-    if (now->tv_sec > fp->last[idx].tv_sec+flow_generic_lifetime) return TRUE;
-  }
+  else lifetime = flow_generic_lifetime;
 
-  return FALSE;
+  return (fp->last[idx].tv_sec + lifetime);
+}
+
+/* flow_expiry() returns the time after which the bi-directional flow is expired */
+time_t flow_expiry(struct ip_flow_common *fp)
+{
+  return MAX(flow_expiry_uni(fp, 0), flow_expiry_uni(fp, 1));
 }
 
 void init_ip6_flow_handler()
 {
-  int size;
+  u_int32_t bufsz;
 
-  if (config.flow_bufsz) flt6_total_nodes = config.flow_bufsz / sizeof(struct ip_flow6);
-  else flt6_total_nodes = DEFAULT_FLOW_BUFFER_SIZE / sizeof(struct ip_flow6);
+  if (config.flow_bufsz) bufsz = config.flow_bufsz;
+  else bufsz = DEFAULT_FLOW_BUFFER_SIZE;
 
   if (!config.flow_hashsz) config.flow_hashsz = FLOW_TABLE_HASHSZ;
-  size = sizeof(struct ip_flow6) * config.flow_hashsz;
-  ip_flow_table6 = (struct ip_flow6 **) malloc(size);
-
-  memset(ip_flow_table6, 0, size);
-  flow_lru_list6.root = (struct ip_flow6 *) malloc(sizeof(struct ip_flow6));
-  flow_lru_list6.last = flow_lru_list6.root;
-  memset(flow_lru_list6.root, 0, sizeof(struct ip_flow6));
-  flt6_prune_deadline = time(NULL)+FLOW_TABLE_PRUNE_INTERVAL;
+  ip_table_init(&ip_flow_table6, "Flow/6", bufsz, sizeof(struct ip_flow6), config.flow_hashsz, ip_flow_table6_expiry, NULL);
   flt6_emergency_prune = 0;
 
   if (config.flow_lifetime) flow_generic_lifetime = config.flow_lifetime;
@@ -420,10 +325,7 @@ void ip_flow6_handler(struct packet_ptrs *pptrs)
 
   gettimeofday(&now, NULL);
 
-  if (now.tv_sec > flt6_prune_deadline) {
-    prune_old_flows6(&now);
-    flt6_prune_deadline = now.tv_sec+FLOW_TABLE_PRUNE_INTERVAL;
-  }
+  ip_table_expire(&ip_flow_table6, now.tv_sec);
 
   find_flow6(&now, pptrs);
 }
@@ -452,7 +354,7 @@ unsigned int hash_flow6(u_int32_t id, struct in6_addr *saddr, struct in6_addr *d
         c += id;
         __jhash_mix(a, b, c);
 
-        return c & (config.flow_hashsz - 1);
+        return c;
 }
 
 unsigned int normalize_flow6(struct in6_addr *saddr, struct in6_addr *daddr,
@@ -492,15 +394,16 @@ void find_flow6(struct timeval *now, struct packet_ptrs *pptrs)
   struct pm_tcphdr my_tlh;
   struct ip6_hdr *iphp = &my_iph;
   struct pm_tlhdr *tlhp = (struct pm_tlhdr *) &my_tlh;
-  struct ip_flow6 *fp, *candidate = NULL, *last_seen = NULL;
-  unsigned int idx, bucket;
+  struct ip_flow6 *fp;
+  unsigned int idx;
+  u_int32_t hash, pos;
 
   memcpy(&my_iph, pptrs->iph_ptr, IP6HdrSz);
   memcpy(&my_tlh, pptrs->tlh_ptr, MyTCPHdrSz);
   idx = normalize_flow6(&iphp->ip6_src, &iphp->ip6_dst, &tlhp->src_port, &tlhp->dst_port);
-  bucket = hash_flow6((tlhp->src_port << 16) | tlhp->dst_port, &iphp->ip6_src, &iphp->ip6_dst);
+  hash = hash_flow6((tlhp->src_port << 16) | tlhp->dst_port, &iphp->ip6_src, &iphp->ip6_dst);
 
-  for (fp = ip_flow_table6[bucket]; fp; fp = fp->next) {
+  for (pos = (hash & ip_flow_table6.mask); (fp = ip_table_probe(&ip_flow_table6, hash, &pos));) {
     if (!ip6_addr_cmp(&fp->ip_src, &iphp->ip6_src) && !ip6_addr_cmp(&fp->ip_dst, &iphp->ip6_dst) &&
         fp->port_src == tlhp->src_port && fp->port_dst == tlhp->dst_port &&
 	fp->cmn.proto == pptrs->l4_proto) {
@@ -511,8 +414,6 @@ void find_flow6(struct timeval *now, struct packet_ptrs *pptrs)
 	fp->cmn.last[idx].tv_sec = now->tv_sec;
 	fp->cmn.last[idx].tv_usec = now->tv_usec;
 	pptrs->new_flow = FALSE;
-
-	return;
       }
       else {
         /* stale flow: will start a new one */
@@ -521,144 +422,42 @@ void find_flow6(struct timeval *now, struct packet_ptrs *pptrs)
 	fp->cmn.last[idx].tv_sec = now->tv_sec;
 	fp->cmn.last[idx].tv_usec = now->tv_usec;
 	pptrs->new_flow = TRUE;
-
-	return;
       }
+
+      update_flow_expiry(&ip_flow_table6, &fp->tn, &fp->cmn);
+
+      return;
     }
-    if (!candidate && is_expired(now, &fp->cmn)) candidate = fp;
-    last_seen = fp;
   }
 
-  if (candidate) create_flow6(now, candidate, TRUE, bucket, pptrs, iphp, tlhp, idx);
-  else create_flow6(now, last_seen, FALSE, bucket, pptrs, iphp, tlhp, idx);
+  create_flow6(now, hash, pptrs, iphp, tlhp, idx);
 }
 
-void create_flow6(struct timeval *now, struct ip_flow6 *fp, u_int8_t is_candidate, unsigned int bucket,
-	          struct packet_ptrs *pptrs, struct ip6_hdr *iphp, struct pm_tlhdr *tlhp, unsigned int idx)
+void create_flow6(struct timeval *now, u_int32_t hash, struct packet_ptrs *pptrs,
+		  struct ip6_hdr *iphp, struct pm_tlhdr *tlhp, unsigned int idx)
 {
-  struct ip_flow6 *newf;
+  struct ip_flow6 *fp;
 
-  if (!flt6_total_nodes) {
+  fp = ip_table_insert(&ip_flow_table6, hash, (now->tv_sec + 1));
+  if (!fp) {
     if (now->tv_sec > flt6_emergency_prune+FLOW_TABLE_EMER_PRUNE_INTERVAL) {
       Log(LOG_INFO, "INFO ( %s/core ): Flow/6 buffer full. Skipping flows. Increase %s_flow_buffer_size\n", config.name, config.progname);
       flt6_emergency_prune = now->tv_sec;
-      prune_old_flows6(now);
     }
     pptrs->new_flow = FALSE;
     return;
   }
 
-  if (fp) {
-    /* a 'not candidate' is simply the tail (last node) of the
-       list. We need to allocate a new node */
-    if (!is_candidate) {
-      newf = (struct ip_flow6 *) malloc(sizeof(struct ip_flow6));
-      if (!newf) {
-	if (now->tv_sec > flt6_emergency_prune+FLOW_TABLE_EMER_PRUNE_INTERVAL) {
-	  Log(LOG_INFO, "INFO ( %s/core ): Flow/6 buffer full. Skipping flows. Increase %s_flow_buffer_size\n", config.name, config.progname);
-	  flt6_emergency_prune = now->tv_sec;
-	  prune_old_flows6(now);
-	}
-        pptrs->new_flow = FALSE;
-	return;
-      }
-      else flt6_total_nodes--;
-      memset(newf, 0, sizeof(struct ip_flow6));
-      fp->next = newf;
-      newf->prev = fp;
-      flow_lru_list6.last->lru_next = newf; /* placing new node as LRU tail */
-      newf->lru_prev = flow_lru_list6.last;
-      flow_lru_list6.last = newf;
-      fp = newf;
-    }
-    else {
-      if (fp->lru_next) { /* if fp->lru_next==NULL the node is already the tail */
-        fp->lru_prev->lru_next = fp->lru_next;
-        fp->lru_next->lru_prev = fp->lru_prev;
-        flow_lru_list6.last->lru_next = fp;
-        fp->lru_prev = flow_lru_list6.last;
-        fp->lru_next = NULL;
-        flow_lru_list6.last = fp;
-      }
-
-      memset(&fp->cmn, 0, sizeof(struct ip_flow_common));
-    }
-  }
-  else {
-    /* we don't have any fragment pointer; this is because current
-       bucket doesn't contain any node; we'll allocate first one */
-    fp = (struct ip_flow6 *) malloc(sizeof(struct ip_flow6));
-    if (!fp) {
-      if (now->tv_sec > flt6_emergency_prune+FLOW_TABLE_EMER_PRUNE_INTERVAL) {
-        Log(LOG_INFO, "INFO ( %s/core ): Flow/6 buffer full. Skipping flows. Increase %s_flow_buffer_size\n", config.name, config.progname);
-        flt6_emergency_prune = now->tv_sec;
-        prune_old_flows6(now);
-      }
-      pptrs->new_flow = FALSE;
-      return;
-    }
-    else flt6_total_nodes--;
-    memset(fp, 0, sizeof(struct ip_flow6));
-    ip_flow_table6[bucket] = fp;
-    flow_lru_list6.last->lru_next = fp; /* placing new node as LRU tail */
-    fp->lru_prev = flow_lru_list6.last;
-    flow_lru_list6.last = fp;
-  }
-
   ip6_addr_cpy(&fp->ip_src, &iphp->ip6_src);
   ip6_addr_cpy(&fp->ip_dst, &iphp->ip6_dst);
   fp->port_src = tlhp->src_port;
   fp->port_dst = tlhp->dst_port;
   fp->cmn.proto = pptrs->l4_proto;
-  fp->cmn.bucket = bucket;
   evaluate_tcp_flags(now, pptrs, &fp->cmn, idx);
   fp->cmn.last[idx].tv_sec = now->tv_sec;
   fp->cmn.last[idx].tv_usec = now->tv_usec;
 
-  pptrs->new_flow = TRUE;
-}
+  ip_table_schedule(&ip_flow_table6, fp, (flow_expiry(&fp->cmn) + 1));
 
-void prune_old_flows6(struct timeval *now)
-{
-  struct ip_flow6 *fp, *temp, *last_seen = flow_lru_list6.root;
-
-  fp = flow_lru_list6.root->lru_next;
-  while (fp) {
-    if (is_expired(now, &fp->cmn)) {
-      /* we found a stale element; we'll prune it */
-      if (fp->lru_next) temp = fp->lru_next;
-      else temp = NULL;
-
-      /* rearranging bucket's pointers */
-      if (fp->prev && fp->next) {
-        fp->prev->next = fp->next;
-        fp->next->prev = fp->prev;
-      }
-      else if (fp->prev) fp->prev->next = NULL;
-      else if (fp->next) {
-        ip_flow_table6[fp->cmn.bucket] = fp->next;
-        fp->next->prev = NULL;
-      }
-      else ip_flow_table6[fp->cmn.bucket] = NULL;
-
-      /* rearranging LRU pointers */
-      if (fp->lru_next) {
-        fp->lru_next->lru_prev = fp->lru_prev;
-        fp->lru_prev->lru_next = fp->lru_next;
-      }
-      else fp->lru_prev->lru_next = NULL;
-
-      free(fp);
-      flt6_total_nodes++;
-
-      if (temp) fp = temp;
-      else fp = NULL;
-    }
-    else {
-      last_seen = fp;
-      fp = fp->lru_next;
-    }
-  }
-
-  flow_lru_list6.last = last_seen;
+  pptrs->new_flow = TRUE;
 }
@@ -22,16 +22,18 @@
 #ifndef IP_FRAG_H
 #define IP_FRAG_H
 
+/* includes */
+#include "ip_table.h"
+
 /* defines */
 #define IPFT_HASHSZ 256 
 #define IPF_TIMEOUT 60 
-#define PRUNE_INTERVAL 7200
 #define EMER_PRUNE_INTERVAL 60
-#define PRUNE_OFFSET 1800 
 #define DEFAULT_FRAG_BUFFER_SIZE 4096000 /* 4 Mb */
 
 /* structures */
 struct ip_fragment {
+  struct ip_table_node tn;
   unsigned char tlhdr[8];	/* upper level info */ 
   u_int8_t got_first;		/* got first packet ? */
   u_int16_t a;			/* bytes accumulator */
@@ -41,19 +43,10 @@ struct ip_fragment {
   u_int8_t ip_p;
   u_int32_t ip_src;
   u_int32_t ip_dst;
-  u_int16_t bucket;
-  struct ip_fragment *lru_next;
-  struct ip_fragment *lru_prev;
-  struct ip_fragment *next;
-  struct ip_fragment *prev;
-};
-
-struct lru_l {
-  struct ip_fragment *root;
-  struct ip_fragment *last;
 };
 
 struct ip6_fragment {
+  struct ip_table_node tn;
   unsigned char tlhdr[8];       /* upper level info */
   u_int8_t got_first;           /* got first packet ? */
   u_int16_t a;                  /* bytes accumulator */
@@ -62,24 +55,11 @@ struct ip6_fragment {
   u_int32_t id;
   u_int32_t src[4];
   u_int32_t dst[4];
-  u_int16_t bucket;
-  struct ip6_fragment *lru_next;
-  struct ip6_fragment *lru_prev;
-  struct ip6_fragment *next;
-  struct ip6_fragment *prev;
-};
-
-struct lru_l6 {
-  struct ip6_fragment *root;
-  struct ip6_fragment *last;
 };
 
 /* global vars */
-extern struct ip_fragment *ipft[IPFT_HASHSZ];
-extern struct lru_l lru_list;
-
-extern struct ip6_fragment *ipft6[IPFT_HASHSZ];
-extern struct lru_l6 lru_list6;
+extern struct ip_table ipft;
+extern struct ip_table ipft6;
 
 /* prototypes */
 extern void enable_ip_fragment_handler();
@@ -87,17 +67,15 @@ extern void init_ip_fragment_handler(); /* wrapper */
 extern void init_ip4_fragment_handler(); 
 extern int ip_fragment_handler(struct packet_ptrs *); 
 extern int find_fragment(u_int32_t, struct packet_ptrs *); 
-extern int create_fragment(u_int32_t, struct ip_fragment *, u_int8_t, unsigned int, struct packet_ptrs *); 
+extern int create_fragment(u_int32_t, struct ip_fragment *, u_int32_t, struct packet_ptrs *); 
 extern unsigned int hash_fragment(u_int16_t, u_int32_t, u_int32_t, u_int8_t);
-extern void prune_old_fragments(u_int32_t, u_int32_t); 
 extern void notify_orphan_fragment(struct ip_fragment *);
 
 extern void init_ip6_fragment_handler();
 extern int ip6_fragment_handler(struct packet_ptrs *, struct ip6_frag *);
 extern unsigned int hash_fragment6(u_int32_t, struct in6_addr *, struct in6_addr *);
 extern int find_fragment6(u_int32_t, struct packet_ptrs *, struct ip6_frag *);
-extern int create_fragment6(u_int32_t, struct ip6_fragment *, u_int8_t, unsigned int, struct packet_ptrs *, struct ip6_frag *);
-extern void prune_old_fragments6(u_int32_t, u_int32_t); 
+extern int create_fragment6(u_int32_t, struct ip6_fragment *, u_int32_t, struct packet_ptrs *, struct ip6_frag *);
 extern void notify_orphan_fragment6(struct ip6_fragment *);
 
 #endif //IP_FRAG_H
@@ -0,0 +1,214 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "ip_table.h"
+
+/* functions */
+static inline struct ip_table_node *ip_table_hdr(struct ip_table *t, u_int32_t idx)
+{
+  return (struct ip_table_node *) ip_table_node(t, idx);
+}
+
+static inline u_int32_t ip_table_idx(struct ip_table *t, void *node)
+{
+  return (((u_char *) node - t->nodes) / t->node_size);
+}
+
+void ip_table_init(struct ip_table *t, char *name, u_int32_t bufsz, u_int32_t node_size, u_int32_t min_cells,
+		   ip_table_expiry_func expiry, ip_table_evict_func evict)
+{
+  u_int32_t cells = 1, idx;
+
+  memset(t, 0, sizeof(struct ip_table));
+  t->name = name;
+  t->node_size = node_size;
+  t->nodes_max = (bufsz / node_size);
+  if (!t->nodes_max) t->nodes_max = 1;
+  t->nodes_free = IP_TABLE_NIL;
+  t->expiry = expiry;
+  t->evict = evict;
+
+  /* keep the index at most half full */
+  while (cells < (2 * t->nodes_max) || cells < min_cells) cells <<= 1;
+  t->mask = (cells - 1);
+
+  /* slab pages get touched as nodes are first used */
+  t->nodes = malloc((size_t) t->nodes_max * node_size);
+  t->cells = malloc((size_t) cells * sizeof(struct ip_table_cell));
+
+  if (!t->nodes || !t->cells) {
+    Log(LOG_ERR, "ERROR ( %s/core ): %s buffer: unable to allocate %u nodes. Exiting.\n", config.name, name, t->nodes_max);
+    exit_gracefully(1);
+  }
+
+  for (idx = 0; idx < cells; idx++) {
+    t->cells[idx].hash = 0;
+    t->cells[idx].node = IP_TABLE_NIL;
+  }
+
+  for (idx = 0; idx < IP_TABLE_WHEEL_SLOTS; idx++) t->wheel[idx] = IP_TABLE_NIL;
+
+  t->clock = time(NULL);
+}
+
+static void ip_table_unlink(struct ip_table *t, struct ip_table_node *n)
+{
+  if (!n->sched) return;
+
+  if (n->prev != IP_TABLE_NIL) ip_table_hdr(t, n->prev)->next = n->next;
+  else t->wheel[n->sched & (IP_TABLE_WHEEL_SLOTS - 1)] = n->next;
+
+  if (n->next != IP_TABLE_NIL) ip_table_hdr(t, n->next)->prev = n->prev;
+
+  n->sched = 0;
+}
+
+static void ip_table_link(struct ip_table *t, struct ip_table_node *n, u_int32_t idx, u_int32_t when)
+{
+  u_int32_t slot = (when & (IP_TABLE_WHEEL_SLOTS - 1));
+
+  n->sched = when;
+  n->prev = IP_TABLE_NIL;
+  n->next = t->wheel[slot];
+  if (n->next != IP_TABLE_NIL) ip_table_hdr(t, n->next)->prev = idx;
+  t->wheel[slot] = idx;
+}
+
+/* (re)schedules the check of 'node' for second 'when' */
+void ip_table_schedule(struct ip_table *t, void *node, time_t when)
+{
+  struct ip_table_node *n = node;
+
+  /* the current slot was already processed: it would be a lap late */
+  if (when <= t->clock) when = (t->clock + 1);
+
+  ip_table_unlink(t, n);
+  ip_table_link(t, n, ip_table_idx(t, node), when);
+}
+
+/*
+   Returns a zeroed node indexed under 'hash' and due for a check at 'when';
+   the caller is expected to have verified the key is not in the table yet.
+   Returns NULL if the table is full.
+*/
+void *ip_table_insert(struct ip_table *t, u_int32_t hash, time_t when)
+{
+  struct ip_table_node *n;
+  u_int32_t idx, pos;
+
+  if (t->nodes_free != IP_TABLE_NIL) {
+    idx = t->nodes_free;
+    t->nodes_free = ip_table_hdr(t, idx)->next;
+  }
+  else if (t->nodes_used < t->nodes_max) idx = t->nodes_used++;
+  else return NULL;
+
+  n = ip_table_hdr(t, idx);
+  memset(n, 0, t->node_size);
+  n->hash = hash;
+
+  for (pos = (hash & t->mask); t->cells[pos].node != IP_TABLE_NIL; pos = ((pos + 1) & t->mask));
+  t->cells[pos].hash = hash;
+  t->cells[pos].node = idx;
+  t->count++;
+
+  ip_table_schedule(t, n, when);
+
+  return n;
+}
+
+void ip_table_delete(struct ip_table *t, void *node)
+{
+  struct ip_table_node *n = node;
+  u_int32_t idx = ip_table_idx(t, node), pos, next, home;
+
+  ip_table_unlink(t, n);
+
+  for (pos = (n->hash & t->mask); t->cells[pos].node != idx; pos = ((pos + 1) & t->mask)) {
+    assert(t->cells[pos].node != IP_TABLE_NIL);
+  }
+
+  /* backward shift deletion: no tombstones are left behind */
+  for (next = pos;;) {
+    next = ((next + 1) & t->mask);
+    if (t->cells[next].node == IP_TABLE_NIL) break;
+
+    /* a cell whose home lies cyclically in (pos, next] has to stay */
+    home = (t->cells[next].hash & t->mask);
+    if ((pos <= next) ? (pos < home && home <= next) : (pos < home || home <= next)) continue;
+
+    t->cells[pos] = t->cells[next];
+    pos = next;
+  }
+
+  t->cells[pos].node = IP_TABLE_NIL;
+
+  n->next = t->nodes_free;
+  t->nodes_free = idx;
+  t->count--;
+}
+
+/*
+   Advances the timer wheel up to 'now', processing each elapsed slot:
+   expired nodes are evicted, others rescheduled. To be called at least
+   once per second in order to avoid catching up in bursts.
+*/
+void ip_table_expire(struct ip_table *t, time_t now)
+{
+  struct ip_table_node *n;
+  u_int32_t idx, next, slot, steps = 0;
+  time_t expiry;
+
+  while (t->clock < now) {
+    if (steps++ == IP_TABLE_WHEEL_SLOTS) {
+      t->clock = now;
+      break;
+    }
+
+    t->clock++;
+    slot = (t->clock & (IP_TABLE_WHEEL_SLOTS - 1));
+    idx = t->wheel[slot];
+    t->wheel[slot] = IP_TABLE_NIL;
+
+    for (; idx != IP_TABLE_NIL; idx = next) {
+      n = ip_table_hdr(t, idx);
+      next = n->next;
+
+      /* due on a later lap of the wheel */
+      if (n->sched > t->clock) {
+	ip_table_link(t, n, idx, n->sched);
+	continue;
+      }
+
+      n->sched = 0;
+      expiry = t->expiry(n, now);
+
+      if (now > expiry) {
+	if (t->evict) t->evict(n);
+	ip_table_delete(t, n);
+      }
+      else ip_table_link(t, n, idx, (expiry + 1));
+    }
+  }
+}
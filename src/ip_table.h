@@ -0,0 +1,116 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef IP_TABLE_H
+#define IP_TABLE_H
+
+/*
+   Fixed-size table backing the flow (ip_flow.c) and fragment (ip_frag.c)
+   buffers. Nodes are preallocated in a single slab and indexed by an
+   open-addressing (linear probing) array of { hash, node } cells kept at
+   most half full, so that a lookup touches a couple of adjacent cells and
+   compares the full key only on a hash match. Expiry is driven by a timer
+   wheel with one-second slots: each node sits in the slot of the second
+   it is due for a check, the owner being free to reschedule it earlier;
+   a node found not expired upon its check is just rescheduled. Expiring
+   nodes costs then O(nodes due) per second and no scan of the table is
+   ever needed.
+*/
+
+/* defines */
+#define IP_TABLE_NIL			0xFFFFFFFF
+#define IP_TABLE_WHEEL_SLOTS		1024	/* secs, power of 2 */
+
+/* structures */
+struct ip_table;
+
+/* returns the time the node expires at: expired when now > expiry */
+typedef time_t (*ip_table_expiry_func)(void *, time_t);
+/* invoked right before an expired node is recycled */
+typedef void (*ip_table_evict_func)(void *);
+
+/* to be the first member of any node */
+struct ip_table_node {
+  u_int32_t hash;
+  u_int32_t sched;		/* second the node is due for a check */
+  u_int32_t prev;		/* timer wheel chaining */
+  u_int32_t next;
+};
+
+struct ip_table_cell {
+  u_int32_t hash;
+  u_int32_t node;		/* IP_TABLE_NIL if the cell is empty */
+};
+
+struct ip_table {
+  char *name;			/* for logging purposes, ie. "Flow/4" */
+  u_char *nodes;		/* slab */
+  u_int32_t node_size;
+  u_int32_t nodes_max;
+  u_int32_t nodes_used;		/* slab high watermark */
+  u_int32_t nodes_free;		/* head of the free list */
+  u_int32_t count;
+
+  struct ip_table_cell *cells;
+  u_int32_t mask;		/* cells - 1 */
+
+  u_int32_t wheel[IP_TABLE_WHEEL_SLOTS];
+  time_t clock;			/* last second processed by the wheel */
+
+  ip_table_expiry_func expiry;
+  ip_table_evict_func evict;
+};
+
+/* prototypes */
+extern void ip_table_init(struct ip_table *, char *, u_int32_t, u_int32_t, u_int32_t, ip_table_expiry_func, ip_table_evict_func);
+extern void *ip_table_insert(struct ip_table *, u_int32_t, time_t);
+extern void ip_table_delete(struct ip_table *, void *);
+extern void ip_table_schedule(struct ip_table *, void *, time_t);
+extern void ip_table_expire(struct ip_table *, time_t);
+
+static inline void *ip_table_node(struct ip_table *t, u_int32_t idx)
+{
+  return (t->nodes + ((size_t) idx * t->node_size));
+}
+
+/*
+   Walks the cells probed for 'hash', starting at (hash & mask) on the
+   first call, and returns the next node with a matching hash or NULL
+   once an empty cell is reached; the caller is left to compare keys.
+*/
+static inline void *ip_table_probe(struct ip_table *t, u_int32_t hash, u_int32_t *pos)
+{
+  struct ip_table_cell *cell;
+
+  for (;; (*pos) = (((*pos) + 1) & t->mask)) {
+    cell = &t->cells[*pos];
+
+    if (cell->node == IP_TABLE_NIL) return NULL;
+
+    if (cell->hash == hash) {
+      (*pos) = (((*pos) + 1) & t->mask);
+      return ip_table_node(t, cell->node);
+    }
+  }
+}
+
+#endif // IP_TABLE_H
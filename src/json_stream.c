@@ -0,0 +1,244 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "json_stream.h"
+
+/* global variables */
+static const char json_stream_digits[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+/* functions */
+void json_stream_init(struct json_stream *js, size_t size)
+{
+  memset(js, 0, sizeof(struct json_stream));
+
+  if (!size) size = JSON_STREAM_BUFLEN;
+
+  js->buf = malloc(size);
+  if (!js->buf) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (json_stream_init). Exiting ..\n", config.name, config.type);
+    exit_gracefully(1);
+  }
+
+  js->buf[0] = '\0';
+  js->size = size;
+}
+
+void json_stream_free(struct json_stream *js)
+{
+  if (js->buf) free(js->buf);
+
+  memset(js, 0, sizeof(struct json_stream));
+}
+
+/* hands the buffer over to the caller, who is then to free() it */
+char *json_stream_detach(struct json_stream *js)
+{
+  char *buf = js->buf;
+
+  memset(js, 0, sizeof(struct json_stream));
+
+  return buf;
+}
+
+void json_stream_grow(struct json_stream *js, size_t len)
+{
+  size_t size = (js->size ? js->size : JSON_STREAM_BUFLEN);
+
+  while (size < (js->len + len)) size *= 2;
+
+  js->buf = realloc(js->buf, size);
+  if (!js->buf) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): realloc() failed (json_stream_grow). Exiting ..\n", config.name, config.type);
+    exit_gracefully(1);
+  }
+
+  js->size = size;
+}
+
+/* same checks as Jansson: no overlong forms, surrogates or codepoints past U+10FFFF */
+int json_stream_utf8_valid(const char *str, size_t len)
+{
+  const u_char *ptr = (const u_char *) str, *end = ptr + len;
+  u_int32_t value;
+  int size, idx;
+
+  while (ptr < end) {
+    if (*ptr < 0x80) {
+      ptr++;
+      continue;
+    }
+    else if (*ptr < 0xC2) return FALSE;
+    else if (*ptr < 0xE0) {
+      size = 2;
+      value = (*ptr & 0x1F);
+    }
+    else if (*ptr < 0xF0) {
+      size = 3;
+      value = (*ptr & 0x0F);
+    }
+    else if (*ptr < 0xF5) {
+      size = 4;
+      value = (*ptr & 0x07);
+    }
+    else return FALSE;
+
+    if ((end - ptr) < size) return FALSE;
+
+    for (idx = 1; idx < size; idx++) {
+      if ((ptr[idx] & 0xC0) != 0x80) return FALSE;
+      value = ((value << 6) | (ptr[idx] & 0x3F));
+    }
+
+    if (size == 3 && (value < 0x800 || (value >= 0xD800 && value <= 0xDFFF))) return FALSE;
+    if (size == 4 && (value < 0x10000 || value > 0x10FFFF)) return FALSE;
+
+    ptr += size;
+  }
+
+  return TRUE;
+}
+
+/* writes 'value' in decimal, two digits at a time; returns the length */
+size_t json_stream_itoa(char *str, int64_t value)
+{
+  char tmp[JSON_STREAM_INTLEN], *ptr = tmp + sizeof(tmp);
+  u_int64_t uvalue = ((value < 0) ? (0 - (u_int64_t) value) : (u_int64_t) value);
+  size_t len;
+  int digit;
+
+  while (uvalue >= 100) {
+    digit = ((uvalue % 100) * 2);
+    uvalue /= 100;
+    *--ptr = json_stream_digits[digit + 1];
+    *--ptr = json_stream_digits[digit];
+  }
+
+  if (uvalue >= 10) {
+    digit = (uvalue * 2);
+    *--ptr = json_stream_digits[digit + 1];
+    *--ptr = json_stream_digits[digit];
+  }
+  else *--ptr = ('0' + uvalue);
+
+  if (value < 0) *--ptr = '-';
+
+  len = ((tmp + sizeof(tmp)) - ptr);
+  memcpy(str, ptr, len);
+  str[len] = '\0';
+
+  return len;
+}
+
+/* appends 'str' quoted, escaping as json_dumps() does with no flags set */
+void json_stream_escape(struct json_stream *js, const char *str, size_t len)
+{
+  const char *run = str, *ptr, *end = str + len;
+  char seq[8];
+
+  json_stream_append(js, "\"", 1);
+
+  for (ptr = str; ptr < end; ptr++) {
+    u_char c = *ptr;
+
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+    if (ptr > run) json_stream_append(js, run, (ptr - run));
+    run = (ptr + 1);
+
+    switch (c) {
+    case '"':
+      json_stream_append(js, "\\\"", 2);
+      break;
+    case '\\':
+      json_stream_append(js, "\\\\", 2);
+      break;
+    case '\b':
+      json_stream_append(js, "\\b", 2);
+      break;
+    case '\f':
+      json_stream_append(js, "\\f", 2);
+      break;
+    case '\n':
+      json_stream_append(js, "\\n", 2);
+      break;
+    case '\r':
+      json_stream_append(js, "\\r", 2);
+      break;
+    case '\t':
+      json_stream_append(js, "\\t", 2);
+      break;
+    default:
+      snprintf(seq, sizeof(seq), "\\u%04X", c);
+      json_stream_append(js, seq, 6);
+      break;
+    }
+  }
+
+  if (ptr > run) json_stream_append(js, run, (ptr - run));
+
+  json_stream_append(js, "\"", 1);
+}
+
+/* returns ERR, writing nothing, where json_string() would have failed */
+int json_stream_string(struct json_stream *js, const char *key, size_t keylen, const char *str)
+{
+  size_t len;
+
+  if (!str) return ERR;
+
+  len = strlen(str);
+  if (!json_stream_utf8_valid(str, len)) return ERR;
+
+  json_stream_key(js, key, keylen);
+  json_stream_escape(js, str, len);
+
+  return SUCCESS;
+}
+
+void json_stream_int(struct json_stream *js, const char *key, size_t keylen, int64_t value)
+{
+  json_stream_key(js, key, keylen);
+  json_stream_reserve(js, JSON_STREAM_INTLEN);
+  js->len += json_stream_itoa(js->buf + js->len, value);
+}
+
+/* appends already serialized members, ie. the content of a dumped object */
+void json_stream_members(struct json_stream *js, const char *members, size_t len)
+{
+  if (!len) return;
+
+  if (js->members) json_stream_append(js, ", ", 2);
+  json_stream_append(js, members, len);
+  js->members++;
+}
@@ -0,0 +1,95 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+/*
+   Append-only JSON writer: members are serialized straight into a
+   reusable buffer instead of going through a tree of Jansson objects.
+   Output is byte-compatible with json_dumps(obj, JSON_PRESERVE_ORDER),
+   ie. ", " and ": " separators, same string escaping and strings that
+   are not valid UTF-8 being skipped along with their key.
+*/
+
+/* defines */
+#define JSON_STREAM_BUFLEN	1024
+#define JSON_STREAM_INTLEN	21	/* sign + 19 digits + NUL */
+
+/* expands to the pre-rendered member prefix and its length */
+#define JSON_STREAM_KEY(k)	"\"" k "\": ", (sizeof("\"" k "\": ") - 1)
+
+/* structures */
+struct json_stream {
+  char *buf;
+  size_t len;			/* bytes written, NUL excluded */
+  size_t size;
+  int members;			/* members written in the current object */
+};
+
+/* prototypes */
+extern void json_stream_init(struct json_stream *, size_t);
+extern void json_stream_free(struct json_stream *);
+extern char *json_stream_detach(struct json_stream *);
+extern void json_stream_grow(struct json_stream *, size_t);
+extern int json_stream_utf8_valid(const char *, size_t);
+extern size_t json_stream_itoa(char *, int64_t);
+extern void json_stream_escape(struct json_stream *, const char *, size_t);
+extern int json_stream_string(struct json_stream *, const char *, size_t, const char *);
+extern void json_stream_int(struct json_stream *, const char *, size_t, int64_t);
+extern void json_stream_members(struct json_stream *, const char *, size_t);
+
+static inline void json_stream_reserve(struct json_stream *js, size_t len)
+{
+  /* one extra byte to keep the buffer NUL-terminated */
+  if ((js->len + len + 1) > js->size) json_stream_grow(js, len + 1);
+}
+
+static inline void json_stream_append(struct json_stream *js, const char *str, size_t len)
+{
+  json_stream_reserve(js, len);
+  memcpy(js->buf + js->len, str, len);
+  js->len += len;
+  js->buf[js->len] = '\0';
+}
+
+static inline void json_stream_open(struct json_stream *js)
+{
+  js->len = 0;
+  js->members = 0;
+  json_stream_append(js, "{", 1);
+}
+
+static inline void json_stream_close(struct json_stream *js)
+{
+  json_stream_append(js, "}", 1);
+}
+
+/* 'key' is a JSON_STREAM_KEY() prefix, ie. quoted and followed by ": " */
+static inline void json_stream_key(struct json_stream *js, const char *key, size_t keylen)
+{
+  if (js->members) json_stream_append(js, ", ", 2);
+  json_stream_append(js, key, keylen);
+  js->members++;
+}
+
+#endif // JSON_STREAM_H
@@ -25,6 +25,7 @@
 #include "pmacct-data.h"
 #include "plugin_hooks.h"
 #include "net_aggr.h"
+#include "net_lpm.h"
 #include "jhash.h"
 
 /* global variables */
@@ -47,7 +48,7 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
 {
   FILE *file;
   struct networks_table tmp, *tmpt = &tmp; 
-  struct networks_table bkt;
+  struct networks_table new, *newt = &new;
   struct networks_table_metadata *mdt = NULL;
   char buf[SRVBUFLEN], *bufptr, *delim, *peer_as, *as, *net, *mask, *nh;
   int rows, eff_rows = 0, j, buflen, fields, prev[NETWORKS_CACHE_DEPTH], current, next;
@@ -58,26 +59,18 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
   memset(&dummy_entry, 0, sizeof(struct networks_table_entry));
   dummy_entry.masknum = 255;
 
-  memset(&bkt, 0, sizeof(bkt));
+  memset(&new, 0, sizeof(new));
   memset(&tmp, 0, sizeof(tmp));
   memset(&st, 0, sizeof(st));
   default_route_in_networks4_table = FALSE;
 
-  /* backing up pre-existing table and cache */ 
-  if (nt->num) {
-    bkt.table = nt->table;
-    bkt.num = nt->num;
-    bkt.timestamp = nt->timestamp;
-
-    nt->table = NULL;
-    nt->num = 0;
-    nt->timestamp = 0;
-  }
-
-  if (filename) {
+  /* the new table is built aside: the live one is only swapped out at the end */
+  if (!filename) networks_table_publish4(nt, newt, 0);
+  else {
     if ((file = fopen(filename,"r")) == NULL) {
       if (!(config.nfacctd_net & NF_NET_KEEP && config.nfacctd_as & NF_AS_KEEP)) {
         Log(LOG_WARNING, "WARN ( %s/%s ): [%s] file not found.\n", config.name, config.type, filename);
+	networks_table_publish4(nt, newt, 0);
 	return;
       }
 
@@ -103,8 +96,8 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
 	rows++;
       }
 
-      nt->table = malloc(rows*sizeof(struct networks_table_entry)); 
-      if (!nt->table) {
+      newt->table = malloc(rows*sizeof(struct networks_table_entry)); 
+      if (!newt->table) {
 	Log(LOG_ERR, "ERROR ( %s/%s ): [%s] malloc() failed while building Networks Table.\n", config.name, config.type, filename);
 	goto handle_error;
       }
@@ -115,7 +108,7 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
         goto handle_error;
       }
 
-      memset(nt->table, 0, rows*sizeof(struct networks_table_entry));
+      memset(newt->table, 0, rows*sizeof(struct networks_table_entry));
       memset(tmpt->table, 0, rows*sizeof(struct networks_table_entry));
       rows = 1;
 
@@ -262,7 +255,7 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
         if (mdt[index].level == 0) eff_rows++;
       }
 
-      nt->num = eff_rows;
+      newt->num = eff_rows;
       /* 4c adjusting child counters: each parent has to know
          only the number of its directly attached childs and
 	 not the whole hierarchy */ 
@@ -281,7 +274,7 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
         if (!index) {
 	  current = 0; next = eff_rows;
 	  memset(&prev, 0, 32);
-	  memcpy(&nt->table[current], &tmpt->table[index], sizeof(struct networks_table_entry));
+	  memcpy(&newt->table[current], &tmpt->table[index], sizeof(struct networks_table_entry));
         }
 	else {
 	  if (mdt[index].level == mdt[index-1].level) current++; /* do nothing: we have only to copy our element */ 
@@ -292,8 +285,8 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
 	      goto handle_error;
 	    }
 
-	    nt->table[current].childs_table.table = &nt->table[next];
-	    nt->table[current].childs_table.num = mdt[index-1].childs;
+	    newt->table[current].childs_table.table = &newt->table[next];
+	    newt->table[current].childs_table.num = mdt[index-1].childs;
 	    prev[mdt[index-1].level] = current;
 	    current = next;
 	    next += mdt[index-1].childs;
@@ -302,7 +295,7 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
 	    current = prev[mdt[index].level];
 	    current++;
 	  }
-	  memcpy(&nt->table[current], &tmpt->table[index], sizeof(struct networks_table_entry));
+	  memcpy(&newt->table[current], &tmpt->table[index], sizeof(struct networks_table_entry));
         }
       }
 
@@ -314,44 +307,38 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
 	  char nh_string[INET6_ADDRSTRLEN];
 	  char net_string[INET6_ADDRSTRLEN];
 
-	  addr_to_str(nh_string, &nt->table[index].nh);
+	  addr_to_str(nh_string, &newt->table[index].nh);
 
 	  net_bin.family = AF_INET;
-	  net_bin.address.ipv4.s_addr = htonl(nt->table[index].net);
+	  net_bin.address.ipv4.s_addr = htonl(newt->table[index].net);
 	  addr_to_str(net_string, &net_bin);
 
 	  Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] v4 nh: %s peer asn: %u asn: %u net: %s mask: %u\n", 
-		config.name, config.type, filename, nh_string, nt->table[index].peer_as,
-		nt->table[index].as, net_string, nt->table[index].masknum); 
+		config.name, config.type, filename, nh_string, newt->table[index].peer_as,
+		newt->table[index].as, net_string, newt->table[index].masknum); 
 	}
-	if (!nt->table[index].mask) {
+	if (!newt->table[index].mask) {
 	  Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] v4 contains a default route\n", config.name, config.type, filename);
 	  default_route_in_networks4_table = TRUE;
 	}
 	index++;
       }
 
-      /* 6th step: create networks cache BUT only for the first time */
-      if (!nc->cache) {
-        if (!config.networks_cache_entries) nc->num = NETWORKS_CACHE_ENTRIES;
-        else nc->num = config.networks_cache_entries;
-        nc->cache = (struct networks_cache_entry *) malloc(nc->num*sizeof(struct networks_cache_entry));
-        if (!nc->cache) {
-          Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed while building Networks Cache.\n", config.name, config.type);
-          goto handle_error;
-        }
-	else Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] IPv4 Networks Cache successfully created: %u entries.\n",
-			config.name, config.type, filename, nc->num);
+      /* 6th step: building the LPM index over the whole hierarchy */
+      newt->lpm = networks_lpm_build4(newt->table, tmpt->num);
+      if (!newt->lpm) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): [%s] malloc() failed while building Networks LPM index.\n", config.name, config.type, filename);
+        goto handle_error;
       }
+      else Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] IPv4 Networks LPM index successfully built: %u entries, %u nodes, %" PRIu64 " bytes.\n",
+		config.name, config.type, filename, tmpt->num, newt->lpm->nodes_num, networks_lpm_size(newt->lpm));
 
       /* 7th step: freeing resources */
-      memset(nc->cache, 0, nc->num*sizeof(struct networks_cache_entry));
       free(tmpt->table);
       free(mdt);
-      if (bkt.table) free(bkt.table);
 
-      /* 8th step: setting timestamp */
-      nt->timestamp = st.st_mtime;
+      /* 8th step: swapping the new table in and setting timestamp */
+      networks_table_publish4(nt, newt, st.st_mtime);
     }
   }
 
@@ -372,16 +359,15 @@ void load_networks4(char *filename, struct networks_table *nt, struct networks_c
   handle_error:
   if (tmpt->table) free(tmpt->table);
   if (mdt) free(mdt);
+  if (newt->table) free(newt->table);
+  if (newt->lpm) networks_lpm_free(newt->lpm);
 
-  if (bkt.num) {
-    if (!nt->table) {
-      memcpy(nt, &bkt, sizeof(struct networks_table));
-      Log(LOG_WARNING, "WARN ( %s/%s ): [%s] Rolling back the old Networks Table.\n", config.name, config.type, filename); 
+  if (nt->num) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): [%s] Rolling back the old Networks Table.\n", config.name, config.type, filename); 
 
-      /* we update the timestamp to avoid loops */ 
-      stat(filename, &st);
-      nt->timestamp = st.st_mtime;
-    }
+    /* we update the timestamp to avoid loops */ 
+    stat(filename, &st);
+    nt->timestamp = st.st_mtime;
   }
   else exit_gracefully(1);
 }
@@ -455,8 +441,15 @@ void merge(char *filename, struct networks_table_entry *table, int start, int mi
 struct networks_table_entry *binsearch(struct networks_table *nt, struct networks_cache *nc, struct host_addr *a)
 {
   int low = 0, mid, high = nt->num-1;
-  u_int32_t net, addrh = ntohl(a->address.ipv4.s_addr), addr = a->address.ipv4.s_addr;
+  u_int32_t net, addrh = ntohl(a->address.ipv4.s_addr), addr = a->address.ipv4.s_addr, idx;
   struct networks_table_entry *ret;
+  struct networks_lpm *lpm = nt->lpm;
+
+  if (lpm) {
+    idx = networks_lpm_lookup(lpm, &addrh);
+
+    return (idx ? &((struct networks_table_entry *) lpm->entries)[idx - 1] : NULL);
+  }
 
   ret = networks_cache_search(nc, &addr); 
   if (ret) {
@@ -531,10 +524,132 @@ void remove_dupes(char *filename, struct networks_table *nt, int want_v6)
   }
 }
 
+/*
+   Swaps 'newt' in as the live IPv4 table. Root lookups only go through
+   the LPM index, so the store to nt->lpm is what moves readers over to
+   the new generation; lookups and reloads run in the same thread in all
+   daemons and plugins, hence the old generation is freed straight away.
+*/
+void networks_table_publish4(struct networks_table *nt, struct networks_table *newt, time_t timestamp)
+{
+  struct networks_table_entry *old_table = nt->table;
+  struct networks_lpm *old_lpm = nt->lpm;
+
+  __sync_synchronize();
+  nt->lpm = newt->lpm;
+  nt->table = newt->table;
+  nt->num = newt->num;
+  nt->timestamp = timestamp;
+
+  if (old_lpm) networks_lpm_free(old_lpm);
+  if (old_table) free(old_table);
+}
+
+void networks_table_publish6(struct networks_table *nt, struct networks_table *newt, time_t timestamp)
+{
+  struct networks6_table_entry *old_table6 = nt->table6;
+  struct networks_lpm *old_lpm6 = nt->lpm6;
+
+  __sync_synchronize();
+  nt->lpm6 = newt->lpm6;
+  nt->table6 = newt->table6;
+  nt->num6 = newt->num6;
+  nt->timestamp = timestamp;
+
+  if (old_lpm6) networks_lpm_free(old_lpm6);
+  if (old_table6) free(old_table6);
+}
+
+/* indexes all 'num' entries of 'table', childs_table hierarchy included */
+struct networks_lpm *networks_lpm_build4(struct networks_table_entry *table, u_int32_t num)
+{
+  struct networks_lpm *lpm;
+  u_int32_t count[32 + 2], *order, idx;
+
+  lpm = networks_lpm_init(32);
+  if (!lpm) return NULL;
+
+  lpm->entries = table;
+  lpm->entries_num = num;
+  if (!num) return lpm;
+
+  order = malloc(num * sizeof(u_int32_t));
+  if (!order) {
+    networks_lpm_free(lpm);
+    return NULL;
+  }
+
+  /* counting sort by mask length: less specific prefixes go in first */
+  memset(count, 0, sizeof(count));
+  for (idx = 0; idx < num; idx++) count[table[idx].masknum + 1]++;
+  for (idx = 1; idx <= 32; idx++) count[idx] += count[idx - 1];
+  for (idx = 0; idx < num; idx++) order[count[table[idx].masknum]++] = idx;
+
+  for (idx = 0; idx < num; idx++) {
+    if (networks_lpm_insert(lpm, &table[order[idx]].net, table[order[idx]].masknum, (order[idx] + 1)) == ERR) {
+      free(order);
+      networks_lpm_free(lpm);
+      return NULL;
+    }
+  }
+
+  free(order);
+
+  if (networks_lpm_compact(lpm) == ERR) {
+    networks_lpm_free(lpm);
+    return NULL;
+  }
+
+  return lpm;
+}
+
+struct networks_lpm *networks_lpm_build6(struct networks6_table_entry *table, u_int32_t num)
+{
+  struct networks_lpm *lpm;
+  u_int32_t count[128 + 2], *order, idx;
+
+  lpm = networks_lpm_init(128);
+  if (!lpm) return NULL;
+
+  lpm->entries = table;
+  lpm->entries_num = num;
+  if (!num) return lpm;
+
+  order = malloc(num * sizeof(u_int32_t));
+  if (!order) {
+    networks_lpm_free(lpm);
+    return NULL;
+  }
+
+  memset(count, 0, sizeof(count));
+  for (idx = 0; idx < num; idx++) count[table[idx].masknum + 1]++;
+  for (idx = 1; idx <= 128; idx++) count[idx] += count[idx - 1];
+  for (idx = 0; idx < num; idx++) order[count[table[idx].masknum]++] = idx;
+
+  for (idx = 0; idx < num; idx++) {
+    if (networks_lpm_insert(lpm, table[order[idx]].net, table[order[idx]].masknum, (order[idx] + 1)) == ERR) {
+      free(order);
+      networks_lpm_free(lpm);
+      return NULL;
+    }
+  }
+
+  free(order);
+
+  if (networks_lpm_compact(lpm) == ERR) {
+    networks_lpm_free(lpm);
+    return NULL;
+  }
+
+  return lpm;
+}
+
 void networks_cache_insert(struct networks_cache *nc, u_int32_t *key, struct networks_table_entry *result)
 {
   struct networks_cache_entry *ptr;
 
+  if (!nc->num) return;
+
   ptr = &nc->cache[*key % nc->num];
   ptr->key = *key;
   ptr->result = result;
@@ -544,6 +659,8 @@ struct networks_table_entry *networks_cache_search(struct networks_cache *nc, u_
 {
   struct networks_cache_entry *ptr;
 
+  if (!nc->num) return NULL;
+
   ptr = &nc->cache[*key % nc->num];
   if (ptr->key == *key) return ptr->result;
   else return NULL;
@@ -1336,7 +1453,7 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
 {
   FILE *file;
   struct networks_table tmp, *tmpt = &tmp;
-  struct networks_table bkt;
+  struct networks_table new, *newt = &new;
   struct networks_table_metadata *mdt = 0;
   char buf[SRVBUFLEN], *bufptr, *delim, *peer_as, *as, *net, *mask, *nh;
   int rows, eff_rows = 0, j, buflen, fields, prev[NETWORKS_CACHE_DEPTH], current, next;
@@ -1348,26 +1465,18 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
   memset(&dummy_entry6, 0, sizeof(struct networks6_table_entry));
   dummy_entry6.masknum = 255;
 
-  memset(&bkt, 0, sizeof(bkt));
+  memset(&new, 0, sizeof(new));
   memset(&tmp, 0, sizeof(tmp));
   memset(&st, 0, sizeof(st));
   default_route_in_networks6_table = FALSE;
 
-  /* backing up pre-existing table and cache */
-  if (nt->num6) {
-    bkt.table6 = nt->table6;
-    bkt.num6 = nt->num6;
-    bkt.timestamp = nt->timestamp;
-
-    nt->table6 = 0;
-    nt->num6 = 0;
-    nt->timestamp = 0;
-  }
-
-  if (filename) {
+  /* the new table is built aside: the live one is only swapped out at the end */
+  if (!filename) networks_table_publish6(nt, newt, 0);
+  else {
     if ((file = fopen(filename,"r")) == NULL) {
       if (!(config.nfacctd_net & NF_NET_KEEP && config.nfacctd_as & NF_AS_KEEP)) {
         Log(LOG_WARNING, "WARN ( %s/%s ): [%s] file not found.\n", config.name, config.type, filename);
+        networks_table_publish6(nt, newt, 0);
         return;
       }
 
@@ -1393,8 +1502,8 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
 	rows++;
       }
       
-      nt->table6 = malloc(rows*sizeof(struct networks6_table_entry));
-      if (!nt->table6) {
+      newt->table6 = malloc(rows*sizeof(struct networks6_table_entry));
+      if (!newt->table6) {
         Log(LOG_ERR, "ERROR ( %s/%s ): [%s] malloc() failed while building Networks Table.\n", config.name, config.type, filename);
         goto handle_error;
       }
@@ -1405,7 +1514,7 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
         goto handle_error;
       }
 
-      memset(nt->table6, 0, rows*sizeof(struct networks6_table_entry));
+      memset(newt->table6, 0, rows*sizeof(struct networks6_table_entry));
       memset(tmpt->table6, 0, rows*sizeof(struct networks6_table_entry));
       rows = 1;
 
@@ -1563,7 +1672,7 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
         if (mdt[index].level == 0) eff_rows++;
       }
 
-      nt->num6 = eff_rows;
+      newt->num6 = eff_rows;
       /* 4c adjusting child counters: each parent has to know
          only the number of its directly attached childs and
          not the whole hierarchy */
@@ -1582,7 +1691,7 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
         if (!index) {
           current = 0; next = eff_rows;
           memset(&prev, 0, 32);
-          memcpy(&nt->table6[current], &tmpt->table6[index], sizeof(struct networks6_table_entry));
+          memcpy(&newt->table6[current], &tmpt->table6[index], sizeof(struct networks6_table_entry));
         }
         else {
           if (mdt[index].level == mdt[index-1].level) current++; /* do nothing: we have only to copy our element */
@@ -1592,8 +1701,8 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
 		  config.name, config.type, NETWORKS_CACHE_DEPTH);
 	      goto handle_error;
 	    }
-            nt->table6[current].childs_table.table6 = &nt->table6[next];
-            nt->table6[current].childs_table.num6 = mdt[index-1].childs;
+            newt->table6[current].childs_table.table6 = &newt->table6[next];
+            newt->table6[current].childs_table.num6 = mdt[index-1].childs;
             prev[mdt[index-1].level] = current;
             current = next;
             next += mdt[index-1].childs;
@@ -1602,7 +1711,7 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
             current = prev[mdt[index].level];
             current++;
           }
-          memcpy(&nt->table6[current], &tmpt->table6[index], sizeof(struct networks6_table_entry));
+          memcpy(&newt->table6[current], &tmpt->table6[index], sizeof(struct networks6_table_entry));
         }
       }
  
@@ -1615,43 +1724,37 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
           char net_string[INET6_ADDRSTRLEN];
 
           net_bin.family = AF_INET6;
-	  memcpy(&net_bin.address.ipv6, (void *) pm_htonl6(&nt->table6[index].net), IP6AddrSz);
+	  memcpy(&net_bin.address.ipv6, (void *) pm_htonl6(&newt->table6[index].net), IP6AddrSz);
           addr_to_str(net_string, &net_bin);
-          addr_to_str(nh_string, &nt->table6[index].nh);
+          addr_to_str(nh_string, &newt->table6[index].nh);
 
           Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] v6 nh: %s peer_asn: %u asn: %u net: %s mask: %u\n",
-		config.name, config.type, filename, nh_string, nt->table6[index].peer_as,
-		nt->table6[index].as, net_string, nt->table6[index].masknum); 
+		config.name, config.type, filename, nh_string, newt->table6[index].peer_as,
+		newt->table6[index].as, net_string, newt->table6[index].masknum); 
 	}
-	if (!nt->table6[index].mask[0] && !nt->table6[index].mask[1] &&
-	    !nt->table6[index].mask[2] && !nt->table6[index].mask[3]) {
+	if (!newt->table6[index].mask[0] && !newt->table6[index].mask[1] &&
+	    !newt->table6[index].mask[2] && !newt->table6[index].mask[3]) {
 	  Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] v6 contains a default route\n", config.name, config.type, filename);
 	  default_route_in_networks6_table = TRUE;
         }
         index++;
       }
 
-      /* 6th step: create networks cache BUT only for the first time */
-      if (!nc->cache6) {
-        if (!config.networks_cache_entries) nc->num6 = NETWORKS6_CACHE_ENTRIES;
-        else nc->num6 = config.networks_cache_entries;
-        nc->cache6 = (struct networks6_cache_entry *) malloc(nc->num6*sizeof(struct networks6_cache_entry));
-        if (!nc->cache6) {
-          Log(LOG_ERR, "ERROR ( %s/%s ): [%s] malloc() failed while building Networks Cache.\n", config.name, config.type, filename);
-          goto handle_error;
-        }
-	else Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] IPv6 Networks Cache successfully created: %u entries.\n",
-			config.name, config.type, filename, nc->num6);
+      /* 6th step: building the LPM index over the whole hierarchy */
+      newt->lpm6 = networks_lpm_build6(newt->table6, tmpt->num6);
+      if (!newt->lpm6) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): [%s] malloc() failed while building IPv6 Networks LPM index.\n", config.name, config.type, filename);
+        goto handle_error;
       }
+      else Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] IPv6 Networks LPM index successfully built: %u entries, %u nodes, %" PRIu64 " bytes.\n",
+		config.name, config.type, filename, tmpt->num6, newt->lpm6->nodes_num, networks_lpm_size(newt->lpm6));
 
       /* 7th step: freeing resources */
-      memset(nc->cache6, 0, nc->num6*sizeof(struct networks6_cache_entry));
       free(tmpt->table6);
       free(mdt);
-      if (bkt.table6) free(bkt.table6);
 
-      /* 8th step: setting timestamp */
-      nt->timestamp = st.st_mtime;
+      /* 8th step: swapping the new table in and setting timestamp */
+      networks_table_publish6(nt, newt, st.st_mtime);
     }
   }
 
@@ -1666,16 +1769,15 @@ void load_networks6(char *filename, struct networks_table *nt, struct networks_c
   handle_error:
   if (tmpt->table6) free(tmpt->table6);
   if (mdt) free(mdt);
+  if (newt->table6) free(newt->table6);
+  if (newt->lpm6) networks_lpm_free(newt->lpm6);
 
-  if (bkt.num6) {
-    if (!nt->table6) {
-      memcpy(nt, &bkt, sizeof(struct networks_table));
-      Log(LOG_WARNING, "WARN ( %s/%s ): [%s] Rolling back the old Networks Table.\n", config.name, config.type, filename);
+  if (nt->num6) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): [%s] Rolling back the old Networks Table.\n", config.name, config.type, filename);
 
-      /* we update the timestamp to avoid loops */
-      stat(filename, &st);
-      nt->timestamp = st.st_mtime;
-    }
+    /* we update the timestamp to avoid loops */
+    stat(filename, &st);
+    nt->timestamp = st.st_mtime;
   }
   else exit_gracefully(1);
 }
@@ -1771,12 +1873,19 @@ void merge6(char *filename, struct networks6_table_entry *table, int start, int
 struct networks6_table_entry *binsearch6(struct networks_table *nt, struct networks_cache *nc, struct host_addr *a)
 {
   int low = 0, mid, high = nt->num6-1, chunk;
-  u_int32_t net[4], addrh[4], addr[4]; 
+  u_int32_t net[4], addrh[4], addr[4], idx; 
   struct networks6_table_entry *ret;
+  struct networks_lpm *lpm = nt->lpm6;
 
   memcpy(&addr, &a->address.ipv6, IP6AddrSz);
   memcpy(&addrh, &a->address.ipv6, IP6AddrSz);
   memcpy(&addrh, (void *) pm_ntohl6(addrh), IP6AddrSz);
+
+  if (lpm) {
+    idx = networks_lpm_lookup(lpm, addrh);
+
+    return (idx ? &((struct networks6_table_entry *) lpm->entries)[idx - 1] : NULL);
+  }
   
   ret = networks_cache_search6(nc, addr);
   if (ret) {
@@ -1826,6 +1935,8 @@ void networks_cache_insert6(struct networks_cache *nc, void *key, struct network
   unsigned int hash;
   u_int32_t *keyptr = key;
 
+  if (!nc->num6) return;
+
   hash = networks_cache_hash6(key); 
   ptr = &nc->cache6[hash % nc->num6];
   memcpy(ptr->key, keyptr, IP6AddrSz); 
@@ -1839,6 +1950,8 @@ struct networks6_table_entry *networks_cache_search6(struct networks_cache *nc,
   u_int32_t *keyptr = key;
   int chunk;
 
+  if (!nc->num6) return NULL;
+
   hash = networks_cache_hash6(key);
   ptr = &nc->cache6[hash % nc->num6];
   for (chunk = 0; chunk < 4; chunk++) {
@@ -49,6 +49,8 @@ struct networks_table {
   unsigned int num6;
   u_int32_t maskbits[4];
   time_t timestamp; 
+  struct networks_lpm *lpm;	/* root table only: LPM index over 'table' */
+  struct networks_lpm *lpm6;	/* root table only: LPM index over 'table6' */
 };
 
 struct networks_table_entry {
@@ -125,6 +127,10 @@ extern void merge_sort(char *, struct networks_table_entry *, int, int);
 extern void merge(char *, struct networks_table_entry *, int, int, int);
 extern struct networks_table_entry *binsearch(struct networks_table *, struct networks_cache *, struct host_addr *);
 extern void remove_dupes(char *, struct networks_table *, int);
+extern void networks_table_publish4(struct networks_table *, struct networks_table *, time_t);
+extern void networks_table_publish6(struct networks_table *, struct networks_table *, time_t);
+extern struct networks_lpm *networks_lpm_build4(struct networks_table_entry *, u_int32_t);
+extern struct networks_lpm *networks_lpm_build6(struct networks6_table_entry *, u_int32_t);
 extern void networks_cache_insert(struct networks_cache *, u_int32_t *, struct networks_table_entry *);
 extern struct networks_table_entry *networks_cache_search(struct networks_cache *, u_int32_t *);
 
@@ -0,0 +1,200 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "net_lpm.h"
+
+/* functions */
+struct networks_lpm *networks_lpm_init(u_int8_t maxlen)
+{
+  struct networks_lpm *lpm;
+
+  if (maxlen != 32 && maxlen != 128) return NULL;
+
+  lpm = malloc(sizeof(struct networks_lpm));
+  if (!lpm) return NULL;
+
+  memset(lpm, 0, sizeof(struct networks_lpm));
+  lpm->maxlen = maxlen;
+
+  lpm->root = calloc((1 << NETWORKS_LPM_ROOT_BITS), sizeof(u_int32_t));
+  if (!lpm->root) {
+    free(lpm);
+    return NULL;
+  }
+
+  return lpm;
+}
+
+/* allocates a node whose slots all inherit 'value'; returns its index or ERR */
+static int64_t networks_lpm_node_new(struct networks_lpm *lpm, u_int32_t value)
+{
+  u_int32_t *nodes, slot, idx;
+
+  if (lpm->nodes_num == lpm->nodes_max) {
+    u_int32_t nodes_max = (lpm->nodes_max ? (lpm->nodes_max * 2) : NETWORKS_LPM_NODES_INIT);
+
+    if (nodes_max >= NETWORKS_LPM_CHILD) return ERR;
+
+    nodes = realloc(lpm->nodes, ((size_t) nodes_max * NETWORKS_LPM_FANOUT * sizeof(u_int32_t)));
+    if (!nodes) return ERR;
+
+    lpm->nodes = nodes;
+    lpm->nodes_max = nodes_max;
+  }
+
+  idx = lpm->nodes_num++;
+  for (slot = 0; slot < NETWORKS_LPM_FANOUT; slot++) lpm->nodes[(idx * NETWORKS_LPM_FANOUT) + slot] = value;
+
+  return idx;
+}
+
+/*
+   Adds the prefix 'key'/'masknum' pointing to 'value' (entry index + 1).
+   Prefixes have to be inserted by increasing mask length: a prefix then
+   never spans slots already pointing to a child node, expanding it is
+   just a matter of overwriting a range of slots.
+*/
+int networks_lpm_insert(struct networks_lpm *lpm, u_int32_t *key, u_int8_t masknum, u_int32_t value)
+{
+  u_int32_t *table = lpm->root, offset = 0, bits = NETWORKS_LPM_ROOT_BITS, slot, first, last;
+  int64_t node, cur = ERR;
+
+  if (lpm->compacted || !value || (value & NETWORKS_LPM_CHILD) || masknum > lpm->maxlen) return ERR;
+
+  for (;;) {
+    if (masknum <= (offset + bits)) {
+      first = networks_lpm_bits(key, offset, bits) & ~((1 << (offset + bits - masknum)) - 1);
+      last = first + (1 << (offset + bits - masknum));
+
+      for (slot = first; slot < last; slot++) table[slot] = value;
+
+      return SUCCESS;
+    }
+
+    slot = networks_lpm_bits(key, offset, bits);
+
+    if (table[slot] & NETWORKS_LPM_CHILD) node = (table[slot] & ~NETWORKS_LPM_CHILD);
+    else {
+      node = networks_lpm_node_new(lpm, table[slot]);
+      if (node == ERR) return ERR;
+
+      /* growing may have moved lpm->nodes, 'table' included */
+      if (cur != ERR) table = &lpm->nodes[cur * NETWORKS_LPM_FANOUT];
+      table[slot] = (node | NETWORKS_LPM_CHILD);
+    }
+
+    cur = node;
+    table = &lpm->nodes[cur * NETWORKS_LPM_FANOUT];
+    offset += bits;
+    bits = NETWORKS_LPM_STRIDE;
+  }
+}
+
+/*
+   Turns the flat nodes into compacted ones, storing each run of identical
+   slots once. Lookups only walk compacted nodes, hence this has to be
+   called once all prefixes are in; no insertions are allowed afterwards.
+*/
+int networks_lpm_compact(struct networks_lpm *lpm)
+{
+  struct networks_lpm_node *cnodes = NULL;
+  u_int32_t *runs = NULL, *slots, node, slot, runs_num = 0;
+
+  if (lpm->compacted) return SUCCESS;
+
+  /* counting runs first, to allocate them in one go */
+  for (node = 0; node < lpm->nodes_num; node++) {
+    slots = &lpm->nodes[node * NETWORKS_LPM_FANOUT];
+
+    for (slot = 0; slot < NETWORKS_LPM_FANOUT; slot++) {
+      if (!slot || slots[slot] != slots[slot - 1]) runs_num++;
+    }
+  }
+
+  if (lpm->nodes_num) {
+    cnodes = calloc(lpm->nodes_num, sizeof(struct networks_lpm_node));
+    runs = malloc(runs_num * sizeof(u_int32_t));
+
+    if (!cnodes || !runs) {
+      if (cnodes) free(cnodes);
+      if (runs) free(runs);
+
+      return ERR;
+    }
+  }
+
+  for (node = 0, runs_num = 0; node < lpm->nodes_num; node++) {
+    slots = &lpm->nodes[node * NETWORKS_LPM_FANOUT];
+    cnodes[node].base = runs_num;
+
+    for (slot = 0; slot < NETWORKS_LPM_FANOUT; slot++) {
+      if (!(slot & 63)) cnodes[node].rank[slot >> 6] = (runs_num - cnodes[node].base);
+
+      if (!slot || slots[slot] != slots[slot - 1]) {
+	cnodes[node].runvec[slot >> 6] |= (((u_int64_t) 1) << (slot & 63));
+	runs[runs_num] = slots[slot];
+	runs_num++;
+      }
+    }
+  }
+
+  if (lpm->nodes) free(lpm->nodes);
+  lpm->nodes = NULL;
+  lpm->nodes_max = 0;
+
+  lpm->cnodes = cnodes;
+  lpm->runs = runs;
+  lpm->runs_num = runs_num;
+  lpm->compacted = TRUE;
+
+  return SUCCESS;
+}
+
+/* memory taken by the index, entries excluded */
+u_int64_t networks_lpm_size(struct networks_lpm *lpm)
+{
+  u_int64_t size = sizeof(struct networks_lpm);
+
+  size += ((1 << NETWORKS_LPM_ROOT_BITS) * sizeof(u_int32_t));
+
+  if (lpm->compacted) {
+    size += ((u_int64_t) lpm->nodes_num * sizeof(struct networks_lpm_node));
+    size += ((u_int64_t) lpm->runs_num * sizeof(u_int32_t));
+  }
+  else size += ((u_int64_t) lpm->nodes_max * NETWORKS_LPM_FANOUT * sizeof(u_int32_t));
+
+  return size;
+}
+
+void networks_lpm_free(struct networks_lpm *lpm)
+{
+  if (!lpm) return;
+
+  if (lpm->root) free(lpm->root);
+  if (lpm->nodes) free(lpm->nodes);
+  if (lpm->cnodes) free(lpm->cnodes);
+  if (lpm->runs) free(lpm->runs);
+
+  free(lpm);
+}
@@ -0,0 +1,109 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef NET_LPM_H
+#define NET_LPM_H
+
+/*
+   Longest-prefix match index over a networks_file table. The first
+   NETWORKS_LPM_ROOT_BITS address bits address a flat root array, further
+   bits are consumed NETWORKS_LPM_STRIDE at a time by fixed-size nodes
+   (DIR-16-8-8 for IPv4; the same layout simply goes deeper for IPv6).
+   Each slot holds either 0 (no match), a node index flagged with
+   NETWORKS_LPM_CHILD or the index + 1 of the most specific table entry.
+   Prefixes are expanded at build time, so a lookup never backtracks.
+
+   Nodes are built as flat arrays, then compacted (poptrie-like, see
+   bgp_lpm.h): a bitmap flags the slots starting a new run of identical
+   values and each run is stored once, addressed via popcount. Nodes are
+   mostly sparse, IPv6 ones especially, where a lone /48 takes four of
+   them: that is some 60 bytes per node instead of 1KB.
+*/
+
+/* defines */
+#define NETWORKS_LPM_ROOT_BITS		16
+#define NETWORKS_LPM_STRIDE		8
+#define NETWORKS_LPM_FANOUT		(1 << NETWORKS_LPM_STRIDE)
+#define NETWORKS_LPM_CHILD		0x80000000
+#define NETWORKS_LPM_NODES_INIT		256
+#define NETWORKS_LPM_WORDS		(NETWORKS_LPM_FANOUT / 64)
+
+/* structures */
+struct networks_lpm_node {
+  u_int64_t runvec[NETWORKS_LPM_WORDS];	/* slots starting a new run */
+  u_int16_t rank[NETWORKS_LPM_WORDS];	/* runs started before each runvec word */
+  u_int32_t base;			/* first run of the node in 'runs' */
+};
+
+struct networks_lpm {
+  u_int32_t *root;
+  u_int32_t *nodes;		/* NETWORKS_LPM_FANOUT slots per node, while building */
+  struct networks_lpm_node *cnodes;	/* compacted nodes */
+  u_int32_t *runs;
+  u_int32_t runs_num;
+  u_int32_t nodes_num;
+  u_int32_t nodes_max;
+  u_int8_t maxlen;		/* 32 or 128 bits */
+  u_int8_t compacted;
+  void *entries;		/* networks_table_entry or networks6_table_entry array */
+  u_int32_t entries_num;
+};
+
+/* prototypes */
+extern struct networks_lpm *networks_lpm_init(u_int8_t);
+extern int networks_lpm_insert(struct networks_lpm *, u_int32_t *, u_int8_t, u_int32_t);
+extern int networks_lpm_compact(struct networks_lpm *);
+extern u_int64_t networks_lpm_size(struct networks_lpm *);
+extern void networks_lpm_free(struct networks_lpm *);
+
+/* returns 'len' bits of the host byte order address 'key' starting at bit 'offset' */
+static inline u_int32_t networks_lpm_bits(u_int32_t *key, u_int32_t offset, u_int32_t len)
+{
+  return ((key[offset >> 5] >> (32 - len - (offset & 31))) & ((1 << len) - 1));
+}
+
+/* returns the value of slot 'slot' of the compacted node 'node' */
+static inline u_int32_t networks_lpm_node_slot(struct networks_lpm *lpm, u_int32_t node, u_int32_t slot)
+{
+  struct networks_lpm_node *cnode = &lpm->cnodes[node];
+  u_int32_t word = (slot >> 6);
+
+  return lpm->runs[cnode->base + cnode->rank[word] +
+		   __builtin_popcountll(cnode->runvec[word] & ((((u_int64_t) 2) << (slot & 63)) - 1)) - 1];
+}
+
+/* returns the index + 1 of the most specific entry covering 'key', 0 if none */
+static inline u_int32_t networks_lpm_lookup(struct networks_lpm *lpm, u_int32_t *key)
+{
+  u_int32_t offset = NETWORKS_LPM_ROOT_BITS, slot;
+
+  slot = lpm->root[networks_lpm_bits(key, 0, NETWORKS_LPM_ROOT_BITS)];
+
+  while (slot & NETWORKS_LPM_CHILD) {
+    slot = networks_lpm_node_slot(lpm, (slot & ~NETWORKS_LPM_CHILD), networks_lpm_bits(key, offset, NETWORKS_LPM_STRIDE));
+    offset += NETWORKS_LPM_STRIDE;
+  }
+
+  return slot;
+}
+
+#endif // NET_LPM_H
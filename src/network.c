@@ -413,7 +413,7 @@ void pm_dtls_server_log(int level, const char *str)
 void pm_dtls_server_bye(pm_dtls_peer_t *peer)
 {
   struct xflow_status_entry *entry;
-  int idx;
+  u_int32_t idx;
 
   if (peer) {
     if (peer->conn.fd) {
@@ -424,22 +424,14 @@ void pm_dtls_server_bye(pm_dtls_peer_t *peer)
     }
   }
   else {
-    for (idx = 0; idx < XFLOW_STATUS_TABLE_SZ; idx++) {
-      entry = dtls_status_table.t[idx];
+    for (idx = 0; idx < dtls_status_table.size; idx++) {
+      entry = dtls_status_table.slots[idx].entry;
 
-      if (entry) {
-	next:
-	if (entry->dtls.conn.fd) {
-	  gnutls_bye(entry->dtls.session, GNUTLS_SHUT_WR);
-	  gnutls_deinit(entry->dtls.session);
+      if (entry && entry->dtls.conn.fd) {
+	gnutls_bye(entry->dtls.session, GNUTLS_SHUT_WR);
+	gnutls_deinit(entry->dtls.session);
 
-	  memset(peer, 0, sizeof(pm_dtls_peer_t));
-	}
-
-	if (entry->next) {
-	  entry = entry->next;
-	  goto next;
-	}
+	memset(&entry->dtls, 0, sizeof(pm_dtls_peer_t));
       }
     }
   }
@@ -459,13 +451,12 @@ void pm_dtls_client_bye(pm_dtls_peer_t *peer)
 
 int pm_dtls_server_process(int dtls_sock, struct sockaddr_storage *client, socklen_t clen, u_char *dtls_packet, int len, void *st)
 {
-  int hash = hash_status_table(0, (struct sockaddr *) client, XFLOW_STATUS_TABLE_SZ);
   xflow_status_table_t *status_table = st;
   struct xflow_status_entry *entry = NULL;
   int dtls_ret = 0, ret = 0;
 
-  if (hash >= 0) {
-    entry = search_status_table(status_table, (struct sockaddr *) client, 0, 0, hash, XFLOW_STATUS_TABLE_MAX_ENTRIES);
+  if (status_table) {
+    entry = search_status_table(status_table, (struct sockaddr *) client, 0, 0, XFLOW_STATUS_TABLE_MAX_ENTRIES);
     if (entry) {
       if (entry->dtls.session) {
         /* Finalizing Hello stage */
@@ -48,6 +48,9 @@
 #ifdef WITH_REDIS
 #include "ha.h"
 #endif
+#include "recv_batch.h"
+#include "thread_pool.h"
+#include "recv_queue.h"
 #include "../include/sav_parser.h"
 
 /* Global variables */
@@ -167,6 +170,8 @@ int main(int argc,char **argv, char **envp)
 
   struct packet_ptrs recv_pptrs;
   struct pcap_pkthdr recv_pkthdr;
+  struct pm_recv_batch recv_batch;
+  struct pm_recv_queue recv_queue;
 
   sigset_t signal_set;
 
@@ -248,6 +253,8 @@ int main(int argc,char **argv, char **envp)
 
   memset(&recv_pptrs, 0, sizeof(recv_pptrs));
   memset(&recv_pkthdr, 0, sizeof(recv_pkthdr));
+  memset(&recv_batch, 0, sizeof(recv_batch));
+  memset(&recv_queue, 0, sizeof(recv_queue));
 
   select_fd = 0;
   bkp_select_fd = 0;
@@ -674,6 +681,39 @@ int main(int argc,char **argv, char **envp)
   }
 #endif
 
+  if (config.nfacctd_workers > 1) {
+#if !defined HAVE_SO_REUSEPORT
+    Log(LOG_ERR, "ERROR ( %s/core ): nfacctd_workers requires SO_REUSEPORT which is not supported on this platform. Exiting.\n\n", config.name);
+    exit_gracefully(1);
+#endif
+
+    if (config.pcap_savefile || config.nfacctd_kafka_broker_host || config.nfacctd_zmq_address) {
+      Log(LOG_ERR, "ERROR ( %s/core ): nfacctd_workers only applies to live UDP collection (nfacctd_ip, nfacctd_port). Exiting.\n\n", config.name);
+      exit_gracefully(1);
+    }
+
+    if (config.nfacctd_templates_port || config.nfacctd_dtls_port) {
+      Log(LOG_ERR, "ERROR ( %s/core ): nfacctd_workers is mutual exclusive with nfacctd_templates_port and nfacctd_dtls_port. Exiting.\n\n", config.name);
+      exit_gracefully(1);
+    }
+
+    if (config.bgp_daemon || config.bmp_daemon || config.telemetry_daemon) {
+      Log(LOG_ERR, "ERROR ( %s/core ): nfacctd_workers is mutual exclusive with bgp_daemon, bmp_daemon and telemetry_daemon. Exiting.\n\n", config.name);
+      exit_gracefully(1);
+    }
+
+    /* the kernel pins an exporter to a worker: rows of different workers only overlap if the agent is not part of the key */
+    for (list = plugins_list; list; list = list->next) {
+      if ((list->type.id == PLUGIN_ID_MYSQL || list->type.id == PLUGIN_ID_PGSQL || list->type.id == PLUGIN_ID_SQLITE3) &&
+	  list->cfg.sql_dont_try_update && !(list->cfg.what_to_count & COUNT_PEER_SRC_IP)) {
+	Log(LOG_ERR, "ERROR ( %s/%s ): nfacctd_workers with sql_dont_try_update requires peer_src_ip in the aggregation method. Exiting.\n\n", list->name, list->type.string);
+	exit_gracefully(1);
+      }
+    }
+
+    NF_spawn_core_workers();
+  }
+
   /* signal handling we want to inherit to plugins (when not re-defined elsewhere) */
   memset(&sighandler_action, 0, sizeof(sighandler_action)); /* To ensure the struct holds no garbage values */
   sigemptyset(&sighandler_action.sa_mask);  /* Within a signal handler all the signals are enabled */
@@ -966,6 +1006,20 @@ int main(int argc,char **argv, char **envp)
       Log(LOG_INFO, "INFO ( %s/core ): nfacctd_pipe_size: obtained=%d target=%d.\n", config.name, obtained, config.nfacctd_pipe_size);
     }
 
+    if (config.nfacctd_recv_batch > 1) {
+      if (config.nfacctd_templates_port || config.nfacctd_dtls_port) {
+	Log(LOG_WARNING, "WARN ( %s/core ): nfacctd_recv_batch is not supported along with nfacctd_templates_port or nfacctd_dtls_port. Ignored.\n", config.name);
+      }
+      else pm_recv_batch_init(&recv_batch, config.sock, config.nfacctd_recv_batch, NETFLOW_MSG_SIZE);
+    }
+
+    if (config.nfacctd_recv_queue) {
+      if (config.nfacctd_templates_port || config.nfacctd_dtls_port) {
+	Log(LOG_WARNING, "WARN ( %s/core ): nfacctd_recv_queue is not supported along with nfacctd_templates_port or nfacctd_dtls_port. Ignored.\n", config.name);
+      }
+      else pm_recv_queue_init(&recv_queue, config.sock, config.nfacctd_recv_queue, NETFLOW_MSG_SIZE, &recv_batch);
+    }
+
     /* Multicast: memberships handling */
     for (idx = 0; mcast_groups[idx].family && idx < MAX_MCAST_GROUPS; idx++) {
       if (mcast_groups[idx].family == AF_INET) { 
@@ -1141,7 +1195,7 @@ int main(int argc,char **argv, char **envp)
 
 #if defined WITH_EBPF
     if (config.nfacctd_rp_ebpf_prog) {
-      attach_ebpf_reuseport_balancer(config.sock, config.nfacctd_rp_ebpf_prog, config.cluster_name, "nfacctd", config.cluster_id, FALSE);
+      attach_ebpf_reuseport_balancer(config.sock, config.nfacctd_rp_ebpf_prog, config.cluster_name, "nfacctd", (config.cluster_id + config.nfacctd_worker_id), FALSE);
     }
 #endif
 
@@ -1185,7 +1239,8 @@ int main(int argc,char **argv, char **envp)
   load_plugins(&req);
   load_plugin_filters(1);
   evaluate_packet_handlers();
-  pm_setproctitle("%s [%s]", "Core Process", config.proc_name);
+  if (config.nfacctd_workers > 1) pm_setproctitle("%s [%s] worker #%d", "Core Process", config.proc_name, config.nfacctd_worker_id);
+  else pm_setproctitle("%s [%s]", "Core Process", config.proc_name);
   if (config.pidfile) write_pid_file(config.pidfile);
   load_networks(config.networks_file, &nt, &nc);
 
@@ -1455,10 +1510,18 @@ int main(int argc,char **argv, char **envp)
     exit(0);
   }
 
+  bgp_epoch_core_reader_init();
+
+  /* started last: threads do not survive the forks above */
+  pm_recv_queue_start(&recv_queue);
+
   /* Main loop */
   for (;;) {
     sigprocmask(SIG_BLOCK, &signal_set, NULL);
 
+    /* never block holding on to BGP RIB references */
+    bgp_epoch_offline(bgp_epoch_core_reader);
+
     if (config.pcap_savefile) {
       ret = recvfrom_savefile(&device, (void **) &netflow_packet, (struct sockaddr *) &client, NULL, &pm_pcap_savefile_round, &recv_pptrs);
     }
@@ -1519,7 +1582,15 @@ int main(int argc,char **argv, char **envp)
 #endif
     else {
       if (!config.nfacctd_templates_port && !config.nfacctd_dtls_port) {
-        ret = recvfrom(config.sock, (unsigned char *)netflow_packet, NETFLOW_MSG_SIZE, 0, (struct sockaddr *) &client, &clen);
+	if (recv_queue.size) {
+	  ret = pm_recv_queue_next(&recv_queue, &netflow_packet, &client, &clen);
+	}
+	else if (recv_batch.size) {
+	  ret = pm_recv_batch_next(&recv_batch, &netflow_packet, &client, &clen);
+	}
+	else {
+          ret = recvfrom(config.sock, (unsigned char *)netflow_packet, NETFLOW_MSG_SIZE, 0, (struct sockaddr *) &client, &clen);
+	}
       }
       else {
 	select_func_again: 
@@ -1573,6 +1644,8 @@ int main(int argc,char **argv, char **envp)
     if (!netflow_packet || ret < 2) continue;
     pptrs.v4.f_len = ret;
 
+    bgp_epoch_online(bgp_epoch_core_reader);
+
     ipv4_mapped_to_ipv4(&client);
 
     /* check if Hosts Allow Table is loaded; if it is, we will enforce rules */
@@ -1615,7 +1688,12 @@ int main(int argc,char **argv, char **envp)
     if (print_stats) {
       time_t now = time(NULL);
 
-      print_status_table(&xflow_status_table, now, XFLOW_STATUS_TABLE_SZ);
+      print_status_table(&xflow_status_table, now);
+      if (recv_batch.size) pm_recv_batch_print_stats(&recv_batch, now);
+      if (recv_queue.size) pm_recv_queue_print_stats(&recv_queue, now);
+      plugin_pipe_print_stats(now);
+      pretag_print_stats(now);
+      bgp_epoch_print_stats(now);
       print_stats = FALSE;
     }
 
@@ -1648,6 +1726,10 @@ int main(int argc,char **argv, char **envp)
       case 10:
 	process_v9_packet(netflow_packet, ret, &pptrs, &req, nfv, NULL, &has_templates);
 
+	/* batched BGP lookups point into the RIB: not to outlive the packet */
+	pptrs.v4.bgp_batch = NULL;
+	pptrs.v6.bgp_batch = NULL;
+
 	/* Let's replicate templates only if not received on
 	   nfacctd_templates_port in order to prevent infinite
 	   looping */
@@ -1691,12 +1773,215 @@ int main(int argc,char **argv, char **envp)
       process_raw_packet(netflow_packet, ret, &pptrs, &req);
     }
 
+    bgp_epoch_offline(bgp_epoch_core_reader);
+
     if (num_descs > 0) goto select_read_again;
 
     sigprocmask(SIG_UNBLOCK, &signal_set, NULL);
   }
 }
 
+/*
+   nfacctd_workers: the calling process turns into a supervisor that
+   forks the Core Process workers and respawns any of them exiting.
+   Workers are forked before sockets are bound and plugins are loaded,
+   hence from here on each worker goes its own way: it binds its own
+   SO_REUSEPORT socket, loads its own plugins and keeps its own template
+   cache and xflow status table. The kernel hashes each exporter onto one
+   of the sockets, so per-exporter template and sequence state stays with
+   one worker; a respawned worker binds again, re-joining the reuseport
+   group (and the eBPF balancer, if any, under the same key). Returns in
+   the workers only.
+*/
+void NF_spawn_core_workers()
+{
+  time_t spawned[MAX_CORE_WORKERS];
+  struct sigaction sa;
+  int idx, status;
+  pid_t pid;
+
+  core_workers.max = config.nfacctd_workers;
+  core_workers.list = malloc(core_workers.max * sizeof(pid_t));
+  if (!core_workers.list) {
+    Log(LOG_ERR, "ERROR ( %s/core ): Unable to allocate Core Process workers list. Exiting.\n", config.name);
+    exit_gracefully(1);
+  }
+  memset(core_workers.list, 0, core_workers.max * sizeof(pid_t));
+  core_workers.active = core_workers.max;
+
+  /* the supervisor relays signals to the workers */
+  memset(&sa, 0, sizeof(sa));
+  sigemptyset(&sa.sa_mask);
+
+  sa.sa_handler = NF_core_workers_shutdown;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  sa.sa_handler = signal_core_workers;
+  sigaction(SIGHUP, &sa, NULL);
+  sigaction(SIGUSR1, &sa, NULL);
+  sigaction(SIGUSR2, &sa, NULL);
+
+  sa.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE, &sa, NULL);
+
+  sa.sa_handler = SIG_DFL;
+  sigaction(SIGCHLD, &sa, NULL);
+
+  if (config.pidfile) write_pid_file(config.pidfile);
+
+  for (idx = 0; idx < config.nfacctd_workers; idx++) {
+    spawned[idx] = time(NULL);
+
+    pid = NF_spawn_core_worker(idx);
+    if (!pid) return;
+    else if (pid < 0) {
+      signal_core_workers(SIGINT);
+      if (config.pidfile) remove_pid_file(config.pidfile);
+      exit(1);
+    }
+  }
+
+  pm_setproctitle("%s [%s]", "Core Process -- Workers Supervisor", config.proc_name);
+  Log(LOG_INFO, "INFO ( %s/core ): Supervising %d Core Process workers (pid: %u).\n", config.name, config.nfacctd_workers, getpid());
+
+  for (;;) {
+    pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      else break; /* ECHILD: no workers left */
+    }
+
+    for (idx = 0; idx < config.nfacctd_workers && core_workers.list[idx] != pid; idx++);
+    if (idx == config.nfacctd_workers) continue;
+
+    core_workers.list[idx] = 0;
+    if (core_workers.flags) continue;
+
+    if (WIFSIGNALED(status)) {
+      Log(LOG_WARNING, "WARN ( %s/core ): Core Process worker #%d (pid: %u) killed by signal %d. Respawning.\n",
+	  config.name, idx, pid, WTERMSIG(status));
+    }
+    else {
+      Log(LOG_WARNING, "WARN ( %s/core ): Core Process worker #%d (pid: %u) exited with status %d. Respawning.\n",
+	  config.name, idx, pid, WEXITSTATUS(status));
+    }
+
+    /* no tight respawn loop for workers failing right away, ie. on bind() */
+    if ((time(NULL) - spawned[idx]) < CORE_WORKER_RESPAWN_DELAY) sleep(CORE_WORKER_RESPAWN_DELAY);
+
+    while (!core_workers.flags) {
+      spawned[idx] = time(NULL);
+
+      pid = NF_spawn_core_worker(idx);
+      if (!pid) return;
+      else if (pid > 0) break;
+
+      sleep(CORE_WORKER_RESPAWN_DELAY);
+    }
+  }
+
+  Log(LOG_INFO, "INFO ( %s/core ): All Core Process workers exited. Exiting.\n", config.name);
+  if (config.pidfile) remove_pid_file(config.pidfile);
+  exit(0);
+}
+
+/*
+   Forks worker #idx; returns its pid to the supervisor, 0 to the worker,
+   -1 on error. Plugins are only started afterwards, by the worker itself:
+   each worker runs a full set of plugins of its own, rather than feeding
+   shared ones, so that the plugin pipes keep their single writer.
+*/
+pid_t NF_spawn_core_worker(int idx)
+{
+  struct plugins_list_entry *list;
+  sigset_t signal_set, saved_set;
+  pid_t pid;
+
+  /* no shutdown request may slip in between fork() and recording the pid */
+  sigemptyset(&signal_set);
+  sigaddset(&signal_set, SIGINT);
+  sigaddset(&signal_set, SIGTERM);
+  sigprocmask(SIG_BLOCK, &signal_set, &saved_set);
+
+  switch (pid = fork()) {
+  case -1: /* Something went wrong */
+    Log(LOG_ERR, "ERROR ( %s/core ): Unable to spawn Core Process worker #%d: %s\n", config.name, idx, strerror(errno));
+    break;
+  case 0: /* Child */
+    free(core_workers.list);
+    memset(&core_workers, 0, sizeof(core_workers));
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGUSR1, SIG_DFL);
+    signal(SIGUSR2, SIG_DFL);
+
+    /* the Core pidfile is the supervisor's; plugin pidfiles are left to worker #0 */
+    config.nfacctd_worker_id = idx;
+    config.pidfile = NULL;
+
+    for (list = plugins_list; list; list = list->next) {
+      list->cfg.nfacctd_worker_id = idx;
+      if (idx) list->cfg.pidfile = NULL;
+    }
+
+    NF_core_worker_paths(idx);
+
+    Log(LOG_INFO, "INFO ( %s/core ): Core Process worker #%d started (pid: %u).\n", config.name, idx, getpid());
+    break;
+  default: /* Parent */
+    core_workers.list[idx] = pid;
+    break;
+  }
+
+  sigprocmask(SIG_SETMASK, &saved_set, NULL);
+
+  return pid;
+}
+
+/*
+   Plugins of each worker write to their own local endpoints: worker #0
+   keeps them as configured, worker #N gets them suffixed by ".N" (ie.
+   IMT plugins listen on imt_path.N; print plugins write to
+   print_output_file.N and link print_latest_file.N). Message brokers
+   and SQL databases are designed for concurrent writers and are left
+   alone (see nfacctd_workers in CONFIG-KEYS).
+*/
+void NF_core_worker_paths(int idx)
+{
+  struct plugins_list_entry *list;
+  char path[SRVBUFLEN];
+
+  if (!idx) return;
+
+  for (list = plugins_list; list; list = list->next) {
+    if (list->type.id == PLUGIN_ID_MEMORY) {
+      snprintf(path, sizeof(path), "%s.%d", (list->cfg.imt_plugin_path ? list->cfg.imt_plugin_path : "/tmp/collect.pipe"), idx);
+      list->cfg.imt_plugin_path = strdup(path);
+    }
+    else if (list->type.id == PLUGIN_ID_PRINT) {
+      if (list->cfg.sql_table) {
+	snprintf(path, sizeof(path), "%s.%d", list->cfg.sql_table, idx);
+	list->cfg.sql_table = strdup(path);
+      }
+
+      if (list->cfg.print_latest_file) {
+	snprintf(path, sizeof(path), "%s.%d", list->cfg.print_latest_file, idx);
+	list->cfg.print_latest_file = strdup(path);
+      }
+    }
+  }
+}
+
+/* supervisor: stop respawning workers, then ask them to shut down */
+void NF_core_workers_shutdown(int signum)
+{
+  core_workers.flags = TRUE;
+  signal_core_workers(SIGINT);
+}
+
 void process_v5_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs *pptrs,
 		struct plugin_requests *req, u_int16_t version, struct NF_dissect *tee_dissect)
 {
@@ -2192,7 +2477,12 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
     pkt += NfDataHdrV9Sz;
     flowoff += NfDataHdrV9Sz;
 
-    tpl = find_template_v2(data_hdr->flow_id, (struct sockaddr *) pptrs->f_agent, version, fid, SourceId);
+    {
+      struct xflow_status_entry *entry = (struct xflow_status_entry *) pptrs->f_status;
+
+      tpl = find_template_v2(data_hdr->flow_id, (struct sockaddr *) pptrs->f_agent, version, fid, SourceId,
+			     entry ? &entry->tpl : NULL);
+    }
     if (!tpl) { /* Unknown template */
       sa_to_addr((struct sockaddr *)pptrs->f_agent, &debug_a, &debug_agent_port);
       addr_to_str(debug_agent_addr, &debug_a);
@@ -2204,8 +2494,8 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
     }
     else if (tpl->template_type == 1) { /* Options coming */
       struct xflow_status_entry *entry;
-      struct xflow_status_entry_sampling *sentry, *ssaved;
-      struct xflow_status_entry_class *centry, *csaved;
+      struct xflow_status_entry_sampling *sentry;
+      struct xflow_status_entry_class *centry;
 
       /* broadcast the whole flowset over */
       if (tee_dissect) {
@@ -2223,8 +2513,8 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
 
       while (flowoff+tpl->len <= flowsetlen) {
 	entry = (struct xflow_status_entry *) pptrs->f_status;
-	sentry = NULL, ssaved = NULL;
-	centry = NULL, csaved = NULL;
+	sentry = NULL;
+	centry = NULL;
 
 	if (tee_dissect) goto finalize_opt_record;
 
@@ -2286,9 +2576,8 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
             sampler_id = pm_ntohll(t64); /* XXX: sampler_id to be moved to 64 bit */
           }
 
-	  if (entry) sentry = search_smp_id_status_table(entry->sampling, sampler_id, FALSE);
-	  if (!sentry) sentry = create_smp_entry_status_table(&xflow_status_table, entry);
-	  else ssaved = sentry->next;
+	  if (entry) sentry = search_smp_id_status_table(&entry->sampling, sampler_id, FALSE);
+	  if (!sentry) sentry = create_smp_entry_status_table(&xflow_status_table, entry, sampler_id, 0);
 
 	  if (sentry) {
 	    memset(sentry, 0, sizeof(struct xflow_status_entry_sampling));
@@ -2340,7 +2629,6 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
 	    }
 
 	    sentry->sampler_id = sampler_id;
-	    if (ssaved) sentry->next = ssaved;
 	  }
 	}
 
@@ -2360,13 +2648,12 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
           memcpy(&class_id, (pkt + tpl->fld[NF9_APPLICATION_ID].off[0] + 1),
                  tpl->fld[NF9_APPLICATION_ID].len[0] - 1);
 
-          if (entry) centry = search_class_id_status_table(entry->class, class_id);
+          if (entry) centry = search_class_id_status_table(&entry->class, class_id);
           if (!centry) {
-	    centry = create_class_entry_status_table(&xflow_status_table, entry);
+	    centry = create_class_entry_status_table(&xflow_status_table, entry, class_id);
 	    class_int_id = pmct_find_first_free();
 	  }
           else {
-	    csaved = centry->next;
 	    class_int_id = centry->class_int_id;
 	    pmct_unregister(centry->class_int_id);
 	  }
@@ -2379,7 +2666,6 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
                    MIN(MAX_PROTOCOL_LEN-1, tpl->fld[NF9_APPLICATION_NAME].len[0]));
             centry->class_id = class_id;
 	    centry->class_int_id = class_int_id;
-            if (csaved) centry->next = csaved;
 
 	    css.id = centry->class_int_id;
 	    strlcpy(css.protocol, centry->class_name, MAX_PROTOCOL_LEN);
@@ -2661,6 +2947,8 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
         }
       } /* End of pre-processing checks */
 
+      if (config.bgp_daemon && !tee_dissect) NF_bgp_lookup_batch_prefill(pkt, flowoff, flowsetlen, tpl, pptrsv);
+
       /* Processing Flowset entries */
       while (flowoff+tpl->len <= flowsetlen) {
         /* Let's bake offsets and lengths if we have variable-length fields */
@@ -2741,7 +3029,14 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
           break;
 
 	case PM_FTYPE_IPV4:
-	  if (req->bpf_filter) {
+	  if (req->bpf_filter && tpl->progs) {
+	    reset_mac(pptrs);
+	    reset_ip4(pptrs);
+
+	    ((struct pm_iphdr *)pptrs->iph_ptr)->ip_vhl = 0x45;
+	    NF_run_template_prog(&tpl->prog[direction == DIRECTION_OUT ? TPL_PROG_IPV4_OUT : TPL_PROG_IPV4_IN], pkt, pptrs);
+	  }
+	  else if (req->bpf_filter) {
 	    reset_mac(pptrs);
 	    reset_ip4(pptrs);
 
@@ -2785,18 +3080,24 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
                    tpl->fld[NF9_TCP_FLAGS].len[0]);
 	  }
 
-          memcpy(&pptrs->lm_mask_src, pkt+tpl->fld[NF9_SRC_MASK].off[0],
-                 tpl->fld[NF9_SRC_MASK].len[0]);
-          memcpy(&pptrs->lm_mask_dst, pkt+tpl->fld[NF9_DST_MASK].off[0],
-                 tpl->fld[NF9_DST_MASK].len[0]);
+	  if (tpl->progs) {
+	    pptrs->l4_proto = 0;
+	    NF_run_template_prog(&tpl->prog[TPL_PROG_META], pkt, pptrs);
+	  }
+	  else {
+            memcpy(&pptrs->lm_mask_src, pkt+tpl->fld[NF9_SRC_MASK].off[0],
+                   tpl->fld[NF9_SRC_MASK].len[0]);
+            memcpy(&pptrs->lm_mask_dst, pkt+tpl->fld[NF9_DST_MASK].off[0],
+                   tpl->fld[NF9_DST_MASK].len[0]);
+
+	    /* Let's copy some relevant field */
+	    pptrs->l4_proto = 0;
+            memcpy(&pptrs->l4_proto, pkt+tpl->fld[NF9_L4_PROTOCOL].off[0],
+                   tpl->fld[NF9_L4_PROTOCOL].len[0]);
+	  }
 	  pptrs->lm_method_src = NF_NET_KEEP;
 	  pptrs->lm_method_dst = NF_NET_KEEP;
 
-	  /* Let's copy some relevant field */
-	  pptrs->l4_proto = 0;
-          memcpy(&pptrs->l4_proto, pkt+tpl->fld[NF9_L4_PROTOCOL].off[0],
-                 tpl->fld[NF9_L4_PROTOCOL].len[0]);
-
 	  NF_process_classifiers(pptrs, pptrs, pkt, tpl);
 	  if (config.bgp_daemon_to_xflow_agent_map) BTA_find_id((struct id_table *)pptrs->bta_table, pptrs, &pptrs->bta, &pptrs->bta2);
           if (config.nfacctd_flow_to_rd_map) NF_find_id((struct id_table *)pptrs->bitr_table, pptrs, &pptrs->bitr, NULL);
@@ -2826,7 +3127,14 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
 	  pptrsv->v6.f_tpl = pptrs->f_tpl;
 	  memcpy(&pptrsv->v6.flow_type, &pptrs->flow_type, sizeof(struct flow_chars));
 
-	  if (req->bpf_filter) {
+	  if (req->bpf_filter && tpl->progs) {
+	    reset_mac(&pptrsv->v6);
+	    reset_ip6(&pptrsv->v6);
+
+	    ((struct ip6_hdr *)pptrsv->v6.iph_ptr)->ip6_ctlun.ip6_un2_vfc = 0x60;
+	    NF_run_template_prog(&tpl->prog[direction == DIRECTION_OUT ? TPL_PROG_IPV6_OUT : TPL_PROG_IPV6_IN], pkt, &pptrsv->v6);
+	  }
+	  else if (req->bpf_filter) {
 	    reset_mac(&pptrsv->v6);
 	    reset_ip6(&pptrsv->v6);
 
@@ -2868,20 +3176,26 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
                    tpl->fld[NF9_TCP_FLAGS].len[0]);
 	  }
 
-          memcpy(&pptrsv->v6.lm_mask_src,
-                 pkt+tpl->fld[NF9_SRC_MASK].off[0],
-                 tpl->fld[NF9_SRC_MASK].len[0]);
-          memcpy(&pptrsv->v6.lm_mask_dst,
-                 pkt+tpl->fld[NF9_DST_MASK].off[0],
-                 tpl->fld[NF9_DST_MASK].len[0]);
+	  if (tpl->progs) {
+	    pptrsv->v6.l4_proto = 0;
+	    NF_run_template_prog(&tpl->prog[TPL_PROG_META], pkt, &pptrsv->v6);
+	  }
+	  else {
+            memcpy(&pptrsv->v6.lm_mask_src,
+                   pkt+tpl->fld[NF9_SRC_MASK].off[0],
+                   tpl->fld[NF9_SRC_MASK].len[0]);
+            memcpy(&pptrsv->v6.lm_mask_dst,
+                   pkt+tpl->fld[NF9_DST_MASK].off[0],
+                   tpl->fld[NF9_DST_MASK].len[0]);
+
+	    /* Let's copy some relevant field */
+	    pptrsv->v6.l4_proto = 0;
+            memcpy(&pptrsv->v6.l4_proto, pkt+tpl->fld[NF9_L4_PROTOCOL].off[0],
+                   tpl->fld[NF9_L4_PROTOCOL].len[0]);
+	  }
           pptrsv->v6.lm_method_src = NF_NET_KEEP;
           pptrsv->v6.lm_method_dst = NF_NET_KEEP;
 
-	  /* Let's copy some relevant field */
-	  pptrsv->v6.l4_proto = 0;
-          memcpy(&pptrsv->v6.l4_proto, pkt+tpl->fld[NF9_L4_PROTOCOL].off[0],
-                 tpl->fld[NF9_L4_PROTOCOL].len[0]);
-
 	  NF_process_classifiers(pptrs, &pptrsv->v6, pkt, tpl);
 	  if (config.bgp_daemon_to_xflow_agent_map) BTA_find_id((struct id_table *)pptrs->bta_table, &pptrsv->v6, &pptrsv->v6.bta, &pptrsv->v6.bta2);
 	  if (config.nfacctd_flow_to_rd_map) NF_find_id((struct id_table *)pptrs->bitr_table, &pptrsv->v6, &pptrsv->v6.bitr, NULL);
@@ -3843,6 +4157,25 @@ void NF_evaluate_flow_type(struct flow_chars *flow_type, struct template_cache_e
   flow_type->traffic_type = ret;
 }
 
+/* runs a decode program precompiled by compose_template_progs() against a data record */
+void NF_run_template_prog(struct tpl_prog *prog, u_char *pkt, struct packet_ptrs *pptrs)
+{
+  u_char *dst[TPL_PROG_DST_MAX];
+  struct tpl_prog_op *op;
+  int idx;
+
+  dst[TPL_PROG_DST_MAC] = pptrs->mac_ptr;
+  dst[TPL_PROG_DST_IPH] = pptrs->iph_ptr;
+  dst[TPL_PROG_DST_TLH] = pptrs->tlh_ptr;
+  dst[TPL_PROG_DST_LM_MASK_SRC] = (u_char *) &pptrs->lm_mask_src;
+  dst[TPL_PROG_DST_LM_MASK_DST] = (u_char *) &pptrs->lm_mask_dst;
+  dst[TPL_PROG_DST_L4_PROTO] = (u_char *) &pptrs->l4_proto;
+
+  for (idx = 0, op = prog->op; idx < prog->num; idx++, op++) {
+    memcpy(dst[op->dst] + op->dst_off, pkt + op->src_off, op->len);
+  }
+}
+
 u_int16_t NF_evaluate_direction(struct template_cache_entry *tpl, struct packet_ptrs *pptrs)
 {
   u_int16_t ret = DIRECTION_IN;
@@ -3939,6 +4272,11 @@ int NF_find_id(struct id_table *t, struct packet_ptrs *pptrs, pm_id_t *tag, pm_i
     goto exit_lane;
   }
 
+  if (t->tree) {
+    ret = pretag_tree_lookup(t, pptrs, sa, tag, tag2);
+    goto exit_lane;
+  }
+
   if (sa->sa_family == AF_INET) {
     begin = 0;
     end = t->ipv4_num;
@@ -3973,15 +4311,12 @@ struct xflow_status_entry *nfv5_check_status(struct packet_ptrs *pptrs)
   struct struct_header_v5 *hdr = (struct struct_header_v5 *) pptrs->f_header;
   struct sockaddr *sa = (struct sockaddr *) pptrs->f_agent;
   u_int32_t aux1 = (hdr->engine_id << 8 | hdr->engine_type);
-  int hash = hash_status_table(aux1, sa, XFLOW_STATUS_TABLE_SZ);
   struct xflow_status_entry *entry = NULL;
   
-  if (hash >= 0) {
-    entry = search_status_table(&xflow_status_table, sa, aux1, 0, hash, XFLOW_STATUS_TABLE_MAX_ENTRIES);
-    if (entry) {
-      update_status_table(entry, ntohl(hdr->flow_sequence), pptrs->f_len);
-      entry->inc = ntohs(hdr->count);
-    }
+  entry = search_status_table(&xflow_status_table, sa, aux1, 0, XFLOW_STATUS_TABLE_MAX_ENTRIES);
+  if (entry) {
+    update_status_table(entry, ntohl(hdr->flow_sequence), pptrs->f_len);
+    entry->inc = ntohs(hdr->count);
   }
 
   return entry;
@@ -3990,15 +4325,12 @@ struct xflow_status_entry *nfv5_check_status(struct packet_ptrs *pptrs)
 struct xflow_status_entry *nfv9_check_status(struct packet_ptrs *pptrs, u_int32_t sid, u_int32_t flags, u_int32_t seq, u_int8_t update)
 {
   struct sockaddr *sa = (struct sockaddr *) pptrs->f_agent;
-  int hash = hash_status_table(sid, sa, XFLOW_STATUS_TABLE_SZ);
   struct xflow_status_entry *entry = NULL;
   
-  if (hash >= 0) {
-    entry = search_status_table(&xflow_status_table, sa, sid, flags, hash, XFLOW_STATUS_TABLE_MAX_ENTRIES);
-    if (entry && update) {
-      update_status_table(entry, seq, pptrs->f_len);
-      entry->inc = 1;
-    }
+  entry = search_status_table(&xflow_status_table, sa, sid, flags, XFLOW_STATUS_TABLE_MAX_ENTRIES);
+  if (entry && update) {
+    update_status_table(entry, seq, pptrs->f_len);
+    entry->inc = 1;
   }
 
   return entry;
@@ -4016,11 +4348,11 @@ void NF_process_classifiers(struct packet_ptrs *pptrs_main, struct packet_ptrs *
 
     memcpy(&class_id, pkt + tpl->fld[NF9_APPLICATION_ID].off[0] + 1,
            tpl->fld[NF9_APPLICATION_ID].len[0] - 1);
-    if (entry) pptrs->class = NF_evaluate_classifiers(entry->class, &class_id, gentry);
+    if (entry) pptrs->class = NF_evaluate_classifiers(&entry->class, &class_id, gentry);
   }
 }
 
-pm_class_t NF_evaluate_classifiers(struct xflow_status_entry_class *entry, pm_class_t *class_id, struct xflow_status_entry *gentry)
+pm_class_t NF_evaluate_classifiers(struct xflow_status_class_table *entry, pm_class_t *class_id, struct xflow_status_entry *gentry)
 {
   struct xflow_status_entry_class *centry;
 
@@ -4032,7 +4364,7 @@ pm_class_t NF_evaluate_classifiers(struct xflow_status_entry_class *entry, pm_cl
 
   /* Try #2: let's chance if we have a global option */
   if (gentry) {
-    centry = search_class_id_status_table(gentry->class, *class_id);
+    centry = search_class_id_status_table(&gentry->class, *class_id);
     if (centry) {
       return centry->class_int_id;
     }
@@ -4344,3 +4676,49 @@ void NF_bgp_lookup_info_preload(struct packet_ptrs *pptrs, struct bgp_lookup_inf
              tpl->fld[NF9_IPV6_DST_ADDR].len[tpl->fld[NF9_IPV6_DST_ADDR].count-1]);
   }
 }
+
+/*
+   Resolves src/dst BGP lookups of all the records of a data flowset in
+   one go, ahead of processing them one by one; bgp_srcdst_lookup() then
+   picks results up via pptrs->bgp_batch. Only fixed-length templates of
+   IPv4 or IPv6 flows qualify; BGP peers mapped per record (ie. via
+   bgp_agent_map) are left to the regular lookup.
+*/
+void NF_bgp_lookup_batch_prefill(u_char *pkt, u_int16_t flowoff, u_int16_t flowsetlen, struct template_cache_entry *tpl, struct packet_ptrs_vector *pptrsv)
+{
+  static struct bgp_lookup_batch blb;
+  struct packet_ptrs *pptrs;
+  u_int16_t l3_proto, src_fld, dst_fld;
+
+  pptrsv->v4.bgp_batch = NULL;
+  pptrsv->v6.bgp_batch = NULL;
+
+  if (tpl->vlen || !tpl->len || config.bgp_daemon_to_xflow_agent_map) return;
+
+  if (tpl->fld[NF9_IPV4_SRC_ADDR].count && tpl->fld[NF9_IPV4_SRC_ADDR].len[0] == 4 &&
+      tpl->fld[NF9_IPV4_DST_ADDR].count && tpl->fld[NF9_IPV4_DST_ADDR].len[0] == 4) {
+    pptrs = &pptrsv->v4;
+    l3_proto = ETHERTYPE_IP;
+    src_fld = NF9_IPV4_SRC_ADDR;
+    dst_fld = NF9_IPV4_DST_ADDR;
+  }
+  else if (tpl->fld[NF9_IPV6_SRC_ADDR].count && tpl->fld[NF9_IPV6_SRC_ADDR].len[0] == 16 &&
+	   tpl->fld[NF9_IPV6_DST_ADDR].count && tpl->fld[NF9_IPV6_DST_ADDR].len[0] == 16) {
+    pptrs = &pptrsv->v6;
+    l3_proto = ETHERTYPE_IPV6;
+    src_fld = NF9_IPV6_SRC_ADDR;
+    dst_fld = NF9_IPV6_DST_ADDR;
+  }
+  else return;
+
+  if (bgp_lookup_batch_init(&blb, (struct sockaddr *) pptrs->f_agent, (struct xflow_status_entry *) pptrs->f_status,
+			    l3_proto, FUNC_TYPE_BGP) == ERR) return;
+
+  for (; (flowoff + tpl->len) <= flowsetlen; pkt += tpl->len, flowoff += tpl->len) {
+    if (bgp_lookup_batch_add(&blb, (pkt + tpl->fld[src_fld].off[0])) == ERR) break;
+    if (bgp_lookup_batch_add(&blb, (pkt + tpl->fld[dst_fld].off[0])) == ERR) break;
+  }
+
+  bgp_lookup_batch_resolve(&blb);
+  pptrs->bgp_batch = (char *) &blb;
+}
@@ -87,6 +87,7 @@ struct data_hdr_v9 {
 
 /* defines */
 #define DEFAULT_NFACCTD_PORT 2100
+#define CORE_WORKER_RESPAWN_DELAY 5 /* secs */
 #define NETFLOW_MSG_SIZE PKT_MSG_SIZE
 #define V5_MAXFLOWS 30  /* max records in V5 packet */
 
@@ -114,8 +115,9 @@ extern void process_v9_packet(unsigned char *, u_int16_t, struct packet_ptrs_vec
 extern void process_raw_packet(unsigned char *, u_int16_t, struct packet_ptrs_vector *, struct plugin_requests *);
 extern void NF_evaluate_flow_type(struct flow_chars *, struct template_cache_entry *, struct packet_ptrs *);
 extern u_int16_t NF_evaluate_direction(struct template_cache_entry *, struct packet_ptrs *);
+extern void NF_run_template_prog(struct tpl_prog *, u_char *, struct packet_ptrs *);
 extern void NF_process_classifiers(struct packet_ptrs *, struct packet_ptrs *, unsigned char *, struct template_cache_entry *);
-extern pm_class_t NF_evaluate_classifiers(struct xflow_status_entry_class *, pm_class_t *, struct xflow_status_entry *);
+extern pm_class_t NF_evaluate_classifiers(struct xflow_status_class_table *, pm_class_t *, struct xflow_status_entry *);
 extern void reset_mac(struct packet_ptrs *);
 extern void reset_mac_vlan(struct packet_ptrs *);
 extern void reset_ip4(struct packet_ptrs *);
@@ -123,6 +125,10 @@ extern void reset_ip6(struct packet_ptrs *);
 extern void reset_dummy_v4(struct packet_ptrs *, u_char *);
 extern int NF_find_id(struct id_table *, struct packet_ptrs *, pm_id_t *, pm_id_t *);
 extern void NF_compute_once();
+extern void NF_spawn_core_workers();
+extern pid_t NF_spawn_core_worker(int);
+extern void NF_core_worker_paths(int);
+extern void NF_core_workers_shutdown(int);
 
 extern struct xflow_status_entry *nfv5_check_status(struct packet_ptrs *);
 extern struct xflow_status_entry *nfv9_check_status(struct packet_ptrs *, u_int32_t, u_int32_t, u_int32_t, u_int8_t);
@@ -146,6 +152,7 @@ extern void NF_mpls_vpn_rd_from_options(struct packet_ptrs *);
 
 extern struct bgp_lookup_info *bl_info;
 extern void NF_bgp_lookup_info_preload(struct packet_ptrs *, struct bgp_lookup_info *);
+extern void NF_bgp_lookup_batch_prefill(u_char *, u_int16_t, u_int16_t, struct template_cache_entry *, struct packet_ptrs_vector *);
 
 extern struct utpl_field *(*get_ext_db_ie_by_type)(struct template_cache_entry *, u_int32_t, u_int16_t, u_int8_t);
 #endif //NFACCTD_H
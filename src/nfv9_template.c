@@ -22,14 +22,38 @@
 /* includes */
 #include "pmacct.h"
 #include "nfv9_template.h"
+#include "jhash.h"
 
 /* structs */
 struct template_cache {
   struct template_cache_entry *c[TEMPLATE_CACHE_ENTRIES];
 };
 
+/* fixed-size key: zeroed before being filled in so that it can be hashed and compared as a blob */
+struct template_index_key {
+  struct host_addr agent;
+  u_int32_t source_id;
+  u_int16_t template_id;
+  u_int8_t version;
+};
+
+struct template_index_slot {
+  u_int32_t hash;
+  u_int32_t gen;			/* unique per stored template; 0 = empty slot */
+  struct template_index_key key;
+  struct template_cache_entry *tpl;
+};
+
+/* open addressing, linear probing; templates are only ever replaced, never removed */
+struct template_index {
+  struct template_index_slot *slots;
+  u_int32_t size;			/* power of two */
+  u_int32_t entries;
+  u_int32_t gen;
+};
+
 /* global variables */
-static cdada_map_t *tpl_data_map;
+static struct template_index tpl_index;
 
 #define MAX_TPL_DESC_LIST 90
 static const char *tpl_desc_list[] = {
@@ -805,25 +829,161 @@ static int get_ipfix_vlen(u_char *base, u_int16_t remlen, u_int16_t *len)
   return ret;
 }
 
-static u_char *compose_template_key(pm_hash_serial_t *ser, u_int8_t nf_version,
-				    u_int16_t template_id, struct sockaddr *agent,
-				    u_int32_t source_id)
+static u_int32_t compose_template_key(struct template_index_key *key, u_int8_t nf_version,
+				      u_int16_t template_id, struct sockaddr *agent,
+				      u_int32_t source_id)
+{
+  u_int16_t agent_port;
+
+  memset(key, 0, sizeof(struct template_index_key));
+  sa_to_addr(agent, &key->agent, &agent_port);
+  key->source_id = source_id;
+  key->template_id = template_id;
+  key->version = nf_version;
+
+  return jhash(key, sizeof(struct template_index_key), 0);
+}
+
+static struct template_index_slot *template_index_lookup(struct template_index_key *key, u_int32_t hash)
+{
+  struct template_index_slot *slot;
+  u_int32_t mask = (tpl_index.size - 1), pos;
+
+  for (pos = (hash & mask); ; pos = ((pos + 1) & mask)) {
+    slot = &tpl_index.slots[pos];
+
+    if (!slot->gen) return slot;
+    if (slot->hash == hash && !memcmp(&slot->key, key, sizeof(struct template_index_key))) return slot;
+  }
+}
+
+static int template_index_alloc(u_int32_t size)
 {
-  pm_hash_key_t *hash_key;
-  u_int16_t hash_keylen;
-  u_int16_t saved_agent_port;
-
-  hash_keylen = calc_template_keylen();
-  hash_init_serial(ser, hash_keylen);
-  hash_serial_append(ser, (char *)&nf_version, sizeof(nf_version), FALSE);
-  hash_serial_append(ser, (char *)&template_id, sizeof(template_id), FALSE);
-  hash_serial_append(ser, (char *)&source_id, sizeof(source_id), TRUE);
-  sa_reset_and_save_port((struct sockaddr_storage *) agent, &saved_agent_port);
-  hash_serial_append(ser, (char *)agent, sizeof(struct sockaddr_storage), TRUE);
-  sa_set_port((struct sockaddr_storage *)agent, saved_agent_port);
-  hash_key = hash_serial_get_key(ser);
-
-  return hash_key_get_val(hash_key);
+  struct template_index_slot *old_slots = tpl_index.slots, *slot;
+  u_int32_t old_size = tpl_index.size, idx;
+
+  tpl_index.slots = calloc(size, sizeof(struct template_index_slot));
+  if (!tpl_index.slots) {
+    tpl_index.slots = old_slots;
+    return ERR;
+  }
+
+  tpl_index.size = size;
+
+  for (idx = 0; idx < old_size; idx++) {
+    if (old_slots[idx].gen) {
+      slot = template_index_lookup(&old_slots[idx].key, old_slots[idx].hash);
+      memcpy(slot, &old_slots[idx], sizeof(struct template_index_slot));
+    }
+  }
+
+  if (old_slots) free(old_slots);
+
+  return SUCCESS;
+}
+
+/* stores tpl under key; returns the template it replaces, if any */
+static struct template_cache_entry *template_index_insert(struct template_index_key *key, u_int32_t hash,
+							  struct template_cache_entry *tpl, int *ret)
+{
+  struct template_index_slot *slot;
+  struct template_cache_entry *old_tpl = NULL;
+
+  (*ret) = SUCCESS;
+
+  /* keep load factor <= 0.5 */
+  if (((tpl_index.entries + 1) * 2) > tpl_index.size) {
+    if (template_index_alloc(tpl_index.size * 2) == ERR && (tpl_index.entries + 1) >= tpl_index.size) {
+      (*ret) = ERR;
+      return NULL;
+    }
+  }
+
+  slot = template_index_lookup(key, hash);
+  if (slot->gen) {
+    old_tpl = slot->tpl;
+  }
+  else {
+    slot->hash = hash;
+    memcpy(&slot->key, key, sizeof(struct template_index_key));
+    tpl_index.entries++;
+  }
+
+  /* a new generation invalidates any hot cache pointing to this slot */
+  tpl_index.gen++;
+  if (!tpl_index.gen) tpl_index.gen++;
+
+  slot->gen = tpl_index.gen;
+  slot->tpl = tpl;
+
+  return old_tpl;
+}
+
+static void compose_template_prog_op(struct template_cache_entry *tpl, struct tpl_prog *prog,
+				     u_int16_t type, u_int8_t dst, u_int8_t dst_off)
+{
+  struct tpl_prog_op *op;
+
+  /* same as copying fld[type].len[0] bytes: nothing to do if the field is not in the template */
+  if (!tpl->fld[type].count || !tpl->fld[type].len[0]) return;
+
+  op = &prog->op[prog->num];
+  op->src_off = tpl->fld[type].off[0];
+  op->len = tpl->fld[type].len[0];
+  op->dst = dst;
+  op->dst_off = dst_off;
+
+  prog->num++;
+}
+
+/*
+   Templates change rarely: fixed-length data templates are compiled, as
+   they are received, into short vectors of copy operations covering the
+   fields the Core Process needs for every record (ie. to build the fake
+   packet fed to BPF filters, prefix masks and L4 protocol). The record
+   loop then runs them linearly instead of looking each field up in the
+   template. Variable-length templates are left to the generic path since
+   their offsets change record by record.
+*/
+static void compose_template_progs(struct template_cache_entry *tpl)
+{
+  struct tpl_prog *prog;
+  int dir;
+
+  memset(tpl->prog, 0, sizeof(tpl->prog));
+  tpl->progs = FALSE;
+
+  if (config.nfacctd_disable_decode_programs || tpl->vlen || tpl->template_type != 0) return;
+
+  for (dir = 0; dir < 2; dir++) {
+    prog = &tpl->prog[dir ? TPL_PROG_IPV4_OUT : TPL_PROG_IPV4_IN];
+    compose_template_prog_op(tpl, prog, dir ? NF9_OUT_SRC_MAC : NF9_IN_SRC_MAC, TPL_PROG_DST_MAC, ETH_ADDR_LEN);
+    compose_template_prog_op(tpl, prog, dir ? NF9_OUT_DST_MAC : NF9_IN_DST_MAC, TPL_PROG_DST_MAC, 0);
+    compose_template_prog_op(tpl, prog, NF9_IPV4_SRC_ADDR, TPL_PROG_DST_IPH, offsetof(struct pm_iphdr, ip_src));
+    compose_template_prog_op(tpl, prog, NF9_IPV4_DST_ADDR, TPL_PROG_DST_IPH, offsetof(struct pm_iphdr, ip_dst));
+    compose_template_prog_op(tpl, prog, NF9_L4_PROTOCOL, TPL_PROG_DST_IPH, offsetof(struct pm_iphdr, ip_p));
+    compose_template_prog_op(tpl, prog, NF9_SRC_TOS, TPL_PROG_DST_IPH, offsetof(struct pm_iphdr, ip_tos));
+    compose_template_prog_op(tpl, prog, NF9_L4_SRC_PORT, TPL_PROG_DST_TLH, offsetof(struct pm_tlhdr, src_port));
+    compose_template_prog_op(tpl, prog, NF9_L4_DST_PORT, TPL_PROG_DST_TLH, offsetof(struct pm_tlhdr, dst_port));
+    compose_template_prog_op(tpl, prog, NF9_TCP_FLAGS, TPL_PROG_DST_TLH, offsetof(struct pm_tcphdr, th_flags));
+
+    prog = &tpl->prog[dir ? TPL_PROG_IPV6_OUT : TPL_PROG_IPV6_IN];
+    compose_template_prog_op(tpl, prog, dir ? NF9_OUT_SRC_MAC : NF9_IN_SRC_MAC, TPL_PROG_DST_MAC, ETH_ADDR_LEN);
+    compose_template_prog_op(tpl, prog, dir ? NF9_OUT_DST_MAC : NF9_IN_DST_MAC, TPL_PROG_DST_MAC, 0);
+    compose_template_prog_op(tpl, prog, NF9_IPV6_SRC_ADDR, TPL_PROG_DST_IPH, offsetof(struct ip6_hdr, ip6_src));
+    compose_template_prog_op(tpl, prog, NF9_IPV6_DST_ADDR, TPL_PROG_DST_IPH, offsetof(struct ip6_hdr, ip6_dst));
+    compose_template_prog_op(tpl, prog, NF9_L4_PROTOCOL, TPL_PROG_DST_IPH, offsetof(struct ip6_hdr, ip6_nxt));
+    compose_template_prog_op(tpl, prog, NF9_L4_SRC_PORT, TPL_PROG_DST_TLH, offsetof(struct pm_tlhdr, src_port));
+    compose_template_prog_op(tpl, prog, NF9_L4_DST_PORT, TPL_PROG_DST_TLH, offsetof(struct pm_tlhdr, dst_port));
+    compose_template_prog_op(tpl, prog, NF9_TCP_FLAGS, TPL_PROG_DST_TLH, offsetof(struct pm_tcphdr, th_flags));
+  }
+
+  prog = &tpl->prog[TPL_PROG_META];
+  compose_template_prog_op(tpl, prog, NF9_SRC_MASK, TPL_PROG_DST_LM_MASK_SRC, 0);
+  compose_template_prog_op(tpl, prog, NF9_DST_MASK, TPL_PROG_DST_LM_MASK_DST, 0);
+  compose_template_prog_op(tpl, prog, NF9_L4_PROTOCOL, TPL_PROG_DST_L4_PROTO, 0);
+
+  tpl->progs = TRUE;
 }
 
 static struct template_cache_entry *compose_template(struct template_hdr_v9 *hdr,
@@ -1154,12 +1314,10 @@ static struct template_cache_entry *compose_opt_template(void *hdr, struct socka
 
 int init_template_cache_v2(void)
 {
-  u_int16_t tpl_hash_keylen = calc_template_keylen();
-  char pm_cdada_map_container[tpl_hash_keylen];
+  memset(&tpl_index, 0, sizeof(tpl_index));
 
-  tpl_data_map = cdada_map_create(pm_cdada_map_container);
-  if (!tpl_data_map) {
-    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to allocate tpl_data_map. Exiting.\n", config.name, config.type);
+  if (template_index_alloc(TEMPLATE_INDEX_INIT_SZ) == ERR) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to allocate template index. Exiting.\n", config.name, config.type);
     return ERR;
   }
 
@@ -1171,12 +1329,11 @@ struct template_cache_entry *handle_template_v2(struct template_hdr_v9 *hdr, str
                                                 u_int16_t len, u_int32_t seq)
 {
   struct template_cache_entry *tpl = NULL, *old_tpl = NULL;
+  struct template_index_key key;
+  u_int32_t hash;
   u_int8_t version = 0;
   int ret;
 
-  pm_hash_serial_t hash_serializer;
-  u_char *hash_keyval;
-
   if (pens) {
     *pens = FALSE;
   }
@@ -1188,32 +1345,23 @@ struct template_cache_entry *handle_template_v2(struct template_hdr_v9 *hdr, str
     version = 10;
   }
 
-  hash_keyval = compose_template_key(&hash_serializer, version, hdr->template_id, agent, sid);
+  hash = compose_template_key(&key, version, hdr->template_id, agent, sid);
 
   /* 0 NetFlow v9, 2 IPFIX */
   if (tpl_type == 0 || tpl_type == 2) {
     tpl = compose_template(hdr, agent, tpl_type, sid, pens, version, len, seq);
+    if (tpl) compose_template_progs(tpl);
   }
   /* 1 NetFlow v9, 3 IPFIX */
   else if (tpl_type == 1 || tpl_type == 3) {
     tpl = compose_opt_template(hdr, agent, tpl_type, sid, pens, version, len, seq);
   }
 
-  {
-    void *old_tpl_aux = NULL;
+  old_tpl = template_index_insert(&key, hash, tpl, &ret);
+  if (old_tpl) free(old_tpl);
 
-    cdada_map_find(tpl_data_map, hash_keyval, &old_tpl_aux);
-    old_tpl = (struct template_cache_entry *) old_tpl_aux;
-
-    if (old_tpl) {
-      cdada_map_erase(tpl_data_map, hash_keyval);
-      free(old_tpl);
-    }
-
-    ret = cdada_map_insert(tpl_data_map, hash_keyval, tpl);
-    if (ret != CDADA_SUCCESS) {
-      Log(LOG_WARNING, "WARN ( %s/core ): Unable to insert template in tpl_data_map\n", config.name);
-    }
+  if (ret == ERR) {
+    Log(LOG_WARNING, "WARN ( %s/core ): Unable to insert template in template index\n", config.name);
   }
 
 #ifdef WITH_JANSSON
@@ -1227,25 +1375,42 @@ struct template_cache_entry *handle_template_v2(struct template_hdr_v9 *hdr, str
   }
 #endif
 
-  /* freeing hash key */
-  hash_destroy_serial(&hash_serializer);
-
   return tpl;
 }
 
+/*
+   hot: optional per-exporter cache of the last template found, ie. the
+   one in the xflow_status_entry for (agent, sid). In the steady state
+   it avoids composing the key and probing the index altogether.
+*/
 struct template_cache_entry *find_template_v2(u_int16_t id, struct sockaddr *agent,
                                            u_int8_t version, u_int16_t tpl_type,
-					   u_int32_t sid)
+					   u_int32_t sid, struct xflow_status_tpl_cache *hot)
 {
   struct template_cache_entry *tpl = NULL;
-  pm_hash_serial_t hash_serializer;
-  u_char *hash_keyval;
-  int ret;
+  struct template_index_slot *slot;
+  struct template_index_key key;
+  u_int32_t hash;
 
-  hash_keyval = compose_template_key(&hash_serializer, version, id, agent, sid);
+  if (hot && hot->gen && hot->template_id == id && hot->version == version &&
+      hot->slot < tpl_index.size && tpl_index.slots[hot->slot].gen == hot->gen) {
+    return tpl_index.slots[hot->slot].tpl;
+  }
 
-  ret = cdada_map_find(tpl_data_map, hash_keyval, (void **) &tpl);
-  if (ret == CDADA_E_NOT_FOUND) {
+  hash = compose_template_key(&key, version, id, agent, sid);
+
+  slot = template_index_lookup(&key, hash);
+  if (slot->gen) {
+    tpl = slot->tpl;
+
+    if (hot) {
+      hot->template_id = id;
+      hot->version = version;
+      hot->slot = (slot - tpl_index.slots);
+      hot->gen = slot->gen;
+    }
+  }
+  else {
     struct host_addr debug_a;
     char debug_agent_addr[INET6_ADDRSTRLEN];
     u_int16_t debug_agent_port;
@@ -1253,13 +1418,10 @@ struct template_cache_entry *find_template_v2(u_int16_t id, struct sockaddr *age
     sa_to_addr((struct sockaddr *)agent, &debug_a, &debug_agent_port);
     addr_to_str(debug_agent_addr, &debug_a);
 
-    Log(LOG_DEBUG, "DEBUG ( %s/core ): find_template_v2(): cdada_map_find() returned CDADA_E_NOT_FOUND for template %u [%s:%u])\n",
+    Log(LOG_DEBUG, "DEBUG ( %s/core ): find_template_v2(): template %u [%s:%u] not found in template index\n",
 	config.name, ntohs(id), debug_agent_addr, sid);
   }
 
-  /* freeing hash key */
-  hash_destroy_serial(&hash_serializer);
-
   return tpl;
 }
 
@@ -1347,23 +1509,24 @@ void load_templates_from_file(char *path)
       addr_to_sa((struct sockaddr *) &agent, &tpl->agent, 0);
 
       /* We assume the cache is empty when templates are loaded */
-      if (find_template_v2(tpl->template_id, (struct sockaddr *) &agent, tpl->version, tpl->template_type, tpl->source_id)) {
+      if (find_template_v2(tpl->template_id, (struct sockaddr *) &agent, tpl->version, tpl->template_type, tpl->source_id, NULL)) {
         Log(LOG_WARNING, "WARN ( %s/core ): load_templates_from_file(): template %u already cached. Skipping.\n",
             config.name, tpl->template_id);
         free(tpl);
       }
       else {
 	char debug_agent_addr[INET6_ADDRSTRLEN];
-	pm_hash_serial_t hash_serializer;
-	u_char *hash_keyval;
+	struct template_index_key key;
+	u_int32_t hash;
 	int ret;
 
-	hash_keyval = compose_template_key(&hash_serializer, tpl->version, tpl->template_id, (struct sockaddr *)&agent, tpl->source_id);
+	hash = compose_template_key(&key, tpl->version, tpl->template_id, (struct sockaddr *)&agent, tpl->source_id);
 	addr_to_str(debug_agent_addr, &tpl->agent);
+	compose_template_progs(tpl);
 
-	ret = cdada_map_insert(tpl_data_map, hash_keyval, tpl);
-	if (ret != CDADA_SUCCESS) {
-	  Log(LOG_WARNING, "WARN ( %s/core ): load_templates_from_file(): Unable to insert template %u [%s:%u] in tpl_data_map\n",
+	template_index_insert(&key, hash, tpl, &ret);
+	if (ret == ERR) {
+	  Log(LOG_WARNING, "WARN ( %s/core ): load_templates_from_file(): Unable to insert template %u [%s:%u] in template index\n",
 	      config.name, ntohs(tpl->template_id), debug_agent_addr, tpl->source_id);
 	}
 	else {
@@ -1386,14 +1549,6 @@ void load_templates_from_file(char *path)
 }
 #endif
 
-u_int16_t calc_template_keylen(void)
-{
-  return (sizeof(u_int8_t) /* NetFlow version */ +
-	  sizeof(u_int16_t /* template id */) +
-          sizeof(u_int32_t /* source id */) +
-          sizeof(struct sockaddr_storage /* sender IP */));
-}
-
 struct utpl_field *ext_db_get_ie(struct template_cache_entry *ptr, u_int32_t pen,
                                  u_int16_t type, u_int8_t repeat_id)
 {
@@ -36,6 +36,7 @@
 #define NF9_MAX_DEFINED_FIELD           384
 
 #define TEMPLATE_CACHE_ENTRIES          1021
+#define TEMPLATE_INDEX_INIT_SZ          1024 /* power of two */
 #define IES_PER_TPL_EXT_DB_ENTRY        32
 #define TPL_EXT_DB_ENTRIES              8
 #define TPL_LIST_ENTRIES                256
@@ -44,6 +45,23 @@
 #define TPL_TYPE_LEGACY                 1
 #define TPL_TYPE_EXT_DB                 2
 
+/* precompiled decode programs, see compose_template_progs() */
+#define TPL_PROG_IPV4_IN		0
+#define TPL_PROG_IPV4_OUT		1
+#define TPL_PROG_IPV6_IN		2
+#define TPL_PROG_IPV6_OUT		3
+#define TPL_PROG_META			4	/* prefix masks, L4 protocol */
+#define TPL_PROG_MAX			5
+#define TPL_PROG_MAX_OPS		12
+
+#define TPL_PROG_DST_MAC		0
+#define TPL_PROG_DST_IPH		1
+#define TPL_PROG_DST_TLH		2
+#define TPL_PROG_DST_LM_MASK_SRC	3
+#define TPL_PROG_DST_LM_MASK_DST	4
+#define TPL_PROG_DST_L4_PROTO		5
+#define TPL_PROG_DST_MAX		6
+
 /* Flowset record types we care about */
 #define NF9_IN_BYTES                    1
 #define NF9_IN_PACKETS                  2
@@ -300,6 +318,19 @@ struct tpl_field_list {
   void *ptr;                            /* struct otpl_field or utpl_field */
 };
 
+/* copy len bytes at src_off of a data record to dst_off of a packet_ptrs base */
+struct tpl_prog_op {
+  u_int16_t src_off;
+  u_int16_t len;
+  u_int8_t dst;				/* TPL_PROG_DST_* */
+  u_int8_t dst_off;
+};
+
+struct tpl_prog {
+  u_int8_t num;
+  struct tpl_prog_op op[TPL_PROG_MAX_OPS];
+};
+
 typedef enum { none, ipv4, ipv6 } layer_prot;
 
 struct layer_protocols {
@@ -320,6 +351,8 @@ struct template_cache_entry {
   struct tpl_field_db ext_db[TPL_EXT_DB_ENTRIES];
   struct tpl_field_list list[TPL_LIST_ENTRIES];
   struct layer_protocols layers;
+  u_int8_t progs;			/* flag for precompiled decode programs */
+  struct tpl_prog prog[TPL_PROG_MAX];
   struct template_cache_entry *next;
 };
 
@@ -327,11 +360,11 @@ struct template_cache_entry {
 extern int init_template_cache_v2(void);
 extern struct template_cache_entry *handle_template_v2(struct template_hdr_v9 *, struct sockaddr *, u_int16_t,
 						       u_int32_t, u_int16_t *, u_int16_t, u_int32_t);
-extern struct template_cache_entry *find_template_v2(u_int16_t, struct sockaddr *, u_int8_t, u_int16_t, u_int32_t);
+extern struct template_cache_entry *find_template_v2(u_int16_t, struct sockaddr *, u_int8_t, u_int16_t, u_int32_t,
+						     struct xflow_status_tpl_cache *);
 
 extern int resolve_vlen_template(u_char *, u_int16_t, struct template_cache_entry *);
 extern void load_templates_from_file(char *);
-extern u_int16_t calc_template_keylen(void);
 extern struct utpl_field *ext_db_get_ie(struct template_cache_entry *, u_int32_t, u_int16_t, u_int8_t);
 extern void notify_malf_packet(short int, char *, char *, struct sockaddr *, u_int32_t);
 
@@ -29,6 +29,7 @@
 #include "ip_flow.h"
 #include "net_aggr.h"
 #include "thread_pool.h"
+#include "pm_tpacket.h"
 #include "bgp/bgp.h"
 #include "bmp/bmp.h"
 #if defined (WITH_NDPI)
@@ -56,6 +57,8 @@ void pm_pcap_cb(u_char *user, const struct pcap_pkthdr *pkthdr, const u_char *bu
   /* We process the packet with the appropriate
      data link layer function */
   if (buf) {
+    bgp_epoch_online(bgp_epoch_core_reader);
+
     memset(&pptrs, 0, sizeof(pptrs));
 
     pptrs.pkthdr = (struct pcap_pkthdr *) pkthdr;
@@ -198,6 +201,8 @@ void pm_pcap_cb(u_char *user, const struct pcap_pkthdr *pkthdr, const u_char *bu
     free(pptrs.tun_pptrs);
   }
 
+  bgp_epoch_offline(bgp_epoch_core_reader);
+
   if (cb_data->sig.is_set) sigprocmask(SIG_UNBLOCK, &cb_data->sig.set, NULL);
 }
 
@@ -556,6 +561,8 @@ int PM_find_id(struct id_table *t, struct packet_ptrs *pptrs, pm_id_t *tag, pm_i
     return ret;
   }
 
+  if (t->tree) return pretag_tree_lookup(t, pptrs, NULL, tag, tag2);
+
   for (x = 0; x < t->ipv4_num; x++) {
     ret = pretag_entry_process(&t->e[x], pptrs, tag, tag2);
 
@@ -579,7 +586,14 @@ void PM_print_stats(time_t now)
 
   if (config.pcap_if || config.pcap_interfaces_map) {
     for (device_idx = 0; device_idx < devices.num; device_idx++) {
-      if (pcap_stats(devices.list[device_idx].dev_desc, &ps) < 0) {
+      if (devices.list[device_idx].ring) {
+	if (pm_tpacket_stats(&devices.list[device_idx], &ps) < 0) {
+	  Log(LOG_INFO, "INFO ( %s/%s ): stats [%s,%u] time=%ld error='pm_tpacket_stats(): %s'\n",
+	      config.name, config.type, devices.list[device_idx].str, devices.list[device_idx].id,
+	      (long)now, strerror(errno));
+	}
+      }
+      else if (pcap_stats(devices.list[device_idx].dev_desc, &ps) < 0) {
 	Log(LOG_INFO, "INFO ( %s/%s ): stats [%s,%u] time=%ld error='pcap_stats(): %s'\n",
 	    config.name, config.type, devices.list[device_idx].str, devices.list[device_idx].id,
 	    (long)now, pcap_geterr(devices.list[device_idx].dev_desc));
@@ -591,6 +605,10 @@ void PM_print_stats(time_t now)
     }
   }
 
+  plugin_pipe_print_stats(now);
+  pretag_print_stats(now);
+  bgp_epoch_print_stats(now);
+
   Log(LOG_NOTICE, "NOTICE ( %s/%s ): ---\n", config.name, config.type);
 }
 
@@ -212,12 +212,14 @@ void pgsql_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
 	  now = idata.now;
         }
         else {
-          if ((ret = read(pipe_fd, &rgptr, sizeof(rgptr))) == 0)
+          if ((ret = plugin_pipe_read(pipe_fd, &rgptr)) == 0)
             exit_gracefully(1); /* we exit silently; something happened at the write end */
         }
 
         if ((rg->ptr + bufsz) > rg->end) rg->ptr = rg->base;
 
+        if (!pollagain) plugin_pipe_spin(rg->ptr, seq);
+
         if (((struct ch_buf_hdr *)rg->ptr)->seq != seq) {
           if (!pollagain) {
             pollagain = TRUE;
@@ -233,12 +235,14 @@ void pgsql_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
             }
 
 	    rg->ptr = (rg->base + status->last_buf_off);
+	    plugin_pipe_resync(status);
             seq = ((struct ch_buf_hdr *)rg->ptr)->seq;
           }
         }
 
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
+        status->tail++;
         rg->ptr += bufsz;
       }
 #ifdef WITH_ZMQ
@@ -3749,10 +3749,10 @@ void NF_sampling_rate_handler(struct channels_list_entry *chptr, struct packet_p
         }
 
         if (entry) {
-	  sentry = search_smp_id_status_table(entry->sampling, sampler_id, TRUE);
+	  sentry = search_smp_id_status_table(&entry->sampling, sampler_id, TRUE);
 	  if (!sentry && pptrs->f_status_g) {
 	    entry = (struct xflow_status_entry *) pptrs->f_status_g;
-	    sentry = search_smp_id_status_table(entry->sampling, sampler_id, FALSE);
+	    sentry = search_smp_id_status_table(&entry->sampling, sampler_id, FALSE);
 	  } 
         }
         if (sentry) pdata->primitives.sampling_rate = sentry->sample_pool;
@@ -3783,10 +3783,10 @@ void NF_sampling_rate_handler(struct channels_list_entry *chptr, struct packet_p
       /* case of no SAMPLER_ID, ALU & IPFIX */
       else {
         if (entry) {
-          sentry = search_smp_id_status_table(entry->sampling, 0, TRUE);
+          sentry = search_smp_id_status_table(&entry->sampling, 0, TRUE);
           if (!sentry && pptrs->f_status_g) {
             entry = (struct xflow_status_entry *) pptrs->f_status_g;
-            sentry = search_smp_id_status_table(entry->sampling, 0, FALSE);
+            sentry = search_smp_id_status_table(&entry->sampling, 0, FALSE);
           }
         }
         if (sentry) pdata->primitives.sampling_rate = sentry->sample_pool;
@@ -4811,10 +4811,10 @@ void NF_counters_renormalize_handler(struct channels_list_entry *chptr, struct p
       }
 
       if (entry) {
-        sentry = search_smp_id_status_table(entry->sampling, sampler_id, TRUE);
+        sentry = search_smp_id_status_table(&entry->sampling, sampler_id, TRUE);
         if (!sentry && pptrs->f_status_g) {
           entry = (struct xflow_status_entry *) pptrs->f_status_g;
-          sentry = search_smp_id_status_table(entry->sampling, sampler_id, FALSE);
+          sentry = search_smp_id_status_table(&entry->sampling, sampler_id, FALSE);
         }
       }
       if (sentry) {
@@ -4853,12 +4853,12 @@ void NF_counters_renormalize_handler(struct channels_list_entry *chptr, struct p
     /* case of no SAMPLER_ID, ALU & IPFIX */
     else {
       if (entry) {
-        sentry = search_smp_id_status_table(entry->sampling, 0, TRUE);
+        sentry = search_smp_id_status_table(&entry->sampling, 0, TRUE);
         if (!sentry && pptrs->f_status_g) {
           entry = (struct xflow_status_entry *) pptrs->f_status_g;
-          sentry = search_smp_id_status_table(entry->sampling, 0, FALSE);
+          sentry = search_smp_id_status_table(&entry->sampling, 0, FALSE);
         }
-        if (!sentry) sentry = search_smp_id_status_table(entry->sampling, ntohs(tpl->template_id), FALSE);
+        if (!sentry) sentry = search_smp_id_status_table(&entry->sampling, ntohs(tpl->template_id), FALSE);
       }
 
       if (sentry) {
@@ -6023,7 +6023,7 @@ void SF_counters_renormalize_handler(struct channels_list_entry *chptr, struct p
 
   if (pptrs->renormalized) return;
 
-  if (entry) sentry = search_smp_if_status_table(entry->sampling, (sample->ds_class << 24 | sample->ds_index));
+  if (entry) sentry = search_smp_if_status_table(&entry->sampling, (sample->ds_class << 24 | sample->ds_index));
   if (sentry) { 
     /* flow sequence number is strictly increasing; however we need a) to avoid
        a division-by-zero by checking the last value and the new one and b) to
@@ -6046,9 +6046,8 @@ void SF_counters_renormalize_handler(struct channels_list_entry *chptr, struct p
     }
   }
   else {
-    if (entry) sentry = create_smp_entry_status_table(&xflow_status_table, entry);
+    if (entry) sentry = create_smp_entry_status_table(&xflow_status_table, entry, 0, (sample->ds_class << 24 | sample->ds_index));
     if (sentry) {
-      sentry->interface = (sample->ds_class << 24 | sample->ds_index);
       sentry->sample_pool = sample->samplePool;
       sentry->seqno = sample->samplesGenerated; 
     }
@@ -623,6 +623,8 @@ void compose_json(u_int64_t wtc, u_int64_t wtc_2, u_int64_t wtc_3)
   }
 
   cjhandler[idx] = compose_json_counters;
+
+  compose_json_stream_template();
 }
 
 void compose_json_event_type(json_t *obj, struct chained_cache *null)
@@ -1488,6 +1490,30 @@ void *compose_purge_close_json(char *writer_name, pid_t writer_pid, int purged_e
 
   return obj;
 }
+
+/* P_encode_func for the brokers: thread-safe, all buffers are local */
+char *compose_json_acct_str(struct chained_cache *cc, void *writer_id_tokens)
+{
+  struct json_stream js;
+  json_t *json_obj;
+  int idx;
+
+  if (cjstream) {
+    json_stream_init(&js, JSON_STREAM_BUFLEN);
+    compose_json_stream_acct(&js, cc);
+    if (writer_id_tokens) compose_json_stream_writer_id(&js, writer_id_tokens);
+    json_stream_close(&js);
+
+    return json_stream_detach(&js);
+  }
+
+  json_obj = json_object();
+
+  for (idx = 0; idx < N_PRIMITIVES && cjhandler[idx]; idx++) cjhandler[idx](json_obj, cc);
+  if (writer_id_tokens) add_writer_name_and_pid_json(json_obj, writer_id_tokens);
+
+  return compose_json_str(json_obj);
+}
 #else
 void compose_json(u_int64_t wtc, u_int64_t wtc_2)
 {
@@ -1507,6 +1533,13 @@ void *compose_purge_close_json(char *writer_name, pid_t writer_pid, int purged_e
 
   return NULL;
 }
+
+char *compose_json_acct_str(struct chained_cache *cc, void *writer_id_tokens)
+{
+  if (config.debug) Log(LOG_DEBUG, "DEBUG ( %s/%s ): compose_json_acct_str(): JSON object not created due to missing --enable-jansson\n", config.name, config.type);
+
+  return NULL;
+}
 #endif
 
 void compose_json_map_label(json_t *obj, struct chained_cache *cc)
@@ -1987,3 +2020,706 @@ void compose_json_sav_fields(json_t *obj, struct chained_cache *cc)
     json_object_set_new_nocheck(obj, "sav_matched_rules", rules_array);
   }
 }
+
+/*
+   Streaming counterparts of the most common handlers: members are written
+   straight into a json_stream (see json_stream.h) with keys rendered at
+   compile time. Handlers lacking a streaming version are run against a
+   temporary object which is then dumped and spliced in, see
+   compose_json_stream_splice(); output is the same either way.
+*/
+struct compose_json_field cjfield[N_PRIMITIVES];
+int cjstream;
+
+static void compose_json_stream_timestamp(struct json_stream *js, const char *key, size_t keylen, struct timeval *tv, int usec)
+{
+  char tstamp_str[VERYSHORTBUFLEN];
+
+  compose_timestamp(tstamp_str, VERYSHORTBUFLEN, tv, usec,
+		    config.timestamps_since_epoch, config.timestamps_rfc9557,
+		    config.timestamps_utc);
+  json_stream_string(js, key, keylen, tstamp_str);
+}
+
+static void compose_json_stream_addr(struct json_stream *js, const char *key, size_t keylen, struct host_addr *addr)
+{
+  char ip_address[INET6_ADDRSTRLEN];
+
+  addr_to_str(ip_address, addr);
+  json_stream_string(js, key, keylen, ip_address);
+}
+
+static void compose_json_stream_mac(struct json_stream *js, const char *key, size_t keylen, u_char *addr)
+{
+  char mac[18];
+
+  etheraddr_string(addr, mac);
+  json_stream_string(js, key, keylen, mac);
+}
+
+/* BGP communities and AS-PATHs get spaces replaced, as their Jansson handlers do */
+static void compose_json_stream_vlen_str(struct json_stream *js, const char *key, size_t keylen, struct chained_cache *cc, pm_cfgreg_t type, int underscore)
+{
+  char *str_ptr = NULL, *space, empty_string[] = "";
+
+  vlen_prims_get(cc->pvlen, type, &str_ptr);
+  if (str_ptr) {
+    if (underscore) {
+      for (space = strchr(str_ptr, ' '); space; space = strchr(space, ' ')) *space = '_';
+    }
+  }
+  else str_ptr = empty_string;
+
+  json_stream_string(js, key, keylen, str_ptr);
+}
+
+static void compose_json_stream_uint_str(struct json_stream *js, const char *key, size_t keylen, u_int32_t value)
+{
+  char misc_str[JSON_STREAM_INTLEN];
+
+  json_stream_itoa(misc_str, value);
+  json_stream_string(js, key, keylen, misc_str);
+}
+
+static void compose_json_stream_event_type(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_string(js, JSON_STREAM_KEY("event_type"), "purge");
+}
+
+static void compose_json_stream_tag(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("tag"), (int64_t) cc->primitives.tag);
+}
+
+static void compose_json_stream_tag2(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("tag2"), (int64_t) cc->primitives.tag2);
+}
+
+static void compose_json_stream_label(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("label"), cc, COUNT_INT_LABEL, FALSE);
+}
+
+static void compose_json_stream_class(struct json_stream *js, struct chained_cache *cc)
+{
+  struct pkt_primitives *pbase = &cc->primitives;
+
+  json_stream_string(js, JSON_STREAM_KEY("class"), ((pbase->class && class[(pbase->class)-1].id) ? class[(pbase->class)-1].protocol : "unknown"));
+}
+
+#if defined (HAVE_L2)
+static void compose_json_stream_src_mac(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_mac(js, JSON_STREAM_KEY("mac_src"), cc->primitives.eth_shost);
+}
+
+static void compose_json_stream_dst_mac(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_mac(js, JSON_STREAM_KEY("mac_dst"), cc->primitives.eth_dhost);
+}
+
+static void compose_json_stream_vlan(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("vlan"), (int64_t) cc->primitives.vlan_id);
+}
+
+static void compose_json_stream_in_vlan(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("vlan_in"), (int64_t) cc->primitives.vlan_id);
+}
+
+static void compose_json_stream_out_vlan(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("vlan_out"), (int64_t) cc->primitives.out_vlan_id);
+}
+
+static void compose_json_stream_in_cvlan(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("cvlan_in"), (int64_t) cc->ptun->cvlan_id);
+}
+
+static void compose_json_stream_out_cvlan(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("cvlan_out"), (int64_t) cc->ptun->out_cvlan_id);
+}
+
+static void compose_json_stream_cos(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("cos"), (int64_t) cc->primitives.cos);
+}
+
+static void compose_json_stream_etype(struct json_stream *js, struct chained_cache *cc)
+{
+  char misc_str[VERYSHORTBUFLEN];
+
+  sprintf(misc_str, "%x", cc->primitives.etype);
+  json_stream_string(js, JSON_STREAM_KEY("etype"), misc_str);
+}
+#endif
+
+static void compose_json_stream_src_as(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("as_src"), (int64_t) cc->primitives.src_as);
+}
+
+static void compose_json_stream_dst_as(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("as_dst"), (int64_t) cc->primitives.dst_as);
+}
+
+static void compose_json_stream_std_comm(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("comms"), cc, COUNT_INT_STD_COMM, TRUE);
+}
+
+static void compose_json_stream_ext_comm(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("ecomms"), cc, COUNT_INT_EXT_COMM, TRUE);
+}
+
+static void compose_json_stream_lrg_comm(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("lcomms"), cc, COUNT_INT_LRG_COMM, TRUE);
+}
+
+static void compose_json_stream_as_path(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("as_path"), cc, COUNT_INT_AS_PATH, TRUE);
+}
+
+static void compose_json_stream_local_pref(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("local_pref"), (int64_t) cc->pbgp->local_pref);
+}
+
+static void compose_json_stream_med(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("med"), (int64_t) cc->pbgp->med);
+}
+
+static void compose_json_stream_peer_src_as(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("peer_as_src"), (int64_t) cc->pbgp->peer_src_as);
+}
+
+static void compose_json_stream_peer_dst_as(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("peer_as_dst"), (int64_t) cc->pbgp->peer_dst_as);
+}
+
+static void compose_json_stream_peer_src_ip(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("peer_ip_src"), &cc->pbgp->peer_src_ip);
+}
+
+static void compose_json_stream_peer_dst_ip(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("peer_ip_dst"), &cc->pbgp->peer_dst_ip);
+}
+
+static void compose_json_stream_src_std_comm(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("comms_src"), cc, COUNT_INT_SRC_STD_COMM, TRUE);
+}
+
+static void compose_json_stream_src_ext_comm(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("ecomms_src"), cc, COUNT_INT_SRC_EXT_COMM, TRUE);
+}
+
+static void compose_json_stream_src_lrg_comm(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("lcomms_src"), cc, COUNT_INT_SRC_LRG_COMM, TRUE);
+}
+
+static void compose_json_stream_src_as_path(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_vlen_str(js, JSON_STREAM_KEY("as_path_src"), cc, COUNT_INT_SRC_AS_PATH, TRUE);
+}
+
+static void compose_json_stream_src_local_pref(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("local_pref_src"), (int64_t) cc->pbgp->src_local_pref);
+}
+
+static void compose_json_stream_src_med(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("med_src"), (int64_t) cc->pbgp->src_med);
+}
+
+static void compose_json_stream_in_iface(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("iface_in"), (int64_t) cc->primitives.ifindex_in);
+}
+
+static void compose_json_stream_out_iface(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("iface_out"), (int64_t) cc->primitives.ifindex_out);
+}
+
+static void compose_json_stream_mpls_pw_id(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("mpls_pw_id"), (int64_t) cc->pbgp->mpls_pw_id);
+}
+
+static void compose_json_stream_src_host(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("ip_src"), &cc->primitives.src_ip);
+}
+
+static void compose_json_stream_src_net(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("net_src"), &cc->primitives.src_net);
+}
+
+static void compose_json_stream_dst_host(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("ip_dst"), &cc->primitives.dst_ip);
+}
+
+static void compose_json_stream_dst_net(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("net_dst"), &cc->primitives.dst_net);
+}
+
+static void compose_json_stream_src_mask(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("mask_src"), (int64_t) cc->primitives.src_nmask);
+}
+
+static void compose_json_stream_dst_mask(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("mask_dst"), (int64_t) cc->primitives.dst_nmask);
+}
+
+static void compose_json_stream_src_port(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("port_src"), (int64_t) cc->primitives.src_port);
+}
+
+static void compose_json_stream_dst_port(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("port_dst"), (int64_t) cc->primitives.dst_port);
+}
+
+static void compose_json_stream_tcp_flags(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_uint_str(js, JSON_STREAM_KEY("tcp_flags"), cc->tcp_flags);
+}
+
+static void compose_json_stream_fwd_status(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_uint_str(js, JSON_STREAM_KEY("fwd_status"), cc->pnat->fwd_status);
+}
+
+static void compose_json_stream_proto(struct json_stream *js, struct chained_cache *cc)
+{
+  char proto[PROTO_NUM_STRLEN];
+
+  json_stream_string(js, JSON_STREAM_KEY("ip_proto"), ip_proto_print(cc->primitives.proto, proto, PROTO_NUM_STRLEN));
+}
+
+static void compose_json_stream_tos(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("tos"), (int64_t) cc->primitives.tos);
+}
+
+static void compose_json_stream_flow_label(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("flow_label"), (int64_t) cc->primitives.flow_label);
+}
+
+static void compose_json_stream_sampling_rate(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("sampling_rate"), (int64_t) cc->primitives.sampling_rate);
+}
+
+static void compose_json_stream_sampling_direction(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_string(js, JSON_STREAM_KEY("sampling_direction"), sampling_direction_print(cc->primitives.sampling_direction));
+}
+
+static void compose_json_stream_post_nat_src_host(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("post_nat_ip_src"), &cc->pnat->post_nat_src_ip);
+}
+
+static void compose_json_stream_post_nat_dst_host(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("post_nat_ip_dst"), &cc->pnat->post_nat_dst_ip);
+}
+
+static void compose_json_stream_post_nat_src_port(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("post_nat_port_src"), (int64_t) cc->pnat->post_nat_src_port);
+}
+
+static void compose_json_stream_post_nat_dst_port(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("post_nat_port_dst"), (int64_t) cc->pnat->post_nat_dst_port);
+}
+
+static void compose_json_stream_nat_event(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("nat_event"), (int64_t) cc->pnat->nat_event);
+}
+
+static void compose_json_stream_fw_event(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("fw_event"), (int64_t) cc->pnat->fw_event);
+}
+
+static void compose_json_stream_mpls_label_top(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("mpls_label_top"), (int64_t) cc->pmpls->mpls_label_top);
+}
+
+static void compose_json_stream_mpls_label_bottom(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("mpls_label_bottom"), (int64_t) cc->pmpls->mpls_label_bottom);
+}
+
+static void compose_json_stream_tunnel_src_mac(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_mac(js, JSON_STREAM_KEY("tunnel_mac_src"), cc->ptun->tunnel_eth_shost);
+}
+
+static void compose_json_stream_tunnel_dst_mac(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_mac(js, JSON_STREAM_KEY("tunnel_mac_dst"), cc->ptun->tunnel_eth_dhost);
+}
+
+static void compose_json_stream_tunnel_src_host(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("tunnel_ip_src"), &cc->ptun->tunnel_src_ip);
+}
+
+static void compose_json_stream_tunnel_dst_host(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_addr(js, JSON_STREAM_KEY("tunnel_ip_dst"), &cc->ptun->tunnel_dst_ip);
+}
+
+static void compose_json_stream_tunnel_proto(struct json_stream *js, struct chained_cache *cc)
+{
+  char proto[PROTO_NUM_STRLEN];
+
+  json_stream_string(js, JSON_STREAM_KEY("tunnel_ip_proto"), ip_proto_print(cc->ptun->tunnel_proto, proto, PROTO_NUM_STRLEN));
+}
+
+static void compose_json_stream_tunnel_tos(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("tunnel_tos"), (int64_t) cc->ptun->tunnel_tos);
+}
+
+static void compose_json_stream_tunnel_flow_label(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("tunnel_flow_label"), (int64_t) cc->ptun->tunnel_flow_label);
+}
+
+static void compose_json_stream_tunnel_src_port(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("tunnel_port_src"), (int64_t) cc->ptun->tunnel_src_port);
+}
+
+static void compose_json_stream_tunnel_dst_port(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("tunnel_port_dst"), (int64_t) cc->ptun->tunnel_dst_port);
+}
+
+static void compose_json_stream_tunnel_tcp_flags(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_uint_str(js, JSON_STREAM_KEY("tunnel_tcp_flags"), cc->tunnel_tcp_flags);
+}
+
+static void compose_json_stream_vxlan(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("vxlan"), (int64_t) cc->ptun->tunnel_id);
+}
+
+static void compose_json_stream_nvgre(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("nvgre"), (int64_t) cc->ptun->nvgre_tunnel_id);
+}
+
+static void compose_json_stream_timestamp_start(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_timestamp(js, JSON_STREAM_KEY("timestamp_start"), &cc->pnat->timestamp_start, TRUE);
+}
+
+static void compose_json_stream_timestamp_end(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_timestamp(js, JSON_STREAM_KEY("timestamp_end"), &cc->pnat->timestamp_end, TRUE);
+}
+
+static void compose_json_stream_timestamp_arrival(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_timestamp(js, JSON_STREAM_KEY("timestamp_arrival"), &cc->pnat->timestamp_arrival, TRUE);
+}
+
+static void compose_json_stream_timestamp_export(struct json_stream *js, struct chained_cache *cc)
+{
+  compose_json_stream_timestamp(js, JSON_STREAM_KEY("timestamp_export"), &cc->pnat->timestamp_export, TRUE);
+}
+
+static void compose_json_stream_export_proto_seqno(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("export_proto_seqno"), (int64_t) cc->primitives.export_proto_seqno);
+}
+
+static void compose_json_stream_export_proto_version(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("export_proto_version"), (int64_t) cc->primitives.export_proto_version);
+}
+
+static void compose_json_stream_export_proto_sysid(struct json_stream *js, struct chained_cache *cc)
+{
+  json_stream_int(js, JSON_STREAM_KEY("export_proto_sysid"), (int64_t) cc->primitives.export_proto_sysid);
+}
+
+static void compose_json_stream_history(struct json_stream *js, struct chained_cache *cc)
+{
+  if (cc->basetime.tv_sec) {
+    struct timeval tv;
+
+    tv.tv_sec = cc->basetime.tv_sec;
+    tv.tv_usec = 0;
+    compose_json_stream_timestamp(js, JSON_STREAM_KEY("stamp_inserted"), &tv, FALSE);
+
+    tv.tv_sec = time(NULL);
+    tv.tv_usec = 0;
+    compose_json_stream_timestamp(js, JSON_STREAM_KEY("stamp_updated"), &tv, FALSE);
+  }
+}
+
+static void compose_json_stream_flows(struct json_stream *js, struct chained_cache *cc)
+{
+  if (cc->flow_type != NF9_FTYPE_EVENT && cc->flow_type != NF9_FTYPE_OPTION)
+    json_stream_int(js, JSON_STREAM_KEY("flows"), (int64_t) cc->flow_counter);
+}
+
+static void compose_json_stream_counters(struct json_stream *js, struct chained_cache *cc)
+{
+  if (cc->flow_type != NF9_FTYPE_EVENT && cc->flow_type != NF9_FTYPE_OPTION) {
+    json_stream_int(js, JSON_STREAM_KEY("packets"), (int64_t) cc->packet_counter);
+    json_stream_int(js, JSON_STREAM_KEY("bytes"), (int64_t) cc->bytes_counter);
+  }
+}
+
+static const struct compose_json_stream_map {
+  compose_json_handler handler;
+  compose_json_stream_handler stream;
+} cjstream_map[] = {
+  { compose_json_event_type, compose_json_stream_event_type },
+  { compose_json_tag, compose_json_stream_tag },
+  { compose_json_tag2, compose_json_stream_tag2 },
+  { compose_json_label, compose_json_stream_label },
+  { compose_json_class, compose_json_stream_class },
+#if defined (HAVE_L2)
+  { compose_json_src_mac, compose_json_stream_src_mac },
+  { compose_json_dst_mac, compose_json_stream_dst_mac },
+  { compose_json_vlan, compose_json_stream_vlan },
+  { compose_json_in_vlan, compose_json_stream_in_vlan },
+  { compose_json_out_vlan, compose_json_stream_out_vlan },
+  { compose_json_in_cvlan, compose_json_stream_in_cvlan },
+  { compose_json_out_cvlan, compose_json_stream_out_cvlan },
+  { compose_json_cos, compose_json_stream_cos },
+  { compose_json_etype, compose_json_stream_etype },
+#endif
+  { compose_json_src_as, compose_json_stream_src_as },
+  { compose_json_dst_as, compose_json_stream_dst_as },
+  { compose_json_std_comm, compose_json_stream_std_comm },
+  { compose_json_ext_comm, compose_json_stream_ext_comm },
+  { compose_json_lrg_comm, compose_json_stream_lrg_comm },
+  { compose_json_as_path, compose_json_stream_as_path },
+  { compose_json_local_pref, compose_json_stream_local_pref },
+  { compose_json_med, compose_json_stream_med },
+  { compose_json_peer_src_as, compose_json_stream_peer_src_as },
+  { compose_json_peer_dst_as, compose_json_stream_peer_dst_as },
+  { compose_json_peer_src_ip, compose_json_stream_peer_src_ip },
+  { compose_json_peer_dst_ip, compose_json_stream_peer_dst_ip },
+  { compose_json_src_std_comm, compose_json_stream_src_std_comm },
+  { compose_json_src_ext_comm, compose_json_stream_src_ext_comm },
+  { compose_json_src_lrg_comm, compose_json_stream_src_lrg_comm },
+  { compose_json_src_as_path, compose_json_stream_src_as_path },
+  { compose_json_src_local_pref, compose_json_stream_src_local_pref },
+  { compose_json_src_med, compose_json_stream_src_med },
+  { compose_json_in_iface, compose_json_stream_in_iface },
+  { compose_json_out_iface, compose_json_stream_out_iface },
+  { compose_json_mpls_pw_id, compose_json_stream_mpls_pw_id },
+  { compose_json_src_host, compose_json_stream_src_host },
+  { compose_json_src_net, compose_json_stream_src_net },
+  { compose_json_dst_host, compose_json_stream_dst_host },
+  { compose_json_dst_net, compose_json_stream_dst_net },
+  { compose_json_src_mask, compose_json_stream_src_mask },
+  { compose_json_dst_mask, compose_json_stream_dst_mask },
+  { compose_json_src_port, compose_json_stream_src_port },
+  { compose_json_dst_port, compose_json_stream_dst_port },
+  { compose_json_tcp_flags, compose_json_stream_tcp_flags },
+  { compose_json_fwd_status, compose_json_stream_fwd_status },
+  { compose_json_proto, compose_json_stream_proto },
+  { compose_json_tos, compose_json_stream_tos },
+  { compose_json_flow_label, compose_json_stream_flow_label },
+  { compose_json_sampling_rate, compose_json_stream_sampling_rate },
+  { compose_json_sampling_direction, compose_json_stream_sampling_direction },
+  { compose_json_post_nat_src_host, compose_json_stream_post_nat_src_host },
+  { compose_json_post_nat_dst_host, compose_json_stream_post_nat_dst_host },
+  { compose_json_post_nat_src_port, compose_json_stream_post_nat_src_port },
+  { compose_json_post_nat_dst_port, compose_json_stream_post_nat_dst_port },
+  { compose_json_nat_event, compose_json_stream_nat_event },
+  { compose_json_fw_event, compose_json_stream_fw_event },
+  { compose_json_mpls_label_top, compose_json_stream_mpls_label_top },
+  { compose_json_mpls_label_bottom, compose_json_stream_mpls_label_bottom },
+  { compose_json_tunnel_src_mac, compose_json_stream_tunnel_src_mac },
+  { compose_json_tunnel_dst_mac, compose_json_stream_tunnel_dst_mac },
+  { compose_json_tunnel_src_host, compose_json_stream_tunnel_src_host },
+  { compose_json_tunnel_dst_host, compose_json_stream_tunnel_dst_host },
+  { compose_json_tunnel_proto, compose_json_stream_tunnel_proto },
+  { compose_json_tunnel_tos, compose_json_stream_tunnel_tos },
+  { compose_json_tunnel_flow_label, compose_json_stream_tunnel_flow_label },
+  { compose_json_tunnel_src_port, compose_json_stream_tunnel_src_port },
+  { compose_json_tunnel_dst_port, compose_json_stream_tunnel_dst_port },
+  { compose_json_tunnel_tcp_flags, compose_json_stream_tunnel_tcp_flags },
+  { compose_json_vxlan, compose_json_stream_vxlan },
+  { compose_json_nvgre, compose_json_stream_nvgre },
+  { compose_json_timestamp_start, compose_json_stream_timestamp_start },
+  { compose_json_timestamp_end, compose_json_stream_timestamp_end },
+  { compose_json_timestamp_arrival, compose_json_stream_timestamp_arrival },
+  { compose_json_timestamp_export, compose_json_stream_timestamp_export },
+  { compose_json_export_proto_seqno, compose_json_stream_export_proto_seqno },
+  { compose_json_export_proto_version, compose_json_stream_export_proto_version },
+  { compose_json_export_proto_sysid, compose_json_stream_export_proto_sysid },
+  { compose_json_history, compose_json_stream_history },
+  { compose_json_flows, compose_json_stream_flows },
+  { compose_json_counters, compose_json_stream_counters },
+  { NULL, NULL }
+};
+
+/*
+   Jansson replaces the value of a key set twice while keeping its position,
+   a stream cannot do that. Custom primitives are the only handler setting
+   keys not known in advance: keys of the builtin handlers are collected by
+   running them against a blank entry and compared to the custom names.
+*/
+static int compose_json_stream_dup_custom_keys()
+{
+  struct chained_cache dummy;
+  struct pkt_bgp_primitives dummy_pbgp;
+  struct pkt_nat_primitives dummy_pnat;
+  struct pkt_mpls_primitives dummy_pmpls;
+  struct pkt_tunnel_primitives dummy_ptun;
+  struct pkt_stitching dummy_stitch;
+  json_t *json_obj;
+  int idx, cp_idx, dup = FALSE;
+
+  memset(&dummy, 0, sizeof(dummy));
+  memset(&dummy_pbgp, 0, sizeof(dummy_pbgp));
+  memset(&dummy_pnat, 0, sizeof(dummy_pnat));
+  memset(&dummy_pmpls, 0, sizeof(dummy_pmpls));
+  memset(&dummy_ptun, 0, sizeof(dummy_ptun));
+  memset(&dummy_stitch, 0, sizeof(dummy_stitch));
+
+  dummy.pbgp = &dummy_pbgp;
+  dummy.pnat = &dummy_pnat;
+  dummy.pmpls = &dummy_pmpls;
+  dummy.ptun = &dummy_ptun;
+  dummy.stitch = &dummy_stitch;
+
+  json_obj = json_object();
+
+  for (idx = 0; idx < N_PRIMITIVES && cjhandler[idx]; idx++) {
+    if (cjhandler[idx] == compose_json_custom_primitives) continue;
+#if defined (WITH_NDPI)
+    /* relies on the nDPI workflow being set up */
+    if (cjhandler[idx] == compose_json_ndpi_class) {
+      json_object_set_new_nocheck(json_obj, "class", json_string(""));
+      continue;
+    }
+#endif
+
+    cjhandler[idx](json_obj, &dummy);
+  }
+
+  for (cp_idx = 0; cp_idx < config.cpptrs.num; cp_idx++) {
+    if (json_object_get(json_obj, config.cpptrs.primitive[cp_idx].name)) dup = TRUE;
+  }
+
+  json_decref(json_obj);
+
+  return dup;
+}
+
+/* builds the streaming template out of cjhandler[]; called upon compose_json() */
+void compose_json_stream_template()
+{
+  int idx, map_idx, class_handlers = 0;
+
+  memset(&cjfield, 0, sizeof(cjfield));
+  cjstream = TRUE;
+
+  for (idx = 0; idx < N_PRIMITIVES && cjhandler[idx]; idx++) {
+    cjfield[idx].handler = cjhandler[idx];
+
+    for (map_idx = 0; cjstream_map[map_idx].handler; map_idx++) {
+      if (cjstream_map[map_idx].handler == cjhandler[idx]) {
+	cjfield[idx].stream = cjstream_map[map_idx].stream;
+	break;
+      }
+    }
+
+    if (cjhandler[idx] == compose_json_class) class_handlers++;
+#if defined (WITH_NDPI)
+    if (cjhandler[idx] == compose_json_ndpi_class) class_handlers++;
+#endif
+  }
+
+  /* both classifiers write 'class' */
+  if (class_handlers > 1) cjstream = FALSE;
+  else if (config.cpptrs.num && compose_json_stream_dup_custom_keys()) cjstream = FALSE;
+
+  if (!cjstream) Log(LOG_INFO, "INFO ( %s/%s ): JSON: duplicate keys, streaming encoder disabled.\n", config.name, config.type);
+}
+
+/* runs a Jansson handler on its own and splices its members into the stream */
+void compose_json_stream_splice(struct json_stream *js, compose_json_handler handler, struct chained_cache *cc)
+{
+  json_t *json_obj = json_object();
+  char *json_str;
+  size_t len;
+
+  handler(json_obj, cc);
+
+  json_str = json_dumps(json_obj, JSON_PRESERVE_ORDER);
+  json_decref(json_obj);
+
+  if (json_str) {
+    len = strlen(json_str);
+
+    /* strip the enclosing braces */
+    if (len > 2) json_stream_members(js, (json_str + 1), (len - 2));
+
+    free(json_str);
+  }
+}
+
+/* opens an object and writes the configured primitives; caller is to close it */
+void compose_json_stream_acct(struct json_stream *js, struct chained_cache *cc)
+{
+  int idx;
+
+  json_stream_open(js);
+
+  for (idx = 0; idx < N_PRIMITIVES && cjfield[idx].handler; idx++) {
+    if (cjfield[idx].stream) cjfield[idx].stream(js, cc);
+    else compose_json_stream_splice(js, cjfield[idx].handler, cc);
+  }
+}
+
+void compose_json_stream_writer_id(struct json_stream *js, struct dynname_tokens *tokens)
+{
+  char wid[SHORTSHORTBUFLEN];
+
+  memset(wid, 0, sizeof(wid));
+  dynname_tokens_compose(wid, sizeof(wid), tokens, NULL);
+  json_stream_string(js, JSON_STREAM_KEY("writer_id"), wid);
+}
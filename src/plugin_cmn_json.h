@@ -24,13 +24,23 @@
 
 /* typedefs */
 #include "preprocess.h"
+#include "json_stream.h"
 #ifdef WITH_JANSSON
 typedef void (*compose_json_handler)(json_t *, struct chained_cache *);
+typedef void (*compose_json_stream_handler)(struct json_stream *, struct chained_cache *);
+
+/* structures */
+struct compose_json_field {
+  compose_json_handler handler;
+  compose_json_stream_handler stream;	/* NULL: handler output is spliced in */
+};
 #endif
 
 #ifdef WITH_JANSSON
 /* global vars */
 extern compose_json_handler cjhandler[N_PRIMITIVES];
+extern struct compose_json_field cjfield[N_PRIMITIVES];
+extern int cjstream;
 
 /* prototypes */
 extern void compose_json_map_label(json_t *, struct chained_cache *);
@@ -162,8 +172,14 @@ extern void compose_json_egress_vrf_name(json_t *, struct chained_cache *);
 extern void compose_json_in_iface_name(json_t *, struct chained_cache *);
 extern void compose_json_out_iface_name(json_t *, struct chained_cache *);
 
+extern void compose_json_stream_template();
+extern void compose_json_stream_splice(struct json_stream *, compose_json_handler, struct chained_cache *);
+extern void compose_json_stream_acct(struct json_stream *, struct chained_cache *);
+extern void compose_json_stream_writer_id(struct json_stream *, struct dynname_tokens *);
+
 #endif
 extern void compose_json(u_int64_t, u_int64_t, u_int64_t);
 extern void *compose_purge_init_json(char *, pid_t);
 extern void *compose_purge_close_json(char *, pid_t, int, int, int);
+extern char *compose_json_acct_str(struct chained_cache *, void *);
 #endif //PLUGIN_CMN_JSON_H
@@ -26,14 +26,17 @@
 #include "plugin_hooks.h"
 #include "ip_flow.h"
 #include "classifier.h"
-#include "crc32.h"
+#include "cache_hash.h"
 #include "preprocess-internal.h"
+#include "thread_pool.h"
 
 /* Global variables */
 void (*insert_func)(struct primitives_ptrs *, struct insert_data *); /* pointer to INSERT function */
 void (*purge_func)(struct chained_cache *[], int, int); /* pointer to purge function */
 struct scratch_area sa;
-struct chained_cache *cache;
+struct cache_index P_cache_index;
+static struct chained_cache *P_cache_free_list;
+static u_int64_t P_cache_entries, P_cache_entries_max;
 struct chained_cache **queries_queue, **pending_queries_queue, *pqq_container;
 struct timeval flushtime;
 int qq_ptr, pqq_ptr, pp_size, pb_size, pn_size, pm_size, pt_size, pc_size;
@@ -46,6 +49,13 @@ int (*basetime_cmp)(struct timeval *, struct timeval *);
 struct timeval basetime, ibasetime, new_basetime;
 time_t timeslot;
 int dyn_table, dyn_table_time_only;
+thread_pool_t *P_writer_pool;
+static struct P_writer_job *P_writer_jobs;
+static u_int64_t P_writer_seq, P_writer_turn;
+static pthread_mutex_t P_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t P_writer_cond = PTHREAD_COND_INITIALIZER;
+thread_pool_t *P_encoder_pool;
+static pid_t P_encoder_pid;
 
 /* Functions */
 void P_set_signals()
@@ -98,30 +108,33 @@ void P_init_default_values()
   pc_size = config.cpptrs.len;
   dbc_size = sizeof(struct chained_cache);
 
+  /* same capacity as a base of print_cache_entries with an average depth of AVERAGE_CHAIN_LEN */
+  P_cache_entries_max = ((u_int64_t) config.print_cache_entries * (AVERAGE_CHAIN_LEN + 1));
+  P_cache_entries = 0;
+  P_cache_free_list = NULL;
   memset(&sa, 0, sizeof(struct scratch_area));
-  sa.num = config.print_cache_entries*AVERAGE_CHAIN_LEN;
-  sa.size = sa.num*dbc_size;
-
-  Log(LOG_INFO, "INFO ( %s/%s ): cache entries=%d base cache memory=%" PRIu64 " bytes\n", config.name, config.type,
-        config.print_cache_entries, ((config.print_cache_entries * dbc_size) + (2 * ((sa.num +
-        config.print_cache_entries) * sizeof(struct chained_cache *))) + sa.size));
-
-  cache = (struct chained_cache *) pm_malloc(config.print_cache_entries*dbc_size);
-  queries_queue = (struct chained_cache **) pm_malloc((sa.num+config.print_cache_entries)*sizeof(struct chained_cache *));
-  pending_queries_queue = (struct chained_cache **) pm_malloc((sa.num+config.print_cache_entries)*sizeof(struct chained_cache *));
-  sa.base = (unsigned char *) pm_malloc(sa.size);
-  sa.ptr = sa.base;
-  sa.next = NULL;
-
-  memset(cache, 0, config.print_cache_entries*sizeof(struct chained_cache));
-  memset(queries_queue, 0, (sa.num+config.print_cache_entries)*sizeof(struct chained_cache *));
-  memset(pending_queries_queue, 0, (sa.num+config.print_cache_entries)*sizeof(struct chained_cache *));
-  memset(sa.base, 0, sa.size);
+
+  if (cache_index_init(&P_cache_index, "cache", config.print_cache_entries) == ERR) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to allocate the cache index. Exiting ..\n", config.name, config.type);
+    exit_gracefully(1);
+  }
+
+  Log(LOG_INFO, "INFO ( %s/%s ): cache entries=%d max entries=%" PRIu64 " base cache memory=%" PRIu64 " bytes\n", config.name, config.type,
+        config.print_cache_entries, P_cache_entries_max, ((P_cache_index.cur.size * sizeof(struct cache_index_slot)) +
+	((2 + (2 * config.dump_writer_threads)) * P_cache_entries_max * sizeof(struct chained_cache *))));
+
+  queries_queue = (struct chained_cache **) pm_malloc(P_cache_entries_max*sizeof(struct chained_cache *));
+  pending_queries_queue = (struct chained_cache **) pm_malloc(P_cache_entries_max*sizeof(struct chained_cache *));
+
+  memset(queries_queue, 0, P_cache_entries_max*sizeof(struct chained_cache *));
+  memset(pending_queries_queue, 0, P_cache_entries_max*sizeof(struct chained_cache *));
   memset(&flushtime, 0, sizeof(flushtime));
   memset(empty_mem_area_256b, 0, sizeof(empty_mem_area_256b));
 
   /* handling purge preprocessor */
   set_preprocess_funcs(config.sql_preprocess, &prep, PREP_DICT_PRINT);
+
+  if (config.dump_writer_threads) P_writer_init();
 }
 
 void P_config_checks()
@@ -137,7 +150,7 @@ exit_lane:
   exit_gracefully(1);
 }
 
-unsigned int P_cache_modulo(struct primitives_ptrs *prim_ptrs)
+u_int32_t P_cache_hash(struct primitives_ptrs *prim_ptrs)
 {
   struct pkt_data *pdata = prim_ptrs->data;
   struct pkt_primitives *srcdst = &pdata->primitives;
@@ -147,98 +160,236 @@ unsigned int P_cache_modulo(struct primitives_ptrs *prim_ptrs)
   struct pkt_tunnel_primitives *ptun = prim_ptrs->ptun;
   u_char *pcust = prim_ptrs->pcust;
   struct pkt_vlen_hdr_primitives *pvlen = prim_ptrs->pvlen;
-  register unsigned int modulo;
+  register u_int32_t hash;
 
-  modulo = cache_crc32((unsigned char *)srcdst, pp_size);
-  if (pbgp) modulo ^= cache_crc32((unsigned char *)pbgp, pb_size);
-  if (pnat) modulo ^= cache_crc32((unsigned char *)pnat, pn_size);
-  if (pmpls) modulo ^= cache_crc32((unsigned char *)pmpls, pm_size);
-  if (ptun) modulo ^= cache_crc32((unsigned char *)ptun, pt_size);
-  if (pcust) modulo ^= cache_crc32((unsigned char *)pcust, pc_size);
-  if (pvlen) modulo ^= cache_crc32((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
+  hash = cache_hash_primitives(srcdst);
+  if (pbgp) hash ^= cache_hash((unsigned char *)pbgp, pb_size);
+  if (pnat) hash ^= cache_hash((unsigned char *)pnat, pn_size);
+  if (pmpls) hash ^= cache_hash((unsigned char *)pmpls, pm_size);
+  if (ptun) hash ^= cache_hash((unsigned char *)ptun, pt_size);
+  if (pcust) hash ^= cache_hash((unsigned char *)pcust, pc_size);
+  if (pvlen) hash ^= cache_hash((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
 
-  return modulo %= config.print_cache_entries;
+  return hash;
 }
 
-struct chained_cache *P_cache_search(struct primitives_ptrs *prim_ptrs)
+/*
+   Returns zero if the cache entry holds the key of the record; invoked by
+   the cache index for entries whose signature matches.
+*/
+static int P_cache_key_cmp(void *entry, void *key)
 {
-  struct pkt_data *pdata = prim_ptrs->data;
-  struct pkt_primitives *data = &pdata->primitives;
-  struct pkt_bgp_primitives *pbgp = prim_ptrs->pbgp;
-  struct pkt_nat_primitives *pnat = prim_ptrs->pnat;
-  struct pkt_mpls_primitives *pmpls = prim_ptrs->pmpls;
-  struct pkt_tunnel_primitives *ptun = prim_ptrs->ptun;
-  u_char *pcust = prim_ptrs->pcust;
-  struct pkt_vlen_hdr_primitives *pvlen = prim_ptrs->pvlen;
-  unsigned int modulo = P_cache_modulo(prim_ptrs);
-  struct chained_cache *cache_ptr = &cache[modulo];
-  int res_data = TRUE, res_bgp = TRUE, res_nat = TRUE, res_mpls = TRUE, res_tun = TRUE;
-  int res_time = TRUE, res_cust = TRUE, res_vlen = TRUE;
+  struct chained_cache *cache_ptr = entry;
+  struct primitives_ptrs *prim_ptrs = key;
+
+  if (memcmp(&cache_ptr->primitives, &prim_ptrs->data->primitives, sizeof(struct pkt_primitives))) return TRUE;
+  if (basetime_cmp && (*basetime_cmp)(&cache_ptr->basetime, &ibasetime)) return TRUE;
+
+  if (prim_ptrs->pbgp) {
+    if (!cache_ptr->pbgp || memcmp(cache_ptr->pbgp, prim_ptrs->pbgp, sizeof(struct pkt_bgp_primitives))) return TRUE;
+  }
+
+  if (prim_ptrs->pnat) {
+    if (!cache_ptr->pnat || memcmp(cache_ptr->pnat, prim_ptrs->pnat, sizeof(struct pkt_nat_primitives))) return TRUE;
+  }
+
+  if (prim_ptrs->pmpls) {
+    if (!cache_ptr->pmpls || memcmp(cache_ptr->pmpls, prim_ptrs->pmpls, sizeof(struct pkt_mpls_primitives))) return TRUE;
+  }
+
+  if (prim_ptrs->ptun) {
+    if (!cache_ptr->ptun || memcmp(cache_ptr->ptun, prim_ptrs->ptun, sizeof(struct pkt_tunnel_primitives))) return TRUE;
+  }
+
+  if (prim_ptrs->pcust) {
+    if (!cache_ptr->pcust || memcmp(cache_ptr->pcust, prim_ptrs->pcust, config.cpptrs.len)) return TRUE;
+  }
+
+  if (prim_ptrs->pvlen) {
+    if (!cache_ptr->pvlen || vlen_prims_cmp(cache_ptr->pvlen, prim_ptrs->pvlen)) return TRUE;
+  }
+
+  return FALSE;
+}
+
+/*
+   BGP, NAT, MPLS, tunnel and custom primitives of an entry are packed in
+   a single pextras area, laid out as per the extras carried by records
+   (which only depend on the aggregate): one allocation per entry, reused
+   as long as the layout does not change, instead of one per extra.
+*/
+int P_cache_extras_set(struct chained_cache *cache_ptr, struct primitives_ptrs *prim_ptrs)
+{
+  u_int32_t len = 0, off = 0;
+  u_int8_t map = 0;
+
+  if (prim_ptrs->pbgp) {
+    map |= PRINT_CACHE_EXTRAS_BGP;
+    len = PRINT_CACHE_EXTRAS_ALIGN(len + PbgpSz);
+  }
 
-  start:
-  res_data = memcmp(&cache_ptr->primitives, data, sizeof(struct pkt_primitives));
+  if (prim_ptrs->pnat) {
+    map |= PRINT_CACHE_EXTRAS_NAT;
+    len = PRINT_CACHE_EXTRAS_ALIGN(len + PnatSz);
+  }
+
+  if (prim_ptrs->pmpls) {
+    map |= PRINT_CACHE_EXTRAS_MPLS;
+    len = PRINT_CACHE_EXTRAS_ALIGN(len + PmplsSz);
+  }
+
+  if (prim_ptrs->ptun) {
+    map |= PRINT_CACHE_EXTRAS_TUN;
+    len = PRINT_CACHE_EXTRAS_ALIGN(len + PtunSz);
+  }
 
-  if (basetime_cmp) {
-    res_time = (*basetime_cmp)(&cache_ptr->basetime, &ibasetime);
+  if (prim_ptrs->pcust) {
+    map |= PRINT_CACHE_EXTRAS_CUST;
+    len += config.cpptrs.len;
   }
-  else res_time = FALSE;
 
-  if (pbgp) {
-    if (cache_ptr->pbgp) res_bgp = memcmp(cache_ptr->pbgp, pbgp, sizeof(struct pkt_bgp_primitives));
+  if (cache_ptr->pextras && cache_ptr->pextras_map != map) P_cache_extras_free(cache_ptr);
+  if (!map) return SUCCESS;
+
+  if (!cache_ptr->pextras) {
+    cache_ptr->pextras = malloc(len);
+    if (!cache_ptr->pextras) return ERR;
+
+    cache_ptr->pextras_map = map;
   }
-  else res_bgp = FALSE;
 
-  if (pnat) {
-    if (cache_ptr->pnat) res_nat = memcmp(cache_ptr->pnat, pnat, sizeof(struct pkt_nat_primitives));
+  if (prim_ptrs->pbgp) {
+    cache_ptr->pbgp = (struct pkt_bgp_primitives *) (cache_ptr->pextras + off);
+    memcpy(cache_ptr->pbgp, prim_ptrs->pbgp, PbgpSz);
+    off = PRINT_CACHE_EXTRAS_ALIGN(off + PbgpSz);
   }
-  else res_nat = FALSE;
+  else cache_ptr->pbgp = NULL;
 
-  if (pmpls) {
-    if (cache_ptr->pmpls) res_mpls = memcmp(cache_ptr->pmpls, pmpls, sizeof(struct pkt_mpls_primitives));
+  if (prim_ptrs->pnat) {
+    cache_ptr->pnat = (struct pkt_nat_primitives *) (cache_ptr->pextras + off);
+    memcpy(cache_ptr->pnat, prim_ptrs->pnat, PnatSz);
+    off = PRINT_CACHE_EXTRAS_ALIGN(off + PnatSz);
   }
-  else res_mpls = FALSE;
+  else cache_ptr->pnat = NULL;
 
-  if (ptun) {
-    if (cache_ptr->ptun) res_tun = memcmp(cache_ptr->ptun, ptun, sizeof(struct pkt_tunnel_primitives));
+  if (prim_ptrs->pmpls) {
+    cache_ptr->pmpls = (struct pkt_mpls_primitives *) (cache_ptr->pextras + off);
+    memcpy(cache_ptr->pmpls, prim_ptrs->pmpls, PmplsSz);
+    off = PRINT_CACHE_EXTRAS_ALIGN(off + PmplsSz);
   }
-  else res_tun = FALSE;
+  else cache_ptr->pmpls = NULL;
 
-  if (pcust) {
-    if (cache_ptr->pcust) res_cust = memcmp(cache_ptr->pcust, pcust, config.cpptrs.len);
+  if (prim_ptrs->ptun) {
+    cache_ptr->ptun = (struct pkt_tunnel_primitives *) (cache_ptr->pextras + off);
+    memcpy(cache_ptr->ptun, prim_ptrs->ptun, PtunSz);
+    off = PRINT_CACHE_EXTRAS_ALIGN(off + PtunSz);
   }
-  else res_cust = FALSE;
+  else cache_ptr->ptun = NULL;
 
-  if (pvlen) {
-    if (cache_ptr->pvlen) res_vlen = vlen_prims_cmp(cache_ptr->pvlen, pvlen);
+  if (prim_ptrs->pcust) {
+    cache_ptr->pcust = (cache_ptr->pextras + off);
+    memcpy(cache_ptr->pcust, prim_ptrs->pcust, config.cpptrs.len);
   }
-  else res_vlen = FALSE;
+  else cache_ptr->pcust = NULL;
+
+  return SUCCESS;
+}
+
+void P_cache_extras_free(struct chained_cache *cache_ptr)
+{
+  if (cache_ptr->pextras) free(cache_ptr->pextras);
+
+  P_cache_extras_detach(cache_ptr);
+}
+
+/* the pextras area was handed over to another entry */
+void P_cache_extras_detach(struct chained_cache *cache_ptr)
+{
+  cache_ptr->pextras = NULL;
+  cache_ptr->pextras_map = 0;
+  cache_ptr->pbgp = NULL;
+  cache_ptr->pnat = NULL;
+  cache_ptr->pmpls = NULL;
+  cache_ptr->ptun = NULL;
+  cache_ptr->pcust = NULL;
+}
 
-  if (res_data || res_bgp || res_nat || res_mpls || res_tun || res_time || res_cust || res_vlen) {
-    if (cache_ptr->valid == PRINT_CACHE_INUSE) {
-      if (cache_ptr->next) {
-        cache_ptr = cache_ptr->next;
-        goto start;
+/*
+   Cache entries are carved out of chunks allocated on demand and recycled
+   through a free list once purged: they are never moved, hence pointers
+   held by the cache index and the queries queues stay valid until flush.
+*/
+struct chained_cache *P_cache_entry_alloc()
+{
+  struct chained_cache *cache_ptr;
+
+  /* entries purged by the writer threads are given back lazily */
+  if (!P_cache_free_list && P_writer_pool && P_cache_entries >= P_cache_entries_max) P_writer_collect(FALSE);
+
+  if (P_cache_free_list) {
+    cache_ptr = P_cache_free_list;
+    P_cache_free_list = cache_ptr->next;
+    cache_ptr->next = NULL;
+
+    return cache_ptr;
+  }
+
+  if (P_cache_entries >= P_cache_entries_max) return NULL;
+
+  if (!sa.base || (sa.ptr + dbc_size) > (sa.base + sa.size)) {
+    struct scratch_area *chunk = NULL;
+
+    if (sa.base) {
+      chunk = malloc(sizeof(struct scratch_area));
+      if (!chunk) return NULL;
+
+      memcpy(chunk, &sa, sizeof(struct scratch_area));
+    }
+
+    sa.num = MIN(PRINT_CACHE_CHUNK_ENTRIES, (P_cache_entries_max - P_cache_entries));
+    sa.size = (sa.num * dbc_size);
+    sa.base = calloc(sa.num, dbc_size);
+
+    if (!sa.base) {
+      if (chunk) {
+        memcpy(&sa, chunk, sizeof(struct scratch_area));
+        free(chunk);
       }
+
+      return NULL;
     }
+
+    sa.ptr = sa.base;
+    sa.next = chunk;
   }
-  else return cache_ptr;
 
-  return NULL;
+  cache_ptr = (struct chained_cache *) sa.ptr;
+  sa.ptr += dbc_size;
+  P_cache_entries++;
+
+  return cache_ptr;
+}
+
+/* entries keep their extras areas, to be reused by the next key */
+void P_cache_entry_release(struct chained_cache *cache_ptr)
+{
+  cache_ptr->valid = PRINT_CACHE_FREE;
+  cache_ptr->next = P_cache_free_list;
+  P_cache_free_list = cache_ptr;
+}
+
+struct chained_cache *P_cache_search(struct primitives_ptrs *prim_ptrs)
+{
+  return cache_index_search(&P_cache_index, P_cache_hash(prim_ptrs), P_cache_key_cmp, prim_ptrs);
 }
 
 void P_cache_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata)
 {
   struct pkt_data *data = prim_ptrs->data;
-  struct pkt_bgp_primitives *pbgp = prim_ptrs->pbgp;
-  struct pkt_nat_primitives *pnat = prim_ptrs->pnat;
-  struct pkt_mpls_primitives *pmpls = prim_ptrs->pmpls;
-  struct pkt_tunnel_primitives *ptun = prim_ptrs->ptun;
-  u_char *pcust = prim_ptrs->pcust;
   struct pkt_vlen_hdr_primitives *pvlen = prim_ptrs->pvlen;
-  unsigned int modulo = P_cache_modulo(prim_ptrs);
-  struct chained_cache *cache_ptr = &cache[modulo];
+  u_int32_t signature = P_cache_hash(prim_ptrs);
+  struct chained_cache *cache_ptr;
   struct pkt_primitives *srcdst = &data->primitives;
-  int res_data, res_bgp, res_nat, res_mpls, res_tun, res_time, res_cust, res_vlen;
 
   /* pro_rating vars */
   int time_delta = 0, time_total = 0;
@@ -270,117 +421,18 @@ void P_cache_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata
     }
   }
 
-  start:
-  res_data = res_bgp = res_nat = res_mpls = res_tun = res_time = res_cust = res_vlen = TRUE;
-
-  res_data = memcmp(&cache_ptr->primitives, srcdst, sizeof(struct pkt_primitives));
-
-  if (basetime_cmp) {
-    res_time = (*basetime_cmp)(&cache_ptr->basetime, &ibasetime);
-  }
-  else res_time = FALSE;
-
-  if (pbgp) {
-    if (cache_ptr->pbgp) res_bgp = memcmp(cache_ptr->pbgp, pbgp, sizeof(struct pkt_bgp_primitives));
-  }
-  else res_bgp = FALSE;
-
-  if (pnat) {
-    if (cache_ptr->pnat) res_nat = memcmp(cache_ptr->pnat, pnat, sizeof(struct pkt_nat_primitives));
-  }
-  else res_nat = FALSE;
+  cache_ptr = cache_index_search(&P_cache_index, signature, P_cache_key_cmp, prim_ptrs);
 
-  if (pmpls) {
-    if (cache_ptr->pmpls) res_mpls = memcmp(cache_ptr->pmpls, pmpls, sizeof(struct pkt_mpls_primitives));
-  }
-  else res_mpls = FALSE;
-
-  if (ptun) {
-    if (cache_ptr->ptun) res_tun = memcmp(cache_ptr->ptun, ptun, sizeof(struct pkt_tunnel_primitives));
-  }
-  else res_tun = FALSE;
-
-  if (pcust) {
-    if (cache_ptr->pcust) res_cust = memcmp(cache_ptr->pcust, pcust, config.cpptrs.len);
-  }
-  else res_cust = FALSE;
-
-  if (pvlen) {
-    if (cache_ptr->pvlen) res_vlen = vlen_prims_cmp(cache_ptr->pvlen, pvlen);
-  }
-  else res_vlen = FALSE;
-
-  if (res_data || res_bgp || res_nat || res_mpls || res_tun || res_time || res_cust || res_vlen) {
-    /* aliasing of entries */
-    if (cache_ptr->valid == PRINT_CACHE_INUSE) {
-      if (cache_ptr->next) {
-        cache_ptr = cache_ptr->next;
-        goto start;
-      }
-      else {
-        cache_ptr = P_cache_attach_new_node(cache_ptr);
-        if (!cache_ptr) goto safe_action;
-        else {
-          queries_queue[qq_ptr] = cache_ptr;
-          qq_ptr++;
-        }
-      }
-    }
-    else {
-      queries_queue[qq_ptr] = cache_ptr;
-      qq_ptr++;
-    }
+  if (!cache_ptr) {
+    cache_ptr = P_cache_entry_alloc();
+    if (!cache_ptr) goto safe_action;
 
     /* we add the new entry in the cache */
     memcpy(&cache_ptr->primitives, srcdst, sizeof(struct pkt_primitives));
-    if (pbgp) {
-      if (!cache_ptr->pbgp) cache_ptr->pbgp = (struct pkt_bgp_primitives *) malloc(PbgpSz);
-      if (cache_ptr->pbgp) memcpy(cache_ptr->pbgp, pbgp, sizeof(struct pkt_bgp_primitives));
-      else goto safe_action;
-    }
-    else {
-      if (cache_ptr->pbgp) free(cache_ptr->pbgp);
-      cache_ptr->pbgp = NULL;
-    }
-
-    if (pnat) {
-      if (!cache_ptr->pnat) cache_ptr->pnat = (struct pkt_nat_primitives *) malloc(PnatSz);
-      if (cache_ptr->pnat) memcpy(cache_ptr->pnat, pnat, sizeof(struct pkt_nat_primitives));
-      else goto safe_action;
-    }
-    else {
-      if (cache_ptr->pnat) free(cache_ptr->pnat);
-      cache_ptr->pnat = NULL;
-    }
-
-    if (pmpls) {
-      if (!cache_ptr->pmpls) cache_ptr->pmpls = (struct pkt_mpls_primitives *) malloc(PmplsSz);
-      if (cache_ptr->pmpls) memcpy(cache_ptr->pmpls, pmpls, sizeof(struct pkt_mpls_primitives));
-      else goto safe_action;
-    }
-    else {
-      if (cache_ptr->pmpls) free(cache_ptr->pmpls);
-      cache_ptr->pmpls = NULL;
-    }
-
-    if (ptun) {
-      if (!cache_ptr->ptun) cache_ptr->ptun = (struct pkt_tunnel_primitives *) malloc(PtunSz);
-      if (cache_ptr->ptun) memcpy(cache_ptr->ptun, ptun, sizeof(struct pkt_tunnel_primitives));
-      else goto safe_action;
-    }
-    else {
-      if (cache_ptr->ptun) free(cache_ptr->ptun);
-      cache_ptr->ptun = NULL;
-    }
-
-    if (pcust) {
-      if (!cache_ptr->pcust) cache_ptr->pcust = malloc(config.cpptrs.len);
-      if (cache_ptr->pcust) memcpy(cache_ptr->pcust, pcust, config.cpptrs.len);
-      else goto safe_action;
-    }
-    else {
-      if (cache_ptr->pcust) free(cache_ptr->pcust);
-      cache_ptr->pcust = NULL;
+    cache_ptr->signature = signature;
+    if (P_cache_extras_set(cache_ptr, prim_ptrs) == ERR) {
+      P_cache_entry_release(cache_ptr);
+      goto safe_action;
     }
 
     /* if we have a pvlen from before let's free it
@@ -392,7 +444,10 @@ void P_cache_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata
 
     if (pvlen) {
       cache_ptr->pvlen = (struct pkt_vlen_hdr_primitives *) vlen_prims_copy(pvlen);
-      if (!cache_ptr->pvlen) goto safe_action;
+      if (!cache_ptr->pvlen) {
+        P_cache_entry_release(cache_ptr);
+        goto safe_action;
+      }
     }
 
     cache_ptr->packet_counter = data->pkt_num;
@@ -417,41 +472,28 @@ void P_cache_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata
     cache_ptr->valid = PRINT_CACHE_INUSE;
     cache_ptr->basetime.tv_sec = ibasetime.tv_sec;
     cache_ptr->basetime.tv_usec = ibasetime.tv_usec;
+
+    if (cache_index_insert(&P_cache_index, signature, cache_ptr) == ERR) {
+      P_cache_entry_release(cache_ptr);
+      goto safe_action;
+    }
+
+    queries_queue[qq_ptr] = cache_ptr;
+    qq_ptr++;
   }
   else {
-    if (cache_ptr->valid == PRINT_CACHE_INUSE) {
-      /* everything is ok; summing counters */
-      cache_ptr->packet_counter += data->pkt_num;
-      cache_ptr->flow_counter += data->flo_num;
-      cache_ptr->bytes_counter += data->pkt_len;
-      cache_ptr->flow_type = data->flow_type;
-      cache_ptr->tcp_flags |= data->tcp_flags;
-      cache_ptr->tunnel_tcp_flags |= data->tunnel_tcp_flags;
-
-      if (config.nfacctd_stitching) {
-        if (cache_ptr->stitch) {
-          P_update_stitch(cache_ptr, data, idata);
-        }
-      }
-    }
-    else {
-      /* entry invalidated; restarting counters */
-      cache_ptr->packet_counter = data->pkt_num;
-      cache_ptr->flow_counter = data->flo_num;
-      cache_ptr->bytes_counter = data->pkt_len;
-      cache_ptr->flow_type = data->flow_type;
-      cache_ptr->tcp_flags = data->tcp_flags;
-      cache_ptr->tunnel_tcp_flags = data->tunnel_tcp_flags;
-
-      if (config.nfacctd_stitching) {
-        P_set_stitch(cache_ptr, data, idata);
-      }
+    /* everything is ok; summing counters: purged entries leave the index */
+    cache_ptr->packet_counter += data->pkt_num;
+    cache_ptr->flow_counter += data->flo_num;
+    cache_ptr->bytes_counter += data->pkt_len;
+    cache_ptr->flow_type = data->flow_type;
+    cache_ptr->tcp_flags |= data->tcp_flags;
+    cache_ptr->tunnel_tcp_flags |= data->tunnel_tcp_flags;
 
-      cache_ptr->valid = PRINT_CACHE_INUSE;
-      cache_ptr->basetime.tv_sec = ibasetime.tv_sec;
-      cache_ptr->basetime.tv_usec = ibasetime.tv_usec;
-      queries_queue[qq_ptr] = cache_ptr;
-      qq_ptr++;
+    if (config.nfacctd_stitching) {
+      if (cache_ptr->stitch) {
+        P_update_stitch(cache_ptr, data, idata);
+      }
     }
   }
 
@@ -477,26 +519,30 @@ void P_cache_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata
     if (qq_ptr) P_cache_mark_flush(queries_queue, qq_ptr, FALSE);
 
     /* Writing out to replenish cache space */
-    dump_writers_count();
-    if (dump_writers_get_flags() != CHLD_ALERT) {
-      switch (ret = fork()) {
-      case 0: /* Child */
-        pm_setproctitle("%s %s [%s]", config.type, "Plugin -- Writer (urgent)", config.name);
-        config.is_forked = TRUE;
+    if (P_writer_pool) P_writer_purge(qq_ptr, TRUE);
+    else {
+      dump_writers_count();
+      if (dump_writers_get_flags() != CHLD_ALERT) {
+        switch (ret = fork()) {
+        case 0: /* Child */
+          pm_setproctitle("%s %s [%s]", config.type, "Plugin -- Writer (urgent)", config.name);
+          config.is_forked = TRUE;
 
-        (*purge_func)(queries_queue, qq_ptr, TRUE);
+          (*purge_func)(queries_queue, qq_ptr, TRUE);
 
-        exit_gracefully(0);
-      default: /* Parent */
-        if (ret == -1) Log(LOG_WARNING, "WARN ( %s/%s ): Unable to fork writer: %s\n", config.name, config.type, strerror(errno));
-        else dump_writers_add(ret);
+          exit_gracefully(0);
+        default: /* Parent */
+          if (ret == -1) Log(LOG_WARNING, "WARN ( %s/%s ): Unable to fork writer: %s\n", config.name, config.type, strerror(errno));
+          else dump_writers_add(ret);
 
-        break;
+          break;
+        }
       }
+      else Log(LOG_WARNING, "WARN ( %s/%s ): Maximum number of writer processes reached (%d).\n", config.name, config.type, dump_writers_get_active());
+
+      P_cache_flush(queries_queue, qq_ptr);
     }
-    else Log(LOG_WARNING, "WARN ( %s/%s ): Maximum number of writer processes reached (%d).\n", config.name, config.type, dump_writers_get_active());
 
-    P_cache_flush(queries_queue, qq_ptr);
     qq_ptr = FALSE;
     if (pqq_ptr) {
       P_cache_insert_pending(pending_queries_queue, pqq_ptr, pqq_container);
@@ -511,64 +557,39 @@ void P_cache_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata
 void P_cache_insert_pending(struct chained_cache *queue[], int index, struct chained_cache *container)
 {
   struct chained_cache *cache_ptr;
-  struct primitives_ptrs prim_ptrs;
-  struct pkt_data pdata;
-  unsigned int modulo, j;
+  unsigned int j;
 
   if (!index || !container) return;
 
   for (j = 0; j < index; j++) {
-    memset(&prim_ptrs, 0, sizeof(prim_ptrs));
-    prim_ptrs.data = &pdata;
-    primptrs_set_all_from_chained_cache(&prim_ptrs, queue[j]);
-
-    modulo = P_cache_modulo(&prim_ptrs);
-    cache_ptr = &cache[modulo];
-
-    start:
-    if (cache_ptr->valid == PRINT_CACHE_INUSE) {
-      if (cache_ptr->next) {
-        cache_ptr = cache_ptr->next;
-        goto start;
-      }
-      else {
-        cache_ptr = P_cache_attach_new_node(cache_ptr);
-        if (!cache_ptr) {
-          Log(LOG_WARNING, "WARN ( %s/%s ): Finished cache entries. Pending entries will be lost.\n", config.name, config.type);
-          Log(LOG_WARNING, "WARN ( %s/%s ): You may want to set a larger print_cache_entries value.\n", config.name, config.type);
-          break;
-        }
-        else {
-          queries_queue[qq_ptr] = cache_ptr;
-          qq_ptr++;
-        }
-      }
-    }
-    else {
-      queries_queue[qq_ptr] = cache_ptr;
-      qq_ptr++;
+    cache_ptr = P_cache_entry_alloc();
+    if (!cache_ptr) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): Finished cache entries. Pending entries will be lost.\n", config.name, config.type);
+      Log(LOG_WARNING, "WARN ( %s/%s ): You may want to set a larger print_cache_entries value.\n", config.name, config.type);
+      break;
     }
 
-    if (cache_ptr->pbgp) free(cache_ptr->pbgp);
-    if (cache_ptr->pnat) free(cache_ptr->pnat);
-    if (cache_ptr->pmpls) free(cache_ptr->pmpls);
-    if (cache_ptr->ptun) free(cache_ptr->ptun);
-    if (cache_ptr->pcust) free(cache_ptr->pcust);
+    P_cache_extras_free(cache_ptr);
     if (cache_ptr->pvlen) free(cache_ptr->pvlen);
     if (cache_ptr->stitch) free(cache_ptr->stitch);
 
-    memcpy(cache_ptr, &container[j], dbc_size);
+    memcpy(cache_ptr, queue[j], dbc_size);
 
-    container[j].pbgp = NULL;
-    container[j].pnat = NULL;
-    container[j].pmpls = NULL;
-    container[j].ptun = NULL;
-    container[j].pcust = NULL;
-    container[j].pvlen = NULL;
-    container[j].stitch = NULL;
+    P_cache_extras_detach(queue[j]);
+    queue[j]->pvlen = NULL;
+    queue[j]->stitch = NULL;
 
     cache_ptr->valid = PRINT_CACHE_INUSE;
     cache_ptr->next = NULL;
+
+    if (cache_index_insert(&P_cache_index, cache_ptr->signature, cache_ptr) == ERR) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): Unable to grow the cache index. Pending entries will be lost.\n", config.name, config.type);
+      P_cache_entry_release(cache_ptr);
+      break;
+    }
+
+    queries_queue[qq_ptr] = cache_ptr;
+    qq_ptr++;
   }
 
   free(container);
@@ -580,28 +601,32 @@ void P_cache_handle_flush_event(struct ports_table *pt, struct protos_table *prt
 
   if (qq_ptr) P_cache_mark_flush(queries_queue, qq_ptr, FALSE);
 
-  dump_writers_count();
-  if (dump_writers_get_flags() != CHLD_ALERT) {
-    switch (ret = fork()) {
-    case 0: /* Child */
-      pm_setproctitle("%s %s [%s]", config.type, "Plugin -- Writer", config.name);
-      config.is_forked = TRUE;
+  if (P_writer_pool) P_writer_purge(qq_ptr, FALSE);
+  else {
+    dump_writers_count();
+    if (dump_writers_get_flags() != CHLD_ALERT) {
+      switch (ret = fork()) {
+      case 0: /* Child */
+        pm_setproctitle("%s %s [%s]", config.type, "Plugin -- Writer", config.name);
+        config.is_forked = TRUE;
 
-      (*purge_func)(queries_queue, qq_ptr, FALSE);
+        (*purge_func)(queries_queue, qq_ptr, FALSE);
 
-      exit_gracefully(0);
-    default: /* Parent */
-      if (ret == -1) Log(LOG_WARNING, "WARN ( %s/%s ): Unable to fork writer: %s\n", config.name, config.type, strerror(errno));
-      else dump_writers_add(ret);
+        exit_gracefully(0);
+      default: /* Parent */
+        if (ret == -1) Log(LOG_WARNING, "WARN ( %s/%s ): Unable to fork writer: %s\n", config.name, config.type, strerror(errno));
+        else dump_writers_add(ret);
 
-      break;
+        break;
+      }
     }
-  }
-  else Log(LOG_WARNING, "WARN ( %s/%s ): Maximum number of writer processes reached (%d).\n", config.name, config.type, dump_writers_get_active());
+    else Log(LOG_WARNING, "WARN ( %s/%s ): Maximum number of writer processes reached (%d).\n", config.name, config.type, dump_writers_get_active());
 
-  P_cache_flush(queries_queue, qq_ptr);
+    P_cache_flush(queries_queue, qq_ptr);
+  }
 
   gettimeofday(&flushtime, NULL);
+  cache_index_print_stats(&P_cache_index, flushtime.tv_sec);
   refresh_deadline += config.sql_refresh_time;
   qq_ptr = FALSE;
   memset(&new_basetime, 0, sizeof(new_basetime));
@@ -626,6 +651,286 @@ void P_cache_handle_flush_event(struct ports_table *pt, struct protos_table *prt
   }
 }
 
+void P_writer_init()
+{
+  sigset_t signal_set, saved_set;
+  int idx;
+
+  /* signals are left to the plugin main thread: writers inherit a blocked mask */
+  sigfillset(&signal_set);
+  pthread_sigmask(SIG_BLOCK, &signal_set, &saved_set);
+  P_writer_pool = allocate_thread_pool(config.dump_writer_threads);
+  pthread_sigmask(SIG_SETMASK, &saved_set, NULL);
+
+  if (!P_writer_pool) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to start %d writer threads. Exiting.\n", config.name, config.type, config.dump_writer_threads);
+    exit_gracefully(1);
+  }
+
+  P_writer_jobs = (struct P_writer_job *) pm_malloc(config.dump_writer_threads * sizeof(struct P_writer_job));
+  memset(P_writer_jobs, 0, config.dump_writer_threads * sizeof(struct P_writer_job));
+
+  for (idx = 0; idx < config.dump_writer_threads; idx++) {
+    P_writer_jobs[idx].owned = (struct chained_cache **) pm_malloc(P_cache_entries_max * sizeof(struct chained_cache *));
+    P_writer_jobs[idx].queue = (struct chained_cache **) pm_malloc(P_cache_entries_max * sizeof(struct chained_cache *));
+  }
+
+  P_writer_seq = 0;
+  P_writer_turn = 0;
+
+  Log(LOG_INFO, "INFO ( %s/%s ): cache purges handed over to %d writer threads.\n", config.name, config.type, config.dump_writer_threads);
+}
+
+/*
+   Gives the entries of completed purges back to the cache. If 'wait' is
+   set, blocks until the oldest purge in flight is done. Returns the number
+   of purges reclaimed.
+*/
+int P_writer_collect(int wait)
+{
+  struct P_writer_job *job, *oldest = NULL;
+  int idx, j, ret = 0;
+
+  pthread_mutex_lock(&P_writer_mutex);
+
+  if (wait) {
+    for (idx = 0; idx < config.dump_writer_threads; idx++) {
+      job = &P_writer_jobs[idx];
+      if (job->busy && (!oldest || job->seq < oldest->seq)) oldest = job;
+    }
+
+    if (oldest) {
+      while (!oldest->done) pthread_cond_wait(&P_writer_cond, &P_writer_mutex);
+    }
+  }
+
+  for (idx = 0; idx < config.dump_writer_threads; idx++) {
+    job = &P_writer_jobs[idx];
+    if (!job->busy || !job->done) continue;
+
+    for (j = 0; j < job->num; j++) P_cache_entry_release(job->owned[j]);
+
+    job->num = 0;
+    job->busy = FALSE;
+    job->done = FALSE;
+    ret++;
+  }
+
+  pthread_mutex_unlock(&P_writer_mutex);
+
+  return ret;
+}
+
+/* blocks until every purge handed over to the writer threads is done */
+void P_writer_wait()
+{
+  while (P_writer_collect(TRUE));
+}
+
+/*
+   Thread counterpart of fork()'ing a writer. Committed entries are not
+   copied: they leave the cache index and are owned by the writer until
+   the purge is done, then P_writer_collect() recycles them. The queries
+   queue itself is double-buffered: the plugin swaps in the spare queue of
+   the job and carries on filling the cache right away.
+*/
+void P_writer_purge(int index, int safe_action)
+{
+  struct P_writer_job *job = NULL;
+  struct chained_cache **swap;
+  int idx, j, num;
+
+  P_writer_collect(FALSE);
+
+  for (idx = 0; !job && idx < config.dump_writer_threads; idx++) {
+    if (!P_writer_jobs[idx].busy) job = &P_writer_jobs[idx];
+  }
+
+  if (!job) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): All writer threads still purging previous caches. Waiting ..\n", config.name, config.type);
+    P_writer_collect(TRUE);
+
+    for (idx = 0; !job && idx < config.dump_writer_threads; idx++) {
+      if (!P_writer_jobs[idx].busy) job = &P_writer_jobs[idx];
+    }
+  }
+
+  for (j = 0, num = 0; j < index; j++) {
+    cache_index_delete(&P_cache_index, queries_queue[j]->signature, queries_queue[j]);
+
+    if (queries_queue[j]->valid == PRINT_CACHE_COMMITTED) {
+      queries_queue[num] = queries_queue[j];
+      num++;
+    }
+    else P_cache_entry_release(queries_queue[j]);
+  }
+
+  swap = job->owned;
+  job->owned = queries_queue;
+  queries_queue = swap;
+
+  job->num = num;
+  job->safe_action = safe_action;
+  job->seq = P_writer_seq++;
+  job->busy = TRUE;
+  job->done = FALSE;
+
+  send_to_pool(P_writer_pool, P_writer_runner, job);
+
+  /* cache is full and all of it is being purged: wait for entries back */
+  if (safe_action) {
+    while (!P_cache_free_list && P_cache_entries >= P_cache_entries_max && P_writer_collect(TRUE));
+  }
+}
+
+/*
+   Purges run in the order they were handed over and one at a time: purge
+   functions keep per-process output state (broker host structs, dynamic
+   topics, output files) which is not safe to share. More writers let the
+   plugin hand over a purge while previous ones are still in flight.
+*/
+int P_writer_runner(struct P_writer_job *job)
+{
+  /* purge functions may reorder and trim the queue: the owned list is kept intact */
+  memcpy(job->queue, job->owned, job->num * sizeof(struct chained_cache *));
+
+  pthread_mutex_lock(&P_writer_mutex);
+  while (P_writer_turn != job->seq) pthread_cond_wait(&P_writer_cond, &P_writer_mutex);
+  pthread_mutex_unlock(&P_writer_mutex);
+
+  (*purge_func)(job->queue, job->num, job->safe_action);
+
+  pthread_mutex_lock(&P_writer_mutex);
+  P_writer_turn++;
+  job->done = TRUE;
+  pthread_cond_broadcast(&P_writer_cond);
+  pthread_mutex_unlock(&P_writer_mutex);
+
+  return SUCCESS;
+}
+
+/*
+   Encoder threads are spawned lazily by the process doing the purge: with
+   fork()'ed writers, threads started by the plugin would not survive into
+   the writer, hence the pool is bound to the pid that created it.
+*/
+void P_encoder_init()
+{
+  sigset_t signal_set, saved_set;
+
+  if (P_encoder_pool && P_encoder_pid == getpid()) return;
+
+  sigfillset(&signal_set);
+  pthread_sigmask(SIG_BLOCK, &signal_set, &saved_set);
+  P_encoder_pool = allocate_thread_pool(config.dump_encoders);
+  pthread_sigmask(SIG_SETMASK, &saved_set, NULL);
+
+  if (!P_encoder_pool) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to start %d encoder threads. Exiting.\n", config.name, config.type, config.dump_encoders);
+    exit_gracefully(1);
+  }
+
+  P_encoder_pid = getpid();
+
+#ifdef WITH_JANSSON
+  /* Jansson seeds its hashing upon creating the first object: not thread-safe */
+  json_decref(json_object());
+#endif
+}
+
+/*
+   Encodes committed entries of the queue in parallel. The queue is split in
+   one contiguous shard per encoder thread; each encoder fills the slots of
+   its own shard only, so the caller can then output the results serially,
+   in queue order. Returns NULL if parallel encoding is not configured.
+*/
+char **P_encode_queue(struct chained_cache *queue[], int index, P_encode_func func, void *arg)
+{
+  struct P_encoder_job *jobs;
+  thread_pool_item_t *worker;
+  char **encoded;
+  int shards, shard_len, idx, free_workers;
+
+  if (config.dump_encoders <= 1 || index <= 0 || !func) return NULL;
+
+  P_encoder_init();
+
+  encoded = calloc(index, sizeof(char *));
+  jobs = calloc(P_encoder_pool->count, sizeof(struct P_encoder_job));
+  if (!encoded || !jobs) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): P_encode_queue() cannot allocate %d entries. Exiting ..\n", config.name, config.type, index);
+    exit_gracefully(1);
+  }
+
+  shards = ((index < P_encoder_pool->count) ? index : P_encoder_pool->count);
+  shard_len = ((index + shards - 1) / shards);
+
+  for (idx = 0; idx < shards; idx++) {
+    jobs[idx].queue = queue;
+    jobs[idx].encoded = encoded;
+    jobs[idx].start = (idx * shard_len);
+    jobs[idx].end = MIN(index, ((idx + 1) * shard_len));
+    jobs[idx].func = func;
+    jobs[idx].arg = arg;
+
+    if (jobs[idx].start < jobs[idx].end) send_to_pool(P_encoder_pool, P_encoder_runner, &jobs[idx]);
+  }
+
+  /* join: wait for all encoders to be back in the free list */
+  pthread_mutex_lock(P_encoder_pool->mutex);
+  for (;;) {
+    for (free_workers = 0, worker = P_encoder_pool->free_list; worker; worker = worker->next) free_workers++;
+    if (free_workers == P_encoder_pool->count) break;
+
+    pthread_cond_wait(P_encoder_pool->cond, P_encoder_pool->mutex);
+  }
+  pthread_mutex_unlock(P_encoder_pool->mutex);
+
+  free(jobs);
+
+  return encoded;
+}
+
+int P_encoder_runner(struct P_encoder_job *job)
+{
+  int j;
+
+  for (j = job->start; j < job->end; j++) {
+    if (job->queue[j]->valid != PRINT_CACHE_COMMITTED) continue;
+
+    job->encoded[j] = job->func(job->queue[j], job->arg);
+  }
+
+  return SUCCESS;
+}
+
+/* frees what was left over, ie. if output got interrupted */
+void P_encoded_free(char **encoded, int index)
+{
+  int j;
+
+  if (!encoded) return;
+
+  for (j = 0; j < index; j++) {
+    if (encoded[j]) free(encoded[j]);
+  }
+
+  free(encoded);
+}
+
+/* returns msecs elapsed since 'tv' and moves 'tv' to now: to time purge stages */
+u_int64_t P_purge_stage_msec(struct timeval *tv)
+{
+  struct timeval now;
+  u_int64_t msec;
+
+  gettimeofday(&now, NULL);
+  msec = (((now.tv_sec - tv->tv_sec) * 1000) + ((now.tv_usec - tv->tv_usec) / 1000));
+  (*tv) = now;
+
+  return msec;
+}
+
 void P_cache_mark_flush(struct chained_cache *queue[], int index, int exiting)
 {
   struct timeval commit_basetime;
@@ -666,11 +971,7 @@ void P_cache_mark_flush(struct chained_cache *queue[], int index, int exiting)
     for (j = 0; j < pqq_ptr; j++) {
       memcpy(&pqq_container[j], pending_queries_queue[j], dbc_size);
 
-      pending_queries_queue[j]->pbgp = NULL;
-      pending_queries_queue[j]->pnat = NULL;
-      pending_queries_queue[j]->pmpls = NULL;
-      pending_queries_queue[j]->ptun = NULL;
-      pending_queries_queue[j]->pcust = NULL;
+      P_cache_extras_detach(pending_queries_queue[j]);
       pending_queries_queue[j]->pvlen = NULL;
       pending_queries_queue[j]->stitch = NULL;
 
@@ -689,22 +990,9 @@ void P_cache_flush(struct chained_cache *queue[], int index)
   int j;
 
   for (j = 0; j < index; j++) {
-    queue[j]->valid = PRINT_CACHE_FREE;
-    queue[j]->next = NULL;
+    cache_index_delete(&P_cache_index, queue[j]->signature, queue[j]);
+    P_cache_entry_release(queue[j]);
   }
-
-  /* rewinding scratch area stuff */
-  sa.ptr = sa.base;
-}
-
-struct chained_cache *P_cache_attach_new_node(struct chained_cache *elem)
-{
-  if ((sa.ptr + (2 * sizeof(struct chained_cache))) <= (sa.base + sa.size)) {
-    sa.ptr += sizeof(struct chained_cache);
-    elem->next = (struct chained_cache *) sa.ptr;
-    return (struct chained_cache *) sa.ptr;
-  }
-  else return NULL;
 }
 
 void P_sum_host_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata)
@@ -759,6 +1047,9 @@ void P_sum_mac_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *ida
 
 void P_exit_now(int signum)
 {
+  /* the final purge runs here: let the writer threads finish first */
+  if (P_writer_pool) P_writer_wait();
+
   if (qq_ptr) P_cache_mark_flush(queries_queue, qq_ptr, TRUE);
 
   dump_writers_count();
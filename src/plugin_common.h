@@ -26,6 +26,8 @@
 #include "net_aggr.h"
 #include "network.h"
 #include "preprocess.h"
+#include "thread_pool.h"
+#include "cache_index.h"
 #include "../include/sav_parser.h"  /* For struct sav_rule */
 
 /* defines */
@@ -35,6 +37,7 @@
 
 #define AVERAGE_CHAIN_LEN 10
 #define PRINT_CACHE_ENTRIES 16411
+#define PRINT_CACHE_CHUNK_ENTRIES 8192
 #define MAX_PTM_LABEL_TOKEN_LEN 128
 #define TCP_FLAG_LEN 6
 #define FWD_TYPES_STR_LEN 50
@@ -55,6 +58,14 @@
 #define PRINT_CACHE_INVALID     3
 #define PRINT_CACHE_ERROR       255
 
+/* chained_cache extras, packed in the pextras area in this order */
+#define PRINT_CACHE_EXTRAS_BGP	0x01
+#define PRINT_CACHE_EXTRAS_NAT	0x02
+#define PRINT_CACHE_EXTRAS_MPLS	0x04
+#define PRINT_CACHE_EXTRAS_TUN	0x08
+#define PRINT_CACHE_EXTRAS_CUST	0x10
+#define PRINT_CACHE_EXTRAS_ALIGN(x)	(((x) + 7) & ~7)
+
 /* structures */
 #ifndef STRUCT_SCRATCH_AREA
 #define STRUCT_SCRATCH_AREA
@@ -71,12 +82,15 @@ struct scratch_area {
 #define STRUCT_CHAINED_CACHE
 struct chained_cache {
   struct pkt_primitives primitives;
+  u_int32_t signature; /* hash of the key, checked before any byte comparison */
   pm_counter_t bytes_counter;
   pm_counter_t packet_counter;
   pm_counter_t flow_counter;
   u_int8_t flow_type;
   u_int8_t tcp_flags;
   u_int8_t tunnel_tcp_flags;
+  u_int8_t pextras_map; /* PRINT_CACHE_EXTRAS_* held by pextras */
+  u_char *pextras; /* single area backing pbgp, pnat, pmpls, ptun and pcust */
   struct pkt_bgp_primitives *pbgp;
   struct pkt_nat_primitives *pnat;
   struct pkt_mpls_primitives *pmpls;
@@ -153,14 +167,42 @@ typedef struct {
 } __attribute__((packed)) generic_delim_string;
 #endif
 
+/* committed cache entries owned by a writer thread until collected */
+struct P_writer_job {
+  struct chained_cache **owned;		/* queries queue swapped out of the plugin */
+  struct chained_cache **queue;		/* copy of owned handed to purge_func */
+  int num;
+  int safe_action;
+  u_int64_t seq;
+  int busy;
+  int done;
+};
+
+/* encodes a cache entry, returning a malloc()'ed string or NULL */
+typedef char *(*P_encode_func)(struct chained_cache *, void *);
+
+/* contiguous shard of a purge queue handed over to an encoder thread */
+struct P_encoder_job {
+  struct chained_cache **queue;
+  char **encoded;			/* one slot per queue entry */
+  int start;
+  int end;
+  P_encode_func func;
+  void *arg;
+};
+
 #include "sql_common.h"
 
 /* prototypes */
 extern void P_set_signals();
 extern void P_init_default_values();
 extern void P_config_checks();
-extern struct chained_cache *P_cache_attach_new_node(struct chained_cache *);
-extern unsigned int P_cache_modulo(struct primitives_ptrs *);
+extern struct chained_cache *P_cache_entry_alloc();
+extern void P_cache_entry_release(struct chained_cache *);
+extern u_int32_t P_cache_hash(struct primitives_ptrs *);
+extern int P_cache_extras_set(struct chained_cache *, struct primitives_ptrs *);
+extern void P_cache_extras_free(struct chained_cache *);
+extern void P_cache_extras_detach(struct chained_cache *);
 extern void P_sum_host_insert(struct primitives_ptrs *, struct insert_data *);
 extern void P_sum_port_insert(struct primitives_ptrs *, struct insert_data *);
 extern void P_sum_as_insert(struct primitives_ptrs *, struct insert_data *);
@@ -173,6 +215,16 @@ extern void P_cache_insert_pending(struct chained_cache *[], int, struct chained
 extern void P_cache_mark_flush(struct chained_cache *[], int, int);
 extern void P_cache_flush(struct chained_cache *[], int);
 extern void P_cache_handle_flush_event(struct ports_table *, struct protos_table *, struct protos_table *);
+extern void P_writer_init();
+extern int P_writer_collect(int);
+extern void P_writer_wait();
+extern void P_writer_purge(int, int);
+extern int P_writer_runner(struct P_writer_job *);
+extern void P_encoder_init();
+extern char **P_encode_queue(struct chained_cache *[], int, P_encode_func, void *);
+extern int P_encoder_runner(struct P_encoder_job *);
+extern void P_encoded_free(char **, int);
+extern u_int64_t P_purge_stage_msec(struct timeval *);
 extern void P_exit_now(int);
 extern int P_trigger_exec(char *);
 extern void primptrs_set_all_from_chained_cache(struct primitives_ptrs *, struct chained_cache *);
@@ -201,7 +253,7 @@ extern void load_tos(char *, struct protos_table *);
 extern void (*insert_func)(struct primitives_ptrs *, struct insert_data *); /* pointer to INSERT function */
 extern void (*purge_func)(struct chained_cache *[], int, int); /* pointer to purge function */
 extern struct scratch_area sa;
-extern struct chained_cache *cache;
+extern struct cache_index P_cache_index;
 extern struct chained_cache **queries_queue, **pending_queries_queue, *pqq_container;
 extern struct timeval flushtime;
 extern int qq_ptr, pqq_ptr, pp_size, pb_size, pn_size, pm_size, pt_size, pc_size;
@@ -214,4 +266,6 @@ extern int (*basetime_cmp)(struct timeval *, struct timeval *);
 extern struct timeval basetime, ibasetime, new_basetime;
 extern time_t timeslot;
 extern int dyn_table, dyn_table_time_only;
+extern thread_pool_t *P_writer_pool;
+extern thread_pool_t *P_encoder_pool;
 #endif //PLUGIN_COMMON_H
@@ -26,6 +26,14 @@
 #include "plugin_hooks.h"
 #include "plugin_common.h"
 #include "pkt_handlers.h"
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#endif
+
+/* global variables */
+static int plugin_pipe_efd = ERR;	/* plugin side, eventfd mode: wakeup counter */
+static int plugin_pipe_live = ERR;	/* plugin side, eventfd mode: Core Process liveness */
 
 /* functions */
 
@@ -118,7 +126,39 @@ void load_plugins(struct plugin_requests *req)
       while (list->cfg.buffer_size % 4 != 0) list->cfg.buffer_size--;
 #endif
 
-      if (!list->cfg.pipe_zmq) {
+      if (list->cfg.pipe_eventfd && !list->cfg.pipe_zmq) {
+#ifdef HAVE_SYS_EVENTFD_H
+	/* the memory plugin reads buffer pointers off the pipe */
+	if (list->type.id == PLUGIN_ID_MEMORY) {
+	  Log(LOG_WARNING, "WARN ( %s/%s ): plugin_pipe_eventfd is not supported by this plugin. Ignored.\n", list->name, list->type.string);
+	  list->cfg.pipe_eventfd = FALSE;
+	}
+#else
+	Log(LOG_WARNING, "WARN ( %s/%s ): plugin_pipe_eventfd is not supported on this platform. Ignored.\n", list->name, list->type.string);
+	list->cfg.pipe_eventfd = FALSE;
+#endif
+      }
+      else if (list->cfg.pipe_zmq) list->cfg.pipe_eventfd = FALSE;
+
+      if (list->cfg.pipe_eventfd && !list->cfg.pipe_zmq) {
+#ifdef HAVE_SYS_EVENTFD_H
+	/* creating wakeup channel: one end each for the Core Process and the plugin */
+	list->pipe[0] = eventfd(0, EFD_NONBLOCK);
+	if (list->pipe[0] >= 0) list->pipe[1] = dup(list->pipe[0]);
+
+	if (list->pipe[0] < 0 || list->pipe[1] < 0) {
+	  Log(LOG_ERR, "ERROR ( %s/%s ): Unable to create eventfd: %s\nExiting.\n", list->name, list->type.string, strerror(errno));
+	  exit_gracefully(1);
+	}
+
+	/* an eventfd never reads EOF: a pipe, never written, tells the plugin if the Core Process is gone */
+	if (pipe(list->live) < 0) {
+	  Log(LOG_ERR, "ERROR ( %s/%s ): Unable to create liveness pipe: %s\nExiting.\n", list->name, list->type.string, strerror(errno));
+	  exit_gracefully(1);
+	}
+#endif
+      }
+      else if (!list->cfg.pipe_zmq) {
         /* creating communication channel */
         socketpair(AF_UNIX, SOCK_DGRAM, 0, list->pipe);
 
@@ -288,6 +328,17 @@ void load_plugins(struct plugin_requests *req)
 	close(config.sock);
 	close(config.bgp_sock);
 	if (!list->cfg.pipe_zmq) close(list->pipe[1]);
+	if (list->cfg.pipe_eventfd) {
+	  struct plugins_list_entry *sibling;
+
+	  /* no write end may be left open here, else EOF would never be seen */
+	  for (sibling = plugins_list; sibling != list; sibling = sibling->next) {
+	    if (sibling->cfg.pipe_eventfd) close(sibling->live[1]);
+	  }
+	  close(list->live[1]);
+
+	  list->pipe[0] = plugin_pipe_liveness_init(list->pipe[0], list->live[0]);
+	}
 	(*list->type.func)(list->pipe[0], &list->cfg, chptr);
 	exit_gracefully(0);
       default: /* Parent */
@@ -295,6 +346,7 @@ void load_plugins(struct plugin_requests *req)
 	  close(list->pipe[0]);
 	  setnonblocking(list->pipe[1]);
 	}
+	if (list->cfg.pipe_eventfd) close(list->live[0]);
 	break;
       }
 
@@ -377,14 +429,14 @@ void exec_plugins(struct packet_ptrs *pptrs, struct plugin_requests *req)
 {
   int saved_have_tag = FALSE, saved_have_tag2 = FALSE, saved_have_label = FALSE;
   pm_id_t saved_tag = 0, saved_tag2 = 0;
-  pt_label_t *saved_label = malloc(sizeof(pt_label_t));
+  pt_label_t saved_label;
 
   int num, fixed_size;
   u_int32_t savedptr;
   char *bptr;
   int index, got_tags = FALSE;
 
-  pretag_init_label(saved_label);
+  pretag_init_label(&saved_label);
 
 #if defined WITH_GEOIPV2
   if (reload_geoipv2_file && config.geoipv2_file) {
@@ -414,7 +466,7 @@ void exec_plugins(struct packet_ptrs *pptrs, struct plugin_requests *req)
       if (p->cfg.ptm_global && got_tags) {
         pptrs->tag = saved_tag;
         pptrs->tag2 = saved_tag2;
-	pretag_copy_label(&pptrs->label, saved_label);
+	pretag_copy_label(&pptrs->label, &saved_label);
 
         pptrs->have_tag = saved_have_tag;
         pptrs->have_tag2 = saved_have_tag2;
@@ -428,7 +480,7 @@ void exec_plugins(struct packet_ptrs *pptrs, struct plugin_requests *req)
 	  if (p->cfg.ptm_global) {
 	    saved_tag = pptrs->tag;
 	    saved_tag2 = pptrs->tag2;
-	    pretag_copy_label(saved_label, &pptrs->label);
+	    pretag_copy_label(&saved_label, &pptrs->label);
 
 	    saved_have_tag = pptrs->have_tag;
 	    saved_have_tag2 = pptrs->have_tag2;
@@ -501,10 +553,12 @@ reprocess:
 	channels_list[index].hdr.seq++;
 	channels_list[index].hdr.seq %= MAX_SEQNUM;
 
-	/* let's commit the buffer we just finished writing */
+	/* let's commit the buffer we just finished writing; seq goes last
+	   as it is what plugins look at to tell the buffer is ready */
 	((struct ch_buf_hdr *)channels_list[index].rg.ptr)->len = channels_list[index].bufptr;
-	((struct ch_buf_hdr *)channels_list[index].rg.ptr)->seq = channels_list[index].hdr.seq;
 	((struct ch_buf_hdr *)channels_list[index].rg.ptr)->num = channels_list[index].hdr.num;
+	__sync_synchronize();
+	((struct ch_buf_hdr *)channels_list[index].rg.ptr)->seq = channels_list[index].hdr.seq;
 
 	channels_list[index].status->last_buf_off = (u_int64_t)(channels_list[index].rg.ptr - channels_list[index].rg.base);
 
@@ -524,15 +578,7 @@ reprocess:
           (void)ret; //Check error?
 #endif
 	}
-	else {
-	  if (channels_list[index].status->wakeup) {
-	    channels_list[index].status->wakeup = channels_list[index].request;
-	    if (write(channels_list[index].pipe, &channels_list[index].rg.ptr, CharPtrSz) != CharPtrSz) {
-	      struct plugins_list_entry *list = channels_list[index].plugin;
-	      Log(LOG_WARNING, "WARN ( %s/%s ): Failed during write: %s\n", list->name, list->type.string, strerror(errno));
-	    }
-	  }
-	}
+	else plugin_pipe_wakeup(&channels_list[index]);
 
 	channels_list[index].rg.ptr += channels_list[index].bufsize;
 
@@ -591,8 +637,7 @@ reprocess:
 
   /* cleanups */
   reload_map_exec_plugins = FALSE;
-  pretag_free_label(saved_label);
-  if (saved_label) free(saved_label);
+  pretag_free_label(&saved_label);
 }
 
 struct channels_list_entry *insert_pipe_channel(int plugin_type, struct configuration *cfg, int pipe)
@@ -844,21 +889,191 @@ void fill_pipe_buffer()
     chptr->hdr.seq++;
     chptr->hdr.seq %= MAX_SEQNUM;
 
-    ((struct ch_buf_hdr *)chptr->rg.ptr)->seq = chptr->hdr.seq;
     ((struct ch_buf_hdr *)chptr->rg.ptr)->num = chptr->hdr.num;
+    __sync_synchronize();
+    ((struct ch_buf_hdr *)chptr->rg.ptr)->seq = chptr->hdr.seq;
 
     if (chptr->plugin->cfg.pipe_zmq) {
 #ifdef WITH_ZMQ
       p_zmq_topic_send(&chptr->zmq_host, chptr->rg.ptr, chptr->bufsize);
 #endif
     }
-    else {
-      if (chptr->status->wakeup) {
-        chptr->status->wakeup = chptr->request;
-        if (write(chptr->pipe, &chptr->rg.ptr, CharPtrSz) != CharPtrSz)
-	  Log(LOG_WARNING, "WARN ( %s/%s ): Failed during write: %s\n", chptr->plugin->cfg.name, chptr->plugin->cfg.type, strerror(errno));
-      }
+    else plugin_pipe_wakeup(chptr);
+  }
+}
+
+/*
+   plugin_pipe_wakeup(): Core Process side of the homegrown ring; to be
+   called once a buffer is committed. Accounts for it and, if the plugin
+   went to sleep, wakes it up either via the socketpair (passing along
+   the buffer pointer) or via eventfd (one counter increment).
+*/
+void plugin_pipe_wakeup(struct channels_list_entry *chptr)
+{
+  struct ch_status *status = chptr->status;
+  int ret;
+
+  status->head++;
+  if (plugin_pipe_occupancy(status) > ((chptr->rg.end - chptr->rg.base) / chptr->bufsize)) status->drops++;
+
+  if (status->wakeup) {
+    status->wakeup = chptr->request;
+    status->wakeups++;
+
+    if (chptr->plugin->cfg.pipe_eventfd) {
+      u_int64_t efd_inc = 1;
+
+      ret = (write(chptr->pipe, &efd_inc, sizeof(efd_inc)) == sizeof(efd_inc));
+    }
+    else ret = (write(chptr->pipe, &chptr->rg.ptr, CharPtrSz) == CharPtrSz);
+
+    if (!ret) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): Failed during write: %s\n", chptr->plugin->cfg.name, chptr->plugin->cfg.type, strerror(errno));
+    }
+  }
+}
+
+/*
+   plugin_pipe_resync(): plugin side; to be called when, following an
+   overrun, the plugin skips ahead to the last committed buffer. Buffers
+   skipped over are accounted as consumed, so that head - tail goes back
+   to reflecting the ring occupancy; the buffer resynced to is accounted
+   for by the caller, as any other, once consumed.
+*/
+void plugin_pipe_resync(struct ch_status *status)
+{
+  u_int64_t head;
+
+  __sync_synchronize();
+  head = status->head;
+
+  if (head) status->tail = (head - 1);
+  __sync_synchronize();
+}
+
+/*
+   plugin_pipe_liveness_init(): plugin side, eventfd mode. Wraps the
+   eventfd and the read end of the liveness pipe into an epoll instance,
+   returned in place of the eventfd: plugins keep polling a single fd,
+   which turns readable on either a wakeup or the Core Process exiting.
+*/
+int plugin_pipe_liveness_init(int efd, int live_fd)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+  struct epoll_event ev;
+  int epfd;
+
+  epfd = epoll_create1(0);
+  if (epfd < 0) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to create epoll instance: %s\nExiting.\n", config.name, config.type, strerror(errno));
+    exit_gracefully(1);
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = efd;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &ev) < 0) goto err;
+
+  ev.data.fd = live_fd;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, live_fd, &ev) < 0) goto err;
+
+  plugin_pipe_efd = efd;
+  plugin_pipe_live = live_fd;
+
+  return epfd;
+
+  err:
+  Log(LOG_ERR, "ERROR ( %s/%s ): Unable to setup epoll instance: %s\nExiting.\n", config.name, config.type, strerror(errno));
+  exit_gracefully(1);
+#endif
+
+  return efd;
+}
+
+/*
+   plugin_pipe_read(): plugin side, consumes a wakeup. Reads one message
+   off the socketpair or the whole counter off the eventfd; the buffer
+   pointer is copied to rgptr only in the former case. As with the
+   socketpair, zero is returned once the Core Process is gone, that is
+   when no wakeup is pending and the liveness pipe reads EOF.
+*/
+ssize_t plugin_pipe_read(int fd, void *rgptr)
+{
+  union {
+    char *ptr;
+    u_int64_t efd_cnt;
+  } msg;
+  ssize_t ret;
+
+  if (plugin_pipe_efd != ERR) {
+    struct pollfd pfd;
+
+    ret = read(plugin_pipe_efd, &msg, sizeof(msg));
+    if (ret > 0) return ret;
+
+    pfd.fd = plugin_pipe_live;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN|POLLHUP))) {
+      if (read(plugin_pipe_live, &msg, sizeof(msg)) <= 0) return 0;
+    }
+
+    return ret;
+  }
+
+  ret = read(fd, &msg, sizeof(msg));
+  if (ret == CharPtrSz && rgptr) memcpy(rgptr, &msg.ptr, CharPtrSz);
+
+  return ret;
+}
+
+/*
+   plugin_pipe_spin(): plugin side, adaptive spin-then-sleep. Before going
+   to sleep on the pipe, busy-waits up to plugin_pipe_spin rounds for the
+   buffer at rgptr to be committed with the expected seq. The budget is
+   doubled each time spinning pays off and halved each time it does not,
+   so that an idle plugin quickly stops burning CPU.
+*/
+int plugin_pipe_spin(char *rgptr, u_int32_t seq)
+{
+  static u_int32_t budget = 0;
+  u_int32_t idx;
+
+  if (!config.pipe_spin) return FALSE;
+  if (!budget) budget = config.pipe_spin;
+
+  for (idx = 0; idx < budget; idx++) {
+    if (((volatile struct ch_buf_hdr *)rgptr)->seq == seq) {
+      __sync_synchronize();
+      budget = MIN((budget * 2), config.pipe_spin);
+
+      return TRUE;
     }
+
+#if defined __x86_64__ || defined __i386__
+    __builtin_ia32_pause();
+#endif
+  }
+
+  budget = MIN(MAX((budget / 2), PLUGIN_PIPE_SPIN_MIN), config.pipe_spin);
+
+  return FALSE;
+}
+
+void plugin_pipe_print_stats(time_t now)
+{
+  struct channels_list_entry *chptr;
+  int index;
+
+  for (index = 0; channels_list[index].aggregation || channels_list[index].aggregation_2 || channels_list[index].aggregation_3; index++) {
+    chptr = &channels_list[index];
+
+    if (chptr->plugin->cfg.pipe_zmq) continue;
+
+    Log(LOG_NOTICE, "NOTICE ( %s/%s ): stats [plugin_pipe] time=%ld plugin=%s/%s slots=%" PRIu64 " occupancy=%" PRIu64 " committed=%" PRIu64 " wakeups=%" PRIu64 " drops=%" PRIu64 "\n",
+	config.name, config.type, (long)now, chptr->plugin->name, chptr->plugin->type.string,
+	(u_int64_t)((chptr->rg.end - chptr->rg.base) / chptr->bufsize), plugin_pipe_occupancy(chptr->status),
+	chptr->status->head, chptr->status->wakeups, chptr->status->drops);
   }
 }
 
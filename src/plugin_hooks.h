@@ -30,6 +30,8 @@
 #define MAX_FAILS 5 
 #define MAX_SEQNUM 65536 
 #define MAX_RG_COUNT_ERR 3 
+#define PLUGIN_PIPE_CACHE_LINE 64
+#define PLUGIN_PIPE_SPIN_MIN 64
 
 struct channels_list_entry;
 typedef void (*pkt_handler) (struct channels_list_entry *, struct packet_ptrs *, char **);
@@ -51,6 +53,14 @@ struct ch_buf_hdr {
 struct ch_status {
   u_int8_t wakeup;		/* plugin is polling */ 
   u_int64_t last_buf_off;	/* offset of last committed buffer */
+
+  /* written by the Core Process only */
+  u_int64_t head __attribute__ ((aligned (PLUGIN_PIPE_CACHE_LINE)));	/* buffers committed */
+  u_int64_t wakeups;		/* wakeups sent to the plugin */
+  u_int64_t drops;		/* buffers overwritten before being consumed */
+
+  /* written by the plugin only */
+  u_int64_t tail __attribute__ ((aligned (PLUGIN_PIPE_CACHE_LINE)));	/* buffers consumed */
 };
 
 struct sampling {
@@ -78,6 +88,7 @@ struct plugins_list_entry {
   char name[SRVBUFLEN];
   struct configuration cfg;
   int pipe[2];
+  int live[2];			/* plugin_pipe_eventfd: Core Process liveness pipe */
   struct plugin_type_entry type;
   struct plugins_list_entry *next;
 };
@@ -138,6 +149,12 @@ extern int evaluate_filters(struct aggregate_filter *, u_char *, struct pcap_pkt
 extern void recollect_pipe_memory(struct channels_list_entry *);
 extern void init_random_seed();
 extern void fill_pipe_buffer();
+extern void plugin_pipe_wakeup(struct channels_list_entry *);
+extern void plugin_pipe_resync(struct ch_status *);
+extern int plugin_pipe_liveness_init(int, int);
+extern ssize_t plugin_pipe_read(int, void *);
+extern int plugin_pipe_spin(char *, u_int32_t);
+extern void plugin_pipe_print_stats(time_t);
 extern int check_pipe_buffer_space(struct channels_list_entry *, struct pkt_vlen_hdr_primitives *, int); 
 extern void return_pipe_buffer_space(struct channels_list_entry *, int);
 extern int check_shadow_status(struct packet_ptrs *, struct channels_list_entry *);
@@ -176,4 +193,13 @@ extern void amqp_plugin(int, struct configuration *, void *);
 #ifdef WITH_KAFKA
 extern void kafka_plugin(int, struct configuration *, void *);
 #endif
+
+/* buffers committed and not consumed yet; tail may briefly run ahead of
+   head after a plugin_pipe_resync() */
+static inline u_int64_t plugin_pipe_occupancy(struct ch_status *status)
+{
+  u_int64_t head = status->head, tail = status->tail;
+
+  return ((head > tail) ? (head - tail) : 0);
+}
 #endif //PLUGIN_HOOKS_H
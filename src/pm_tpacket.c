@@ -0,0 +1,376 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "pm_tpacket.h"
+
+#if defined HAVE_LINUX_IF_PACKET_H
+#include <poll.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#endif
+
+#if defined HAVE_LINUX_IF_PACKET_H && defined TPACKET3_HDRLEN
+/* functions */
+static int pm_tpacket_set_filter(struct pm_pcap_device *dev_ptr)
+{
+  struct bpf_program filter;
+  struct sock_fprog fprog;
+  int ret = SUCCESS;
+
+  if (!config.clbuf || !strlen(config.clbuf)) return SUCCESS;
+
+  /* pcap_compile() output for DLT_EN10MB is what the kernel expects */
+  memset(&filter, 0, sizeof(filter));
+  if (pcap_compile(dev_ptr->dev_desc, &filter, config.clbuf, 0, PCAP_NETMASK_UNKNOWN) < 0) return ERR;
+
+  fprog.len = filter.bf_len;
+  fprog.filter = (struct sock_filter *) filter.bf_insns;
+
+  if (setsockopt(dev_ptr->ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) ret = ERR;
+
+  pcap_freecode(&filter);
+
+  return ret;
+}
+
+static int pm_tpacket_setup(struct pm_pcap_device *dev_ptr)
+{
+  struct pm_tpacket *ring = dev_ptr->ring;
+  struct tpacket_req3 req;
+  struct sockaddr_ll sll;
+  struct packet_mreq mreq;
+  int version = TPACKET_V3, reserve = PM_TPACKET_VLAN_TAG_LEN, fanout;
+  u_int16_t protocol = (config.pcap_protocol ? htons(config.pcap_protocol) : htons(ETH_P_ALL));
+
+  /* no protocol yet: nothing is received, on any interface, until bind() */
+  ring->fd = socket(AF_PACKET, SOCK_RAW, 0);
+  if (ring->fd < 0) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: socket() failed: %s\n", config.name, dev_ptr->str, strerror(errno));
+    return ERR;
+  }
+
+  if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: TPACKET_V3 not supported: %s\n", config.name, dev_ptr->str, strerror(errno));
+    return ERR;
+  }
+
+  /* headroom to re-insert VLAN tags stripped by the NIC in front of frames */
+  if (setsockopt(ring->fd, SOL_PACKET, PACKET_RESERVE, &reserve, sizeof(reserve)) < 0) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: PACKET_RESERVE failed: %s\n", config.name, dev_ptr->str, strerror(errno));
+    return ERR;
+  }
+
+  /* attached before bind() so no unfiltered packet makes it to the ring */
+  if (pm_tpacket_set_filter(dev_ptr) == ERR) {
+    Log(LOG_WARNING, "WARN ( %s/core ): [%s] pm_tpacket: unable to attach filter (going on without a filter)\n", config.name, dev_ptr->str);
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = ring->block_size;
+  req.tp_block_nr = ring->block_num;
+  req.tp_frame_size = PM_TPACKET_FRAME_SIZE;
+  req.tp_frame_nr = ((ring->block_size / PM_TPACKET_FRAME_SIZE) * ring->block_num);
+  req.tp_retire_blk_tov = PM_TPACKET_BLOCK_TIMEOUT;
+
+  if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: unable to allocate %u x %u bytes ring: %s\n",
+	config.name, dev_ptr->str, ring->block_num, ring->block_size, strerror(errno));
+    return ERR;
+  }
+
+  ring->map_len = ((size_t) ring->block_size * ring->block_num);
+  ring->map = mmap(NULL, ring->map_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_LOCKED, ring->fd, 0);
+  if (ring->map == MAP_FAILED) {
+    /* MAP_LOCKED may fail against RLIMIT_MEMLOCK; it is a nice-to-have */
+    ring->map = mmap(NULL, ring->map_len, PROT_READ|PROT_WRITE, MAP_SHARED, ring->fd, 0);
+  }
+
+  if (ring->map == MAP_FAILED) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: mmap() failed: %s\n", config.name, dev_ptr->str, strerror(errno));
+    ring->map = NULL;
+    return ERR;
+  }
+
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = protocol;
+  sll.sll_ifindex = ring->ifindex;
+
+  if (bind(ring->fd, (struct sockaddr *) &sll, sizeof(sll)) < 0) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: bind() failed: %s\n", config.name, dev_ptr->str, strerror(errno));
+    return ERR;
+  }
+
+  if (config.promisc) {
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.mr_ifindex = ring->ifindex;
+    mreq.mr_type = PACKET_MR_PROMISC;
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+      Log(LOG_WARNING, "WARN ( %s/core ): [%s] pm_tpacket: unable to set promiscuous mode: %s\n", config.name, dev_ptr->str, strerror(errno));
+    }
+  }
+
+  /*
+     The kernel flow hash covers ports too, except for IP fragments which
+     are hashed on addresses only: all fragments of a datagram land on the
+     same member, possibly not the one of unfragmented packets of the flow.
+     PACKET_FANOUT_FLAG_DEFRAG is not set as it would deliver reassembled
+     datagrams in place of the fragments actually on the wire.
+  */
+  if (config.pcap_fanout_group) {
+    fanout = ((config.pcap_fanout_group & 0xffff) | (PACKET_FANOUT_HASH << 16));
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0) {
+      Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: unable to join fanout group %u: %s\n",
+	  config.name, dev_ptr->str, config.pcap_fanout_group, strerror(errno));
+      return ERR;
+    }
+  }
+
+  return SUCCESS;
+}
+
+/*
+   Replaces the libpcap capture of a freshly opened device with a TPACKET_V3
+   ring. The pcap handle is swapped for a dead one of the same link type so
+   filters can still be compiled against it but no packet gets captured
+   twice. Only Ethernet devices are supported.
+*/
+int pm_tpacket_open(struct pm_pcap_device *dev_ptr, u_int32_t snaplen)
+{
+  struct pm_tpacket *ring;
+  pcap_t *dead;
+
+  if (dev_ptr->link_type != DLT_EN10MB) {
+    Log(LOG_WARNING, "WARN ( %s/core ): [%s] pcap_tpacket supports Ethernet devices only (link type: %d).\n",
+	config.name, dev_ptr->str, dev_ptr->link_type);
+    return ERR;
+  }
+
+  ring = malloc(sizeof(struct pm_tpacket));
+  if (!ring) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket_open(): malloc() failed.\n", config.name, dev_ptr->str);
+    return ERR;
+  }
+
+  memset(ring, 0, sizeof(struct pm_tpacket));
+  ring->fd = ERR;
+  ring->ifindex = if_nametoindex(dev_ptr->str);
+  ring->snaplen = snaplen;
+  ring->block_size = (config.pcap_tpacket_block_size ? config.pcap_tpacket_block_size : PM_TPACKET_BLOCK_SIZE_DEFAULT);
+  ring->block_num = (config.pcap_tpacket_blocks ? config.pcap_tpacket_blocks : PM_TPACKET_BLOCKS_DEFAULT);
+  dev_ptr->ring = ring;
+
+  if (!ring->ifindex) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: unable to resolve ifindex.\n", config.name, dev_ptr->str);
+    goto err;
+  }
+
+  if (pm_tpacket_setup(dev_ptr) == ERR) goto err;
+
+  dead = pcap_open_dead(dev_ptr->link_type, snaplen);
+  if (!dead) {
+    Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: pcap_open_dead() failed.\n", config.name, dev_ptr->str);
+    goto err;
+  }
+
+  pcap_close(dev_ptr->dev_desc);
+  dev_ptr->dev_desc = dead;
+  dev_ptr->fd = ring->fd;
+
+  Log(LOG_INFO, "INFO ( %s/core ): [%s,%u] TPACKET_V3 ring: blocks=%u block_size=%u fanout_group=%u\n",
+      config.name, dev_ptr->str, dev_ptr->id, ring->block_num, ring->block_size, config.pcap_fanout_group);
+
+  return SUCCESS;
+
+  err:
+  pm_tpacket_close(dev_ptr);
+
+  return ERR;
+}
+
+static void pm_tpacket_walk_block(struct pm_pcap_device *dev_ptr, struct tpacket_block_desc *pbd, pcap_handler cb, u_char *user)
+{
+  struct pm_tpacket *ring = dev_ptr->ring;
+  struct tpacket3_hdr *ppd;
+  struct sockaddr_ll *sll;
+  struct pcap_pkthdr hdr;
+  u_int32_t idx, num_pkts = pbd->hdr.bh1.num_pkts;
+  u_int16_t tpid, tci;
+  u_char *pkt;
+
+  ppd = (struct tpacket3_hdr *) ((u_char *) pbd + pbd->hdr.bh1.offset_to_first_pkt);
+
+  for (idx = 0; idx < num_pkts; idx++, ppd = (struct tpacket3_hdr *) ((u_char *) ppd + ppd->tp_next_offset)) {
+    sll = (struct sockaddr_ll *) ((u_char *) ppd + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+    /* pcap_setdirection() equivalent */
+    if (config.pcap_direction == PCAP_D_IN && sll->sll_pkttype == PACKET_OUTGOING) continue;
+    if (config.pcap_direction == PCAP_D_OUT && sll->sll_pkttype != PACKET_OUTGOING) continue;
+
+    pkt = ((u_char *) ppd + ppd->tp_mac);
+    hdr.ts.tv_sec = ppd->tp_sec;
+    hdr.ts.tv_usec = (ppd->tp_nsec / 1000);
+    hdr.caplen = ppd->tp_snaplen;
+    hdr.len = ppd->tp_len;
+
+    /* put back in place the VLAN tag possibly stripped by the NIC */
+    if ((ppd->tp_status & TP_STATUS_VLAN_VALID) && hdr.caplen >= (2 * ETH_ALEN)) {
+#if defined TP_STATUS_VLAN_TPID_VALID
+      tpid = ((ppd->tp_status & TP_STATUS_VLAN_TPID_VALID) ? ppd->hv1.tp_vlan_tpid : ETH_P_8021Q);
+#else
+      tpid = ETH_P_8021Q;
+#endif
+      tci = ppd->hv1.tp_vlan_tci;
+
+      memmove((pkt - PM_TPACKET_VLAN_TAG_LEN), pkt, (2 * ETH_ALEN));
+      pkt -= PM_TPACKET_VLAN_TAG_LEN;
+
+      tpid = htons(tpid);
+      tci = htons(tci);
+      memcpy((pkt + (2 * ETH_ALEN)), &tpid, 2);
+      memcpy((pkt + (2 * ETH_ALEN) + 2), &tci, 2);
+
+      hdr.caplen += PM_TPACKET_VLAN_TAG_LEN;
+      hdr.len += PM_TPACKET_VLAN_TAG_LEN;
+    }
+
+    if (hdr.caplen > ring->snaplen) hdr.caplen = ring->snaplen;
+
+    cb(user, &hdr, pkt);
+  }
+}
+
+/*
+   pcap_loop() equivalent: walks the ring block by block and hands packets
+   to 'cb' in place; a block is given back to the kernel once all of its
+   packets are processed. Returns ERR if the device goes away.
+*/
+int pm_tpacket_loop(struct pm_pcap_device *dev_ptr, pcap_handler cb, u_char *user)
+{
+  struct pm_tpacket *ring = dev_ptr->ring;
+  struct tpacket_block_desc *pbd;
+  struct pollfd pfd;
+  int ret;
+
+  if (!ring) return ERR;
+
+  memset(&pfd, 0, sizeof(pfd));
+  pfd.fd = ring->fd;
+  pfd.events = (POLLIN|POLLERR);
+
+  for (;;) {
+    pbd = (struct tpacket_block_desc *) (ring->map + ((size_t) ring->block_idx * ring->block_size));
+
+    if (!(pbd->hdr.bh1.block_status & TP_STATUS_USER)) {
+      pfd.revents = 0;
+      ret = poll(&pfd, 1, PM_TPACKET_POLL_TIMEOUT);
+
+      if (ret < 0 && errno != EINTR) {
+	Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: poll() failed: %s\n", config.name, dev_ptr->str, strerror(errno));
+	return ERR;
+      }
+
+      if (pfd.revents & (POLLERR|POLLHUP|POLLNVAL)) {
+	Log(LOG_ERR, "ERROR ( %s/core ): [%s] pm_tpacket: device error.\n", config.name, dev_ptr->str);
+	return ERR;
+      }
+
+      continue;
+    }
+
+    /* block contents must not be read ahead of its status */
+    __sync_synchronize();
+
+    pm_tpacket_walk_block(dev_ptr, pbd, cb, user);
+
+    __sync_synchronize();
+    pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+
+    ring->block_idx = ((ring->block_idx + 1) % ring->block_num);
+  }
+
+  return SUCCESS;
+}
+
+/* the kernel resets its counters upon each read: keep running totals */
+int pm_tpacket_stats(struct pm_pcap_device *dev_ptr, struct pcap_stat *ps)
+{
+  struct pm_tpacket *ring = dev_ptr->ring;
+  struct tpacket_stats_v3 kstats;
+  socklen_t slen = sizeof(kstats);
+
+  if (!ring) return ERR;
+
+  memset(&kstats, 0, sizeof(kstats));
+  if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &kstats, &slen) < 0) return ERR;
+
+  /* tp_packets does include drops */
+  ring->stats.packets += kstats.tp_packets;
+  ring->stats.drops += kstats.tp_drops;
+  ring->stats.freezes += kstats.tp_freeze_q_cnt;
+
+  memset(ps, 0, sizeof(struct pcap_stat));
+  ps->ps_recv = ring->stats.packets;
+  ps->ps_drop = ring->stats.drops;
+
+  return SUCCESS;
+}
+
+void pm_tpacket_close(struct pm_pcap_device *dev_ptr)
+{
+  struct pm_tpacket *ring = dev_ptr->ring;
+
+  if (!ring) return;
+
+  if (ring->map) munmap(ring->map, ring->map_len);
+  if (ring->fd >= 0) close(ring->fd);
+
+  free(ring);
+  dev_ptr->ring = NULL;
+}
+#else
+int pm_tpacket_open(struct pm_pcap_device *dev_ptr, u_int32_t snaplen)
+{
+  Log(LOG_WARNING, "WARN ( %s/core ): pcap_tpacket not supported on this platform (missing TPACKET_V3). Ignored.\n", config.name);
+
+  return ERR;
+}
+
+int pm_tpacket_loop(struct pm_pcap_device *dev_ptr, pcap_handler cb, u_char *user)
+{
+  return ERR;
+}
+
+int pm_tpacket_stats(struct pm_pcap_device *dev_ptr, struct pcap_stat *ps)
+{
+  return ERR;
+}
+
+void pm_tpacket_close(struct pm_pcap_device *dev_ptr)
+{
+}
+#endif
@@ -0,0 +1,68 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef PM_TPACKET_H
+#define PM_TPACKET_H
+
+/*
+   Native Linux capture backend for pmacctd: packets are read straight out
+   of a memory-mapped TPACKET_V3 block ring and handed to pm_pcap_cb()
+   in place, without going through libpcap. Optionally the socket joins a
+   PACKET_FANOUT_HASH group so that several pmacctd instances can split
+   the traffic of one interface on a per-flow basis.
+*/
+
+/* defines */
+#define PM_TPACKET_BLOCK_SIZE_DEFAULT	(1 << 20)
+#define PM_TPACKET_BLOCKS_DEFAULT	64
+#define PM_TPACKET_FRAME_SIZE		2048
+#define PM_TPACKET_BLOCK_TIMEOUT	100	/* msecs before a partially filled block is retired */
+#define PM_TPACKET_POLL_TIMEOUT		1000	/* msecs */
+#define PM_TPACKET_VLAN_TAG_LEN		4
+
+/* structures */
+struct pm_tpacket_stats {
+  u_int64_t packets;		/* packets accepted into the ring */
+  u_int64_t drops;		/* packets dropped by the kernel, ie. ring full */
+  u_int64_t freezes;		/* times the ring was found full */
+};
+
+struct pm_tpacket {
+  int fd;
+  int ifindex;
+  u_int32_t snaplen;
+  u_int32_t block_size;
+  u_int32_t block_num;
+  u_int32_t block_idx;		/* next block to be read */
+  u_char *map;			/* block_num * block_size mmap()'ed bytes */
+  size_t map_len;
+
+  struct pm_tpacket_stats stats;
+};
+
+/* prototypes */
+extern int pm_tpacket_open(struct pm_pcap_device *, u_int32_t);
+extern int pm_tpacket_loop(struct pm_pcap_device *, pcap_handler, u_char *);
+extern int pm_tpacket_stats(struct pm_pcap_device *, struct pcap_stat *);
+extern void pm_tpacket_close(struct pm_pcap_device *);
+
+#endif // PM_TPACKET_H
@@ -31,6 +31,7 @@
 #define N_PRIMITIVES 128
 #define N_FUNCS 10 
 #define MAX_N_PLUGINS 32
+#define MAX_CORE_WORKERS 64
 #define PROTO_LEN 12
 #define PROTO_NUM_STRLEN 4
 #define MAX_MAP_ENTRIES 2048 /* allow maps */
@@ -432,7 +433,7 @@
 #define WANT_MATCH			0x00000010
 #define WANT_RESET			0x00000020
 #define WANT_CLASS_TABLE		0x00000040
-/* #define XXX 				0x00000080 */
+#define WANT_TOPN			0x00000080
 #define WANT_LOCK_OP			0x00000100
 #define WANT_CUSTOM_PRIMITIVES_TABLE	0x00000200
 #define WANT_ERASE_LAST_TSTAMP		0x00000400
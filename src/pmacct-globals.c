@@ -37,6 +37,7 @@ int data_plugins, tee_plugins;
 int collector_port;
 struct timeval reload_map_tstamp;
 struct child_ctl2 dump_writers;
+struct child_ctl2 core_workers;
 int debug;
 struct configuration config; /* global configuration structure */
 struct plugins_list_entry *plugins_list = NULL; /* linked list of each plugin configuration */
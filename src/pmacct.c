@@ -665,10 +665,11 @@ int build_query_client(char *path_ptr)
 
 int main(int argc,char **argv)
 {
-  int clibufsz = (MAX_QUERIES*sizeof(struct query_entry))+sizeof(struct query_header)+2;
+  int clibufsz = (MAX_QUERIES*sizeof(struct query_entry))+sizeof(struct query_header)+sizeof(struct query_topn)+2;
   struct pkt_data *acc_elem = NULL;
   struct bucket_desc *bd;
   struct query_header q; 
+  struct query_topn qt;
   struct pkt_primitives empty_addr;
   struct pkt_bgp_primitives empty_pbgp;
   struct pkt_legacy_bgp_primitives empty_plbgp;
@@ -722,6 +723,7 @@ int main(int argc,char **argv)
   clibuf = malloc(clibufsz);
 
   memset(&q, 0, sizeof(struct query_header));
+  memset(&qt, 0, sizeof(struct query_topn));
   memset(&empty_addr, 0, sizeof(struct pkt_primitives));
   memset(&empty_pbgp, 0, sizeof(struct pkt_bgp_primitives));
   memset(&empty_plbgp, 0, sizeof(struct pkt_legacy_bgp_primitives));
@@ -1357,6 +1359,13 @@ int main(int argc,char **argv)
     exit(1);
   }
 
+  /* the whole table is not needed if the server keeps top-N heaps deep enough */
+  if (want_stats && topN_howmany && (topN_counter == 1 || topN_counter == 2)) {
+    q.type |= WANT_TOPN;
+    qt.counter = topN_counter;
+    qt.howmany = topN_howmany;
+  }
+
   if (want_counter || want_match) {
     char *ptr = match_string, prefix[] = "file:";
 
@@ -2131,6 +2140,10 @@ int main(int argc,char **argv)
   /* arranging header and size of buffer to send */
   memcpy(clibuf, &q, sizeof(struct query_header)); 
   buflen = sizeof(struct query_header)+(q.num*sizeof(struct query_entry));
+  if (q.type & WANT_TOPN) {
+    memcpy(clibuf+buflen, &qt, sizeof(struct query_topn));
+    buflen += sizeof(struct query_topn);
+  }
   buflen++;
   clibuf[buflen] = '\x4'; /* EOT */
   buflen++;
@@ -278,6 +278,7 @@ struct pm_pcap_device {
   int fd;
   struct _devices_struct *data; 
   struct pm_pcap_interface *pcap_if;
+  struct pm_tpacket *ring; /* native capture backend, see pm_tpacket.h */
 };
 
 struct pm_pcap_devices {
@@ -356,7 +357,7 @@ struct child_ctl2 {
   pid_t *list;
   u_int16_t active;
   u_int16_t max;
-  u_int32_t flags;
+  volatile sig_atomic_t flags; /* also set from signal handlers */
 };
 
 #define INIT_BUF(x) \
@@ -443,6 +444,7 @@ extern int data_plugins, tee_plugins;
 extern int collector_port;
 extern struct timeval reload_map_tstamp;
 extern struct child_ctl2 dump_writers;
+extern struct child_ctl2 core_workers;
 extern int debug;
 extern struct configuration config; /* global configuration structure */
 extern struct plugins_list_entry *plugins_list; /* linked list of each plugin configuration */
@@ -30,6 +30,7 @@
 #include "ip_flow.h"
 #include "net_aggr.h"
 #include "thread_pool.h"
+#include "pm_tpacket.h"
 #include "bgp/bgp.h"
 #include "bmp/bmp.h"
 #if defined (WITH_NDPI)
@@ -237,6 +238,18 @@ int pm_pcap_add_interface(struct pm_pcap_device *dev_ptr, char *ifname, struct p
 
     pm_pcap_check(dev_ptr);
     pm_pcap_add_filter(dev_ptr);
+
+    if ((config.pcap_tpacket || config.pcap_fanout_group) && !config.pcap_interfaces_map) {
+      if (pm_tpacket_open(dev_ptr, psize) == ERR) {
+	/* falling back to libpcap would duplicate traffic across the group */
+	if (config.pcap_fanout_group) {
+	  Log(LOG_ERR, "ERROR ( %s/core ): [%s] unable to set up pcap_fanout_group. Exiting.\n", config.name, ifname);
+	  exit_gracefully(1);
+	}
+
+	Log(LOG_WARNING, "WARN ( %s/core ): [%s] pcap_tpacket unavailable, falling back to libpcap.\n", config.name, ifname);
+      }
+    }
   }
   else {
     Log(LOG_WARNING, "WARN ( %s/core ): [%s] pm_pcap_open(): giving up after too many attempts.\n", config.name, ifname);
@@ -961,6 +974,10 @@ int main(int argc,char **argv, char **envp)
   bkp_select_fd = 0;
   FD_ZERO(&bkp_read_descs);
 
+  if ((config.pcap_tpacket || config.pcap_fanout_group) && !config.pcap_if) {
+    Log(LOG_WARNING, "WARN ( %s/core ): pcap_tpacket and pcap_fanout_group are supported along with pcap_interface only. Ignored.\n", config.name);
+  }
+
   if (config.pcap_if) {
     ret = pm_pcap_add_interface(&devices.list[0], config.pcap_if, NULL, psize);
     if (!ret) {
@@ -1259,6 +1276,8 @@ int main(int argc,char **argv, char **envp)
     exit(0);
   }
 
+  bgp_epoch_core_reader_init();
+
   /* Main loop (for the case of a single interface): if pcap_loop() exits
      maybe an error occurred; we will try closing and reopening again our
      listening device */
@@ -1275,7 +1294,12 @@ int main(int argc,char **argv, char **envp)
       }
 
       read_packet:
-      pcap_loop(devices.list[0].dev_desc, -1, pm_pcap_cb, (u_char *) &cb_data);
+      if (devices.list[0].ring) {
+	pm_tpacket_loop(&devices.list[0], pm_pcap_cb, (u_char *) &cb_data);
+	pm_tpacket_close(&devices.list[0]);
+      }
+      else pcap_loop(devices.list[0].dev_desc, -1, pm_pcap_cb, (u_char *) &cb_data);
+
       pcap_close(devices.list[0].dev_desc);
 
       if (config.pcap_savefile) {
@@ -45,6 +45,9 @@ int custom_primitives_allocated;
 int bta_map_caching;
 int sampling_map_caching;
 
+u_int64_t pretag_entries_evaluated;
+u_int64_t pretag_label_allocs;
+
 int (*find_id_func)(struct id_table *, struct packet_ptrs *, pm_id_t *, pm_id_t *);
 
 /*
@@ -55,6 +58,7 @@ int (*find_id_func)(struct id_table *, struct packet_ptrs *, pm_id_t *, pm_id_t
 void load_id_file(int acct_type, char *filename, struct id_table *t, struct plugin_requests *req, int *map_allocated)
 {
   struct id_table tmp;
+  struct id_table_tree *old_tree = NULL;
   struct id_entry *ptr;
   FILE *file;
   char *buf = NULL;
@@ -136,6 +140,9 @@ void load_id_file(int acct_type, char *filename, struct id_table *t, struct plug
 	cdada_map_destroy(t->label_map_v4);
 	cdada_map_destroy(t->label_map_v6);
 
+	/* the tree is released once its replacement is compiled */
+	old_tree = t->tree;
+
         memset(t, 0, sizeof(struct id_table));
         t->e = ptr ;
       }
@@ -787,6 +794,17 @@ void load_id_file(int acct_type, char *filename, struct id_table *t, struct plug
       if (report) {
 	pretag_index_report(t);
       }
+
+      /* pre_tag_map decision tree */
+      if (config.maps_tree &&
+	  (acct_type == ACCT_NF || acct_type == ACCT_SF || acct_type == ACCT_PM ||
+	   acct_type == MAP_BGP_PEER_AS_SRC || acct_type == MAP_BGP_SRC_LOCAL_PREF ||
+	   acct_type == MAP_BGP_SRC_MED || acct_type == MAP_FLOW_TO_RD)) {
+	t->tree = pretag_tree_build(t);
+      }
+
+      pretag_tree_destroy(old_tree);
+      old_tree = NULL;
     }
   }
 
@@ -807,6 +825,7 @@ void load_id_file(int acct_type, char *filename, struct id_table *t, struct plug
   handle_error:
   if (*map_allocated && tmp.e) free(tmp.e) ;
   if (buf) free(buf);
+  if (old_tree) pretag_tree_destroy(old_tree);
 
   if (t && t->timestamp) {
     Log(LOG_WARNING, "WARN ( %s/%s ): [%s] Rolling back old map.\n", config.name, config.type, filename);
@@ -887,11 +906,77 @@ void pretag_init_label(pt_label_t *label)
   memset(label, 0, sizeof(pt_label_t));
 }
 
+/*
+   Label buffers are recycled through a small per-process pool, bucketed
+   by power-of-two size classes: packet labels (and the ptm_global saved
+   copy in exec_plugins()) are built and dropped for every packet, so
+   after warm-up they are served from the pool and never hit malloc().
+   pretag_label_allocs only counts the pool misses.
+*/
+static struct pretag_label_buf *pretag_label_pool[PRETAG_LABEL_POOL_CLASSES];
+static u_int32_t pretag_label_pool_depth[PRETAG_LABEL_POOL_CLASSES];
+
+static u_int32_t pretag_label_class(int len)
+{
+  u_int32_t class = 0, size = PRETAG_LABEL_POOL_MIN;
+
+  while (size < len && class < PRETAG_LABEL_POOL_CLASSES) {
+    size <<= 1;
+    class++;
+  }
+
+  return class;
+}
+
+static struct pretag_label_buf *pretag_label_buf(char *val)
+{
+  return (struct pretag_label_buf *) (val - offsetof(struct pretag_label_buf, val));
+}
+
+static char *pretag_label_get(int len)
+{
+  struct pretag_label_buf *buf;
+  u_int32_t class = pretag_label_class(len), size;
+
+  if (class < PRETAG_LABEL_POOL_CLASSES && pretag_label_pool[class]) {
+    buf = pretag_label_pool[class];
+    pretag_label_pool[class] = buf->next;
+    pretag_label_pool_depth[class]--;
+  }
+  else {
+    if (class < PRETAG_LABEL_POOL_CLASSES) size = (PRETAG_LABEL_POOL_MIN << class);
+    else size = len;
+
+    pretag_label_allocs++;
+    buf = malloc(offsetof(struct pretag_label_buf, val) + size);
+    if (!buf) return NULL;
+
+    buf->class = class;
+    buf->size = size;
+  }
+
+  buf->next = NULL;
+
+  return buf->val;
+}
+
+static void pretag_label_put(char *val)
+{
+  struct pretag_label_buf *buf = pretag_label_buf(val);
+
+  if (buf->class < PRETAG_LABEL_POOL_CLASSES && pretag_label_pool_depth[buf->class] < PRETAG_LABEL_POOL_DEPTH) {
+    buf->next = pretag_label_pool[buf->class];
+    pretag_label_pool[buf->class] = buf;
+    pretag_label_pool_depth[buf->class]++;
+  }
+  else free(buf);
+}
+
 int pretag_malloc_label(pt_label_t *label, int len)
 {
   if (!label) return ERR;
 
-  label->val = malloc(len);
+  label->val = pretag_label_get(len);
   if (!label->val) {
     Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (pretag_malloc_label).\n", config.name, config.type);
     return ERR;
@@ -907,7 +992,15 @@ int pretag_realloc_label(pt_label_t *label, int old_len, int add_len)
 
   if (!label) return ERR;
 
-  local_val = malloc((old_len + add_len));
+  /* grow in place if the pooled buffer is already large enough */
+  if (label->val && pretag_label_buf(label->val)->size >= (old_len + add_len)) {
+    memset(label->val + strlen(label->val), 0, (old_len + add_len) - strlen(label->val));
+    label->len = (old_len + add_len);
+
+    return SUCCESS;
+  }
+
+  local_val = pretag_label_get(old_len + add_len);
   if (!local_val) {
     Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (pretag_realloc_label).\n", config.name, config.type);
     return ERR;
@@ -916,7 +1009,7 @@ int pretag_realloc_label(pt_label_t *label, int old_len, int add_len)
   memset(local_val, 0, (old_len + add_len));
   strcpy(local_val, label->val);
 
-  free(label->val);
+  pretag_label_put(label->val);
   label->val = local_val;
   label->len = (old_len + add_len);
 
@@ -1006,7 +1099,7 @@ int pretag_append_label(pt_label_t *dst, pt_label_t *src)
 void pretag_free_label(pt_label_t *label)
 {
   if (label && label->val) {
-    free(label->val); 
+    pretag_label_put(label->val);
     label->val = NULL;
     label->len = 0;
   }
@@ -1016,15 +1109,17 @@ int pretag_entry_process(struct id_entry *e, struct packet_ptrs *pptrs, pm_id_t
 {
   int j = 0;
   pm_id_t id = 0, stop = 0, ret = 0;
-  pt_label_t *label_local = malloc(sizeof(pt_label_t));
+  pt_label_t label_local;
 
-  pretag_init_label(label_local);
+  /* label_local borrows the entry label (see pretag_label_handler()): never free it */
+  pretag_init_label(&label_local);
 
   e->last_matched = FALSE;
+  pretag_entries_evaluated++;
 
   for (j = 0, stop = 0, ret = 0; ((!ret || ret > TRUE) && (*e->func[j])); j++) {
     if (e->func_type[j] == PRETAG_SET_LABEL) {
-      ret = (*e->func[j])(pptrs, label_local, e);
+      ret = (*e->func[j])(pptrs, &label_local, e);
     }
     else {
       ret = (*e->func[j])(pptrs, &id, e);
@@ -1047,10 +1142,10 @@ int pretag_entry_process(struct id_entry *e, struct packet_ptrs *pptrs, pm_id_t
     } 
     else if (stop & PRETAG_MAP_RCODE_LABEL) {
       if (pptrs->label.len) {
-	pretag_append_label(&pptrs->label, label_local);
+	pretag_append_label(&pptrs->label, &label_local);
       }
       else {
-	pretag_copy_label(&pptrs->label, label_local);
+	pretag_copy_label(&pptrs->label, &label_local);
       }
 
       pptrs->have_label = TRUE;
@@ -1079,12 +1174,22 @@ int pretag_entry_process(struct id_entry *e, struct packet_ptrs *pptrs, pm_id_t
     }
   }
 
-  pretag_free_label(label_local);
-  if (label_local) free(label_local);
-
   return stop;
 }
 
+/*
+   Evaluating map entries is allocation free and packet labels are
+   served from the label pool; label_allocs should stay flat in steady
+   state, growing only while the pool warms up or on map reloads.
+*/
+void pretag_print_stats(time_t now)
+{
+  if (!pretag_entries_evaluated) return;
+
+  Log(LOG_NOTICE, "NOTICE ( %s/%s ): stats [pre_tag_map] time=%ld entries_evaluated=%" PRIu64 " label_allocs=%" PRIu64 "\n",
+      config.name, config.type, (long)now, pretag_entries_evaluated, pretag_label_allocs);
+}
+
 pt_bitmap_t pretag_index_build_bitmap(struct id_entry *ptr, int acct_type)
 {
   pt_bitmap_t idx_bmap = 0;
@@ -1514,3 +1619,419 @@ int pretag_index_have_one(struct id_table *t)
 {
   return t->index[0].entries;
 }
+
+struct pretag_tree_item {
+  struct host_addr agent;
+  u_int32_t value;
+  u_int32_t pos;
+};
+
+static int pretag_tree_agent_cmp(const struct host_addr *a, const struct host_addr *b)
+{
+  if (a->family != b->family) return (a->family < b->family ? -1 : 1);
+
+  if (a->family == AF_INET) return memcmp(&a->address.ipv4, &b->address.ipv4, 4);
+  else return memcmp(&a->address.ipv6, &b->address.ipv6, 16);
+}
+
+static int pretag_tree_item_agent_cmp(const void *a, const void *b)
+{
+  const struct pretag_tree_item *ia = a, *ib = b;
+  int ret;
+
+  ret = pretag_tree_agent_cmp(&ia->agent, &ib->agent);
+  if (!ret) ret = (ia->pos < ib->pos ? -1 : (ia->pos > ib->pos));
+
+  return ret;
+}
+
+static int pretag_tree_item_value_cmp(const void *a, const void *b)
+{
+  const struct pretag_tree_item *ia = a, *ib = b;
+
+  if (ia->value != ib->value) return (ia->value < ib->value ? -1 : 1);
+
+  return (ia->pos < ib->pos ? -1 : (ia->pos > ib->pos));
+}
+
+/*
+   Returns TRUE if the entry can be branched on 'key', ie. it matches
+   the key by plain equality; in that case the value is copied in item.
+*/
+static int pretag_tree_entry_value(struct id_entry *e, pt_bitmap_t key, struct pretag_tree_item *item)
+{
+  int x;
+
+  if (key == PRETAG_IP) {
+    if (e->key.agent_mask.family != e->key.agent_ip.a.family) return FALSE;
+    if (e->key.agent_mask.family == AF_INET && e->key.agent_mask.len != 32) return FALSE;
+    if (e->key.agent_mask.family == AF_INET6 && e->key.agent_mask.len != 128) return FALSE;
+
+    memset(&item->agent, 0, sizeof(struct host_addr));
+    item->agent.family = e->key.agent_ip.a.family;
+    if (item->agent.family == AF_INET) item->agent.address.ipv4 = e->key.agent_ip.a.address.ipv4;
+    else memcpy(&item->agent.address.ipv6, &e->key.agent_ip.a.address.ipv6, 16);
+
+    return TRUE;
+  }
+
+  for (x = 0; x < N_MAP_HANDLERS && e->func[x]; x++) {
+    if (e->func_type[x] == key) break;
+  }
+
+  if (x == N_MAP_HANDLERS || !e->func[x]) return FALSE;
+
+  switch (key) {
+  case PRETAG_IN_IFACE:
+    if (e->key.input.neg) return FALSE;
+    item->value = e->key.input.n;
+    break;
+  case PRETAG_OUT_IFACE:
+    if (e->key.output.neg) return FALSE;
+    item->value = e->key.output.n;
+    break;
+  default:
+    return FALSE;
+  }
+
+  /* NetFlow v5 and 2-bytes v9/IPFIX interfaces are compared truncated */
+  if (config.acct_type == ACCT_NF && item->value > UINT16_MAX) return FALSE;
+
+  return TRUE;
+}
+
+static pt_bitmap_t pretag_tree_select_key(struct id_table *t, u_int32_t *pos, u_int32_t num, pt_bitmap_t used,
+					  struct pretag_tree_item *items)
+{
+  pt_bitmap_t keys[] = { PRETAG_IN_IFACE, PRETAG_OUT_IFACE, 0 }, best_key = 0;
+  u_int32_t idx, num_items, distinct, best_distinct = 0;
+  int k;
+
+  if (num <= PRETAG_TREE_LEAF_MIN) return 0;
+
+  /* agent goes first: it is what NF_find_id()/SF_find_id() scanned on */
+  if (!(used & PRETAG_IP) && config.acct_type != ACCT_PM) {
+    for (idx = 0; idx < num; idx++) {
+      if (pretag_tree_entry_value(&t->e[pos[idx]], PRETAG_IP, &items[0])) return PRETAG_IP;
+    }
+  }
+
+  for (k = 0; keys[k]; k++) {
+    if (used & keys[k]) continue;
+
+    for (idx = 0, num_items = 0; idx < num; idx++) {
+      if (pretag_tree_entry_value(&t->e[pos[idx]], keys[k], &items[num_items])) {
+	items[num_items].pos = pos[idx];
+	num_items++;
+      }
+    }
+
+    if (!num_items) continue;
+
+    qsort(items, num_items, sizeof(struct pretag_tree_item), pretag_tree_item_value_cmp);
+
+    for (idx = 1, distinct = 1; idx < num_items; idx++) {
+      if (items[idx].value != items[idx - 1].value) distinct++;
+    }
+
+    if (distinct > best_distinct) {
+      best_distinct = distinct;
+      best_key = keys[k];
+    }
+  }
+
+  return best_key;
+}
+
+static struct id_table_tree_node *pretag_tree_build_node(struct id_table_tree *tree, struct id_table *t,
+							 u_int32_t *pos, u_int32_t num, pt_bitmap_t used)
+{
+  struct id_table_tree_node *node;
+  struct pretag_tree_item *items = NULL;
+  u_int32_t *rest = NULL, *sub = NULL;
+  u_int32_t idx, run, num_items, num_rest;
+
+  if (!num || tree->err) return NULL;
+
+  node = calloc(1, sizeof(struct id_table_tree_node));
+  items = malloc(num * sizeof(struct pretag_tree_item));
+  if (!node || !items) goto handle_error;
+
+  tree->nodes++;
+
+  node->key = pretag_tree_select_key(t, pos, num, used, items);
+
+  if (!node->key) {
+    node->pos = malloc(num * sizeof(u_int32_t));
+    if (!node->pos) goto handle_error;
+
+    memcpy(node->pos, pos, num * sizeof(u_int32_t));
+    node->num = num;
+
+    tree->leaves++;
+    if (num > tree->max_leaf) tree->max_leaf = num;
+
+    free(items);
+    return node;
+  }
+
+  rest = malloc(num * sizeof(u_int32_t));
+  sub = malloc(num * sizeof(u_int32_t));
+  if (!rest || !sub) goto handle_error;
+
+  for (idx = 0, num_items = 0, num_rest = 0; idx < num; idx++) {
+    if (pretag_tree_entry_value(&t->e[pos[idx]], node->key, &items[num_items])) {
+      items[num_items].pos = pos[idx];
+      num_items++;
+    }
+    else rest[num_rest++] = pos[idx];
+  }
+
+  if (node->key == PRETAG_IP) qsort(items, num_items, sizeof(struct pretag_tree_item), pretag_tree_item_agent_cmp);
+  else qsort(items, num_items, sizeof(struct pretag_tree_item), pretag_tree_item_value_cmp);
+
+  node->branch = calloc(num_items, sizeof(struct id_table_tree_branch));
+  if (!node->branch) goto handle_error;
+
+  /* items are sorted by value, then by position: each run is a branch */
+  for (idx = 0; idx < num_items; idx += run) {
+    struct id_table_tree_branch *branch = &node->branch[node->num];
+
+    for (run = 0; (idx + run) < num_items; run++) {
+      if (node->key == PRETAG_IP && pretag_tree_agent_cmp(&items[idx].agent, &items[idx + run].agent)) break;
+      if (node->key != PRETAG_IP && items[idx].value != items[idx + run].value) break;
+
+      sub[run] = items[idx + run].pos;
+    }
+
+    branch->agent = items[idx].agent;
+    branch->value = items[idx].value;
+    branch->node = pretag_tree_build_node(tree, t, sub, run, (used | node->key));
+    node->num++;
+  }
+
+  node->rest = pretag_tree_build_node(tree, t, rest, num_rest, (used | node->key));
+
+  free(items);
+  free(rest);
+  free(sub);
+
+  return node;
+
+  handle_error:
+  tree->err = TRUE;
+
+  if (items) free(items);
+  if (rest) free(rest);
+  if (sub) free(sub);
+  if (node) {
+    if (node->branch) free(node->branch);
+    if (node->pos) free(node->pos);
+    free(node);
+  }
+
+  return NULL;
+}
+
+static void pretag_tree_destroy_node(struct id_table_tree_node *node)
+{
+  u_int32_t idx;
+
+  if (!node) return;
+
+  if (node->branch) {
+    for (idx = 0; idx < node->num; idx++) pretag_tree_destroy_node(node->branch[idx].node);
+    free(node->branch);
+  }
+
+  pretag_tree_destroy_node(node->rest);
+  if (node->pos) free(node->pos);
+  free(node);
+}
+
+/*
+   The tree is compiled into fresh memory and only handed back once
+   complete; on failure the map keeps being scanned linearly.
+*/
+struct id_table_tree *pretag_tree_build(struct id_table *t)
+{
+  struct id_table_tree *tree;
+  u_int32_t *pos, idx, begin;
+
+  if (!t || !t->num) return NULL;
+
+  tree = calloc(1, sizeof(struct id_table_tree));
+  pos = malloc(t->num * sizeof(u_int32_t));
+  if (!tree || !pos) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): [%s] maps_tree: malloc() failed. Tree disabled.\n", config.name, config.type, t->filename);
+    if (tree) free(tree);
+    if (pos) free(pos);
+    return NULL;
+  }
+
+  for (idx = 0; idx < t->ipv4_num; idx++) pos[idx] = idx;
+  tree->v4 = pretag_tree_build_node(tree, t, pos, t->ipv4_num, 0);
+
+  begin = (t->num - t->ipv6_num);
+  for (idx = 0; idx < t->ipv6_num; idx++) pos[idx] = (begin + idx);
+  tree->v6 = pretag_tree_build_node(tree, t, pos, t->ipv6_num, 0);
+
+  free(pos);
+
+  if (tree->err) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): [%s] maps_tree: unable to compile map. Tree disabled.\n", config.name, config.type, t->filename);
+    pretag_tree_destroy(tree);
+    return NULL;
+  }
+
+  Log(LOG_INFO, "INFO ( %s/%s ): [%s] maps_tree: %u entries compiled into %u nodes (leaves=%u largest_leaf=%u).\n",
+      config.name, config.type, t->filename, t->num, tree->nodes, tree->leaves, tree->max_leaf);
+
+  return tree;
+}
+
+void pretag_tree_destroy(struct id_table_tree *tree)
+{
+  if (!tree) return;
+
+  pretag_tree_destroy_node(tree->v4);
+  pretag_tree_destroy_node(tree->v6);
+  free(tree);
+}
+
+static int pretag_tree_packet_value(pt_bitmap_t key, struct packet_ptrs *pptrs, u_int32_t *value)
+{
+  struct id_entry res_fdata;
+  pm_hash_serial_t hash_serializer;
+
+  /* no flow data, no interface: only 'rest' sub-trees can match */
+  if (config.acct_type != ACCT_PM && !pptrs->f_data) return FALSE;
+
+  /* a zero-length serializer makes the fdata handlers skip serialization */
+  memset(&hash_serializer, 0, sizeof(hash_serializer));
+
+  switch (key) {
+  case PRETAG_IN_IFACE:
+    res_fdata.key.input.n = 0;
+    PT_map_index_fdata_input_handler(NULL, 0, ERR, &res_fdata, &hash_serializer, pptrs);
+    (*value) = res_fdata.key.input.n;
+    break;
+  case PRETAG_OUT_IFACE:
+    res_fdata.key.output.n = 0;
+    PT_map_index_fdata_output_handler(NULL, 0, ERR, &res_fdata, &hash_serializer, pptrs);
+    (*value) = res_fdata.key.output.n;
+    break;
+  default:
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static struct id_table_tree_branch *pretag_tree_find_branch(struct id_table_tree_node *node, struct host_addr *agent, u_int32_t value)
+{
+  int low = 0, high = (node->num - 1), mid, ret;
+
+  while (low <= high) {
+    mid = ((low + high) / 2);
+
+    if (node->key == PRETAG_IP) ret = pretag_tree_agent_cmp(agent, &node->branch[mid].agent);
+    else ret = (value < node->branch[mid].value ? -1 : (value > node->branch[mid].value));
+
+    if (!ret) return &node->branch[mid];
+    else if (ret < 0) high = (mid - 1);
+    else low = (mid + 1);
+  }
+
+  return NULL;
+}
+
+/*
+   Collects the leaves reachable by the packet, then walks their entries
+   merged in map order: first match wins and 'jeq' resumes the walk from
+   the target position, exactly as the linear scan would do. 'sa' is the
+   agent address or NULL where maps are not keyed on agents (pmacctd).
+*/
+pm_id_t pretag_tree_lookup(struct id_table *t, struct packet_ptrs *pptrs, struct sockaddr *sa, pm_id_t *tag, pm_id_t *tag2)
+{
+  struct id_table_tree_node *stack[PRETAG_TREE_MAX_LEAVES * 2], *leaf[PRETAG_TREE_MAX_LEAVES], *node;
+  struct id_table_tree_branch *branch;
+  struct host_addr agent;
+  u_int32_t cursor[PRETAG_TREE_MAX_LEAVES], value[PRETAG_TREE_KEYS], min_pos = 0, x;
+  int sp = 0, num_leaves = 0, have_value[PRETAG_TREE_KEYS], best, idx, slot;
+  pm_id_t ret = 0;
+
+  if (!t || !t->tree) return 0;
+
+  memset(&agent, 0, sizeof(agent));
+  memset(have_value, 0, sizeof(have_value));
+
+  if (!sa) node = t->tree->v4;
+  else if (sa->sa_family == AF_INET) {
+    agent.family = AF_INET;
+    agent.address.ipv4 = ((struct sockaddr_in *) sa)->sin_addr;
+    node = t->tree->v4;
+  }
+  else if (sa->sa_family == AF_INET6) {
+    agent.family = AF_INET6;
+    memcpy(&agent.address.ipv6, &((struct sockaddr_in6 *) sa)->sin6_addr, 16);
+    node = t->tree->v6;
+  }
+  else return 0;
+
+  if (node) stack[sp++] = node;
+
+  while (sp) {
+    node = stack[--sp];
+
+    if (!node->key) {
+      leaf[num_leaves] = node;
+      cursor[num_leaves] = 0;
+      num_leaves++;
+      continue;
+    }
+
+    if (node->rest) stack[sp++] = node->rest;
+
+    if (node->key == PRETAG_IP) {
+      branch = pretag_tree_find_branch(node, &agent, 0);
+    }
+    else {
+      slot = (node->key == PRETAG_IN_IFACE ? 1 : 2);
+
+      if (!have_value[slot]) {
+	have_value[slot] = (pretag_tree_packet_value(node->key, pptrs, &value[slot]) ? TRUE : ERR);
+      }
+
+      branch = (have_value[slot] == TRUE ? pretag_tree_find_branch(node, NULL, value[slot]) : NULL);
+    }
+
+    if (branch && branch->node) stack[sp++] = branch->node;
+  }
+
+  for (;;) {
+    for (idx = 0, best = ERR; idx < num_leaves; idx++) {
+      while (cursor[idx] < leaf[idx]->num && leaf[idx]->pos[cursor[idx]] < min_pos) cursor[idx]++;
+
+      if (cursor[idx] < leaf[idx]->num) {
+	if (best == ERR || leaf[idx]->pos[cursor[idx]] < leaf[best]->pos[cursor[best]]) best = idx;
+      }
+    }
+
+    if (best == ERR) break;
+
+    x = leaf[best]->pos[cursor[best]];
+    cursor[best]++;
+
+    if (sa && host_addr_mask_sa_cmp(&t->e[x].key.agent_ip.a, &t->e[x].key.agent_mask, sa)) continue;
+
+    ret = pretag_entry_process(&t->e[x], pptrs, tag, tag2);
+
+    if (!ret || ret > TRUE) {
+      if (ret & PRETAG_MAP_RCODE_JEQ) min_pos = t->e[x].jeq.ptr->pos;
+      else break;
+    }
+  }
+
+  return ret;
+}
@@ -34,6 +34,14 @@
 #define MAX_ID_TABLE_INDEXES 8
 #define ID_TABLE_INDEX_RESULTS (MAX_ID_TABLE_INDEXES * 8)
 
+#define PRETAG_TREE_KEYS 3 /* agent, in, out */
+#define PRETAG_TREE_MAX_LEAVES (1 << PRETAG_TREE_KEYS)
+#define PRETAG_TREE_LEAF_MIN 8
+
+#define PRETAG_LABEL_POOL_CLASSES 8 /* 32 .. 4096 bytes */
+#define PRETAG_LABEL_POOL_MIN 32
+#define PRETAG_LABEL_POOL_DEPTH 64
+
 #define PRETAG_IN_IFACE			0x0000000000000001ULL
 #define PRETAG_OUT_IFACE		0x0000000000000002ULL
 #define PRETAG_NEXTHOP			0x0000000000000004ULL
@@ -109,6 +117,13 @@ typedef pm_id_t (*pretag_stack_handler) (pm_id_t, pm_id_t);
 
 typedef u_int64_t pt_bitmap_t;
 
+struct pretag_label_buf {
+  struct pretag_label_buf *next;
+  u_int32_t class;
+  u_int32_t size;
+  char val[];
+};
+
 typedef struct {
   u_int8_t neg;
   u_int8_t n;
@@ -265,6 +280,37 @@ struct id_table_index {
   cdada_map_t *idx_map;
 };
 
+/*
+   Decision tree compiled out of a map: every node branches on one key
+   (agent first, then the most selective of input/output interface);
+   entries not constraining that key by plain equality go to 'rest'.
+   Leaves list entry positions in map order.
+*/
+struct id_table_tree_node;
+
+struct id_table_tree_branch {
+  struct host_addr agent;			/* PRETAG_IP */
+  u_int32_t value;				/* PRETAG_IN_IFACE, PRETAG_OUT_IFACE */
+  struct id_table_tree_node *node;
+};
+
+struct id_table_tree_node {
+  pt_bitmap_t key;				/* 0 for leaves */
+  u_int32_t num;				/* branches or, for leaves, entries */
+  struct id_table_tree_branch *branch;
+  struct id_table_tree_node *rest;
+  u_int32_t *pos;
+};
+
+struct id_table_tree {
+  struct id_table_tree_node *v4;
+  struct id_table_tree_node *v6;
+  u_int32_t nodes;
+  u_int32_t leaves;
+  u_int32_t max_leaf;
+  int err;
+};
+
 struct id_table {
   char *filename;
   int type;
@@ -280,6 +326,7 @@ struct id_table {
   u_int32_t flags;
   cdada_map_t *label_map_v4;
   cdada_map_t *label_map_v6;
+  struct id_table_tree *tree;
 };
 
 struct _map_dictionary_line {
@@ -340,6 +387,10 @@ extern u_int32_t pretag_index_lookup(struct id_table *, struct packet_ptrs *, st
 extern void pretag_index_results_sort(struct id_entry **, int);
 extern void pretag_index_results_compress_jeqs(struct id_entry **, int);
 extern int pretag_index_have_one(struct id_table *);
+extern void pretag_print_stats(time_t);
+extern struct id_table_tree *pretag_tree_build(struct id_table *);
+extern void pretag_tree_destroy(struct id_table_tree *);
+extern pm_id_t pretag_tree_lookup(struct id_table *, struct packet_ptrs *, struct sockaddr *, pm_id_t *, pm_id_t *);
 
 extern int bpas_map_allocated;
 extern int blp_map_allocated;
@@ -353,6 +404,9 @@ extern int custom_primitives_allocated;
 extern int bta_map_caching; 
 extern int sampling_map_caching; 
 
+extern u_int64_t pretag_entries_evaluated;
+extern u_int64_t pretag_label_allocs;
+
 extern int (*find_id_func)(struct id_table *, struct packet_ptrs *, pm_id_t *, pm_id_t *);
 
 #endif //PRETAG_H
@@ -2942,8 +2942,10 @@ int pretag_label_handler(struct packet_ptrs *pptrs, void *id, void *e)
   struct id_entry *entry = e;
   pt_label_t *out_label = (pt_label_t *) id;
 
+  /* lend the entry label: it outlives the packet, no copy needed */
   if (out_label) {
-    pretag_copy_label(out_label, &entry->label);
+    out_label->val = entry->label.val;
+    out_label->len = entry->label.len;
   }
 
   return PRETAG_MAP_RCODE_LABEL; /* cap */
@@ -265,7 +265,7 @@ void print_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
 
       saved_qq_ptr = qq_ptr;
       P_cache_handle_flush_event(&pt, &prt, &tost);
-      if (saved_qq_ptr) print_output_stdout_header = FALSE;
+      if (saved_qq_ptr && !P_writer_pool) print_output_stdout_header = FALSE;
     }
 
     recv_budget = 0;
@@ -291,12 +291,14 @@ void print_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
           if (seq == 0) rg_err_count = FALSE;
         }
         else {
-          if ((ret = read(pipe_fd, &rgptr, sizeof(rgptr))) == 0) 
+          if ((ret = plugin_pipe_read(pipe_fd, &rgptr)) == 0) 
 	    exit_gracefully(1); /* we exit silently; something happened at the write end */
         }
 
         if ((rg->ptr + bufsz) > rg->end) rg->ptr = rg->base;
 
+        if (!pollagain) plugin_pipe_spin(rg->ptr, seq);
+
 	if (((struct ch_buf_hdr *)rg->ptr)->seq != seq) {
 	  if (!pollagain) {
 	    pollagain = TRUE;
@@ -312,12 +314,14 @@ void print_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
             }
 
 	    rg->ptr = (rg->base + status->last_buf_off);
+	    plugin_pipe_resync(status);
             seq = ((struct ch_buf_hdr *)rg->ptr)->seq;
           }
         }
 
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
+        status->tail++;
         rg->ptr += bufsz;
       }
 #ifdef WITH_ZMQ
@@ -380,6 +384,37 @@ void print_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
   }
 }
 
+#ifdef WITH_JANSSON
+/* P_encode_func: same as the serial JSON path in P_cache_purge() */
+static char *P_encode_json(struct chained_cache *cc, void *arg)
+{
+  struct json_stream js;
+  json_t *json_obj;
+  int idx;
+
+  if (cjstream) {
+    json_stream_init(&js, JSON_STREAM_BUFLEN);
+    compose_json_stream_acct(&js, cc);
+    compose_json_stream_splice(&js, compose_json_sav_fields, cc);
+    json_stream_close(&js);
+
+    return json_stream_detach(&js);
+  }
+
+  json_obj = json_object();
+
+  for (idx = 0; idx < N_PRIMITIVES && cjhandler[idx]; idx++) cjhandler[idx](json_obj, cc);
+  compose_json_sav_fields(json_obj, cc);
+
+  return compose_json_str(json_obj);
+}
+#else
+static char *P_encode_json(struct chained_cache *cc, void *arg)
+{
+  return NULL;
+}
+#endif
+
 void P_cache_purge(struct chained_cache *queue[], int index, int safe_action)
 {
   struct pkt_primitives *data = NULL;
@@ -404,9 +439,17 @@ void P_cache_purge(struct chained_cache *queue[], int index, int safe_action)
   FILE *f = NULL, *lockf = NULL;
   int j, stop, is_event = FALSE, qn = 0, go_to_pending, saved_index = index, file_to_be_created;
   time_t start, duration;
+  struct timeval stage;
+  u_int64_t stage_prep, stage_enc = 0, stage_out = 0;
+  char **encoded = NULL;
+#ifdef WITH_JANSSON
+  struct json_stream js;
+#endif
   char tmpbuf[SRVBUFLEN], current_table[SRVBUFLEN], elem_table[SRVBUFLEN];
   struct primitives_ptrs prim_ptrs, elem_prim_ptrs;
   struct pkt_data dummy_data, elem_dummy_data;
+  struct chained_cache **pending_queue = NULL;
+  int pending_ptr = 0;
   pid_t writer_pid = getpid();
 #ifdef WITH_AVRO
   avro_file_writer_t p_avro_writer;
@@ -436,19 +479,35 @@ void P_cache_purge(struct chained_cache *queue[], int index, int safe_action)
 
   fd_buf = malloc(OUTPUT_FILE_BUFSZ);
 
+#ifdef WITH_JANSSON
+  if (config.print_output & PRINT_OUTPUT_JSON) json_stream_init(&js, JSON_STREAM_BUFLEN);
+#endif
+
+  gettimeofday(&stage, NULL);
+
   for (j = 0, stop = 0; (!stop) && P_preprocess_funcs[j]; j++)
     stop = P_preprocess_funcs[j](queue, &index, j);
 
-  memcpy(pending_queries_queue, queue, index*sizeof(struct db_cache *));
-  pqq_ptr = index;
+  stage_prep = P_purge_stage_msec(&stage);
+
+  /* not using the global pending_queries_queue: with print_writer_threads the
+     plugin keeps using it while we purge */
+  pending_queue = malloc((index ? index : 1)*sizeof(struct chained_cache *));
+  if (!pending_queue) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() pending_queue. Exiting.\n", config.name, config.type);
+    exit_gracefully(1);
+  }
+
+  memcpy(pending_queue, queue, index*sizeof(struct chained_cache *));
+  pending_ptr = index;
 
   Log(LOG_INFO, "INFO ( %s/%s ): *** Purging cache - START (PID: %u) ***\n", config.name, config.type, writer_pid);
   start = time(NULL);
 
   start:
-  memcpy(queue, pending_queries_queue, pqq_ptr*sizeof(struct db_cache *));
-  memset(pending_queries_queue, 0, pqq_ptr*sizeof(struct db_cache *));
-  index = pqq_ptr; pqq_ptr = 0; file_to_be_created = FALSE;
+  memcpy(queue, pending_queue, pending_ptr*sizeof(struct chained_cache *));
+  memset(pending_queue, 0, pending_ptr*sizeof(struct chained_cache *));
+  index = pending_ptr; pending_ptr = 0; file_to_be_created = FALSE;
 
   if (config.print_output & PRINT_OUTPUT_EVENT) is_event = TRUE;
 
@@ -569,9 +628,21 @@ void P_cache_purge(struct chained_cache *queue[], int index, int safe_action)
         P_write_stats_header_formatted(stdout, is_event);
       else if (config.print_output & PRINT_OUTPUT_CSV)
         P_write_stats_header_csv(stdout, is_event);
+
+      /* no forked copy of the flag with writer threads: clear it here */
+      if (P_writer_pool && index) print_output_stdout_header = FALSE;
     }
   }
 
+  stage_out += P_purge_stage_msec(&stage);
+
+  /* with dynamic tables entries may be deferred to a later pass: encode serially */
+  if (!dyn_table && (config.print_output & PRINT_OUTPUT_JSON)) {
+    encoded = P_encode_queue(queue, index, P_encode_json, NULL);
+  }
+
+  stage_enc += P_purge_stage_msec(&stage);
+
   for (j = 0; j < index; j++) {
     int count = 0;
     go_to_pending = FALSE;
@@ -589,9 +660,9 @@ void P_cache_purge(struct chained_cache *queue[], int index, int safe_action)
       pm_strftime_same(elem_table, SRVBUFLEN, tmpbuf, &stamp, config.timestamps_utc);
 
       if (strncmp(current_table, elem_table, SRVBUFLEN)) {
-        pending_queries_queue[pqq_ptr] = queue[j];
+        pending_queue[pending_ptr] = queue[j];
 
-        pqq_ptr++;
+        pending_ptr++;
         go_to_pending = TRUE;
       }
     }
@@ -1380,15 +1451,34 @@ void P_cache_purge(struct chained_cache *queue[], int index, int safe_action)
       }
       else if (f && config.print_output & PRINT_OUTPUT_JSON) {
 #ifdef WITH_JANSSON
-	json_t *json_obj = json_object();
-	int idx;
-
-	for (idx = 0; idx < N_PRIMITIVES && cjhandler[idx]; idx++) cjhandler[idx](json_obj, queue[j]);
-        
-        /* Add SAV fields if present */
-        compose_json_sav_fields(json_obj, queue[j]);
-        
-        if (json_obj) write_and_free_json(f, json_obj);
+	if (encoded) {
+	  if (encoded[j]) {
+	    fprintf(f, "%s\n", encoded[j]);
+	    free(encoded[j]);
+	    encoded[j] = NULL;
+	  }
+	}
+	else if (cjstream) {
+	  compose_json_stream_acct(&js, queue[j]);
+
+	  /* Add SAV fields if present */
+	  compose_json_stream_splice(&js, compose_json_sav_fields, queue[j]);
+
+	  json_stream_close(&js);
+	  fwrite(js.buf, 1, js.len, f);
+	  fputc('\n', f);
+	}
+	else {
+	  json_t *json_obj = json_object();
+	  int idx;
+
+	  for (idx = 0; idx < N_PRIMITIVES && cjhandler[idx]; idx++) cjhandler[idx](json_obj, queue[j]);
+
+	  /* Add SAV fields if present */
+	  compose_json_sav_fields(json_obj, queue[j]);
+
+	  if (json_obj) write_and_free_json(f, json_obj);
+	}
 #endif
       }
       else if (f &&
@@ -1435,6 +1525,9 @@ void P_cache_purge(struct chained_cache *queue[], int index, int safe_action)
   }
 
   duration = time(NULL)-start;
+  stage_out += P_purge_stage_msec(&stage);
+  P_encoded_free(encoded, index);
+  encoded = NULL;
 
   if (f && config.print_markers) {
     if ((config.print_output & PRINT_OUTPUT_CSV) || (config.print_output & PRINT_OUTPUT_FORMATTED))
@@ -1495,14 +1588,20 @@ void P_cache_purge(struct chained_cache *queue[], int index, int safe_action)
   }
 
   /* If we have pending queries then start again */
-  if (pqq_ptr) goto start;
+  if (pending_ptr) goto start;
 
   Log(LOG_INFO, "INFO ( %s/%s ): *** Purging cache - END (PID: %u, QN: %u/%u, ET: %lu) ***\n",
 		config.name, config.type, writer_pid, qn, saved_index, (long)duration);
+  Log(LOG_INFO, "INFO ( %s/%s ): Purging cache - stages (PID: %u, preprocess: %" PRIu64 " ms, encode: %" PRIu64 " ms, output: %" PRIu64 " ms)\n",
+		config.name, config.type, writer_pid, stage_prep, stage_enc, stage_out);
 
   if (config.sql_trigger_exec && !safe_action) P_trigger_exec(config.sql_trigger_exec); 
 
   if (empty_pcust) free(empty_pcust);
+  if (pending_queue) free(pending_queue);
+#ifdef WITH_JANSSON
+  if (config.print_output & PRINT_OUTPUT_JSON) json_stream_free(&js);
+#endif
 }
 
 void P_write_stats_header_formatted(FILE *f, int is_event)
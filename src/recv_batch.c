@@ -0,0 +1,181 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* recvmmsg() and struct mmsghdr are GNU extensions */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* includes */
+#include "pmacct.h"
+#include "recv_batch.h"
+
+/* functions */
+int pm_recv_batch_init(struct pm_recv_batch *rb, int fd, u_int32_t size, u_int32_t msg_size)
+{
+  memset(rb, 0, sizeof(struct pm_recv_batch));
+
+#if defined HAVE_RECVMMSG
+  u_int32_t idx;
+
+  if (size > RECV_BATCH_MAX) {
+    Log(LOG_WARNING, "WARN ( %s/core ): %s_recv_batch capped to %u.\n", config.name, config.progname, RECV_BATCH_MAX);
+    size = RECV_BATCH_MAX;
+  }
+
+  rb->bufs = malloc(size * msg_size);
+  rb->addrs = malloc(size * sizeof(struct sockaddr_storage));
+  rb->iovs = malloc(size * sizeof(struct iovec));
+  rb->msgs = malloc(size * sizeof(struct mmsghdr));
+  rb->cmsgs = malloc(size * RECV_BATCH_CMSG_LEN);
+
+  if (!rb->bufs || !rb->addrs || !rb->iovs || !rb->msgs || !rb->cmsgs) {
+    Log(LOG_ERR, "ERROR ( %s/core ): pm_recv_batch_init(): unable to allocate %u x %u bytes receive batch.\n", config.name, size, msg_size);
+    pm_recv_batch_free(rb);
+    return ERR;
+  }
+
+  memset(rb->msgs, 0, size * sizeof(struct mmsghdr));
+
+  for (idx = 0; idx < size; idx++) {
+    rb->iovs[idx].iov_base = rb->bufs + (idx * msg_size);
+    rb->iovs[idx].iov_len = msg_size;
+
+    rb->msgs[idx].msg_hdr.msg_iov = &rb->iovs[idx];
+    rb->msgs[idx].msg_hdr.msg_iovlen = 1;
+  }
+
+#if defined SO_RXQ_OVFL
+  {
+    int yes = TRUE;
+
+    if (!setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &yes, (socklen_t) sizeof(yes))) rb->rxq_ovfl = TRUE;
+    else Log(LOG_WARNING, "WARN ( %s/core ): setsockopt() failed for SO_RXQ_OVFL (errno: %d).\n", config.name, errno);
+  }
+#endif
+
+  rb->fd = fd;
+  rb->size = size;
+  rb->msg_size = msg_size;
+
+  Log(LOG_INFO, "INFO ( %s/core ): %s_recv_batch: reading up to %u datagrams per syscall.\n", config.name, config.progname, size);
+
+  return SUCCESS;
+#else
+  Log(LOG_WARNING, "WARN ( %s/core ): %s_recv_batch not supported on this platform (missing recvmmsg()). Ignored.\n", config.name, config.progname);
+
+  return ERR;
+#endif
+}
+
+#if defined HAVE_RECVMMSG
+static void pm_recv_batch_parse_cmsg(struct pm_recv_batch *rb, struct msghdr *mhdr)
+{
+#if defined SO_RXQ_OVFL
+  struct cmsghdr *cmsg;
+
+  for (cmsg = CMSG_FIRSTHDR(mhdr); cmsg; cmsg = CMSG_NXTHDR(mhdr, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+      memcpy(&rb->stats.kernel_drops, CMSG_DATA(cmsg), sizeof(u_int32_t));
+    }
+  }
+#endif
+}
+#endif
+
+/*
+   Returns the next datagram of the batch, refilling the batch via
+   recvmmsg() once drained. The blocking behaviour mimics recvfrom():
+   we wait for at least one datagram and then grab whatever else is
+   already queued (MSG_WAITFORONE). Returned buffers stay valid until
+   the following call.
+*/
+ssize_t pm_recv_batch_next(struct pm_recv_batch *rb, unsigned char **pkt, struct sockaddr_storage *client, socklen_t *clen)
+{
+#if defined HAVE_RECVMMSG
+  struct msghdr *mhdr;
+  u_int32_t idx;
+  int ret;
+
+  if (rb->idx >= rb->count) {
+    for (idx = 0; idx < rb->size; idx++) {
+      rb->msgs[idx].msg_hdr.msg_name = &rb->addrs[idx];
+      rb->msgs[idx].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+
+      if (rb->rxq_ovfl) {
+	rb->msgs[idx].msg_hdr.msg_control = rb->cmsgs + (idx * RECV_BATCH_CMSG_LEN);
+	rb->msgs[idx].msg_hdr.msg_controllen = RECV_BATCH_CMSG_LEN;
+      }
+    }
+
+    rb->idx = 0;
+    rb->count = 0;
+
+    ret = recvmmsg(rb->fd, rb->msgs, rb->size, MSG_WAITFORONE, NULL);
+    if (ret <= 0) return ret;
+
+    rb->count = ret;
+    rb->stats.syscalls++;
+    rb->stats.datagrams += ret;
+    if ((u_int32_t) ret == rb->size) rb->stats.full++;
+
+    /* the kernel counter is cumulative: the last datagram has the most recent value */
+    if (rb->rxq_ovfl) pm_recv_batch_parse_cmsg(rb, &rb->msgs[ret - 1].msg_hdr);
+  }
+
+  idx = rb->idx++;
+  mhdr = &rb->msgs[idx].msg_hdr;
+
+  (*pkt) = rb->iovs[idx].iov_base;
+  memcpy(client, &rb->addrs[idx], mhdr->msg_namelen);
+  if (clen) (*clen) = mhdr->msg_namelen;
+
+  return rb->msgs[idx].msg_len;
+#else
+  return ERR;
+#endif
+}
+
+void pm_recv_batch_print_stats(struct pm_recv_batch *rb, time_t now)
+{
+  float fill_ratio = 0;
+
+  if (!rb->size) return;
+
+  if (rb->stats.syscalls) {
+    fill_ratio = ((float) rb->stats.datagrams / (rb->stats.syscalls * rb->size));
+  }
+
+  Log(LOG_NOTICE, "NOTICE ( %s/%s ): stats [recv_batch] time=%ld batch_size=%u syscalls=%" PRIu64 " datagrams=%" PRIu64 " full_batches=%" PRIu64 " fill_ratio=%.2f kernel_drops=%u\n",
+      config.name, config.type, (long)now, rb->size, rb->stats.syscalls, rb->stats.datagrams,
+      rb->stats.full, fill_ratio, rb->stats.kernel_drops);
+}
+
+void pm_recv_batch_free(struct pm_recv_batch *rb)
+{
+  if (rb->bufs) free(rb->bufs);
+  if (rb->addrs) free(rb->addrs);
+  if (rb->iovs) free(rb->iovs);
+  if (rb->msgs) free(rb->msgs);
+  if (rb->cmsgs) free(rb->cmsgs);
+
+  memset(rb, 0, sizeof(struct pm_recv_batch));
+}
@@ -0,0 +1,62 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef RECV_BATCH_H
+#define RECV_BATCH_H
+
+/* defines */
+#define RECV_BATCH_MAX		1024
+#define RECV_BATCH_CMSG_LEN	64
+
+/* structures */
+struct pm_recv_batch_stats
+{
+  u_int64_t syscalls;		/* recvmmsg() calls returning data */
+  u_int64_t datagrams;		/* datagrams returned across all calls */
+  u_int64_t full;		/* calls that filled the whole batch */
+  u_int32_t kernel_drops;	/* last SO_RXQ_OVFL value reported by the kernel */
+};
+
+struct pm_recv_batch
+{
+  int fd;
+  u_int32_t size;		/* configured batch size; 0 means disabled */
+  u_int32_t msg_size;		/* size of each datagram buffer */
+  u_int32_t count;		/* datagrams returned by the last recvmmsg() */
+  u_int32_t idx;		/* next datagram to hand out */
+  int rxq_ovfl;			/* SO_RXQ_OVFL successfully enabled */
+
+  unsigned char *bufs;		/* size * msg_size contiguous buffers */
+  struct sockaddr_storage *addrs;
+  struct iovec *iovs;
+  struct mmsghdr *msgs;
+  unsigned char *cmsgs;		/* size * RECV_BATCH_CMSG_LEN control buffers */
+
+  struct pm_recv_batch_stats stats;
+};
+
+/* prototypes */
+extern int pm_recv_batch_init(struct pm_recv_batch *, int, u_int32_t, u_int32_t);
+extern ssize_t pm_recv_batch_next(struct pm_recv_batch *, unsigned char **, struct sockaddr_storage *, socklen_t *);
+extern void pm_recv_batch_print_stats(struct pm_recv_batch *, time_t);
+extern void pm_recv_batch_free(struct pm_recv_batch *);
+
+#endif // RECV_BATCH_H
@@ -0,0 +1,254 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "thread_pool.h"
+#include "recv_batch.h"
+#include "recv_queue.h"
+
+/* functions */
+int pm_recv_queue_init(struct pm_recv_queue *rq, int fd, u_int32_t size, u_int32_t msg_size, struct pm_recv_batch *rb)
+{
+  u_int32_t idx, slots = 1;
+
+  memset(rq, 0, sizeof(struct pm_recv_queue));
+
+  if (size > RECV_QUEUE_MAX) {
+    Log(LOG_WARNING, "WARN ( %s/core ): %s_recv_queue capped to %u.\n", config.name, config.progname, RECV_QUEUE_MAX);
+    size = RECV_QUEUE_MAX;
+  }
+
+  /* ring indexes are masked, hence the power of two */
+  while (slots < size) slots <<= 1;
+
+  rq->bufs = malloc((size_t) slots * msg_size);
+  rq->discard = malloc(msg_size);
+  rq->slots = malloc(slots * sizeof(struct pm_recv_queue_slot));
+
+  if (!rq->bufs || !rq->discard || !rq->slots) {
+    Log(LOG_ERR, "ERROR ( %s/core ): pm_recv_queue_init(): unable to allocate %u x %u bytes receive queue.\n", config.name, slots, msg_size);
+
+    if (rq->bufs) free(rq->bufs);
+    if (rq->discard) free(rq->discard);
+    if (rq->slots) free(rq->slots);
+    memset(rq, 0, sizeof(struct pm_recv_queue));
+
+    return ERR;
+  }
+
+  memset(rq->slots, 0, slots * sizeof(struct pm_recv_queue_slot));
+  for (idx = 0; idx < slots; idx++) rq->slots[idx].buf = rq->bufs + ((size_t) idx * msg_size);
+
+  pthread_mutex_init(&rq->mutex, NULL);
+  pthread_cond_init(&rq->cond, NULL);
+
+  rq->fd = fd;
+  rq->size = slots;
+  rq->msg_size = msg_size;
+  if (rb && rb->size) rq->rb = rb;
+
+  Log(LOG_INFO, "INFO ( %s/core ): %s_recv_queue: buffering up to %u datagrams between receive and processing.\n", config.name, config.progname, slots);
+
+  return SUCCESS;
+}
+
+static ssize_t pm_recv_queue_recv(struct pm_recv_queue *rq, unsigned char *buf, struct sockaddr_storage *client, socklen_t *clen)
+{
+  unsigned char *pkt;
+  ssize_t ret;
+
+  if (rq->rb) {
+    ret = pm_recv_batch_next(rq->rb, &pkt, client, clen);
+    if (ret > 0 && buf) memcpy(buf, pkt, ret);
+  }
+  else {
+    (*clen) = sizeof(struct sockaddr_storage);
+    ret = recvfrom(rq->fd, (buf ? buf : rq->discard), rq->msg_size, 0, (struct sockaddr *) client, clen);
+  }
+
+  return ret;
+}
+
+/*
+   Receive errors: interrupted or empty reads are retried right away;
+   errors that can't go away (ie. the socket is gone) are fatal, as
+   nothing would ever be received again; anything else (ie. ENOMEM,
+   ENOBUFS) is logged, at most once per second, and backed off from so
+   that a persistent error does not pin a core.
+*/
+static void pm_recv_queue_error(struct pm_recv_queue *rq, int err)
+{
+  time_t now;
+
+  switch (err) {
+  case EINTR:
+  case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+  case EWOULDBLOCK:
+#endif
+    return;
+  case EBADF:
+  case ENOTSOCK:
+  case EINVAL:
+  case EFAULT:
+    Log(LOG_ERR, "ERROR ( %s/core ): %s_recv_queue: unable to receive: %s. Exiting.\n", config.name, config.progname, strerror(err));
+    exit_gracefully(1);
+    break;
+  default:
+    rq->stats.errors++;
+    now = time(NULL);
+
+    if (now != rq->error_tstamp) {
+      Log(LOG_WARNING, "WARN ( %s/core ): %s_recv_queue: unable to receive: %s\n", config.name, config.progname, strerror(err));
+      rq->error_tstamp = now;
+    }
+
+    usleep(RECV_QUEUE_ERROR_BACKOFF);
+    break;
+  }
+}
+
+/* receive thread: the only writer of 'head' */
+static int pm_recv_queue_producer(void *arg)
+{
+  struct pm_recv_queue *rq = arg;
+  struct pm_recv_queue_slot *slot;
+  struct sockaddr_storage client;
+  socklen_t clen;
+  u_int32_t head, depth;
+  ssize_t ret;
+
+  for (;;) {
+    head = rq->head;
+    depth = (head - rq->tail);
+
+    if (depth >= rq->size) {
+      ret = pm_recv_queue_recv(rq, NULL, &client, &clen);
+      if (ret > 0) rq->stats.drops++;
+      else if (ret < 0) pm_recv_queue_error(rq, errno);
+
+      continue;
+    }
+
+    slot = &rq->slots[head & (rq->size - 1)];
+
+    ret = pm_recv_queue_recv(rq, slot->buf, &slot->client, &slot->clen);
+    if (ret < 0) {
+      pm_recv_queue_error(rq, errno);
+      continue;
+    }
+
+    /* short datagram, not even a version field: not worth a slot */
+    if (ret < 2) continue;
+
+    slot->len = ret;
+
+    /* slot contents must be visible before the slot is published */
+    __sync_synchronize();
+    rq->head = (head + 1);
+
+    rq->stats.enqueued++;
+    if ((depth + 1) > rq->stats.max_depth) rq->stats.max_depth = (depth + 1);
+
+    /* pairs with the barrier in pm_recv_queue_next(): no lost wake-ups */
+    __sync_synchronize();
+
+    if (rq->waiting) {
+      pthread_mutex_lock(&rq->mutex);
+      pthread_cond_signal(&rq->cond);
+      pthread_mutex_unlock(&rq->mutex);
+    }
+  }
+
+  return SUCCESS;
+}
+
+void pm_recv_queue_start(struct pm_recv_queue *rq)
+{
+  sigset_t signal_set, saved_set;
+
+  if (!rq->size) return;
+
+  /* signals are left to the Core Process thread */
+  sigfillset(&signal_set);
+  pthread_sigmask(SIG_BLOCK, &signal_set, &saved_set);
+  rq->pool = allocate_thread_pool(1);
+  pthread_sigmask(SIG_SETMASK, &saved_set, NULL);
+
+  if (!rq->pool) {
+    Log(LOG_ERR, "ERROR ( %s/core ): Unable to start %s_recv_queue thread. Exiting.\n", config.name, config.progname);
+    exit_gracefully(1);
+  }
+
+  send_to_pool(rq->pool, pm_recv_queue_producer, rq);
+}
+
+/*
+   Returns the next datagram in the ring, sleeping while the ring is empty.
+   Like pm_recv_batch_next(), the returned buffer stays valid (and owned by
+   the caller, which may modify it) until the following call.
+*/
+ssize_t pm_recv_queue_next(struct pm_recv_queue *rq, unsigned char **pkt, struct sockaddr_storage *client, socklen_t *clen)
+{
+  struct pm_recv_queue_slot *slot;
+
+  if (rq->pending) {
+    /* done with the previous slot: hand it back to the producer */
+    __sync_synchronize();
+    rq->tail++;
+    rq->pending = FALSE;
+  }
+
+  while (rq->head == rq->tail) {
+    pthread_mutex_lock(&rq->mutex);
+    rq->waiting = TRUE;
+    __sync_synchronize();
+
+    if (rq->head == rq->tail) pthread_cond_wait(&rq->cond, &rq->mutex);
+
+    rq->waiting = FALSE;
+    pthread_mutex_unlock(&rq->mutex);
+  }
+
+  /* slot contents must not be read before 'head' */
+  __sync_synchronize();
+
+  slot = &rq->slots[rq->tail & (rq->size - 1)];
+  rq->pending = TRUE;
+  rq->stats.dequeued++;
+
+  (*pkt) = slot->buf;
+  memcpy(client, &slot->client, slot->clen);
+  if (clen) (*clen) = slot->clen;
+
+  return slot->len;
+}
+
+void pm_recv_queue_print_stats(struct pm_recv_queue *rq, time_t now)
+{
+  if (!rq->size) return;
+
+  Log(LOG_NOTICE, "NOTICE ( %s/%s ): stats [recv_queue] time=%ld queue_size=%u depth=%u max_depth=%u enqueued=%" PRIu64 " dequeued=%" PRIu64 " queue_drops=%" PRIu64 " recv_errors=%" PRIu64 "\n",
+      config.name, config.type, (long)now, rq->size, (rq->head - rq->tail), rq->stats.max_depth,
+      rq->stats.enqueued, rq->stats.dequeued, rq->stats.drops, rq->stats.errors);
+}
@@ -0,0 +1,90 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef RECV_QUEUE_H
+#define RECV_QUEUE_H
+
+/*
+   Decouples socket reads from datagram processing: a dedicated receive
+   thread drains the collector socket into a single-producer single-consumer
+   ring of datagram slots, while the Core Process thread decodes, enriches
+   and hands records over to the plugins. A slow consumer (ie. BGP lookups
+   under churn, map reloads) makes the ring fill up instead of the kernel
+   socket buffer; datagrams arriving with the ring full are read and
+   discarded so that drops are accounted for.
+*/
+
+/* defines */
+#define RECV_QUEUE_MAX		65536
+#define RECV_QUEUE_CACHE_LINE	64
+#define RECV_QUEUE_ERROR_BACKOFF	10000	/* usecs */
+
+/* structures */
+struct pm_recv_queue_slot
+{
+  ssize_t len;
+  socklen_t clen;
+  struct sockaddr_storage client;
+  unsigned char *buf;
+};
+
+struct pm_recv_queue_stats
+{
+  u_int64_t enqueued;		/* datagrams handed over to the consumer */
+  u_int64_t dequeued;		/* datagrams picked up by the consumer */
+  u_int64_t drops;		/* datagrams discarded on a full ring */
+  u_int64_t errors;		/* failed receives, retried after a back-off */
+  u_int32_t max_depth;		/* high-water mark of the ring */
+};
+
+struct pm_recv_queue
+{
+  int fd;
+  u_int32_t size;		/* ring slots, power of two; 0 means disabled */
+  u_int32_t msg_size;		/* size of each datagram buffer */
+  struct pm_recv_batch *rb;	/* optional: receive via recvmmsg() */
+  int pending;			/* consumer holds the slot at 'tail' */
+  time_t error_tstamp;		/* last receive error logged */
+
+  unsigned char *bufs;		/* size * msg_size contiguous buffers */
+  unsigned char *discard;	/* scratch buffer for datagrams dropped */
+  struct pm_recv_queue_slot *slots;
+  thread_pool_t *pool;
+
+  /* producer and consumer indexes, free running, kept apart */
+  volatile u_int32_t head __attribute__ ((aligned (RECV_QUEUE_CACHE_LINE)));
+  volatile u_int32_t tail __attribute__ ((aligned (RECV_QUEUE_CACHE_LINE)));
+  volatile int waiting;		/* consumer sleeping on 'cond' */
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  struct pm_recv_queue_stats stats;
+};
+
+/* prototypes */
+extern int pm_recv_queue_init(struct pm_recv_queue *, int, u_int32_t, u_int32_t, struct pm_recv_batch *);
+extern void pm_recv_queue_start(struct pm_recv_queue *);
+extern ssize_t pm_recv_queue_next(struct pm_recv_queue *, unsigned char **, struct sockaddr_storage *, socklen_t *);
+extern void pm_recv_queue_print_stats(struct pm_recv_queue *, time_t);
+
+#endif // RECV_QUEUE_H
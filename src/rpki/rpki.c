@@ -149,6 +149,8 @@ int rpki_daemon()
     if (config.rpki_rtr_cache) rpki_cache.now = time(NULL);
     if (select_num < 0) goto select_again;
 
+    bgp_epoch_reclaim();
+
     /* signals handling */
     if (reload_map_rpki_thread) {
       rpki_roas_file_reload();
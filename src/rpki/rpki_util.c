@@ -68,10 +68,13 @@ void rpki_ribs_free(struct bgp_peer *peer, struct bgp_table *rib_v4, struct bgp_
 
 void rpki_ribs_reset(struct bgp_peer *peer, struct bgp_table **rib_v4, struct bgp_table **rib_v6)
 {
-  rpki_ribs_free(peer, (*rib_v4), (*rib_v6));
+  struct bgp_table *old_v4 = (*rib_v4), *old_v6 = (*rib_v6);
 
+  /* publish the empty tables first so that lookups never see freed ones */
   (*rib_v4) = bgp_table_init(AFI_IP, SAFI_UNICAST);
   (*rib_v6) = bgp_table_init(AFI_IP6, SAFI_UNICAST);
+
+  rpki_ribs_free(peer, old_v4, old_v6);
 }
 
 void rpki_rtr_set_dont_reconnect(struct rpki_rtr_handle *cache)
@@ -22,6 +22,7 @@
 /* includes */
 #include "pmacct.h"
 #include "imt_plugin.h"
+#include "imt_sidx.h"
 #include "ip_flow.h"
 #include "classifier.h"
 #include "bgp/bgp_packet.h"
@@ -61,12 +62,73 @@ int build_query_server(char *path_ptr)
 }
 
 
+/* enqueues 'acc_elem' along with the structures of the non-standard primitives it carries */
+static void enQueue_acc(int sd, struct reply_buffer *rb, struct acc *acc_elem, struct extra_primitives *extras, int datasize)
+{
+  enQueue_elem(sd, rb, acc_elem, PdataSz, datasize);
+
+  if (extras->off_pkt_bgp_primitives && acc_elem->pbgp) {
+    enQueue_elem(sd, rb, acc_elem->pbgp, PbgpSz, datasize - extras->off_pkt_bgp_primitives);
+  }
+
+  if (extras->off_pkt_lbgp_primitives) {
+    if (acc_elem->clbgp) {
+      struct pkt_legacy_bgp_primitives tmp_plbgp;
+
+      cache_to_pkt_legacy_bgp_primitives(&tmp_plbgp, acc_elem->clbgp);
+      enQueue_elem(sd, rb, &tmp_plbgp, PlbgpSz, datasize - extras->off_pkt_lbgp_primitives);
+    }
+  }
+
+  if (extras->off_pkt_nat_primitives && acc_elem->pnat) {
+    enQueue_elem(sd, rb, acc_elem->pnat, PnatSz, datasize - extras->off_pkt_nat_primitives);
+  }
+
+  if (extras->off_pkt_mpls_primitives && acc_elem->pmpls) {
+    enQueue_elem(sd, rb, acc_elem->pmpls, PmplsSz, datasize - extras->off_pkt_mpls_primitives);
+  }
+
+  if (extras->off_pkt_tun_primitives && acc_elem->ptun) {
+    enQueue_elem(sd, rb, acc_elem->ptun, PtunSz, datasize - extras->off_pkt_tun_primitives);
+  }
+
+  if (extras->off_custom_primitives && acc_elem->pcust) {
+    enQueue_elem(sd, rb, acc_elem->pcust, config.cpptrs.len, datasize - extras->off_custom_primitives);
+  }
+
+  if (extras->off_pkt_vlen_hdr_primitives && acc_elem->pvlen) {
+    enQueue_elem(sd, rb, acc_elem->pvlen, PvhdrSz + acc_elem->pvlen->tot_len, datasize - extras->off_pkt_vlen_hdr_primitives);
+  }
+}
+
+/*
+   Fetches the top-N block of a query; returns FALSE if WANT_TOPN is not
+   set or the block does not fit in the 'len' bytes received
+*/
+int query_topn_get(unsigned char *buf, int len, struct query_topn *qt)
+{
+  struct query_header *q = (struct query_header *) buf;
+  size_t off;
+
+  memset(qt, 0, sizeof(struct query_topn));
+
+  if (len < (int) sizeof(struct query_header) || !(q->type & WANT_TOPN)) return FALSE;
+
+  off = (sizeof(struct query_header) + ((size_t) q->num * sizeof(struct query_entry)));
+  if ((off + sizeof(struct query_topn)) > (size_t) len) return FALSE;
+
+  memcpy(qt, (buf + off), sizeof(struct query_topn));
+
+  return TRUE;
+}
+
 void process_query_data(int sd, unsigned char *buf, int len, struct extra_primitives *extras, int datasize, int forked)
 {
   struct acc *acc_elem = 0;
   struct bucket_desc bd;
   struct query_header *q, *uq;
   struct query_entry request;
+  struct query_topn qt;
   struct reply_buffer rb;
   unsigned char *elem, *bufptr;
   int following_chain=0;
@@ -157,7 +219,30 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
 
   reset_counter = q->type & WANT_RESET;
 
-  if (q->type & WANT_STATS) {
+  if ((q->type & WANT_STATS) && query_topn_get(buf, len, &qt) && imt_topn_serves(qt.counter, qt.howmany)) {
+    struct acc **topn_list;
+    u_int32_t topn_idx, topn_num;
+
+    q->what_to_count = config.what_to_count;
+    q->what_to_count_2 = config.what_to_count_2;
+    q->what_to_count_3 = config.what_to_count_3;
+
+    /* served off the top-N heaps, no walk through the table */
+    topn_list = malloc(imt_topn[qt.counter - 1].max * sizeof(struct acc *));
+    if (!topn_list) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() topn_list. Exiting.\n", config.name, config.type);
+      exit_gracefully(1);
+    }
+
+    topn_num = imt_topn_get((qt.counter - 1), topn_list, qt.howmany);
+    for (topn_idx = 0; topn_idx < topn_num; topn_idx++) {
+      if (!test_zero_elem(topn_list[topn_idx])) enQueue_acc(sd, &rb, topn_list[topn_idx], extras, datasize);
+    }
+
+    free(topn_list);
+    if (rb.packed) send(sd, rb.buf, rb.packed, 0); /* send remainder data */
+  }
+  else if (q->type & WANT_STATS) {
     q->what_to_count = config.what_to_count; 
     q->what_to_count_2 = config.what_to_count_2; 
     q->what_to_count_3 = config.what_to_count_3; 
@@ -165,40 +250,7 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
     for (idx = 0; idx < config.buckets; idx++) {
       if (!following_chain) acc_elem = (struct acc *) elem;
       if (!test_zero_elem(acc_elem)) {
-	enQueue_elem(sd, &rb, acc_elem, PdataSz, datasize);
-
-        if (extras->off_pkt_bgp_primitives && acc_elem->pbgp) {
-          enQueue_elem(sd, &rb, acc_elem->pbgp, PbgpSz, datasize - extras->off_pkt_bgp_primitives);
-        }
-
-        if (extras->off_pkt_lbgp_primitives) {
-          if (acc_elem->clbgp) {
-            struct pkt_legacy_bgp_primitives tmp_plbgp;
-
-            cache_to_pkt_legacy_bgp_primitives(&tmp_plbgp, acc_elem->clbgp);
-            enQueue_elem(sd, &rb, &tmp_plbgp, PlbgpSz, datasize - extras->off_pkt_lbgp_primitives);
-          }
-        }
-
-        if (extras->off_pkt_nat_primitives && acc_elem->pnat) {
-          enQueue_elem(sd, &rb, acc_elem->pnat, PnatSz, datasize - extras->off_pkt_nat_primitives);
-	}
-
-        if (extras->off_pkt_mpls_primitives && acc_elem->pmpls) {
-          enQueue_elem(sd, &rb, acc_elem->pmpls, PmplsSz, datasize - extras->off_pkt_mpls_primitives);
-	}
-
-        if (extras->off_pkt_tun_primitives && acc_elem->ptun) {
-          enQueue_elem(sd, &rb, acc_elem->ptun, PtunSz, datasize - extras->off_pkt_tun_primitives);
-	}
-
-        if (extras->off_custom_primitives && acc_elem->pcust) {
-          enQueue_elem(sd, &rb, acc_elem->pcust, config.cpptrs.len, datasize - extras->off_custom_primitives);
-        }
-
-        if (extras->off_pkt_vlen_hdr_primitives && acc_elem->pvlen) {
-          enQueue_elem(sd, &rb, acc_elem->pvlen, PvhdrSz + acc_elem->pvlen->tot_len, datasize - extras->off_pkt_vlen_hdr_primitives);
-        }
+	enQueue_acc(sd, &rb, acc_elem, extras, datasize);
       } 
       if (acc_elem->next != NULL) {
         Log(LOG_DEBUG, "DEBUG ( %s/%s ): Following chain in reply ...\n", config.name, config.type);
@@ -265,40 +317,7 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
         acc_elem = search_accounting_structure(&prim_ptrs);
         if (acc_elem) { 
 	  if (!test_zero_elem(acc_elem)) {
-	    enQueue_elem(sd, &rb, acc_elem, PdataSz, datasize);
-
-            if (extras->off_pkt_bgp_primitives && acc_elem->pbgp) {
-              enQueue_elem(sd, &rb, acc_elem->pbgp, PbgpSz, datasize - extras->off_pkt_bgp_primitives);
-            }
-
-            if (extras->off_pkt_lbgp_primitives) {
-              if (acc_elem->clbgp) {
-                struct pkt_legacy_bgp_primitives tmp_plbgp;
-
-                cache_to_pkt_legacy_bgp_primitives(&tmp_plbgp, acc_elem->clbgp);
-                enQueue_elem(sd, &rb, &tmp_plbgp, PlbgpSz, datasize - extras->off_pkt_lbgp_primitives);
-              }
-            }
-
-            if (extras->off_pkt_nat_primitives && acc_elem->pnat) {
-              enQueue_elem(sd, &rb, acc_elem->pnat, PnatSz, datasize - extras->off_pkt_nat_primitives);
-            }
-
-	    if (extras->off_pkt_mpls_primitives && acc_elem->pmpls) {
-	      enQueue_elem(sd, &rb, acc_elem->pmpls, PmplsSz, datasize - extras->off_pkt_mpls_primitives);
-	    }
-
-            if (extras->off_pkt_tun_primitives && acc_elem->ptun) {
-              enQueue_elem(sd, &rb, acc_elem->ptun, PtunSz, datasize - extras->off_pkt_tun_primitives);
-            }
-
-	    if (extras->off_custom_primitives && acc_elem->pcust) {
-	      enQueue_elem(sd, &rb, acc_elem->pcust, config.cpptrs.len, datasize - extras->off_custom_primitives);
-	    }
-
-	    if (extras->off_pkt_vlen_hdr_primitives && acc_elem->pvlen) {
-	      enQueue_elem(sd, &rb, acc_elem->pvlen, PvhdrSz + acc_elem->pvlen->tot_len, datasize - extras->off_pkt_vlen_hdr_primitives);
-	    }
+	    enQueue_acc(sd, &rb, acc_elem, extras, datasize);
 
 	    if (reset_counter) {
 	      if (forked) set_reset_flag(acc_elem);
@@ -359,6 +378,22 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
 	  }
 	}
       }
+      else if (imt_sidx_serves(&request)) {
+	struct pkt_data abuf;
+
+	/* served walking the matching group of the secondary index */
+	memset(&abuf, 0, sizeof(abuf));
+
+	for (acc_elem = imt_sidx_search(&request); acc_elem; acc_elem = acc_elem->sidx_next) {
+	  if (test_zero_elem(acc_elem)) continue;
+
+	  if (q->type & WANT_COUNTER) Accumulate_Counters(&abuf, acc_elem);
+	  else enQueue_acc(sd, &rb, acc_elem, extras, datasize); /* q->type == WANT_MATCH */
+
+	  if (reset_counter) set_reset_flag(acc_elem);
+	}
+	if (q->type & WANT_COUNTER) enQueue_elem(sd, &rb, &abuf, PdataSz, PdataSz); /* enqueue accumulated data */
+      }
       else {
         struct pkt_primitives tbuf;  
 	struct pkt_bgp_primitives bbuf;
@@ -385,36 +420,7 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
 		!memcmp(&ubuf, &request.ptun, sizeof(struct pkt_tunnel_primitives))) {
 	      if (q->type & WANT_COUNTER) Accumulate_Counters(&abuf, acc_elem); 
 	      else {
-		enQueue_elem(sd, &rb, acc_elem, PdataSz, datasize); /* q->type == WANT_MATCH */
-
-                if (extras->off_pkt_bgp_primitives && acc_elem->pbgp) {
-                  enQueue_elem(sd, &rb, acc_elem->pbgp, PbgpSz, datasize - extras->off_pkt_bgp_primitives);
-                }
-
-                if (extras->off_pkt_lbgp_primitives) {
-                  if (acc_elem->clbgp) {
-                    struct pkt_legacy_bgp_primitives tmp_plbgp;
-
-                    cache_to_pkt_legacy_bgp_primitives(&tmp_plbgp, acc_elem->clbgp);
-                    enQueue_elem(sd, &rb, &tmp_plbgp, PlbgpSz, datasize - extras->off_pkt_lbgp_primitives);
-                  }
-                }
-
-                if (extras->off_pkt_nat_primitives && acc_elem->pnat) {
-                  enQueue_elem(sd, &rb, acc_elem->pnat, PnatSz, datasize - extras->off_pkt_nat_primitives);
-                }
-		if (extras->off_pkt_mpls_primitives && acc_elem->pmpls) {
-		  enQueue_elem(sd, &rb, acc_elem->pmpls, PmplsSz, datasize - extras->off_pkt_mpls_primitives);
-		}
-                if (extras->off_pkt_tun_primitives && acc_elem->ptun) {
-                  enQueue_elem(sd, &rb, acc_elem->ptun, PtunSz, datasize - extras->off_pkt_tun_primitives);
-                }
-                if (extras->off_custom_primitives && acc_elem->pcust) {
-                  enQueue_elem(sd, &rb, acc_elem->pcust, config.cpptrs.len, datasize - extras->off_custom_primitives);
-                }
-		if (extras->off_pkt_vlen_hdr_primitives && acc_elem->pvlen) {
-		  enQueue_elem(sd, &rb, acc_elem->pvlen, PvhdrSz + acc_elem->pvlen->tot_len, datasize - extras->off_pkt_vlen_hdr_primitives);
-		}
+		enQueue_acc(sd, &rb, acc_elem, extras, datasize); /* q->type == WANT_MATCH */
 	      }
 	      if (reset_counter) set_reset_flag(acc_elem);
 	    }
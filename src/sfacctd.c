@@ -52,6 +52,7 @@
 #ifdef WITH_REDIS
 #include "ha.h"
 #endif
+#include "recv_batch.h"
 
 /* variables to be exported away */
 int sfacctd_counter_backend_methods;
@@ -161,6 +162,7 @@ int main(int argc,char **argv, char **envp)
 
   struct packet_ptrs recv_pptrs;
   struct pcap_pkthdr recv_pkthdr;
+  struct pm_recv_batch recv_batch;
 
   sigset_t signal_set;
 
@@ -230,6 +232,7 @@ int main(int argc,char **argv, char **envp)
 
   memset(&recv_pptrs, 0, sizeof(recv_pptrs));
   memset(&recv_pkthdr, 0, sizeof(recv_pkthdr));
+  memset(&recv_batch, 0, sizeof(recv_batch));
 
   /* getting commandline values */
   while (!errflag && ((cp = getopt(argc, argv, ARGS_SFACCTD)) != -1)) {
@@ -782,6 +785,10 @@ int main(int argc,char **argv, char **envp)
       Log(LOG_INFO, "INFO ( %s/core ): sfacctd_pipe_size: obtained=%d target=%d.\n", config.name, obtained, config.nfacctd_pipe_size);
     }
 
+    if (config.nfacctd_recv_batch > 1) {
+      pm_recv_batch_init(&recv_batch, config.sock, config.nfacctd_recv_batch, SFLOW_MAX_MSG_SIZE);
+    }
+
     /* Multicast: memberships handling */
     for (idx = 0; mcast_groups[idx].family && idx < MAX_MCAST_GROUPS; idx++) {
       if (mcast_groups[idx].family == AF_INET) {
@@ -1247,10 +1254,15 @@ int main(int argc,char **argv, char **envp)
     exit(0);
   }
 
+  bgp_epoch_core_reader_init();
+
   /* Main loop */
   for (;;) {
     sigprocmask(SIG_BLOCK, &signal_set, NULL);
 
+    /* never block holding on to BGP RIB references */
+    bgp_epoch_offline(bgp_epoch_core_reader);
+
     if (config.pcap_savefile) {
       ret = recvfrom_savefile(&device, (void **) &sflow_packet, (struct sockaddr *) &client, &spp.ts, &pm_pcap_savefile_round, &recv_pptrs);
     }
@@ -1309,10 +1321,15 @@ int main(int argc,char **argv, char **envp)
       ret = recvfrom_rawip(sflow_packet, ret, (struct sockaddr *) &client, &recv_pptrs);
     }
 #endif
+    else if (recv_batch.size) {
+      ret = pm_recv_batch_next(&recv_batch, &sflow_packet, &client, &clen);
+    }
     else {
       ret = recvfrom(config.sock, (unsigned char *)sflow_packet, SFLOW_MAX_MSG_SIZE, 0, (struct sockaddr *) &client, &clen);
     }
 
+    bgp_epoch_online(bgp_epoch_core_reader);
+
     spp.rawSample = pptrs.v4.f_header = sflow_packet;
     spp.rawSampleLen = pptrs.v4.f_len = ret;
     spp.datap = (u_int32_t *) spp.rawSample;
@@ -1376,7 +1393,11 @@ int main(int argc,char **argv, char **envp)
     if (print_stats) {
       time_t now = time(NULL);
 
-      print_status_table(&xflow_status_table, now, XFLOW_STATUS_TABLE_SZ);
+      print_status_table(&xflow_status_table, now);
+      if (recv_batch.size) pm_recv_batch_print_stats(&recv_batch, now);
+      plugin_pipe_print_stats(now);
+      pretag_print_stats(now);
+      bgp_epoch_print_stats(now);
       print_stats = FALSE;
     }
 
@@ -2228,6 +2249,9 @@ int SF_find_id(struct id_table *t, struct packet_ptrs *pptrs, pm_id_t *tag, pm_i
     sa_local.sa_family = AF_INET6;
     ip6_addr_cpy(&sa6->sin6_addr, &sample->agent_addr.address.ip_v6);
   }
+  else return ret;
+
+  if (t->tree) return pretag_tree_lookup(t, pptrs, &sa_local, tag, tag2);
 
   for (x = begin; x < end; x++) {
     if (host_addr_mask_sa_cmp(&t->e[x].key.agent_ip.a, &t->e[x].key.agent_mask, &sa_local) == 0) {
@@ -2302,7 +2326,6 @@ struct xflow_status_entry *sfv245_check_status(SFSample *spp, struct packet_ptrs
   struct sockaddr salocal;
   u_int32_t aux1 = spp->agentSubId;
   struct xflow_status_entry *entry = NULL;
-  int hash; 
 
   memcpy(&salocal, sa, sizeof(struct sockaddr));
 
@@ -2311,14 +2334,10 @@ struct xflow_status_entry *sfv245_check_status(SFSample *spp, struct packet_ptrs
   salocal.sa_family = AF_INET; 
   ( (struct sockaddr_in *)&salocal )->sin_addr = spp->agent_addr.address.ip_v4;
 
-  hash = hash_status_table(aux1, &salocal, XFLOW_STATUS_TABLE_SZ);
-
-  if (hash >= 0) {
-    entry = search_status_table(&xflow_status_table, &salocal, aux1, 0, hash, XFLOW_STATUS_TABLE_MAX_ENTRIES);
-    if (entry) {
-      update_status_table(entry, spp->sequenceNo, pptrs->f_len);
-      entry->inc = 1;
-    }
+  entry = search_status_table(&xflow_status_table, &salocal, aux1, 0, XFLOW_STATUS_TABLE_MAX_ENTRIES);
+  if (entry) {
+    update_status_table(entry, spp->sequenceNo, pptrs->f_len);
+    entry->inc = 1;
   }
 
   return entry;
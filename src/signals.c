@@ -23,6 +23,7 @@
 #include "pmacct.h"
 #include "pmacct-data.h"
 #include "plugin_hooks.h"
+#include "pm_tpacket.h"
 #include "bgp/bgp.h"
 
 /* extern */
@@ -57,6 +58,7 @@ void handle_falling_child(int unused)
         Log(LOG_WARNING, "WARN ( %s/%s ): connection lost to '%s-%s'; closing connection.\n",
 		config.name, config.type, list->name, list->type.string);
         close(list->pipe[1]);
+        if (list->cfg.pipe_eventfd) close(list->live[1]);
         delete_pipe_channel(list->pipe[1]);
         ret = delete_plugin_by_id(list->id);
         if (!ret) {
@@ -83,6 +85,7 @@ void handle_falling_child(int unused)
     Log(LOG_WARNING, "WARN ( %s/%s ): connection lost to '%s-%s'; closing connection.\n",
 	config.name, config.type, list->name, list->type.string);
     close(list->pipe[1]);
+    if (list->cfg.pipe_eventfd) close(list->live[1]);
     delete_pipe_channel(list->pipe[1]);
     ret = delete_plugin_by_id(list->id);
     if (!ret) {
@@ -166,7 +169,14 @@ void PM_sigint_handler(int signum)
       printf("NOTICE ( %s/%s ): +++\n", config.name, config.type);
 
       for (device_idx = 0; device_idx < devices.num; device_idx++) {
-        if (pcap_stats(devices.list[device_idx].dev_desc, &ps) < 0) {
+        if (devices.list[device_idx].ring) {
+	  if (pm_tpacket_stats(&devices.list[device_idx], &ps) < 0) {
+	    printf("INFO ( %s/%s ): [%s,%u] error='pm_tpacket_stats(): %s'\n",
+		  config.name, config.type, devices.list[device_idx].str,
+		  devices.list[device_idx].id, strerror(errno));
+	  }
+	}
+        else if (pcap_stats(devices.list[device_idx].dev_desc, &ps) < 0) {
 	  printf("INFO ( %s/%s ): [%s,%u] error='pcap_stats(): %s'\n",
 		config.name, config.type, devices.list[device_idx].str,
 		devices.list[device_idx].id,
@@ -25,7 +25,7 @@
 #include "plugin_hooks.h"
 #include "sql_common.h"
 #include "sql_common_m.h"
-#include "crc32.h"
+#include "cache_hash.h"
 
 /* Global variables */
 char sql_data[LARGEBUFLEN];
@@ -339,13 +339,13 @@ void sql_cache_modulo(struct primitives_ptrs *prim_ptrs, struct insert_data *ida
   u_char *pcust = prim_ptrs->pcust;
   struct pkt_vlen_hdr_primitives *pvlen = prim_ptrs->pvlen;
 
-  idata->hash = cache_crc32((unsigned char *)srcdst, sql_pp_size);
-  if (pbgp) idata->hash ^= cache_crc32((unsigned char *)pbgp, sql_pb_size);
-  if (pnat) idata->hash ^= cache_crc32((unsigned char *)pnat, sql_pn_size);
-  if (pmpls) idata->hash ^= cache_crc32((unsigned char *)pmpls, sql_pm_size);
-  if (ptun) idata->hash ^= cache_crc32((unsigned char *)ptun, sql_pt_size);
-  if (pcust) idata->hash ^= cache_crc32((unsigned char *)pcust, sql_pc_size);
-  if (pvlen) idata->hash ^= cache_crc32((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
+  idata->hash = cache_hash_primitives(srcdst);
+  if (pbgp) idata->hash ^= cache_hash((unsigned char *)pbgp, sql_pb_size);
+  if (pnat) idata->hash ^= cache_hash((unsigned char *)pnat, sql_pn_size);
+  if (pmpls) idata->hash ^= cache_hash((unsigned char *)pmpls, sql_pm_size);
+  if (ptun) idata->hash ^= cache_hash((unsigned char *)ptun, sql_pt_size);
+  if (pcust) idata->hash ^= cache_hash((unsigned char *)pcust, sql_pc_size);
+  if (pvlen) idata->hash ^= cache_hash((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
 
   idata->modulo = idata->hash % config.sql_cache_entries;
 }
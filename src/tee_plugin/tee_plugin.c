@@ -213,11 +213,13 @@ void tee_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
           if (seq == 0) rg_err_count = FALSE;
         }
         else {
-          if ((ret = read(pipe_fd, &rgptr, sizeof(rgptr))) == 0)
+          if ((ret = plugin_pipe_read(pipe_fd, &rgptr)) == 0)
             exit_gracefully(1); /* we exit silently; something happened at the write end */
         }
   
         if ((rg->ptr + bufsz) > rg->end) rg->ptr = rg->base;
+
+        if (!pollagain) plugin_pipe_spin(rg->ptr, seq);
   
         if (((struct ch_buf_hdr *)rg->ptr)->seq != seq) {
           if (!pollagain) {
@@ -234,12 +236,14 @@ void tee_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
             }
 
 	    rg->ptr = (rg->base + status->last_buf_off);
+	    plugin_pipe_resync(status);
             seq = ((struct ch_buf_hdr *)rg->ptr)->seq;
           }
         }
   
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
+        status->tail++;
         rg->ptr += bufsz;
       }
 #ifdef WITH_ZMQ
@@ -1098,6 +1098,8 @@ int main(int argc,char **argv, char **envp)
     exit(0);
   }
 
+  bgp_epoch_core_reader_init();
+
   /* Main loop: if pcap_loop() exits maybe an error occurred; we will try closing
      and reopening again our listening device */
   for (;;) {
@@ -1796,6 +1796,17 @@ void signal_kittens(int sig, int amicore_check)
   }
 }
 
+/* signal_core_workers(): relays a signal received by the main Core Process
+   to the sibling Core Processes spawned via nfacctd_workers */
+void signal_core_workers(int sig)
+{
+  int idx;
+
+  for (idx = 0; idx < core_workers.active; idx++) {
+    if (core_workers.list[idx]) kill(core_workers.list[idx], sig);
+  }
+}
+
 /*
  * exit_all(): Core Process exit lane. Not meant to be a nice shutdown method: it is
  * an exit() replacement that sends kill signals to the plugins.
@@ -1809,6 +1820,7 @@ void exit_all(int status)
 #endif
 
   signal_kittens(SIGKILL, TRUE);
+  signal_core_workers(SIGINT);
 
   wait(NULL);
   if (config.pidfile) remove_pid_file(config.pidfile);
@@ -96,6 +96,7 @@ extern u_int32_t decode_mpls_label(u_char *);
 extern void encode_mpls_label(char *, u_int32_t);
 extern int timeval_cmp(struct timeval *, struct timeval *);
 extern void signal_kittens(int, int);
+extern void signal_core_workers(int);
 extern void exit_all(int);
 extern void exit_plugin(int);
 extern void exit_gracefully(int);
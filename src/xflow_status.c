@@ -21,67 +21,121 @@
 
 /* includes */
 #include "pmacct.h"
+#include "jhash.h"
 
 /* Global variables */
 xflow_status_table_t xflow_status_table;
 
 /* functions */
-u_int32_t hash_status_table(u_int32_t data, struct sockaddr *sa, u_int32_t size)
+static u_int32_t compose_status_key(struct xflow_status_key *key, struct sockaddr *sa, u_int32_t aux1, u_int32_t aux2)
 {
-  int hash = -1;
+  u_int32_t v4;
+  u_int16_t port;
+
+  memset(key, 0, sizeof(struct xflow_status_key));
+  if (!sa_to_addr(sa, &key->agent, &port)) return FALSE;
+
+  /* sa_addr_cmp() semantics: IPv4 and IPv4-mapped IPv6 agents are the same */
+  if (key->agent.family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&key->agent.address.ipv6)) {
+    memcpy(&v4, key->agent.address.ipv6.s6_addr + 12, 4);
+    memset(&key->agent, 0, sizeof(struct host_addr));
+    key->agent.family = AF_INET;
+    key->agent.address.ipv4.s_addr = v4;
+  }
+
+  key->aux1 = aux1;
+  key->aux2 = aux2;
+
+  return jhash(key, sizeof(struct xflow_status_key), 0);
+}
+
+static struct xflow_status_slot *status_table_lookup(xflow_status_table_t *table, struct xflow_status_key *key, u_int32_t hash)
+{
+  struct xflow_status_slot *slot;
+  u_int32_t mask = (table->size - 1), pos;
+
+  for (pos = (hash & mask); ; pos = ((pos + 1) & mask)) {
+    slot = &table->slots[pos];
 
-  if (sa->sa_family == AF_INET)
-    hash = (data ^ ((struct sockaddr_in *)sa)->sin_addr.s_addr) % size;
-  else if (sa->sa_family == AF_INET6) {
-    u_int32_t tmp;
+    if (!slot->entry) return slot;
+    if (slot->hash == hash && !memcmp(&slot->key, key, sizeof(struct xflow_status_key))) return slot;
+  }
+}
+
+static int status_table_alloc(xflow_status_table_t *table, u_int32_t size)
+{
+  struct xflow_status_slot *old_slots = table->slots, *slot;
+  u_int32_t old_size = table->size, idx;
+
+  table->slots = calloc(size, sizeof(struct xflow_status_slot));
+  if (!table->slots) {
+    table->slots = old_slots;
+    return ERR;
+  }
+
+  table->size = size;
 
-    memcpy(&tmp, ((struct sockaddr_in6 *)sa)->sin6_addr.s6_addr+12, 4);
-    hash = (data ^ tmp) % size;
+  /* only slots move: entry pointers held elsewhere stay valid */
+  for (idx = 0; idx < old_size; idx++) {
+    if (old_slots[idx].entry) {
+      slot = status_table_lookup(table, &old_slots[idx].key, old_slots[idx].hash);
+      memcpy(slot, &old_slots[idx], sizeof(struct xflow_status_slot));
+    }
   }
 
-  return hash;
+  if (old_slots) free(old_slots);
+
+  return SUCCESS;
 }
 
-struct xflow_status_entry *search_status_table(xflow_status_table_t *table, struct sockaddr *sa, u_int32_t aux1, u_int32_t aux2, int hash, int num_entries)
+struct xflow_status_entry *search_status_table(xflow_status_table_t *table, struct sockaddr *sa, u_int32_t aux1, u_int32_t aux2, int num_entries)
 {
-  struct xflow_status_entry *entry = table->t[hash], *saved = NULL;
+  struct xflow_status_entry *entry = NULL;
+  struct xflow_status_slot *slot;
+  struct xflow_status_key key;
+  u_int32_t hash;
   u_int16_t port;
 
-  cycle_again:
-  if (entry) {
-    saved = entry;
-    if (!sa_addr_cmp(sa, &entry->agent_addr) && aux1 == entry->aux1 && aux2 == entry->aux2); /* FOUND IT: we are done */
-    else {
-      entry = entry->next;
-      goto cycle_again;
+  hash = compose_status_key(&key, sa, aux1, aux2);
+  if (!key.agent.family) return NULL;
+
+  if (table->size) {
+    slot = status_table_lookup(table, &key, hash);
+    if (slot->entry) return slot->entry;
+  }
+
+  if (table->entries < num_entries) {
+    /* keep load factor <= 0.5 */
+    if (((table->used + 1) * 2) > table->size) {
+      if (status_table_alloc(table, table->size ? (table->size * 2) : XFLOW_STATUS_TABLE_INIT_SZ) == ERR &&
+	  (table->used + 1) >= table->size) goto error;
     }
+
+    if (posix_memalign((void **) &entry, XFLOW_STATUS_CACHE_LINE, sizeof(struct xflow_status_entry))) goto error;
+
+    memset(entry, 0, sizeof(struct xflow_status_entry));
+    sa_to_addr((struct sockaddr *)sa, &entry->agent_addr, &port);
+    entry->aux1 = aux1;
+    entry->aux2 = aux2;
+    entry->seqno = 0;
+
+    slot = status_table_lookup(table, &key, hash);
+    slot->hash = hash;
+    memcpy(&slot->key, &key, sizeof(struct xflow_status_key));
+    slot->entry = entry;
+
+    table->memerr = TRUE;
+    table->entries++;
+    table->used++;
   }
   else {
-    if (table->entries < num_entries) {
-      entry = malloc(sizeof(struct xflow_status_entry));
-      if (!entry) goto error;
-      else {
-	memset(entry, 0, sizeof(struct xflow_status_entry));
-	sa_to_addr((struct sockaddr *)sa, &entry->agent_addr, &port);
-	entry->aux1 = aux1;
-	entry->aux2 = aux2;
-	entry->seqno = 0;
-	entry->next = FALSE;
-        if (!saved) table->t[hash] = entry;
-        else saved->next = entry;
-
-	table->memerr = TRUE;
-	table->entries++;
-      }
-    }
-    else {
-      error:
-      if (table->memerr) {
-	Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate more entries into the xFlow status table.\n", config.name, config.type);
-	table->memerr = FALSE;
-	return NULL;
-      }
+    error:
+    if (table->memerr) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate more entries into the xFlow status table.\n", config.name, config.type);
+      table->memerr = FALSE;
     }
+
+    return NULL;
   }
 
   return entry;
@@ -121,10 +175,15 @@ void update_status_table(struct xflow_status_entry *entry, u_int32_t seqno, int
   entry->seqno = seqno;
 }
 
-void print_status_table(xflow_status_table_t *table, time_t now, int buckets)
+/*
+   Called by the Core Process itself, in between two datagrams, upon
+   SIGUSR1: the dump is a linear walk of the slots, counters are read
+   as they are and the collector never stops or locks.
+*/
+void print_status_table(xflow_status_table_t *table, time_t now)
 {
   struct xflow_status_entry *entry; 
-  int idx;
+  u_int32_t idx;
   char agent_ip_address[INET6_ADDRSTRLEN];
   char collector_ip_address[INET6_ADDRSTRLEN];
   char null_ip_address[] = "0.0.0.0";
@@ -134,10 +193,9 @@ void print_status_table(xflow_status_table_t *table, time_t now, int buckets)
   if (config.nfacctd_ip) memcpy(collector_ip_address, config.nfacctd_ip, MAX(strlen(config.nfacctd_ip), INET6_ADDRSTRLEN));
   else strcpy(collector_ip_address, null_ip_address);
   
-  for (idx = 0; idx < buckets; idx++) {
-    entry = table->t[idx];
+  for (idx = 0; idx < table->size; idx++) {
+    entry = table->slots[idx].entry;
 
-    bucket_cycle:
     if (entry && entry->counters.total && entry->counters.bytes) {
       addr_to_str(agent_ip_address, &entry->agent_addr);
 
@@ -145,11 +203,6 @@ void print_status_table(xflow_status_table_t *table, time_t now, int buckets)
 		config.name, config.type, collector_ip_address, collector_port,
 		agent_ip_address, entry->aux1, (long)now, entry->counters.total, entry->counters.bytes,
 		entry->counters.good, entry->counters.jumps_f, entry->counters.jumps_b);
-
-      if (entry->next) {
-	entry = entry->next;
-	goto bucket_cycle;
-      }
     } 
   }
 
@@ -160,102 +213,175 @@ void print_status_table(xflow_status_table_t *table, time_t now, int buckets)
   Log(LOG_NOTICE, "NOTICE ( %s/%s ): ---\n", config.name, config.type);
 }
 
-struct xflow_status_entry_sampling *
-search_smp_if_status_table(struct xflow_status_entry_sampling *sentry, u_int32_t interface)
+/* sampling and class sub-tables are a handful of entries: sorted arrays, binary search */
+static int smp_status_table_pos(struct xflow_status_smp_table *st, u_int32_t sampler_id, u_int32_t interface, int *found)
 {
-  while (sentry) {
-    if (sentry->interface == interface) return sentry;
-    sentry = sentry->next;
+  struct xflow_status_entry_sampling *sentry;
+  int low = 0, high = st->num, mid;
+
+  (*found) = FALSE;
+
+  while (low < high) {
+    mid = ((low + high) / 2);
+    sentry = &st->e[mid];
+
+    if (sentry->sampler_id < sampler_id || (sentry->sampler_id == sampler_id && sentry->interface < interface)) low = (mid + 1);
+    else high = mid;
   }
 
+  if (low < st->num && st->e[low].sampler_id == sampler_id && st->e[low].interface == interface) (*found) = TRUE;
+
+  return low;
+}
+
+struct xflow_status_entry_sampling *
+search_smp_if_status_table(struct xflow_status_smp_table *st, u_int32_t interface)
+{
+  int pos, found;
+
+  pos = smp_status_table_pos(st, 0, interface, &found);
+  if (found) return &st->e[pos];
+
   return NULL;
 }
 
 struct xflow_status_entry_sampling *
-search_smp_id_status_table(struct xflow_status_entry_sampling *sentry, u_int32_t sampler_id, u_int8_t return_unequal)
+search_smp_id_status_table(struct xflow_status_smp_table *st, u_int32_t sampler_id, u_int8_t return_unequal)
 {
+  int low = 0, high = st->num, mid;
+
   /* Match a samplerID or, if samplerID within a data record is zero and no match was
      possible, then return the last samplerID defined -- last part is C7600 workaround */
-  while (sentry) {
-    if (sentry->sampler_id == sampler_id || (return_unequal && !sampler_id && !sentry->next)) return sentry;
-    sentry = sentry->next;
+  while (low < high) {
+    mid = ((low + high) / 2);
+
+    if (st->e[mid].sampler_id < sampler_id) low = (mid + 1);
+    else high = mid;
   }
 
+  if (low < st->num && st->e[low].sampler_id == sampler_id) return &st->e[low];
+  if (return_unequal && !sampler_id && st->num) return &st->e[st->last];
+
   return NULL;
 }
 
+/* returned pointers are valid until the next entry is created for the same exporter */
 struct xflow_status_entry_sampling *
-create_smp_entry_status_table(xflow_status_table_t *table, struct xflow_status_entry *entry)
+create_smp_entry_status_table(xflow_status_table_t *table, struct xflow_status_entry *entry, u_int32_t sampler_id, u_int32_t interface)
 {
-  struct xflow_status_entry_sampling *sentry = entry->sampling, *new = NULL;  
+  struct xflow_status_smp_table *st;
+  struct xflow_status_entry_sampling *new = NULL;
+  int pos, found;
 
-  if (sentry) {
-    while (sentry->next) sentry = sentry->next; 
-  }
+  if (!entry) return NULL;
+
+  st = &entry->sampling;
+  pos = smp_status_table_pos(st, sampler_id, interface, &found);
+  if (found) return &st->e[pos];
 
   if (table->entries < XFLOW_STATUS_TABLE_MAX_ENTRIES) {
-    new = malloc(sizeof(struct xflow_status_entry_sampling));
-    if (!new) {
-      if (table->smp_entry_status_table_memerr) {
-	Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate more entries into the xflow renormalization table.\n", config.name, config.type);
-	table->smp_entry_status_table_memerr = FALSE;
+    if (st->num == st->size) {
+      new = realloc(st->e, (st->size ? (st->size * 2) : XFLOW_STATUS_SUBTABLE_INIT_SZ) * sizeof(struct xflow_status_entry_sampling));
+      if (!new) {
+        if (table->smp_entry_status_table_memerr) {
+	  Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate more entries into the xflow renormalization table.\n", config.name, config.type);
+	  table->smp_entry_status_table_memerr = FALSE;
+        }
+
+	return NULL;
       }
-    }
-    else {
-      if (!entry->sampling) entry->sampling = new;
-      if (sentry) sentry->next = new;
-      new->next = FALSE;
 
-      table->smp_entry_status_table_memerr = TRUE;
-      table->entries++;
+      st->e = new;
+      st->size = (st->size ? (st->size * 2) : XFLOW_STATUS_SUBTABLE_INIT_SZ);
     }
+
+    memmove(&st->e[pos + 1], &st->e[pos], (st->num - pos) * sizeof(struct xflow_status_entry_sampling));
+    st->num++;
+    st->last = pos;
+
+    new = &st->e[pos];
+    memset(new, 0, sizeof(struct xflow_status_entry_sampling));
+    new->sampler_id = sampler_id;
+    new->interface = interface;
+
+    table->smp_entry_status_table_memerr = TRUE;
+    table->entries++;
   }
 
   return new;
 }
 
-struct xflow_status_entry_class *
-search_class_id_status_table(struct xflow_status_entry_class *centry, pm_class_t class_id)
+static int class_status_table_pos(struct xflow_status_class_table *ct, pm_class_t class_id, int *found)
 {
   pm_class_t needle, haystack;
+  int low = 0, high = ct->num, mid;
 
   needle = ntohl(class_id);
+  (*found) = FALSE;
 
-  while (centry) {
-    haystack = ntohl(centry->class_id);
+  while (low < high) {
+    mid = ((low + high) / 2);
+    haystack = ntohl(ct->e[mid].class_id);
 
-    if (haystack == needle) return centry;
-    centry = centry->next;
+    if (haystack < needle) low = (mid + 1);
+    else high = mid;
   }
 
+  if (low < ct->num && ntohl(ct->e[low].class_id) == needle) (*found) = TRUE;
+
+  return low;
+}
+
+struct xflow_status_entry_class *
+search_class_id_status_table(struct xflow_status_class_table *ct, pm_class_t class_id)
+{
+  int pos, found;
+
+  pos = class_status_table_pos(ct, class_id, &found);
+  if (found) return &ct->e[pos];
+
   return NULL;
 }
 
+/* returned pointers are valid until the next entry is created for the same exporter */
 struct xflow_status_entry_class *
-create_class_entry_status_table(xflow_status_table_t *table, struct xflow_status_entry *entry)
+create_class_entry_status_table(xflow_status_table_t *table, struct xflow_status_entry *entry, pm_class_t class_id)
 {
-  struct xflow_status_entry_class *centry = entry->class, *new = NULL;
+  struct xflow_status_class_table *ct;
+  struct xflow_status_entry_class *new = NULL;
+  int pos, found;
 
-  if (centry) {
-    while (centry->next) centry = centry->next;
-  }
+  if (!entry) return NULL;
+
+  ct = &entry->class;
+  pos = class_status_table_pos(ct, class_id, &found);
+  if (found) return &ct->e[pos];
 
   if (table->entries < XFLOW_STATUS_TABLE_MAX_ENTRIES) {
-    new = malloc(sizeof(struct xflow_status_entry_class));
-    if (!new) {
-      if (table->class_entry_status_table_memerr) {
-        Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate more entries into the xflow classification table.\n", config.name, config.type);
-        table->class_entry_status_table_memerr = FALSE;
+    if (ct->num == ct->size) {
+      new = realloc(ct->e, (ct->size ? (ct->size * 2) : XFLOW_STATUS_SUBTABLE_INIT_SZ) * sizeof(struct xflow_status_entry_class));
+      if (!new) {
+        if (table->class_entry_status_table_memerr) {
+          Log(LOG_ERR, "ERROR ( %s/%s ): unable to allocate more entries into the xflow classification table.\n", config.name, config.type);
+          table->class_entry_status_table_memerr = FALSE;
+        }
+
+	return NULL;
       }
-    }
-    else {
-      if (!entry->class) entry->class = new;
-      if (centry) centry->next = new;
-      new->next = FALSE;
 
-      table->class_entry_status_table_memerr = TRUE;
-      table->entries++;
+      ct->e = new;
+      ct->size = (ct->size ? (ct->size * 2) : XFLOW_STATUS_SUBTABLE_INIT_SZ);
     }
+
+    memmove(&ct->e[pos + 1], &ct->e[pos], (ct->num - pos) * sizeof(struct xflow_status_entry_class));
+    ct->num++;
+
+    new = &ct->e[pos];
+    memset(new, 0, sizeof(struct xflow_status_entry_class));
+    new->class_id = class_id;
+
+    table->class_entry_status_table_memerr = TRUE;
+    table->entries++;
   }
 
   return new;
@@ -24,10 +24,13 @@
 
 /* defines */
 #define XFLOW_RESET_BOUNDARY 50
-#define XFLOW_STATUS_TABLE_SZ 9973
+#define XFLOW_STATUS_TABLE_INIT_SZ 1024 /* power of two */
 #define XFLOW_STATUS_TABLE_MAX_ENTRIES 100000
+#define XFLOW_STATUS_SUBTABLE_INIT_SZ 4
+#define XFLOW_STATUS_CACHE_LINE 64
 
 /* structures */
+/* written by the Core Process only, read by print_status_table(): own cache line */
 struct xflow_status_entry_counters
 {
   // XXX: change to 64 bit?
@@ -37,7 +40,7 @@ struct xflow_status_entry_counters
 
   u_int64_t total;
   u_int64_t bytes;
-};
+} __attribute__ ((aligned (XFLOW_STATUS_CACHE_LINE)));
 
 struct xflow_status_entry_sampling
 {
@@ -45,7 +48,15 @@ struct xflow_status_entry_sampling
   u_int32_t sample_pool;	/* sampling rate */
   u_int32_t seqno;		/* sFlow: flow samples sequence number */
   u_int32_t sampler_id;		/* NetFlow v9: flow sampler ID field */ 
-  struct xflow_status_entry_sampling *next;
+};
+
+/* sorted by (sampler_id, interface); NetFlow/IPFIX set the former, sFlow the latter */
+struct xflow_status_smp_table
+{
+  struct xflow_status_entry_sampling *e;
+  u_int32_t num;
+  u_int32_t size;
+  u_int32_t last;		/* index of the entry defined last */
 };
 
 struct xflow_status_entry_class
@@ -53,7 +64,14 @@ struct xflow_status_entry_class
   pm_class_t class_id;				/* NetFlow v9: classfier ID field */
   pm_class_t class_int_id;			/* NetFlow v9: internal classfier ID field */
   char class_name[MAX_PROTOCOL_LEN];		/* NetFlow v9: classfier name field */
-  struct xflow_status_entry_class *next;
+};
+
+/* sorted by class_id (host byte order) */
+struct xflow_status_class_table
+{
+  struct xflow_status_entry_class *e;
+  u_int32_t num;
+  u_int32_t size;
 };
 
 struct xflow_status_map_cache
@@ -65,6 +83,23 @@ struct xflow_status_map_cache
   struct timeval stamp;
 };
 
+struct xflow_status_peer_cache
+{
+  void *peer;			/* struct bgp_peer; NULL = no peer found */
+  struct host_addr addr;	/* lookup key: agent or bgp_agent_map address */
+  u_int16_t port;		/* lookup key, if BGP ports are compared */
+  u_int8_t type;		/* FUNC_TYPE_BGP, FUNC_TYPE_BMP; 0 = empty */
+  u_int32_t gen;		/* peers generation the entry is valid for */
+};
+
+struct xflow_status_tpl_cache
+{
+  u_int16_t template_id;	/* as found in the FlowSet, network byte order */
+  u_int8_t version;		/* NetFlow v9 / IPFIX */
+  u_int32_t slot;		/* template index slot */
+  u_int32_t gen;		/* template generation; 0 = empty */
+};
+
 struct xflow_status_entry
 {
   struct host_addr agent_addr;  /* NetFlow/IPFIX: socket IP address
@@ -79,14 +114,15 @@ struct xflow_status_entry
                                    sFlow v5: agentSubID */
   u_int32_t aux2;		/* Some more distinguishing (internal) flags */
   u_int16_t inc;		/* increment, NetFlow v5: required by flow sequence number */
-  u_int32_t peer_v4_idx;        /* last known BGP peer index for ipv4 address family */
-  u_int32_t peer_v6_idx;        /* last known BGP peer index for ipv6 address family */
+  struct xflow_status_peer_cache peer_v4;		/* last known BGP peer for ipv4 address family */
+  struct xflow_status_peer_cache peer_v6;		/* last known BGP peer for ipv6 address family */
   struct xflow_status_map_cache bta_v4;			/* last known bgp_agent_map IPv4 result */
   struct xflow_status_map_cache bta_v6;			/* last known bgp_agent_map IPv6 result */
   struct xflow_status_map_cache st;			/* last known sampling_map result */
+  struct xflow_status_tpl_cache tpl;			/* last template found */
   struct xflow_status_entry_counters counters;
-  struct xflow_status_entry_sampling *sampling;
-  struct xflow_status_entry_class *class;
+  struct xflow_status_smp_table sampling;
+  struct xflow_status_class_table class;
   cdada_map_t *in_rd_map;	/* hash map for ingress vrf id -> mpls vpn rd lookup */
   cdada_map_t *out_rd_map;	/* hash map for egress vrf id -> mpls vpn rd lookup */
   cdada_map_t *vrf_name_map;	/* hash map for ingress vrf id -> vrf name lookup */
@@ -96,10 +132,24 @@ struct xflow_status_entry
 #ifdef WITH_GNUTLS
   pm_dtls_peer_t dtls;
 #endif
+};
 
-  struct xflow_status_entry *next;
+/* fixed-size key: zeroed before being filled in so that it can be hashed and compared as a blob */
+struct xflow_status_key
+{
+  struct host_addr agent;	/* IPv4-mapped IPv6 addresses are stored as IPv4 */
+  u_int32_t aux1;
+  u_int32_t aux2;
+};
+
+struct xflow_status_slot
+{
+  u_int32_t hash;
+  struct xflow_status_key key;
+  struct xflow_status_entry *entry;	/* NULL = empty slot */
 };
 
+/* open addressing, linear probing; entries are never removed and never move */
 typedef struct {
   u_int32_t entries;
 
@@ -108,20 +158,21 @@ typedef struct {
   u_int8_t smp_entry_status_table_memerr;
   u_int8_t class_entry_status_table_memerr;
 
-  struct xflow_status_entry *t[XFLOW_STATUS_TABLE_SZ];
+  struct xflow_status_slot *slots;
+  u_int32_t size;		/* power of two; 0 = not allocated yet */
+  u_int32_t used;		/* slots in use */
 } xflow_status_table_t;
 
 /* prototypes */
-extern u_int32_t hash_status_table(u_int32_t, struct sockaddr *, u_int32_t);
-extern struct xflow_status_entry *search_status_table(xflow_status_table_t *, struct sockaddr *, u_int32_t, u_int32_t, int, int);
+extern struct xflow_status_entry *search_status_table(xflow_status_table_t *, struct sockaddr *, u_int32_t, u_int32_t, int);
 extern void update_good_status_table(struct xflow_status_entry *, u_int32_t);
 extern void update_bad_status_table(struct xflow_status_entry *);
-extern void print_status_table(xflow_status_table_t *, time_t, int);
-extern struct xflow_status_entry_sampling *search_smp_if_status_table(struct xflow_status_entry_sampling *, u_int32_t);
-extern struct xflow_status_entry_sampling *search_smp_id_status_table(struct xflow_status_entry_sampling *, u_int32_t, u_int8_t);
-extern struct xflow_status_entry_sampling *create_smp_entry_status_table(xflow_status_table_t *, struct xflow_status_entry *);
-extern struct xflow_status_entry_class *search_class_id_status_table(struct xflow_status_entry_class *, pm_class_t);
-extern struct xflow_status_entry_class *create_class_entry_status_table(xflow_status_table_t *, struct xflow_status_entry *);
+extern void print_status_table(xflow_status_table_t *, time_t);
+extern struct xflow_status_entry_sampling *search_smp_if_status_table(struct xflow_status_smp_table *, u_int32_t);
+extern struct xflow_status_entry_sampling *search_smp_id_status_table(struct xflow_status_smp_table *, u_int32_t, u_int8_t);
+extern struct xflow_status_entry_sampling *create_smp_entry_status_table(xflow_status_table_t *, struct xflow_status_entry *, u_int32_t, u_int32_t);
+extern struct xflow_status_entry_class *search_class_id_status_table(struct xflow_status_class_table *, pm_class_t);
+extern struct xflow_status_entry_class *create_class_entry_status_table(xflow_status_table_t *, struct xflow_status_entry *, pm_class_t);
 extern void set_vector_f_status(struct packet_ptrs_vector *);
 extern void set_vector_f_status_g(struct packet_ptrs_vector *);
 extern void update_status_table(struct xflow_status_entry *, u_int32_t, int);
@@ -0,0 +1,194 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "bgp/bgp.h"
+#include "bench_common.h"
+#include "bench_bgp.h"
+
+/* global variables */
+struct bgp_peer *bench_bgp_peers;
+
+static struct bgp_misc_structs bench_bgp_misc_db;
+
+/* functions */
+struct bgp_misc_structs *bgp_select_misc_db(int type)
+{
+  return &bench_bgp_misc_db;
+}
+
+void bench_bgp_init(int peers)
+{
+  int idx;
+
+  bench_bgp_misc_db.table_peer_buckets = DEFAULT_BGP_INFO_HASH;
+  bench_bgp_misc_db.table_per_peer_buckets = DEFAULT_BGP_INFO_PER_PEER_HASH;
+  bench_bgp_misc_db.table_per_peer_hash = BGP_ASPATH_HASH_PATHID;
+  bench_bgp_misc_db.log_str = "BGP";
+
+  bench_bgp_peers = calloc(peers, sizeof(struct bgp_peer));
+  if (!bench_bgp_peers) exit_gracefully(1);
+
+  for (idx = 0; idx < peers; idx++) {
+    bench_bgp_peers[idx].idx = idx;
+    bench_bgp_peers[idx].fd = idx;
+    bench_bgp_peers[idx].type = FUNC_TYPE_BGP;
+  }
+}
+
+struct bgp_table *bench_bgp_table_init(afi_t afi, int lpm_index)
+{
+  struct bgp_table *table = bgp_table_init(afi, SAFI_UNICAST);
+
+  if (lpm_index) table->lpm = bgp_lpm_init(afi);
+
+  return table;
+}
+
+/* random prefix of length 'len' or, given 'base', random address sharing its first 'len' bits */
+void bench_bgp_prefix(struct prefix *p, afi_t afi, u_int8_t len, u_char *base)
+{
+  u_char *addr = (u_char *) &p->u.prefix;
+  int idx, maxlen = (afi == AFI_IP ? 32 : 128);
+
+  memset(p, 0, sizeof(struct prefix));
+  p->family = (afi == AFI_IP ? AF_INET : AF_INET6);
+  p->prefixlen = len;
+
+  for (idx = 0; idx < (maxlen / 8); idx++) addr[idx] = (base ? base[idx] : bench_rand());
+
+  /* keep the first 'len' bits of a base prefix, randomize the rest */
+  if (base) {
+    for (idx = len; idx < maxlen; idx++) {
+      if (bench_rand() & 1) addr[idx / 8] ^= (0x80 >> (idx % 8));
+    }
+  }
+  else {
+    for (idx = len; idx < maxlen; idx++) addr[idx / 8] &= ~(0x80 >> (idx % 8));
+  }
+}
+
+/* a rough global routing table distribution */
+u_int8_t bench_bgp_prefixlen(afi_t afi)
+{
+  u_int32_t r = (bench_rand() % 100);
+
+  if (afi == AFI_IP) {
+    if (r < 60) return 24;
+    if (r < 90) return (16 + (bench_rand() % 8));
+    return (8 + (bench_rand() % 8));
+  }
+  else {
+    if (r < 50) return 48;
+    if (r < 85) return (32 + (bench_rand() % 16));
+    return (19 + (bench_rand() % 13));
+  }
+}
+
+/* same as bgp_route_info_modulo_pathid() for routes without a path-id */
+u_int32_t bench_bgp_modulo(struct bgp_peer *peer, rd_t *rd, path_id_t *path_id, struct bgp_msg_extra_data *bmed, int per_peer_buckets)
+{
+  return (((peer->fd * per_peer_buckets) % (bench_bgp_misc_db.table_peer_buckets * per_peer_buckets)));
+}
+
+int bench_bgp_cmp(struct bgp_info *info, struct node_match_cmp_term2 *nmct2)
+{
+  return (info->peer != nmct2->peer);
+}
+
+static int bench_bgp_node_is_empty(struct bgp_node *rn)
+{
+  u_int32_t ri_idx;
+
+  for (ri_idx = 0; ri_idx < (bench_bgp_misc_db.table_peer_buckets * bench_bgp_misc_db.table_per_peer_buckets); ri_idx++) {
+    if (rn->info[ri_idx]) return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void bench_bgp_route_free(void *ptr, void *arg)
+{
+  struct bench_route *route = ptr;
+
+  route->magic = BENCH_ROUTE_DEAD;
+  free(route);
+}
+
+/* adds a route of 'peer' for 'p'; NULL if 'peer' has one already */
+struct bgp_info *bench_bgp_route_add(struct bgp_peer *peer, struct bgp_table *table, struct prefix *p)
+{
+  struct bench_route *route;
+  struct bgp_node *rn;
+  struct bgp_info *ri;
+  u_int32_t modulo;
+  int lpm_add;
+
+  rn = bgp_node_get(peer, table, p);
+  modulo = bench_bgp_modulo(peer, NULL, NULL, NULL, 1);
+
+  for (ri = rn->info[modulo]; ri; ri = ri->next) {
+    if (ri->peer == peer) {
+      bgp_unlock_node(peer, rn);
+      return NULL;
+    }
+  }
+
+  route = calloc(1, sizeof(struct bench_route));
+  if (!route) exit_gracefully(1);
+
+  route->magic = BENCH_ROUTE_ALIVE;
+  ri = &route->info;
+  ri->peer = peer;
+  ri->node = rn;
+  ri->next = rn->info[modulo];
+  if (ri->next) ri->next->prev = ri;
+
+  lpm_add = (table->lpm && bench_bgp_node_is_empty(rn));
+
+  /* the lock taken by bgp_node_get() is held by the route from now on */
+  __sync_synchronize();
+  rn->info[modulo] = ri;
+
+  if (lpm_add) bgp_lpm_route_add(table->lpm, rn);
+
+  return ri;
+}
+
+void bench_bgp_route_delete(struct bgp_peer *peer, struct bgp_info *ri)
+{
+  struct bgp_node *rn = ri->node, *repl;
+  u_int32_t modulo = bench_bgp_modulo(peer, NULL, NULL, NULL, 1);
+
+  if (ri->next) ri->next->prev = ri->prev;
+  if (ri->prev) ri->prev->next = ri->next;
+  else rn->info[modulo] = ri->next;
+
+  if (rn->table->lpm && bench_bgp_node_is_empty(rn)) {
+    for (repl = rn->parent; repl && bench_bgp_node_is_empty(repl); repl = repl->parent);
+    bgp_lpm_route_delete(rn->table->lpm, rn, repl);
+  }
+
+  bgp_epoch_defer(bench_bgp_route_free, ri, NULL);
+  bgp_unlock_node(peer, rn);
+}
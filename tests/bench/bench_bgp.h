@@ -0,0 +1,56 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef BENCH_BGP_H
+#define BENCH_BGP_H
+
+/*
+   A minimal BGP RIB for the benchmarks: tables are the real bgp_table /
+   bgp_lpm / bgp_epoch code, routes are linked and unlinked the same way
+   bgp_info_add() and bgp_info_delete() do (without attributes), which
+   spares linking the whole BGP daemon.
+*/
+
+/* defines */
+#define BENCH_ROUTE_ALIVE	0xA11CEA11
+#define BENCH_ROUTE_DEAD	0xDEADDEAD
+
+/* structures */
+struct bench_route {
+  struct bgp_info info;		/* must be first */
+  volatile u_int32_t magic;
+};
+
+/* global variables */
+extern struct bgp_peer *bench_bgp_peers;
+
+/* prototypes */
+extern void bench_bgp_init(int);
+extern struct bgp_table *bench_bgp_table_init(afi_t, int);
+extern struct bgp_info *bench_bgp_route_add(struct bgp_peer *, struct bgp_table *, struct prefix *);
+extern void bench_bgp_route_delete(struct bgp_peer *, struct bgp_info *);
+extern void bench_bgp_prefix(struct prefix *, afi_t, u_int8_t, u_char *);
+extern u_int8_t bench_bgp_prefixlen(afi_t);
+extern u_int32_t bench_bgp_modulo(struct bgp_peer *, rd_t *, path_id_t *, struct bgp_msg_extra_data *, int);
+extern int bench_bgp_cmp(struct bgp_info *, struct node_match_cmp_term2 *);
+
+#endif // BENCH_BGP_H
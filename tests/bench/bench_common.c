@@ -0,0 +1,71 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* includes */
+#include "pmacct.h"
+#include "bench_common.h"
+
+/* global variables */
+struct configuration config;
+
+static u_int64_t bench_rand_state = 88172645463325252ULL;
+
+/* functions */
+void Log(short int level, char *msg, ...)
+{
+  va_list ap;
+
+  if (level > LOG_NOTICE && !config.debug) return;
+
+  va_start(ap, msg);
+  vfprintf(stderr, msg, ap);
+  va_end(ap);
+}
+
+void exit_gracefully(int status)
+{
+  exit(status);
+}
+
+double bench_now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+void bench_srand(u_int64_t seed)
+{
+  bench_rand_state = (seed ? seed : 88172645463325252ULL);
+}
+
+/* xorshift64: fast and reproducible across runs and hosts */
+u_int32_t bench_rand()
+{
+  bench_rand_state ^= (bench_rand_state << 13);
+  bench_rand_state ^= (bench_rand_state >> 7);
+  bench_rand_state ^= (bench_rand_state << 17);
+
+  return (u_int32_t) bench_rand_state;
+}
@@ -0,0 +1,37 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+/*
+   Support code for the benchmarks: they link a handful of pmacct sources
+   rather than the daemons libraries, so the few globals those sources need
+   (config, Log(), exit_gracefully()) are provided here.
+*/
+
+/* prototypes */
+extern double bench_now();
+extern void bench_srand(u_int64_t);
+extern u_int32_t bench_rand();
+
+#endif // BENCH_COMMON_H
@@ -0,0 +1,223 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/*
+   Microbenchmark of the batched src/dst route lookups against the scalar
+   path, on a table fronted by the LPM index. Flows come in flowsets of
+   -r records from a random exporter (peer) each, as nfacctd sees them:
+   the scalar path runs bgp_node_match() for the src and dst address of
+   every record; the batched path walks the LPM index for the whole
+   flowset with bgp_lpm_lookup_batch() and then resolves each address via
+   bgp_node_match_hint(), as bgp_srcdst_lookup() does when handed a batch.
+   The LPM index walk alone is reported too. Results must be identical.
+
+   Usage: bgp-batch-bench [-6] [-n prefixes] [-p peers] [-q flows] [-r records]
+*/
+
+/* includes */
+#include "pmacct.h"
+#include "bgp/bgp.h"
+#include "bench_common.h"
+#include "bench_bgp.h"
+
+/* defines */
+#define BATCH_BENCH_ROUNDS	5
+
+/* global variables */
+static struct bgp_table *batch_table;
+static struct prefix *batch_queries;
+static int batch_queries_num = 2000000, batch_records = 30, batch_peers = 4;
+
+/* functions */
+static void batch_bench_match(struct prefix *p, struct bgp_node *hint, int hinted, struct bgp_peer *peer,
+			      struct bgp_node **node)
+{
+  struct node_match_cmp_term2 nmct2;
+  struct bgp_info *info;
+
+  memset(&nmct2, 0, sizeof(nmct2));
+  nmct2.peer = peer;
+  nmct2.afi = batch_table->afi;
+  nmct2.safi = SAFI_UNICAST;
+  nmct2.p = p;
+
+  if (hinted) bgp_node_match_hint(batch_table, p, hint, peer, bench_bgp_modulo, bench_bgp_cmp, &nmct2, NULL, node, &info);
+  else bgp_node_match(batch_table, p, peer, bench_bgp_modulo, bench_bgp_cmp, &nmct2, NULL, node, &info);
+}
+
+static double batch_bench_scalar(struct bgp_node **results)
+{
+  double start = bench_now();
+  int round, idx;
+
+  for (round = 0; round < BATCH_BENCH_ROUNDS; round++) {
+    for (idx = 0; idx < batch_queries_num; idx++) {
+      batch_bench_match(&batch_queries[idx], NULL, FALSE, &bench_bgp_peers[(idx / (2 * batch_records)) % batch_peers], &results[idx]);
+    }
+  }
+
+  return (bench_now() - start);
+}
+
+static double batch_bench_batched(struct bgp_node **results)
+{
+  struct prefix *p[BGP_LPM_BATCH_MAX];
+  struct bgp_node *hint[BGP_LPM_BATCH_MAX];
+  double start = bench_now();
+  int round, idx, num, batch;
+
+  for (round = 0; round < BATCH_BENCH_ROUNDS; round++) {
+    for (idx = 0; idx < batch_queries_num; idx += num) {
+      num = MIN((2 * batch_records), (batch_queries_num - idx));
+
+      for (batch = 0; batch < num; batch++) p[batch] = &batch_queries[idx + batch];
+      bgp_lpm_lookup_batch(batch_table->lpm, p, hint, num);
+
+      for (batch = 0; batch < num; batch++) {
+	batch_bench_match(p[batch], hint[batch], TRUE, &bench_bgp_peers[(idx / (2 * batch_records)) % batch_peers],
+			  &results[idx + batch]);
+      }
+    }
+  }
+
+  return (bench_now() - start);
+}
+
+static double batch_bench_walk(int batched, struct bgp_node **results)
+{
+  struct prefix *p[BGP_LPM_BATCH_MAX];
+  double start = bench_now();
+  int round, idx, num, batch;
+
+  for (round = 0; round < BATCH_BENCH_ROUNDS; round++) {
+    for (idx = 0; idx < batch_queries_num; idx += num) {
+      num = MIN((2 * batch_records), (batch_queries_num - idx));
+
+      if (batched) {
+	for (batch = 0; batch < num; batch++) p[batch] = &batch_queries[idx + batch];
+	bgp_lpm_lookup_batch(batch_table->lpm, p, &results[idx], num);
+      }
+      else {
+	for (batch = 0; batch < num; batch++) results[idx + batch] = bgp_lpm_lookup(batch_table->lpm, &batch_queries[idx + batch]);
+      }
+    }
+  }
+
+  return (bench_now() - start);
+}
+
+static int batch_bench_compare(struct bgp_node **a, struct bgp_node **b)
+{
+  int idx, mismatches = 0;
+
+  for (idx = 0; idx < batch_queries_num; idx++) {
+    if (a[idx] != b[idx]) mismatches++;
+  }
+
+  return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+  struct prefix *prefixes;
+  struct bgp_node **res_a, **res_b;
+  afi_t afi = AFI_IP;
+  int prefixes_num = 500000, idx, peer, cp, mismatches;
+  double t_a, t_b, lookups;
+
+  while ((cp = getopt(argc, argv, "6n:p:q:r:")) != -1) {
+    switch (cp) {
+    case '6':
+      afi = AFI_IP6;
+      break;
+    case 'n':
+      prefixes_num = atoi(optarg);
+      break;
+    case 'p':
+      batch_peers = atoi(optarg);
+      break;
+    case 'q':
+      batch_queries_num = (2 * atoi(optarg));
+      break;
+    case 'r':
+      batch_records = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-6] [-n prefixes] [-p peers] [-q flows] [-r records]\n", argv[0]);
+      exit(1);
+    }
+  }
+
+  if (prefixes_num <= 0 || batch_peers <= 0 || batch_queries_num <= 0 || batch_records <= 0 || (2 * batch_records) > BGP_LPM_BATCH_MAX) {
+    fprintf(stderr, "ERROR: invalid arguments (records: 1-%u)\n", (BGP_LPM_BATCH_MAX / 2));
+    exit(1);
+  }
+
+  bench_bgp_init(batch_peers);
+
+  prefixes = calloc(prefixes_num, sizeof(struct prefix));
+  batch_queries = calloc(batch_queries_num, sizeof(struct prefix));
+  res_a = calloc(batch_queries_num, sizeof(struct bgp_node *));
+  res_b = calloc(batch_queries_num, sizeof(struct bgp_node *));
+  if (!prefixes || !batch_queries || !res_a || !res_b) exit_gracefully(1);
+
+  for (idx = 0; idx < prefixes_num; idx++) {
+    bench_bgp_prefix(&prefixes[idx], afi, bench_bgp_prefixlen(afi), NULL);
+  }
+
+  /* half of the addresses within a loaded prefix, half random */
+  for (idx = 0; idx < batch_queries_num; idx++) {
+    if (idx & 1) bench_bgp_prefix(&batch_queries[idx], afi, (afi == AFI_IP ? 32 : 128), NULL);
+    else {
+      struct prefix *base = &prefixes[bench_rand() % prefixes_num];
+
+      bench_bgp_prefix(&batch_queries[idx], afi, base->prefixlen, (u_char *) &base->u.prefix);
+      batch_queries[idx].prefixlen = (afi == AFI_IP ? 32 : 128);
+    }
+  }
+
+  batch_table = bench_bgp_table_init(afi, TRUE);
+
+  for (peer = 0; peer < batch_peers; peer++) {
+    for (idx = 0; idx < prefixes_num; idx++) bench_bgp_route_add(&bench_bgp_peers[peer], batch_table, &prefixes[idx]);
+  }
+
+  lookups = ((double) batch_queries_num * BATCH_BENCH_ROUNDS / 1e6);
+  printf("%s: %d prefixes x %d peers, %d flows in flowsets of %d records\n",
+	 (afi == AFI_IP ? "IPv4" : "IPv6"), prefixes_num, batch_peers, (batch_queries_num / 2), batch_records);
+
+  t_a = batch_bench_walk(FALSE, res_a);
+  t_b = batch_bench_walk(TRUE, res_b);
+  mismatches = batch_bench_compare(res_a, res_b);
+  printf("LPM index walk:  scalar %8.2f Mlookups/s, batched %8.2f Mlookups/s (%.2fx)\n",
+	 (lookups / t_a), (lookups / t_b), (t_a / t_b));
+
+  t_a = batch_bench_scalar(res_a);
+  t_b = batch_bench_batched(res_b);
+  mismatches += batch_bench_compare(res_a, res_b);
+  printf("src/dst lookups: scalar %8.2f Mlookups/s, batched %8.2f Mlookups/s (%.2fx)\n",
+	 (lookups / t_a), (lookups / t_b), (t_a / t_b));
+
+  printf("mismatches: %d\n", mismatches);
+
+  return (mismatches != 0);
+}
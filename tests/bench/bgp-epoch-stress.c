@@ -0,0 +1,237 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/*
+   Stress test for the lock-less RIB readers (see bgp_epoch.h): a writer
+   thread floods a table with route announcements and withdrawals while
+   reader threads run bgp_node_match() for random addresses, as the Core
+   Process does for flow enrichment. A set of covering routes is never
+   withdrawn, so every lookup must return a live route of the right peer
+   whose prefix contains the address: anything else is a torn read or a
+   route released before a grace period. Run once walking the tree and
+   once via the LPM index. Building with -fsanitize=address also catches
+   nodes freed too early.
+
+   Usage: bgp-epoch-stress [-s seconds] [-r readers] [-n prefixes]
+*/
+
+/* includes */
+#include "pmacct.h"
+#include "bgp/bgp.h"
+#include "bench_common.h"
+#include "bench_bgp.h"
+
+/* defines */
+#define STRESS_PEERS		4
+#define STRESS_LOOKUP_BATCH	64	/* lookups per reader epoch, ie. a datagram */
+#define STRESS_RECLAIM_EVERY	256	/* updates per writer event loop iteration */
+
+/* structures */
+struct stress_reader {
+  pthread_t thread;
+  u_int64_t seed;
+  u_int64_t lookups;
+  u_int64_t errors;
+};
+
+/* global variables */
+static struct bgp_table *stress_table;
+static struct prefix *stress_prefixes;
+static struct bgp_info **stress_routes;
+static struct bgp_info *stress_covering[STRESS_PEERS * 257];
+static int stress_covering_num;
+static int stress_prefixes_num = 100000;
+static volatile int stress_stop;
+
+/* functions */
+static void stress_prefix(struct prefix *p, u_int32_t addr, u_int8_t len)
+{
+  memset(p, 0, sizeof(struct prefix));
+  p->family = AF_INET;
+  p->prefixlen = len;
+  p->u.prefix4.s_addr = htonl(len ? (addr & (0xffffffffU << (32 - len))) : 0);
+}
+
+static void *stress_reader_thread(void *arg)
+{
+  struct stress_reader *sr = arg;
+  struct bgp_epoch_reader *reader = bgp_epoch_reader_register();
+  struct node_match_cmp_term2 nmct2;
+  struct bgp_node *node;
+  struct bgp_info *info;
+  struct prefix p;
+  u_int64_t x = sr->seed;
+  int idx;
+
+  if (!reader) return NULL;
+
+  while (!stress_stop) {
+    bgp_epoch_online(reader);
+
+    for (idx = 0; idx < STRESS_LOOKUP_BATCH; idx++) {
+      x ^= (x << 13); x ^= (x >> 7); x ^= (x << 17);
+
+      stress_prefix(&p, (u_int32_t) x, 32);
+      memset(&nmct2, 0, sizeof(nmct2));
+      nmct2.peer = &bench_bgp_peers[(x >> 32) % STRESS_PEERS];
+      nmct2.afi = AFI_IP;
+      nmct2.safi = SAFI_UNICAST;
+      nmct2.p = &p;
+
+      bgp_node_match(stress_table, &p, nmct2.peer, bench_bgp_modulo, bench_bgp_cmp, &nmct2, NULL, &node, &info);
+
+      if (!info || !node || ((struct bench_route *) info)->magic != BENCH_ROUTE_ALIVE ||
+	  info->peer != nmct2.peer || info->node != node || !prefix_match(&node->p, &p)) {
+	sr->errors++;
+      }
+
+      sr->lookups++;
+    }
+
+    bgp_epoch_offline(reader);
+  }
+
+  bgp_epoch_reader_unregister(reader);
+
+  return NULL;
+}
+
+static int stress_run(int lpm_index, int seconds, int readers)
+{
+  struct stress_reader *sr;
+  struct prefix p;
+  u_int64_t updates = 0, lookups = 0, errors = 0;
+  double start, elapsed;
+  int idx, peer;
+
+  stress_table = bench_bgp_table_init(AFI_IP, lpm_index);
+
+  /* covering routes, never withdrawn: every lookup has an answer */
+  for (peer = 0, stress_covering_num = 0; peer < STRESS_PEERS; peer++) {
+    stress_prefix(&p, 0, 0);
+    stress_covering[stress_covering_num++] = bench_bgp_route_add(&bench_bgp_peers[peer], stress_table, &p);
+
+    for (idx = 0; idx < 256; idx += (peer + 1)) {
+      stress_prefix(&p, ((u_int32_t) idx << 24), 8);
+      stress_covering[stress_covering_num++] = bench_bgp_route_add(&bench_bgp_peers[peer], stress_table, &p);
+    }
+  }
+
+  memset(stress_routes, 0, (stress_prefixes_num * STRESS_PEERS * sizeof(struct bgp_info *)));
+
+  sr = calloc(readers, sizeof(struct stress_reader));
+  if (!sr) exit_gracefully(1);
+
+  stress_stop = FALSE;
+  for (idx = 0; idx < readers; idx++) {
+    sr[idx].seed = (0x9E3779B97F4A7C15ULL * (idx + 1));
+    pthread_create(&sr[idx].thread, NULL, stress_reader_thread, &sr[idx]);
+  }
+
+  /* UPDATE flood: toggle random (prefix, peer) pairs */
+  start = bench_now();
+  while ((elapsed = (bench_now() - start)) < seconds) {
+    for (idx = 0; idx < STRESS_RECLAIM_EVERY; idx++, updates++) {
+      u_int32_t slot = (bench_rand() % (stress_prefixes_num * STRESS_PEERS));
+      struct bgp_peer *bp = &bench_bgp_peers[slot % STRESS_PEERS];
+
+      if (stress_routes[slot]) {
+	bench_bgp_route_delete(bp, stress_routes[slot]);
+	stress_routes[slot] = NULL;
+      }
+      else stress_routes[slot] = bench_bgp_route_add(bp, stress_table, &stress_prefixes[slot / STRESS_PEERS]);
+    }
+
+    bgp_epoch_reclaim();
+  }
+
+  stress_stop = TRUE;
+  for (idx = 0; idx < readers; idx++) {
+    pthread_join(sr[idx].thread, NULL);
+    lookups += sr[idx].lookups;
+    errors += sr[idx].errors;
+  }
+
+  /* withdraw everything: the table must end up empty */
+  for (idx = 0; idx < (stress_prefixes_num * STRESS_PEERS); idx++) {
+    if (stress_routes[idx]) bench_bgp_route_delete(&bench_bgp_peers[idx % STRESS_PEERS], stress_routes[idx]);
+  }
+
+  for (idx = 0; idx < stress_covering_num; idx++) {
+    bench_bgp_route_delete(stress_covering[idx]->peer, stress_covering[idx]);
+  }
+
+  bgp_epoch_reclaim();
+
+  printf("%-16s %10.0f updates/s %10.0f lookups/s (%d readers)  errors: %" PRIu64 "  nodes left: %lu\n",
+	 lpm_index ? "LPM index:" : "Patricia walk:", (updates / elapsed), (lookups / elapsed), readers,
+	 errors, stress_table->count);
+
+  idx = (errors || stress_table->count);
+
+  bgp_table_free(stress_table);
+  free(sr);
+
+  return idx;
+}
+
+int main(int argc, char **argv)
+{
+  int seconds = 10, readers = 4, idx, cp, ret = 0;
+
+  while ((cp = getopt(argc, argv, "s:r:n:")) != -1) {
+    switch (cp) {
+    case 's':
+      seconds = atoi(optarg);
+      break;
+    case 'r':
+      readers = atoi(optarg);
+      break;
+    case 'n':
+      stress_prefixes_num = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-s seconds] [-r readers] [-n prefixes]\n", argv[0]);
+      exit(1);
+    }
+  }
+
+  if (seconds <= 0 || stress_prefixes_num <= 0 || readers <= 0 || readers >= BGP_EPOCH_MAX_READERS) {
+    fprintf(stderr, "ERROR: invalid arguments (readers: 1-%u)\n", (BGP_EPOCH_MAX_READERS - 1));
+    exit(1);
+  }
+
+  bench_bgp_init(STRESS_PEERS);
+
+  stress_prefixes = calloc(stress_prefixes_num, sizeof(struct prefix));
+  stress_routes = malloc(stress_prefixes_num * STRESS_PEERS * sizeof(struct bgp_info *));
+  if (!stress_prefixes || !stress_routes) exit_gracefully(1);
+
+  for (idx = 0; idx < stress_prefixes_num; idx++) {
+    stress_prefix(&stress_prefixes[idx], bench_rand(), (9 + (bench_rand() % 24)));
+  }
+
+  ret |= stress_run(FALSE, seconds, readers);
+  ret |= stress_run(TRUE, seconds, readers);
+
+  return ret;
+}
@@ -0,0 +1,155 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/*
+   Microbenchmark of bgp_node_match(), ie. the route lookup behind flow
+   enrichment: the same routes are loaded in two tables, one walked as a
+   Patricia tree and one fronted by the LPM index (bgp_table_lpm_index),
+   then both are queried for the same host addresses, for a random peer
+   each. Half of the addresses fall within a loaded prefix, half are
+   random. Results must be identical.
+
+   Usage: bgp-lpm-bench [-6] [-n prefixes] [-p peers] [-q lookups]
+*/
+
+/* includes */
+#include "pmacct.h"
+#include "bgp/bgp.h"
+#include "bench_common.h"
+#include "bench_bgp.h"
+
+/* defines */
+#define LPM_BENCH_ROUNDS	5
+
+/* functions */
+static double lpm_bench_run(struct bgp_table *table, struct prefix *queries, int queries_num,
+			    int peers, struct bgp_node **results)
+{
+  struct node_match_cmp_term2 nmct2;
+  struct bgp_info *info;
+  double start;
+  int round, idx;
+
+  start = bench_now();
+
+  for (round = 0; round < LPM_BENCH_ROUNDS; round++) {
+    for (idx = 0; idx < queries_num; idx++) {
+      memset(&nmct2, 0, sizeof(nmct2));
+      nmct2.peer = &bench_bgp_peers[idx % peers];
+      nmct2.afi = table->afi;
+      nmct2.safi = SAFI_UNICAST;
+      nmct2.p = &queries[idx];
+
+      bgp_node_match(table, &queries[idx], nmct2.peer, bench_bgp_modulo, bench_bgp_cmp, &nmct2, NULL,
+		     &results[idx], &info);
+    }
+  }
+
+  return (bench_now() - start);
+}
+
+int main(int argc, char **argv)
+{
+  struct bgp_table *tree, *indexed;
+  struct prefix *prefixes, *queries;
+  struct bgp_node **res_tree, **res_indexed;
+  afi_t afi = AFI_IP;
+  int prefixes_num = 500000, peers = 4, queries_num = 1000000;
+  int idx, peer, cp, mismatches = 0;
+  double t_tree, t_indexed, start;
+
+  while ((cp = getopt(argc, argv, "6n:p:q:")) != -1) {
+    switch (cp) {
+    case '6':
+      afi = AFI_IP6;
+      break;
+    case 'n':
+      prefixes_num = atoi(optarg);
+      break;
+    case 'p':
+      peers = atoi(optarg);
+      break;
+    case 'q':
+      queries_num = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-6] [-n prefixes] [-p peers] [-q lookups]\n", argv[0]);
+      exit(1);
+    }
+  }
+
+  if (prefixes_num <= 0 || peers <= 0 || queries_num <= 0) {
+    fprintf(stderr, "ERROR: invalid arguments\n");
+    exit(1);
+  }
+
+  bench_bgp_init(peers);
+
+  prefixes = calloc(prefixes_num, sizeof(struct prefix));
+  queries = calloc(queries_num, sizeof(struct prefix));
+  res_tree = calloc(queries_num, sizeof(struct bgp_node *));
+  res_indexed = calloc(queries_num, sizeof(struct bgp_node *));
+  if (!prefixes || !queries || !res_tree || !res_indexed) exit_gracefully(1);
+
+  for (idx = 0; idx < prefixes_num; idx++) {
+    bench_bgp_prefix(&prefixes[idx], afi, bench_bgp_prefixlen(afi), NULL);
+  }
+
+  for (idx = 0; idx < queries_num; idx++) {
+    if (idx & 1) bench_bgp_prefix(&queries[idx], afi, (afi == AFI_IP ? 32 : 128), NULL);
+    else {
+      struct prefix *base = &prefixes[bench_rand() % prefixes_num];
+
+      bench_bgp_prefix(&queries[idx], afi, base->prefixlen, (u_char *) &base->u.prefix);
+      queries[idx].prefixlen = (afi == AFI_IP ? 32 : 128);
+    }
+  }
+
+  tree = bench_bgp_table_init(afi, FALSE);
+  indexed = bench_bgp_table_init(afi, TRUE);
+
+  start = bench_now();
+  for (peer = 0; peer < peers; peer++) {
+    for (idx = 0; idx < prefixes_num; idx++) {
+      bench_bgp_route_add(&bench_bgp_peers[peer], tree, &prefixes[idx]);
+      bench_bgp_route_add(&bench_bgp_peers[peer], indexed, &prefixes[idx]);
+    }
+  }
+
+  printf("%s: %d prefixes x %d peers loaded in %.1fs, LPM index nodes: %" PRIu64 "\n",
+	 (afi == AFI_IP ? "IPv4" : "IPv6"), prefixes_num, peers, (bench_now() - start), indexed->lpm->nodes);
+
+  t_tree = lpm_bench_run(tree, queries, queries_num, peers, res_tree);
+  t_indexed = lpm_bench_run(indexed, queries, queries_num, peers, res_indexed);
+
+  for (idx = 0; idx < queries_num; idx++) {
+    if (!res_tree[idx] != !res_indexed[idx]) mismatches++;
+    else if (res_tree[idx] && prefix_same(&res_tree[idx]->p, &res_indexed[idx]->p) != TRUE) mismatches++;
+  }
+
+  printf("Patricia walk: %8.2f Mlookups/s\n", (((double) queries_num * LPM_BENCH_ROUNDS) / t_tree / 1e6));
+  printf("LPM index:     %8.2f Mlookups/s (%.2fx)\n", (((double) queries_num * LPM_BENCH_ROUNDS) / t_indexed / 1e6),
+	 (t_tree / t_indexed));
+  printf("mismatches:    %d\n", mismatches);
+
+  return (mismatches != 0);
+}
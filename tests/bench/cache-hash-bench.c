@@ -0,0 +1,244 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2025 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/*
+   Benchmark of the aggregation cache hashing (see cache_hash.h) over
+   realistic primitive sets: for each set, random records are hashed the
+   way P_cache_hash() and search_accounting_structure() do, ie. the byte
+   ranges of struct pkt_primitives relevant to the aggregate plus the whole
+   BGP primitives blob, if any. Each available hash function is timed,
+   alongside the djb2 loop of cache_crc32() over the full key formerly in
+   use. Timings run over a cache resident window of records, as hashing
+   happens on records fresh from the plugin buffer; the distribution of
+   all records over a prime number of buckets is reported as chi-square
+   per degree of freedom (close to 1 means uniform).
+
+   Usage: cache-hash-bench [-q records]
+*/
+
+/* includes */
+#include "pmacct.h"
+#include "crc32.h"
+#include "cache_hash.h"
+#include "bench_common.h"
+
+/* defines */
+#define HASH_BENCH_ROUNDS	5
+#define HASH_BENCH_BUCKETS	32771
+#define HASH_BENCH_WINDOW	4096	/* records timed at once: cache resident, as in a plugin buffer */
+
+/* structures */
+struct hash_bench_set {
+  char *name;
+  pm_cfgreg_t wtc;
+  pm_cfgreg_t wtc_2;
+  int bgp;
+  void (*fill)(struct pkt_primitives *, struct pkt_bgp_primitives *);
+};
+
+struct hash_bench_func {
+  char *name;
+  cache_hash_func_t func;
+  int ranges;
+};
+
+/* functions */
+static void hash_bench_fill_v4(struct pkt_primitives *pp, struct pkt_bgp_primitives *pbgp)
+{
+  pp->src_ip.family = AF_INET;
+  pp->src_ip.address.ipv4.s_addr = bench_rand();
+  pp->dst_ip.family = AF_INET;
+  pp->dst_ip.address.ipv4.s_addr = (bench_rand() & htonl(0xffffff00));
+  pp->proto = ((bench_rand() % 3) ? IPPROTO_TCP : IPPROTO_UDP);
+}
+
+static void hash_bench_fill_v6(struct pkt_primitives *pp, struct pkt_bgp_primitives *pbgp)
+{
+  u_int32_t *addr;
+  int idx;
+
+  pp->src_ip.family = AF_INET6;
+  addr = (u_int32_t *) &pp->src_ip.address.ipv6;
+  for (idx = 0; idx < 4; idx++) addr[idx] = bench_rand();
+
+  pp->dst_ip.family = AF_INET6;
+  addr = (u_int32_t *) &pp->dst_ip.address.ipv6;
+  addr[0] = htonl(0x20010db8);
+  addr[1] = (bench_rand() % 256);
+
+  pp->src_port = bench_rand();
+  pp->dst_port = ((bench_rand() % 2) ? 443 : 53);
+  pp->proto = IPPROTO_TCP;
+  pp->ifindex_in = (bench_rand() % 64);
+  pp->ifindex_out = (bench_rand() % 64);
+}
+
+static void hash_bench_fill_nets(struct pkt_primitives *pp, struct pkt_bgp_primitives *pbgp)
+{
+  pp->src_net.family = AF_INET;
+  pp->src_nmask = (16 + (bench_rand() % 9));
+  pp->src_net.address.ipv4.s_addr = (bench_rand() & htonl(0xffffffff << (32 - pp->src_nmask)));
+  pp->dst_net.family = AF_INET;
+  pp->dst_nmask = (16 + (bench_rand() % 9));
+  pp->dst_net.address.ipv4.s_addr = (bench_rand() & htonl(0xffffffff << (32 - pp->dst_nmask)));
+}
+
+static void hash_bench_fill_bgp(struct pkt_primitives *pp, struct pkt_bgp_primitives *pbgp)
+{
+  pp->src_as = (bench_rand() % 70000);
+  pp->dst_as = (bench_rand() % 70000);
+  pp->ifindex_in = (bench_rand() % 64);
+  pbgp->peer_src_as = (bench_rand() % 1000);
+  pbgp->peer_dst_ip.family = AF_INET;
+  pbgp->peer_dst_ip.address.ipv4.s_addr = htonl(0x0a000000 | (bench_rand() % 100));
+}
+
+static struct hash_bench_set hash_bench_sets[] = {
+  { "src_host, dst_host, proto", (COUNT_SRC_HOST|COUNT_DST_HOST|COUNT_IP_PROTO), 0, FALSE, hash_bench_fill_v4 },
+  { "IPv6 5-tuple, in_iface, out_iface", (COUNT_SRC_HOST|COUNT_DST_HOST|COUNT_SRC_PORT|COUNT_DST_PORT|COUNT_IP_PROTO|
+					   COUNT_IN_IFACE|COUNT_OUT_IFACE), 0, FALSE, hash_bench_fill_v6 },
+  { "src_net, dst_net, src_mask, dst_mask", (COUNT_SRC_NET|COUNT_DST_NET|COUNT_SRC_NMASK|COUNT_DST_NMASK), 0, FALSE,
+    hash_bench_fill_nets },
+  { "src_as, dst_as, in_iface, peer_src_as, peer_dst_ip", (COUNT_SRC_AS|COUNT_DST_AS|COUNT_IN_IFACE|COUNT_PEER_SRC_AS|
+							   COUNT_PEER_DST_IP), 0, TRUE, hash_bench_fill_bgp },
+  { NULL, 0, 0, FALSE, NULL }
+};
+
+static u_int32_t hash_bench_djb2(const unsigned char *buf, unsigned int len, u_int32_t seed)
+{
+  return cache_crc32(buf, len);
+}
+
+static struct hash_bench_func hash_bench_funcs[] = {
+  { "djb2, full key", hash_bench_djb2, FALSE },
+  { "portable, full key", cache_hash_portable, FALSE },
+  { "portable, ranges", cache_hash_portable, TRUE },
+#if defined (__x86_64__) && defined (__GNUC__)
+  { "crc32c, full key", NULL, FALSE },
+  { "crc32c, ranges", NULL, TRUE },
+#endif
+  { NULL, NULL, FALSE }
+};
+
+/* same as P_cache_hash(), for the given function and ranges */
+static u_int32_t hash_bench_key(struct hash_bench_func *hf, struct cache_hash_ranges *r,
+				struct pkt_primitives *pp, struct pkt_bgp_primitives *pbgp)
+{
+  u_int32_t hash = CACHE_HASH_SEED;
+  int idx;
+
+  if (hf->ranges) {
+    for (idx = 0; idx < r->num; idx++) hash = hf->func(((u_char *) pp) + r->off[idx], r->len[idx], hash);
+  }
+  else hash = hf->func((u_char *) pp, sizeof(struct pkt_primitives), hash);
+
+  if (pbgp) hash ^= hf->func((u_char *) pbgp, sizeof(struct pkt_bgp_primitives), CACHE_HASH_SEED);
+
+  return hash;
+}
+
+int main(int argc, char **argv)
+{
+  struct pkt_primitives *pp;
+  struct pkt_bgp_primitives *pbgp;
+  struct hash_bench_set *hs;
+  struct hash_bench_func *hf;
+  struct cache_hash_ranges r;
+  u_int32_t *buckets, acc = 0;
+  int records = 1000000, idx, win, round, cp;
+  double start, elapsed, chi2, expected;
+
+  while ((cp = getopt(argc, argv, "q:")) != -1) {
+    switch (cp) {
+    case 'q':
+      records = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-q records]\n", argv[0]);
+      exit(1);
+    }
+  }
+
+  if (records <= 0) {
+    fprintf(stderr, "ERROR: invalid arguments\n");
+    exit(1);
+  }
+
+#if defined (__x86_64__) && defined (__GNUC__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2")) {
+    for (hf = hash_bench_funcs; hf->name; hf++) {
+      if (!hf->func) hf->func = cache_hash_crc32c;
+    }
+  }
+#endif
+
+  pp = malloc(records * sizeof(struct pkt_primitives));
+  pbgp = malloc(records * sizeof(struct pkt_bgp_primitives));
+  buckets = malloc(HASH_BENCH_BUCKETS * sizeof(u_int32_t));
+  if (!pp || !pbgp || !buckets) exit_gracefully(1);
+
+  printf("%d records, pkt_primitives: %zu bytes, pkt_bgp_primitives: %zu bytes\n", records,
+	 sizeof(struct pkt_primitives), sizeof(struct pkt_bgp_primitives));
+
+  for (hs = hash_bench_sets; hs->name; hs++) {
+    memset(pp, 0, (records * sizeof(struct pkt_primitives)));
+    memset(pbgp, 0, (records * sizeof(struct pkt_bgp_primitives)));
+    bench_srand(0);
+
+    for (idx = 0; idx < records; idx++) hs->fill(&pp[idx], &pbgp[idx]);
+
+    cache_hash_ranges_init(&r, hs->wtc, hs->wtc_2);
+
+    for (idx = 0, win = 0; idx < r.num; idx++) win += r.len[idx];
+    printf("\n%s (ranges: %d, %d bytes)\n", hs->name, r.num, win);
+
+    for (hf = hash_bench_funcs; hf->name; hf++) {
+      if (!hf->func) continue;
+
+      start = bench_now();
+      for (round = 0; round < HASH_BENCH_ROUNDS; round++) {
+	for (idx = 0; idx < records; idx++) {
+	  win = (idx % HASH_BENCH_WINDOW);
+	  acc += hash_bench_key(hf, &r, &pp[win], (hs->bgp ? &pbgp[win] : NULL));
+	}
+      }
+      elapsed = (bench_now() - start);
+
+      memset(buckets, 0, (HASH_BENCH_BUCKETS * sizeof(u_int32_t)));
+      for (idx = 0; idx < records; idx++) {
+	buckets[hash_bench_key(hf, &r, &pp[idx], (hs->bgp ? &pbgp[idx] : NULL)) % HASH_BENCH_BUCKETS]++;
+      }
+
+      expected = ((double) records / HASH_BENCH_BUCKETS);
+      for (idx = 0, chi2 = 0; idx < HASH_BENCH_BUCKETS; idx++) {
+	chi2 += (((buckets[idx] - expected) * (buckets[idx] - expected)) / expected);
+      }
+
+      printf("  %-20s %8.1f ns/record  chi2/df: %.2f\n", hf->name,
+	     ((elapsed * 1e9) / ((double) records * HASH_BENCH_ROUNDS)), (chi2 / (HASH_BENCH_BUCKETS - 1)));
+    }
+  }
+
+  /* keeps the timed loops from being optimized out */
+  return (acc == 42);
+}
@@ -0,0 +1,93 @@
+#!/bin/sh
+#
+# Replays a NetFlow v9/IPFIX capture through nfacctd twice, with the
+# precompiled per-template decode programs (see compose_template_progs())
+# and with the generic path ('nfacctd_disable_decode_programs: true'),
+# and reports the CPU time spent by the Core Process in each run.
+#
+# An 'aggregate_filter' is configured so that the BPF fake packet, the
+# main user of the decode programs, is built for every record. Plugins
+# run in their own processes and are not accounted for.
+#
+# Usage: nfv9-decode-programs.sh [nfacctd binary] [pcap file] [replays]
+
+NFACCTD=${1:-$(dirname "$0")/../../src/nfacctd}
+PCAP=${2:-$(dirname "$0")/../100-IPFIXv10-CISCO/traffic-00.pcap}
+REPLAYS=${3:-20000}
+TIMEOUT=600
+
+WORKDIR=$(mktemp -d /tmp/pmacct-bench.XXXXXX) || exit 1
+trap 'rm -rf "$WORKDIR"' EXIT
+
+if [ ! -x "$NFACCTD" ]; then
+  echo "ERROR: nfacctd binary not found: $NFACCTD" >&2
+  exit 1
+fi
+
+if [ ! -r "$PCAP" ]; then
+  echo "ERROR: pcap file not found: $PCAP" >&2
+  exit 1
+fi
+
+CLK_TCK=$(getconf CLK_TCK)
+
+# run_once <disable_decode_programs> : prints Core Process CPU seconds
+run_once() {
+  CONF="$WORKDIR/nfacctd-$1.conf"
+  LOG="$WORKDIR/nfacctd-$1.log"
+  PIDFILE="$WORKDIR/nfacctd-$1.pid"
+
+  cat > "$CONF" <<EOF
+daemonize: false
+logfile: $LOG
+pidfile: $PIDFILE
+!
+pcap_savefile: $PCAP
+pcap_savefile_replay: $REPLAYS
+pcap_savefile_wait: true
+nfacctd_disable_decode_programs: $1
+!
+plugins: print[bench]
+aggregate[bench]: src_host, dst_host, src_port, dst_port, proto, tos
+aggregate_filter[bench]: ip or ip6
+print_output_file[bench]: /dev/null
+print_refresh_time[bench]: 3600
+EOF
+
+  "$NFACCTD" -f "$CONF" > /dev/null 2>&1 &
+  DAEMON=$!
+
+  # the Core Process logs this and then idles until signalled
+  ELAPSED=0
+  while ! grep -q "finished reading PCAP capture file" "$LOG" 2> /dev/null; do
+    if ! kill -0 "$DAEMON" 2> /dev/null || [ "$ELAPSED" -ge "$TIMEOUT" ]; then
+      echo "ERROR: nfacctd did not complete the replay, see below:" >&2
+      cat "$LOG" >&2
+      kill "$DAEMON" 2> /dev/null
+      return 1
+    fi
+
+    sleep 1
+    ELAPSED=$((ELAPSED + 1))
+  done
+
+  CORE=$(cat "$PIDFILE")
+  # utime and stime, fields 14 and 15 of /proc/<pid>/stat
+  TICKS=$(awk '{ print $14 + $15 }' "/proc/$CORE/stat")
+
+  kill -INT "$DAEMON"
+  wait "$DAEMON" 2> /dev/null
+
+  echo "$TICKS $CLK_TCK" | awk '{ printf "%.2f\n", $1 / $2 }'
+}
+
+echo "nfacctd: $NFACCTD"
+echo "capture: $PCAP, replayed $REPLAYS times"
+
+PROGS=$(run_once false) || exit 1
+echo "Core Process CPU time, decode programs: ${PROGS}s"
+
+GENERIC=$(run_once true) || exit 1
+echo "Core Process CPU time, generic path:    ${GENERIC}s"
+
+echo "$GENERIC $PROGS" | awk '$2 > 0 { printf "speed-up: %.2fx\n", $1 / $2 }'